@@ -23,6 +23,7 @@
 #include "CCConfiguration.h"
 #include "ccMacros.h"
 #include "ccConfig.h"
+#include "CCDirector.h"
 #include <string.h>
 using namespace std;
 NS_CC_BEGIN
@@ -32,6 +33,7 @@ CCConfiguration::CCConfiguration(void)
 :m_nMaxTextureSize(0) 
 , m_nMaxModelviewStackDepth(0)
 , m_bSupportsPVRTC(false)
+, m_nSupportsBCTextures(-1)
 , m_bSupportsNPOT(false)
 , m_bSupportsBGRA8888(false)
 , m_bSupportsDiscardFramebuffer(false)
@@ -83,6 +85,22 @@ bool CCConfiguration::init(void)
 	return true;
 }
 
+bool CCConfiguration::isSupportsBCTextures(void)
+{
+	// the configuration can be read before the device exists, so it is only asked on first use
+	if (m_nSupportsBCTextures < 0)
+	{
+		UINT uBC1Support = 0, uBC3Support = 0;
+		UINT uRequired = D3D11_FORMAT_SUPPORT_TEXTURE2D | D3D11_FORMAT_SUPPORT_SHADER_SAMPLE | D3D11_FORMAT_SUPPORT_MIP;
+		bool bSupported = SUCCEEDED(CCID3D11Device->CheckFormatSupport(DXGI_FORMAT_BC1_UNORM, &uBC1Support))
+			&& SUCCEEDED(CCID3D11Device->CheckFormatSupport(DXGI_FORMAT_BC3_UNORM, &uBC3Support))
+			&& (uBC1Support & uRequired) == uRequired && (uBC3Support & uRequired) == uRequired;
+		m_nSupportsBCTextures = bSupported ? 1 : 0;
+		CCLOG("cocos2d: D3D supports BC1/BC3 textures: %s", (bSupported ? "YES" : "NO"));
+	}
+	return m_nSupportsBCTextures == 1;
+}
+
 CCGlesVersion CCConfiguration::getGlesVersion()
 {
 	// To get the Opengl ES version
@@ -39,6 +39,15 @@
 #include "CCLabelBMFont.h"
 #include "CCActionManager.h"
 #include "CCLabelTTF.h"
+#include "CCGlyphAtlasCache.h"
+#include "CCRuntimeAtlas.h"
+#include "CCGPUUploadQueue.h"
+#include "CCDrawingPrimitives.h"
+#include "CCRenderQueue.h"
+#include "CCRenderPipeline.h"
+#include "CCShaderCache.h"
+#include "ccDXStateCache.h"
+#include "CCTextLayoutCache.h"
 #include "CCConfiguration.h"
 #include "CCKeypadDispatcher.h"
 #include "CCGL.h"
@@ -105,6 +114,12 @@ bool CCDirector::init(void)
 	m_bDisplayStats = false;
 	m_uTotalFrames = m_uFrames = 0;
 	m_pszFPS = new char[10];
+#if CC_DIRECTOR_FAST_FPS
+	m_pFPSLabel = NULL;
+#endif
+	m_pSPFLabel = NULL;
+	m_pDrawsLabel = NULL;
+	m_pStateLabel = NULL;
 	m_pLastUpdate = new struct cc_timeval();
 
 	// paused ?
@@ -152,6 +167,7 @@ CCDirector::~CCDirector(void)
 #if CC_DIRECTOR_FAST_FPS
 	CC_SAFE_RELEASE(m_pFPSLabel);
 #endif 
+	CC_SAFE_RELEASE(m_pStateLabel);
     
 	CC_SAFE_RELEASE(m_pRunningScene);
 	CC_SAFE_RELEASE(m_pNotificationNode);
@@ -215,6 +231,9 @@ void CCDirector::drawScene(void)
 	{
 		setNextScene();
 	}
+	// create the textures queued for upload, within the budget of the frame, before they are drawn
+	CCGPUUploadQueue::sharedGPUUploadQueue()->processUploads();
+
 	m_pobOpenGLView->D3DPushMatrix();
 
 	applyOrientation();
@@ -222,6 +241,9 @@ void CCDirector::drawScene(void)
 	// By default enable VertexArray, ColorArray, TextureCoordArray and Texture2D
 
 	// draw the scene
+	CCNode::resetCullingStats();
+	CCRenderQueue::sharedRenderQueue()->resetStats();
+	ccDXResetStateStats();
     if (m_pRunningScene)
     {
         m_pRunningScene->visit();
@@ -233,6 +255,10 @@ void CCDirector::drawScene(void)
 		m_pNotificationNode->visit();
 	}
 
+	// draw the nodes still queued and the primitives still batched, under the stats
+	CCRenderQueue::sharedRenderQueue()->flush();
+	ccDrawFlush();
+
 	if (m_bDisplayStats)
 	{
 		showFPS();
@@ -248,11 +274,11 @@ void CCDirector::drawScene(void)
 	m_uTotalFrames++;
 
 
-	// render and swap buffers
+	// render and swap buffers, on the render thread when the frames are pipelined
 	if (m_pobOpenGLView)
     {
 		//m_pobOpenGLView->render();
-        m_pobOpenGLView->swapBuffers();
+        CCRenderPipeline::sharedRenderPipeline()->presentFrame();
     }
 }
 
@@ -390,7 +416,10 @@ void CCDirector::setProjection(ccDirectorProjection kProjection)
 void CCDirector::purgeCachedData(void)
 {
     CCLabelBMFont::purgeCachedData();
+	CCGlyphAtlasCache::sharedGlyphAtlasCache()->removeAllGlyphs();
+	CCTextLayoutCache::sharedTextLayoutCache()->removeAllLayouts();
 	CCTextureCache::sharedTextureCache()->removeUnusedTextures();
+	CCFileUtils::purgeCachedFileData();
 }
 
 float CCDirector::getZEye(void)
@@ -666,7 +695,15 @@ void CCDirector::resetDirector()
  	CCSpriteFrameCache::purgeSharedSpriteFrameCache();
 	//CCActionManager::sharedManager()->purgeSharedManager();
 	//CCScheduler::purgeSharedScheduler();
+	CCGlyphAtlasCache::purgeSharedGlyphAtlasCache();
+	CCRuntimeAtlas::purgeSharedRuntimeAtlas();
+	CCTextLayoutCache::purgeSharedTextLayoutCache();
 	CCTextureCache::purgeSharedTextureCache();
+	CCGPUUploadQueue::purgeSharedGPUUploadQueue();
+	CCRenderQueue::purgeSharedRenderQueue();
+	CCRenderPipeline::purgeSharedRenderPipeline();
+	CCShaderCache::purgeSharedShaderCache();
+	ccDXPurgeStateObjects();
 }
 
 
@@ -707,7 +744,15 @@ void CCDirector::purgeDirector()
  	CCSpriteFrameCache::purgeSharedSpriteFrameCache();
 	//CCActionManager::sharedManager()->purgeSharedManager();
 	//CCScheduler::purgeSharedScheduler();
+	CCGlyphAtlasCache::purgeSharedGlyphAtlasCache();
+	CCRuntimeAtlas::purgeSharedRuntimeAtlas();
+	CCTextLayoutCache::purgeSharedTextLayoutCache();
 	CCTextureCache::purgeSharedTextureCache();
+	CCGPUUploadQueue::purgeSharedGPUUploadQueue();
+	CCRenderQueue::purgeSharedRenderQueue();
+	CCRenderPipeline::purgeSharedRenderPipeline();
+	CCShaderCache::purgeSharedShaderCache();
+	ccDXPurgeStateObjects();
 	
 #if (CC_TARGET_PLATFORM != CC_PLATFORM_MARMALADE)	
 	CCUserDefault::purgeSharedUserDefault();
@@ -802,9 +847,25 @@ void CCDirector::showFPS(void)
 
 		sprintf(m_pszFPS, "%.1f", m_fFrameRate);
 		m_pFPSLabel->setString(m_pszFPS);
+
+		if (m_pStateLabel)
+		{
+			// read before the labels draw, they request states too
+			const ccDXStateStats& stats = ccDXGetStateStats();
+			char szStates[64];
+			sprintf(szStates, "%u states, %u redundant", stats.uRequests,
+				stats.uRequests - stats.uBlendChanges - stats.uDepthStencilChanges);
+			m_pStateLabel->setString(szStates);
+		}
 	}
 
     m_pFPSLabel->draw();
+	if (m_pStateLabel)
+	{
+		// visited to get its position; the scene's queue is already flushed
+		m_pStateLabel->visit();
+		CCRenderQueue::sharedRenderQueue()->flush();
+	}
 }
 #endif // CC_DIRECTOR_FAST_FPS
 
@@ -960,6 +1021,7 @@ void CCDirector::createStatsLabel()
         CC_SAFE_RELEASE_NULL(m_pFPSLabel);
         CC_SAFE_RELEASE_NULL(m_pSPFLabel);
         CC_SAFE_RELEASE_NULL(m_pDrawsLabel);
+        CC_SAFE_RELEASE_NULL(m_pStateLabel);
 
         CCFileUtils::sharedFileUtils()->purgeCachedEntries();
     }
@@ -980,8 +1042,14 @@ void CCDirector::createStatsLabel()
     m_pSPFLabel->retain();
     m_pDrawsLabel = CCLabelTTF::create("000", "Arial", fontSize);
     m_pDrawsLabel->retain();
-
-    CCSize contentSize = m_pDrawsLabel->getContentSize();
+    m_pStateLabel = CCLabelTTF::create("0 states, 0 redundant", "Arial", fontSize);
+    m_pStateLabel->retain();
+
+    // on top of the frame rate, which is drawn at the origin; left aligned, its width changes with the counts
+    CCSize contentSize = m_pStateLabel->getContentSize();
+    m_pStateLabel->setAnchorPoint(ccp(0, 0.5f));
+    m_pStateLabel->setPosition(ccpAdd(ccp(0, contentSize.height*3/2), CC_DIRECTOR_STATS_POSITION));
+    contentSize = m_pDrawsLabel->getContentSize();
     m_pDrawsLabel->setPosition(ccpAdd(ccp(contentSize.width/2, contentSize.height*5/2), CC_DIRECTOR_STATS_POSITION));
     contentSize = m_pSPFLabel->getContentSize();
     m_pSPFLabel->setPosition(ccpAdd(ccp(contentSize.width/2, contentSize.height*3/2), CC_DIRECTOR_STATS_POSITION));
@@ -0,0 +1,198 @@
+/*
+* cocos2d-x   http://www.cocos2d-x.org
+*
+* Copyright (c) 2010-2011 - cocos2d-x community
+*
+* Portions Copyright (c) Microsoft Open Technologies, Inc.
+* All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on an
+* "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and limitations under the License.
+*/
+
+#include "pch.h"
+#include "CCRenderPipeline.h"
+#include "CCDirector.h"
+#include "CCDrawingPrimitives.h"
+#include "CCEGLView.h"
+#include "ccMacros.h"
+#include "platform.h"
+
+NS_CC_BEGIN
+
+static CCRenderPipeline *g_sharedRenderPipeline = NULL;
+
+CCRenderPipeline * CCRenderPipeline::sharedRenderPipeline()
+{
+    if (!g_sharedRenderPipeline)
+    {
+        g_sharedRenderPipeline = new CCRenderPipeline();
+        g_sharedRenderPipeline->setEnabled(CC_ENABLE_RENDER_PIPELINE != 0);
+    }
+
+    return g_sharedRenderPipeline;
+}
+
+void CCRenderPipeline::purgeSharedRenderPipeline()
+{
+    CC_SAFE_RELEASE_NULL(g_sharedRenderPipeline);
+}
+
+CCRenderPipeline::CCRenderPipeline()
+: m_bRecording(false)
+, m_bFrameInFlight(false)
+, m_pWork(NULL)
+, m_pCommandList(NULL)
+, m_hPresentResult(S_OK)
+, m_uSyncs(0)
+{
+    CCAssert(g_sharedRenderPipeline == NULL, "Attempted to allocate a second instance of a singleton.");
+
+    memset(&m_tStats, 0, sizeof(m_tStats));
+}
+
+CCRenderPipeline::~CCRenderPipeline()
+{
+    CCLOGINFO("cocos2d: deallocing CCRenderPipeline.");
+    setEnabled(false);
+    if (m_pWork)
+    {
+        CloseThreadpoolWork(m_pWork);
+    }
+}
+
+void CCRenderPipeline::setEnabled(bool bEnabled)
+{
+    if (bEnabled == m_bRecording)
+    {
+        return;
+    }
+
+    CCEGLView *pView = CCDirector::sharedDirector()->getOpenGLView();
+    if (bEnabled)
+    {
+        if (! m_pWork)
+        {
+            m_pWork = CreateThreadpoolWork(renderFrame, this, NULL);
+        }
+        m_bRecording = m_pWork && pView->BeginDeferredContext();
+    }
+    else
+    {
+        sync();
+        pView->EndDeferredContext();
+        m_bRecording = false;
+    }
+}
+
+void CALLBACK CCRenderPipeline::renderFrame(PTP_CALLBACK_INSTANCE pInstance, PVOID pContext, PTP_WORK pWork)
+{
+    CC_UNUSED_PARAM(pInstance);
+    CC_UNUSED_PARAM(pWork);
+
+    CCRenderPipeline *pPipeline = (CCRenderPipeline*)pContext;
+    CCEGLView *pView = &CCEGLView::sharedOpenGLView();
+    if (pPipeline->m_pCommandList)
+    {
+        pView->GetImmediateDeviceContext()->ExecuteCommandList(pPipeline->m_pCommandList, FALSE);
+        CC_SAFE_RELEASE_NULL_DX(pPipeline->m_pCommandList);
+    }
+    // blocks the render thread until the vertical blank, not the main thread.
+    // The failures are handled by the main thread: nothing catches an exception here
+    pPipeline->m_hPresentResult = pView->PresentBackBuffer();
+}
+
+bool CCRenderPipeline::waitForRenderThread(void)
+{
+    if (! m_bFrameInFlight)
+    {
+        return true;
+    }
+
+    WaitForThreadpoolWorkCallbacks(m_pWork, FALSE);
+    m_bFrameInFlight = false;
+
+    HRESULT hr = m_hPresentResult;
+    m_hPresentResult = S_OK;
+    if (SUCCEEDED(hr))
+    {
+        return true;
+    }
+
+    // the view drops its deferred context with the lost device: record on the new one
+    CCEGLView *pView = CCDirector::sharedDirector()->getOpenGLView();
+    if (! pView->HandlePresentResult(hr))
+    {
+        return true;
+    }
+    CCLOG("cocos2d: CCRenderPipeline: the device was lost, the frames recorded for it are dropped");
+    m_bRecording = pView->BeginDeferredContext();
+    return false;
+}
+
+void CCRenderPipeline::presentFrame(void)
+{
+    CCEGLView *pView = CCDirector::sharedDirector()->getOpenGLView();
+    if (! m_bRecording)
+    {
+        pView->swapBuffers();
+        return;
+    }
+
+    // the primitives still mapped must be unmapped before the list is closed
+    ccDrawFlush();
+    ID3D11CommandList *pCommandList = pView->FinishCommandList();
+
+    struct cc_timeval start, end;
+    CCTime::gettimeofdayCocos2d(&start, NULL);
+    bool bDeviceValid = waitForRenderThread();
+    CCTime::gettimeofdayCocos2d(&end, NULL);
+
+    if (bDeviceValid)
+    {
+        m_pCommandList = pCommandList;
+        m_bFrameInFlight = true;
+        SubmitThreadpoolWork(m_pWork);
+    }
+    else
+    {
+        // recorded for the lost device: the frame is dropped
+        CC_SAFE_RELEASE_NULL_DX(pCommandList);
+    }
+
+    m_tStats.uFrames++;
+    m_tStats.uSyncsLastFrame = m_uSyncs;
+    m_tStats.fWaitLastFrame = (float)CCTime::timersubCocos2d(&start, &end);
+    m_uSyncs = 0;
+}
+
+void CCRenderPipeline::sync(void)
+{
+    if (! m_bRecording)
+    {
+        return;
+    }
+
+    if (! waitForRenderThread() && ! m_bRecording)
+    {
+        return;
+    }
+
+    ccDrawFlush();
+    CCEGLView *pView = CCDirector::sharedDirector()->getOpenGLView();
+    ID3D11CommandList *pCommandList = pView->FinishCommandList();
+    if (pCommandList)
+    {
+        pView->GetImmediateDeviceContext()->ExecuteCommandList(pCommandList, FALSE);
+        pCommandList->Release();
+    }
+    m_uSyncs++;
+}
+
+NS_CC_END
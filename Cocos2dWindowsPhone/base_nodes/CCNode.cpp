@@ -27,11 +27,13 @@
 #include "support/TransformUtils.h"
 #include "CCCamera.h"
 #include "CCGrid.h"
+#include "CCDrawingPrimitives.h"
 #include "CCDirector.h"
 #include "CCScheduler.h"
 #include "CCTouch.h"
 #include "CCActionManager.h"
 #include "CCScriptSupport.h"
+#include <float.h>
 
 #if CC_COCOSNODE_RENDER_SUBPIXEL
 #define RENDER_IN_SUBPIXEL
@@ -41,6 +43,7 @@
 
 NS_CC_BEGIN
 static int s_globalOrderOfArrival = 1;
+static ccCullingStats s_tCullingStats = { 0, 0 };
 CCNode::CCNode(void)
 : m_nZOrder(0)
 , m_fVertexZ(0.0f)
@@ -71,6 +74,10 @@ CCNode::CCNode(void)
 , m_pUserData(NULL)
 , m_bIsTransformDirty(true)
 , m_bIsInverseDirty(true)
+, m_bCullingEnabled(false)
+, m_bCullingBoundsDirty(true)
+, m_bCullingBounded(true)
+, m_tCullingBounds(CCRectZero)
 #ifdef CC_NODE_TRANSFORM_USING_AFFINE_MATRIX
 , m_bIsTransformGLDirty(true)
 #endif
@@ -140,6 +147,7 @@ void CCNode::setSkewX(float newSkewX)
 {
 	m_fSkewX = newSkewX;
 	m_bIsTransformDirty = m_bIsInverseDirty = true;
+	markCullingBoundsDirty();
 #if CC_NODE_TRANSFORM_USING_AFFINE_MATRIX
 	m_bIsTransformGLDirty = true;
 #endif
@@ -155,6 +163,7 @@ void CCNode::setSkewY(float newSkewY)
 	m_fSkewY = newSkewY;
 
 	m_bIsTransformDirty = m_bIsInverseDirty = true;
+	markCullingBoundsDirty();
 #if CC_NODE_TRANSFORM_USING_AFFINE_MATRIX
 	m_bIsTransformGLDirty = true;
 #endif
@@ -184,6 +193,7 @@ float CCNode::getVertexZ()
 void CCNode::setVertexZ(float var)
 {
 	m_fVertexZ = var * CC_CONTENT_SCALE_FACTOR();
+	markCullingBoundsDirty();
 }
 
 
@@ -198,6 +208,7 @@ void CCNode::setRotation(float newRotation)
 {
 	m_fRotation = newRotation;
 	m_bIsTransformDirty = m_bIsInverseDirty = true;
+	markCullingBoundsDirty();
 #ifdef CC_NODE_TRANSFORM_USING_AFFINE_MATRIX
 	m_bIsTransformGLDirty = true;
 #endif
@@ -215,6 +226,7 @@ void CCNode::setScale(float scale)
 {
 	m_fScaleX = m_fScaleY = scale;
 	m_bIsTransformDirty = m_bIsInverseDirty = true;
+	markCullingBoundsDirty();
 #ifdef CC_NODE_TRANSFORM_USING_AFFINE_MATRIX
 	m_bIsTransformGLDirty = true;
 #endif
@@ -231,6 +243,7 @@ void CCNode::setScaleX(float newScaleX)
 {
 	m_fScaleX = newScaleX;
 	m_bIsTransformDirty = m_bIsInverseDirty = true;
+	markCullingBoundsDirty();
 #ifdef CC_NODE_TRANSFORM_USING_AFFINE_MATRIX
 	m_bIsTransformGLDirty = true;
 #endif
@@ -247,6 +260,7 @@ void CCNode::setScaleY(float newScaleY)
 {
 	m_fScaleY = newScaleY;
 	m_bIsTransformDirty = m_bIsInverseDirty = true;
+	markCullingBoundsDirty();
 #ifdef CC_NODE_TRANSFORM_USING_AFFINE_MATRIX
 	m_bIsTransformGLDirty = true;
 #endif
@@ -272,6 +286,7 @@ void CCNode::setPosition(const CCPoint& newPosition)
 	}
 
 	m_bIsTransformDirty = m_bIsInverseDirty = true;
+	markCullingBoundsDirty();
 #ifdef CC_NODE_TRANSFORM_USING_AFFINE_MATRIX
 	m_bIsTransformGLDirty = true;
 #endif
@@ -291,6 +306,7 @@ void CCNode::setPositionInPixels(const CCPoint& newPosition)
 	}
 
 	m_bIsTransformDirty = m_bIsInverseDirty = true;
+	markCullingBoundsDirty();
 
 #if CC_NODE_TRANSFORM_USING_AFFINE_MATRIX
 	m_bIsTransformGLDirty = true;
@@ -360,6 +376,7 @@ CCCamera* CCNode::getCamera()
 	if (!m_pCamera)
 	{
 		m_pCamera = new CCCamera();
+		markCullingBoundsDirty();
 	}
 	
 	return m_pCamera;
@@ -378,6 +395,7 @@ void CCNode::setGrid(CCGridBase* pGrid)
 	CC_SAFE_RETAIN(pGrid);
 	CC_SAFE_RELEASE(m_pGrid);
 	m_pGrid = pGrid;
+	markCullingBoundsDirty();
 }
 
 
@@ -412,6 +430,7 @@ void CCNode::setAnchorPoint(const CCPoint& point)
 		m_tAnchorPoint = point;
 		m_tAnchorPointInPixels = ccp( m_tContentSizeInPixels.width * m_tAnchorPoint.x, m_tContentSizeInPixels.height * m_tAnchorPoint.y );
 		m_bIsTransformDirty = m_bIsInverseDirty = true;
+		markCullingBoundsDirty();
 #ifdef CC_NODE_TRANSFORM_USING_AFFINE_MATRIX
 		m_bIsTransformGLDirty = true;
 #endif
@@ -447,6 +466,7 @@ void CCNode::setContentSize(const CCSize& size)
 
 		m_tAnchorPointInPixels = ccp( m_tContentSizeInPixels.width * m_tAnchorPoint.x, m_tContentSizeInPixels.height * m_tAnchorPoint.y );
 		m_bIsTransformDirty = m_bIsInverseDirty = true;
+		markCullingBoundsDirty();
 #ifdef CC_NODE_TRANSFORM_USING_AFFINE_MATRIX
 		m_bIsTransformGLDirty = true;
 #endif
@@ -470,6 +490,7 @@ void CCNode::setContentSizeInPixels(const CCSize& size)
 
 		m_tAnchorPointInPixels = ccp(m_tContentSizeInPixels.width * m_tAnchorPoint.x, m_tContentSizeInPixels.height * m_tAnchorPoint.y);
 		m_bIsTransformDirty = m_bIsInverseDirty = true;
+		markCullingBoundsDirty();
 
 #if CC_NODE_TRANSFORM_USING_AFFINE_MATRIX
 		m_bIsTransformGLDirty = true;
@@ -508,6 +529,7 @@ void CCNode::setIsRelativeAnchorPoint(bool newValue)
 {
 	m_bIsRelativeAnchorPoint = newValue;
 	m_bIsTransformDirty = m_bIsInverseDirty = true;
+	markCullingBoundsDirty();
 #ifdef CC_NODE_TRANSFORM_USING_AFFINE_MATRIX
 	m_bIsTransformGLDirty = true;
 #endif
@@ -631,6 +653,7 @@ void CCNode::addChild(CCNode *child, int zOrder, int tag)
 
 	child->setParent(this);
 	child->setOrderOfArrival(s_globalOrderOfArrival++);
+	markCullingBoundsDirty();
 	if( m_bRunning )
 	{
 		child->onEnter();
@@ -718,6 +741,7 @@ void CCNode::removeAllChildrenWithCleanup(bool cleanup)
 		}
 		
 		m_pChildren->removeAllObjects();
+		markCullingBoundsDirty();
 	}
 	
 }
@@ -743,6 +767,7 @@ void CCNode::detachChild(CCNode *child, bool doCleanup)
 	child->setParent(NULL);
 
 	m_pChildren->removeObject(child);
+	markCullingBoundsDirty();
 }
 
 
@@ -819,6 +844,12 @@ void CCNode::sortAllChildren()
  	// DON'T draw your stuff outside this method
  }
 
+bool CCNode::getRenderState(ccRenderState *pState)
+{
+	CC_UNUSED_PARAM(pState);
+	return false;
+}
+
 void CCNode::visit()
 {
 	// quick return if not visible
@@ -826,6 +857,9 @@ void CCNode::visit()
 	{
 		return;
 	}
+	// primitives batched by the parent's draw go before this node, and before the grid switches targets
+	ccDrawFlush();
+
 	CCD3DCLASS->D3DPushMatrix();
 
  	if (m_pGrid && m_pGrid->isActive())
@@ -836,6 +870,13 @@ void CCNode::visit()
 
 	this->transform();
 
+	// nothing of the node or its children would show
+	if (m_bCullingEnabled && isCulled())
+	{
+		CCD3DCLASS->D3DPopMatrix();
+		return;
+	}
+
     CCNode* pNode = NULL;
     unsigned int i = 0;
 
@@ -858,8 +899,8 @@ void CCNode::visit()
 		}
     }
 
-	// self draw
-	this->draw();
+	// self draw, now or when the render queue is flushed
+	CCRenderQueue::sharedRenderQueue()->addCommand(this);
 
 	// draw children zOrder >= 0
     if (m_pChildren && m_pChildren->count() > 0)
@@ -883,6 +924,119 @@ void CCNode::visit()
 	CCD3DCLASS->D3DPopMatrix();
 }
 
+bool CCNode::getCullingRectInPixels(CCRect *pRect)
+{
+	*pRect = CCRectMake(0, 0, m_tContentSizeInPixels.width, m_tContentSizeInPixels.height);
+	return true;
+}
+
+bool CCNode::subtreeBoundsInPixels(CCRect *pRect)
+{
+	if (m_bCullingBoundsDirty)
+	{
+		float fMinX = FLT_MAX, fMinY = FLT_MAX, fMaxX = -FLT_MAX, fMaxY = -FLT_MAX;
+		CCRect rect;
+		m_bCullingBounded = getCullingRectInPixels(&rect);
+		if (m_bCullingBounded && rect.size.width > 0 && rect.size.height > 0)
+		{
+			fMinX = rect.getMinX(); fMinY = rect.getMinY();
+			fMaxX = rect.getMaxX(); fMaxY = rect.getMaxY();
+		}
+
+		if (m_pChildren)
+		{
+			ccArray *arrayData = m_pChildren->data;
+			// every child is visited, even once the result is unbounded, so that none stays dirty
+			// under a clean parent: markCullingBoundsDirty would stop at it and never reach this node
+			for (unsigned int i = 0; i < arrayData->num; i++)
+			{
+				CCNode *pChild = (CCNode*) arrayData->arr[i];
+				bool bChildBounded = pChild->subtreeBoundsInPixels(&rect);
+				// the affine transform doesn't hold the camera, the grid or the vertex z of a child
+				if (! bChildBounded || pChild->m_pCamera || pChild->m_pGrid || pChild->m_fVertexZ != 0.0f)
+				{
+					m_bCullingBounded = false;
+				}
+				else if (m_bCullingBounded && rect.size.width > 0 && rect.size.height > 0)
+				{
+					rect = CCRectApplyAffineTransform(rect, pChild->nodeToParentTransform());
+					fMinX = MIN(fMinX, rect.getMinX()); fMinY = MIN(fMinY, rect.getMinY());
+					fMaxX = MAX(fMaxX, rect.getMaxX()); fMaxY = MAX(fMaxY, rect.getMaxY());
+				}
+			}
+		}
+
+		m_tCullingBounds = fMinX <= fMaxX ? CCRectMake(fMinX, fMinY, fMaxX - fMinX, fMaxY - fMinY) : CCRectZero;
+		m_bCullingBoundsDirty = false;
+	}
+
+	*pRect = m_tCullingBounds;
+	return m_bCullingBounded;
+}
+
+void CCNode::markCullingBoundsDirty(void)
+{
+	// the ancestors of a dirty node are dirty, so the walk stops at the first one
+	for (CCNode *pNode = this; pNode && ! pNode->m_bCullingBoundsDirty; pNode = pNode->m_pParent)
+	{
+		pNode->m_bCullingBoundsDirty = true;
+	}
+}
+
+bool CCNode::isCulled(void)
+{
+	// the camera and the grid move the node where the bounds don't follow
+	CCRect bounds;
+	if (m_pCamera || m_pGrid || ! subtreeBoundsInPixels(&bounds)
+		|| bounds.size.width <= 0 || bounds.size.height <= 0)
+	{
+		return false;
+	}
+
+	s_tCullingStats.uTested++;
+
+	// the corners of the bounds in normalized device coordinates, with the matrices set by transform
+	DirectX::XMMATRIX viewMatrix, projectionMatrix;
+	CCD3DCLASS->GetViewMatrix(viewMatrix);
+	CCD3DCLASS->GetProjectionMatrix(projectionMatrix);
+	DirectX::XMMATRIX transform = DirectX::XMMatrixMultiply(viewMatrix, projectionMatrix);
+	float fMinX = FLT_MAX, fMinY = FLT_MAX, fMaxX = -FLT_MAX, fMaxY = -FLT_MAX;
+	for (int i = 0; i < 4; i++)
+	{
+		DirectX::XMVECTOR corner = DirectX::XMVectorSet((i & 1) ? bounds.getMaxX() : bounds.getMinX(),
+			(i & 2) ? bounds.getMaxY() : bounds.getMinY(), 0.0f, 1.0f);
+		DirectX::XMFLOAT4 clip;
+		DirectX::XMStoreFloat4(&clip, DirectX::XMVector4Transform(corner, transform));
+		// a corner behind the eye projects nowhere meaningful
+		if (clip.w <= 0.0f)
+		{
+			return false;
+		}
+		fMinX = MIN(fMinX, clip.x / clip.w);
+		fMinY = MIN(fMinY, clip.y / clip.w);
+		fMaxX = MAX(fMaxX, clip.x / clip.w);
+		fMaxY = MAX(fMaxY, clip.y / clip.w);
+	}
+
+	if (fMaxX < -1.0f || fMinX > 1.0f || fMaxY < -1.0f || fMinY > 1.0f)
+	{
+		s_tCullingStats.uCulled++;
+		return true;
+	}
+	return false;
+}
+
+const ccCullingStats& CCNode::getCullingStats(void)
+{
+	return s_tCullingStats;
+}
+
+void CCNode::resetCullingStats(void)
+{
+	s_tCullingStats.uTested = 0;
+	s_tCullingStats.uCulled = 0;
+}
+
 void CCNode::transformAncestors()
 {
 	if( m_pParent != NULL  )
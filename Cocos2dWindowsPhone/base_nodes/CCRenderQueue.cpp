@@ -0,0 +1,308 @@
+/*
+* cocos2d-x   http://www.cocos2d-x.org
+*
+* Copyright (c) 2010-2011 - cocos2d-x community
+*
+* Portions Copyright (c) Microsoft Open Technologies, Inc.
+* All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on an
+* "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and limitations under the License.
+*/
+
+#include "pch.h"
+#include "CCRenderQueue.h"
+#include "CCNode.h"
+#include "CCLayer.h"
+#include "CCScene.h"
+#include "CCMenu.h"
+#include "CCMenuItem.h"
+#include "CCParallaxNode.h"
+#include "CCDirector.h"
+#include "CCDrawingPrimitives.h"
+#include "ccMacros.h"
+#include "support/CCProfiling.h"
+#include <algorithm>
+#include <float.h>
+#include <typeinfo>
+
+using namespace std;
+using namespace DirectX;
+
+NS_CC_BEGIN
+
+// bits of the sort key, from the most significant ones
+#define CC_RENDER_KEY_LAYER_BITS    8
+#define CC_RENDER_KEY_DEPTH_BITS    20
+#define CC_RENDER_KEY_SHADER_BITS   8
+#define CC_RENDER_KEY_TEXTURE_BITS  20
+#define CC_RENDER_KEY_BLEND_BITS    8
+
+#define CC_RENDER_KEY_BLEND_SHIFT   0
+#define CC_RENDER_KEY_TEXTURE_SHIFT (CC_RENDER_KEY_BLEND_SHIFT + CC_RENDER_KEY_BLEND_BITS)
+#define CC_RENDER_KEY_SHADER_SHIFT  (CC_RENDER_KEY_TEXTURE_SHIFT + CC_RENDER_KEY_TEXTURE_BITS)
+#define CC_RENDER_KEY_DEPTH_SHIFT   (CC_RENDER_KEY_SHADER_SHIFT + CC_RENDER_KEY_SHADER_BITS)
+#define CC_RENDER_KEY_LAYER_SHIFT   (CC_RENDER_KEY_DEPTH_SHIFT + CC_RENDER_KEY_DEPTH_BITS)
+
+#define CC_RENDER_KEY_MASK(__bits__) ((1ULL << (__bits__)) - 1)
+
+// batches a command looks back through to find its place, which bounds the cost of a command
+#define CC_RENDER_QUEUE_BATCH_WINDOW 64
+
+static CCRenderQueue *g_sharedRenderQueue = NULL;
+
+// bounds of the commands drawn outside of their content size: they overlap everything
+static const CCRect s_tUnboundedRect(-1e30f, -1e30f, 2e30f, 2e30f);
+
+// The containers whose draw is the empty CCNode::draw. They have no render state and, being
+// unbounded or full screen, would split the batches around them for nothing. The exact class is
+// tested: a subclass may override draw.
+static bool drawsNothing(CCNode *pNode)
+{
+    const type_info& type = typeid(*pNode);
+    return type == typeid(CCNode) || type == typeid(CCLayer) || type == typeid(CCScene)
+        || type == typeid(CCMenu) || type == typeid(CCLayerMultiplex) || type == typeid(CCParallaxNode)
+        || type == typeid(CCMenuItemSprite) || type == typeid(CCMenuItemImage)
+        || type == typeid(CCMenuItemLabel) || type == typeid(CCMenuItemFont)
+        || type == typeid(CCMenuItemAtlasFont) || type == typeid(CCMenuItemToggle);
+}
+
+CCRenderQueue * CCRenderQueue::sharedRenderQueue()
+{
+    if (!g_sharedRenderQueue)
+        g_sharedRenderQueue = new CCRenderQueue();
+
+    return g_sharedRenderQueue;
+}
+
+void CCRenderQueue::purgeSharedRenderQueue()
+{
+    CC_SAFE_RELEASE_NULL(g_sharedRenderQueue);
+}
+
+CCRenderQueue::CCRenderQueue()
+: m_bEnabled(CC_ENABLE_RENDER_QUEUE != 0)
+, m_bStrictOrder(CC_RENDER_QUEUE_STRICT_ORDER != 0)
+, m_bFlushing(false)
+{
+    CCAssert(g_sharedRenderQueue == NULL, "Attempted to allocate a second instance of a singleton.");
+
+    memset(&m_tStats, 0, sizeof(m_tStats));
+}
+
+CCRenderQueue::~CCRenderQueue()
+{
+    CCLOGINFO("cocos2d: deallocing CCRenderQueue.");
+    flush();
+}
+
+void CCRenderQueue::setEnabled(bool bEnabled)
+{
+    if (! bEnabled)
+    {
+        flush();
+    }
+    m_bEnabled = bEnabled;
+}
+
+unsigned int CCRenderQueue::textureId(CCTexture2D *pTexture)
+{
+    if (! pTexture)
+    {
+        return 0;
+    }
+
+    // ids follow the first use in the frame, so they stay small
+    map<CCTexture2D*, unsigned int>::iterator it = m_tTextureIds.find(pTexture);
+    if (it != m_tTextureIds.end())
+    {
+        return it->second;
+    }
+    unsigned int uId = MIN((unsigned int)m_tTextureIds.size() + 1, (unsigned int)CC_RENDER_KEY_MASK(CC_RENDER_KEY_TEXTURE_BITS));
+    m_tTextureIds[pTexture] = uId;
+    return uId;
+}
+
+unsigned int CCRenderQueue::blendId(const ccBlendFunc& blendFunc)
+{
+    unsigned int uBlend = (blendFunc.src << 16) | (blendFunc.dst & 0xffff);
+    map<unsigned int, unsigned int>::iterator it = m_tBlendIds.find(uBlend);
+    if (it != m_tBlendIds.end())
+    {
+        return it->second;
+    }
+    unsigned int uId = MIN((unsigned int)m_tBlendIds.size(), (unsigned int)CC_RENDER_KEY_MASK(CC_RENDER_KEY_BLEND_BITS));
+    m_tBlendIds[uBlend] = uId;
+    return uId;
+}
+
+unsigned int CCRenderQueue::batchForCommand(const ccRenderCommand& command)
+{
+    // the command can't be drawn before the last batch it overlaps
+    unsigned int uCount = m_tBatches.size();
+    unsigned int uFirst = uCount > CC_RENDER_QUEUE_BATCH_WINDOW ? uCount - CC_RENDER_QUEUE_BATCH_WINDOW : 0;
+    unsigned int uBarrier = uFirst;
+    for (unsigned int i = uCount; i > uFirst; i--)
+    {
+        if (m_tBatches[i - 1].tBounds.intersectsRect(command.tBounds))
+        {
+            uBarrier = i - 1;
+            break;
+        }
+    }
+
+    // join the first batch of the same state from there on
+    if (command.bMergeable)
+    {
+        for (unsigned int i = uBarrier; i < uCount; i++)
+        {
+            ccRenderBatch& batch = m_tBatches[i];
+            if (batch.bMergeable && batch.uState == command.uState)
+            {
+                float fMinX = MIN(batch.tBounds.getMinX(), command.tBounds.getMinX());
+                float fMinY = MIN(batch.tBounds.getMinY(), command.tBounds.getMinY());
+                float fMaxX = MAX(batch.tBounds.getMaxX(), command.tBounds.getMaxX());
+                float fMaxY = MAX(batch.tBounds.getMaxY(), command.tBounds.getMaxY());
+                batch.tBounds = CCRectMake(fMinX, fMinY, fMaxX - fMinX, fMaxY - fMinY);
+                return i;
+            }
+        }
+    }
+
+    ccRenderBatch batch = { command.uState, command.bMergeable, command.tBounds };
+    m_tBatches.push_back(batch);
+    return uCount;
+}
+
+void CCRenderQueue::addCommand(CCNode *pNode)
+{
+    CCAssert(pNode, "pNode can't be NULL");
+    if (drawsNothing(pNode))
+    {
+        return;
+    }
+
+    if (! m_bEnabled || m_bFlushing)
+    {
+        pNode->draw();
+        ccDrawFlush();
+        return;
+    }
+
+    // the node must live until it is drawn
+    pNode->retain();
+    ccRenderCommand command;
+    command.pNode = pNode;
+
+    XMMATRIX viewMatrix, projectionMatrix;
+    CCD3DCLASS->GetViewMatrix(viewMatrix);
+    CCD3DCLASS->GetProjectionMatrix(projectionMatrix);
+    XMStoreFloat4x4(&command.tView, viewMatrix);
+    XMStoreFloat4x4(&command.tProjection, projectionMatrix);
+
+    ccRenderState state;
+    state.layer = 0;
+    state.shader = kCCRenderShaderNone;
+    state.texture = NULL;
+    state.blendFunc.src = CC_BLEND_SRC;
+    state.blendFunc.dst = CC_BLEND_DST;
+    command.bMergeable = pNode->getRenderState(&state) && state.shader != kCCRenderShaderNone;
+    command.uState = ((unsigned long long)state.layer << CC_RENDER_KEY_LAYER_SHIFT)
+        | ((unsigned long long)state.shader << CC_RENDER_KEY_SHADER_SHIFT)
+        | ((unsigned long long)textureId(state.texture) << CC_RENDER_KEY_TEXTURE_SHIFT)
+        | ((unsigned long long)blendId(state.blendFunc) << CC_RENDER_KEY_BLEND_SHIFT);
+
+    unsigned long long uDepth;
+    if (m_bStrictOrder)
+    {
+        uDepth = m_tCommands.size();
+    }
+    else
+    {
+        // the content of the node on screen, unbounded when the node has no size or is behind the camera
+        command.tBounds = s_tUnboundedRect;
+        const CCSize& size = pNode->getContentSizeInPixels();
+        if (size.width > 0 && size.height > 0)
+        {
+            XMMATRIX transform = XMMatrixMultiply(viewMatrix, projectionMatrix);
+            float fMinX = FLT_MAX, fMinY = FLT_MAX, fMaxX = -FLT_MAX, fMaxY = -FLT_MAX;
+            bool bVisible = true;
+            for (int i = 0; i < 4 && bVisible; i++)
+            {
+                XMVECTOR corner = XMVectorSet((i & 1) ? size.width : 0.0f, (i & 2) ? size.height : 0.0f, 0.0f, 1.0f);
+                XMFLOAT4 clip;
+                XMStoreFloat4(&clip, XMVector4Transform(corner, transform));
+                bVisible = clip.w > 0.0f;
+                fMinX = MIN(fMinX, clip.x / clip.w);
+                fMinY = MIN(fMinY, clip.y / clip.w);
+                fMaxX = MAX(fMaxX, clip.x / clip.w);
+                fMaxY = MAX(fMaxY, clip.y / clip.w);
+            }
+            if (bVisible)
+            {
+                command.tBounds = CCRectMake(fMinX, fMinY, fMaxX - fMinX, fMaxY - fMinY);
+            }
+        }
+        uDepth = batchForCommand(command);
+    }
+    uDepth = MIN(uDepth, CC_RENDER_KEY_MASK(CC_RENDER_KEY_DEPTH_BITS));
+
+    m_tKeys.push_back(make_pair(command.uState | (uDepth << CC_RENDER_KEY_DEPTH_SHIFT), (unsigned int)m_tCommands.size()));
+    m_tCommands.push_back(command);
+}
+
+void CCRenderQueue::flush(void)
+{
+    if (m_tCommands.empty() || m_bFlushing)
+    {
+        return;
+    }
+
+    CC_PROFILER_START("CCRenderQueue - flush");
+    m_bFlushing = true;
+
+    // the index breaks the ties, which keeps the sort stable
+    sort(m_tKeys.begin(), m_tKeys.end());
+
+    XMMATRIX viewMatrix, projectionMatrix;
+    CCD3DCLASS->GetViewMatrix(viewMatrix);
+    CCD3DCLASS->GetProjectionMatrix(projectionMatrix);
+
+    m_tStats.uCommands += m_tKeys.size();
+    unsigned long long uStateMask = ~(CC_RENDER_KEY_MASK(CC_RENDER_KEY_DEPTH_BITS) << CC_RENDER_KEY_DEPTH_SHIFT);
+    for (unsigned int i = 0; i < m_tKeys.size(); i++)
+    {
+        const ccRenderCommand& command = m_tCommands[m_tKeys[i].second];
+        if (i == 0 || ! command.bMergeable
+            || (m_tKeys[i].first & uStateMask) != (m_tKeys[i - 1].first & uStateMask))
+        {
+            m_tStats.uBatches++;
+        }
+
+        CCD3DCLASS->SetViewMatrix(XMLoadFloat4x4(&command.tView));
+        CCD3DCLASS->SetProjectionMatrix(XMLoadFloat4x4(&command.tProjection));
+        command.pNode->draw();
+        ccDrawFlush();
+        command.pNode->release();
+    }
+
+    CCD3DCLASS->SetViewMatrix(viewMatrix);
+    CCD3DCLASS->SetProjectionMatrix(projectionMatrix);
+
+    m_tCommands.clear();
+    m_tKeys.clear();
+    m_tBatches.clear();
+    m_tTextureIds.clear();
+    m_tBlendIds.clear();
+
+    m_bFlushing = false;
+    CC_PROFILER_STOP("CCRenderQueue - flush");
+}
+
+NS_CC_END
@@ -28,6 +28,13 @@ NS_CC_BEGIN
 
 CCData::CCData(void)
 : m_pData(NULL)
+, m_nSize(0)
+{
+}
+
+CCData::CCData(unsigned char *pBytes, unsigned long nSize)
+: m_pData((char*)pBytes)
+, m_nSize(nSize)
 {
 }
 
@@ -49,6 +56,7 @@ CCData* CCData::dataWithContentsOfFile(const string &strPath)
 
 	CCData *pRet = new CCData();
     pRet->m_pData = new char[nSize];
+    pRet->m_nSize = nSize;
     memcpy(pRet->m_pData, pBuffer, nSize);
 
 	return pRet;
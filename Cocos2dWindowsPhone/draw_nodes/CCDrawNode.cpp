@@ -24,8 +24,15 @@
 
 #include "CCDrawNode.h"
 #include "CCPointExtension.h"
-//#include "CCShaderCache.h"
+#include "CCDirector.h"
 #include "CCGL.h"
+#include "DirectXHelper.h"
+#include "CCShaderCache.h"
+#include "ccDXStateCache.h"
+#include <vector>
+
+using namespace std;
+using namespace DirectX;
 
 NS_CC_BEGIN
 
@@ -94,11 +101,77 @@ static inline ccTex2F __t(const ccVertex2F &v)
 	return *(ccTex2F*)&v;
 }
 
+// twice the signed area of abc, positive when it turns counterclockwise
+static inline float ccTriangleArea2(const CCPoint &a, const CCPoint &b, const CCPoint &c)
+{
+	return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+}
+
+// Splits a simple polygon, convex or not, into count-2 triangles by clipping its ears.
+// winding is 1 for counterclockwise polygons, -1 for clockwise ones.
+static void ccTriangulatePolygon(const CCPoint *verts, unsigned int count, float winding, unsigned int *triangles)
+{
+	vector<unsigned int> remaining(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		remaining[i] = i;
+	}
+
+	unsigned int i = 0;
+	unsigned int misses = 0;
+	while (remaining.size() > 3)
+	{
+		unsigned int size = remaining.size();
+		unsigned int prev = remaining[(i + size - 1) % size];
+		unsigned int cur = remaining[i];
+		unsigned int next = remaining[(i + 1) % size];
+
+		// an ear is convex, with no other vertex inside
+		bool ear = ccTriangleArea2(verts[prev], verts[cur], verts[next]) * winding > 0.0f;
+		for (unsigned int j = 0; ear && j < size; j++)
+		{
+			unsigned int other = remaining[j];
+			if (other == prev || other == cur || other == next)
+			{
+				continue;
+			}
+			ear = ! (ccTriangleArea2(verts[prev], verts[cur], verts[other]) * winding >= 0.0f
+				&& ccTriangleArea2(verts[cur], verts[next], verts[other]) * winding >= 0.0f
+				&& ccTriangleArea2(verts[next], verts[prev], verts[other]) * winding >= 0.0f);
+		}
+
+		// a degenerate polygon may have no ear left: clip anyway rather than loop forever
+		if (ear || misses >= size)
+		{
+			*triangles++ = prev;
+			*triangles++ = cur;
+			*triangles++ = next;
+			remaining.erase(remaining.begin() + i);
+			if (i >= remaining.size())
+			{
+				i = 0;
+			}
+			misses = 0;
+		}
+		else
+		{
+			i = (i + 1) % size;
+			misses++;
+		}
+	}
+
+	*triangles++ = remaining[0];
+	*triangles++ = remaining[1];
+	*triangles++ = remaining[2];
+}
+
 // implementation of CCDrawNode
 
+CCDXDrawNode CCDrawNode::mDXDrawNode;
+
 CCDrawNode::CCDrawNode()
-: m_uVao(0)
-, m_uVbo(0)
+: m_pVertexBuffer(NULL)
+, m_uVertexBufferCapacity(0)
 , m_uBufferCapacity(0)
 , m_nBufferCount(0)
 , m_pBuffer(NULL)
@@ -113,13 +186,8 @@ CCDrawNode::~CCDrawNode()
     free(m_pBuffer);
     m_pBuffer = NULL;
     
-    glDeleteBuffers(1, &m_uVbo);
-    m_uVbo = 0;
-    
-#if CC_TEXTURE_ATLAS_USE_VAO      
-    glDeleteVertexArrays(1, &m_uVao);
-    m_uVao = 0;
-#endif
+    CC_SAFE_RELEASE_NULL_DX(m_pVertexBuffer);
+    m_uVertexBufferCapacity = 0;
 }
 
 CCDrawNode* CCDrawNode::create()
@@ -151,36 +219,8 @@ bool CCDrawNode::init()
     m_sBlendFunc.src = CC_BLEND_SRC;
     m_sBlendFunc.dst = CC_BLEND_DST;
 
-    setShaderProgram(CCShaderCache::sharedShaderCache()->programForKey(kCCShader_PositionLengthTexureColor));
-    
     ensureCapacity(512);
     
-#if CC_TEXTURE_ATLAS_USE_VAO    
-    glGenVertexArrays(1, &m_uVao);
-    ccGLBindVAO(m_uVao);
-#endif
-    
-    glGenBuffers(1, &m_uVbo);
-    glBindBuffer(GL_ARRAY_BUFFER, m_uVbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(ccV2F_C4B_T2F)* m_uBufferCapacity, m_pBuffer, GL_STREAM_DRAW);
-    
-    glEnableVertexAttribArray(kCCVertexAttrib_Position);
-    glVertexAttribPointer(kCCVertexAttrib_Position, 2, GL_FLOAT, GL_FALSE, sizeof(ccV2F_C4B_T2F), (GLvoid *)offsetof(ccV2F_C4B_T2F, vertices));
-    
-    glEnableVertexAttribArray(kCCVertexAttrib_Color);
-    glVertexAttribPointer(kCCVertexAttrib_Color, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ccV2F_C4B_T2F), (GLvoid *)offsetof(ccV2F_C4B_T2F, colors));
-    
-    glEnableVertexAttribArray(kCCVertexAttrib_TexCoords);
-    glVertexAttribPointer(kCCVertexAttrib_TexCoords, 2, GL_FLOAT, GL_FALSE, sizeof(ccV2F_C4B_T2F), (GLvoid *)offsetof(ccV2F_C4B_T2F, texCoords));
-    
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    
-#if CC_TEXTURE_ATLAS_USE_VAO 
-    ccGLBindVAO(0);
-#endif
-    
-    CHECK_GL_ERROR_DEBUG();
-    
     m_bDirty = true;
     
     return true;
@@ -188,42 +228,104 @@ bool CCDrawNode::init()
 
 void CCDrawNode::render()
 {
+    if (m_nBufferCount == 0)
+    {
+        return;
+    }
+
     if (m_bDirty)
     {
-        glBindBuffer(GL_ARRAY_BUFFER, m_uVbo);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(ccV2F_C4B_T2F)*m_uBufferCapacity, m_pBuffer, GL_STREAM_DRAW);
+        // the vertex buffer follows the capacity of m_pBuffer, so it is recreated only when that grows
+        if (m_uVertexBufferCapacity < m_uBufferCapacity)
+        {
+            CC_SAFE_RELEASE_NULL_DX(m_pVertexBuffer);
+            m_uVertexBufferCapacity = 0;
+
+            D3D11_BUFFER_DESC vertexBufferDesc;
+            vertexBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+            vertexBufferDesc.ByteWidth = sizeof(ccV2F_C4B_T2F)*m_uBufferCapacity;
+            vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+            vertexBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+            vertexBufferDesc.MiscFlags = 0;
+            vertexBufferDesc.StructureByteStride = 0;
+            if (FAILED(CCID3D11Device->CreateBuffer(&vertexBufferDesc, NULL, &m_pVertexBuffer)))
+            {
+                m_pVertexBuffer = NULL;
+                return;
+            }
+            m_uVertexBufferCapacity = m_uBufferCapacity;
+        }
+
+        D3D11_MAPPED_SUBRESOURCE mappedResource;
+        if (FAILED(CCID3D11DeviceContext->Map(m_pVertexBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource)))
+        {
+            return;
+        }
+
+        // the shapes are kept in points, the buffer is in pixels
+        ccV2F_C4B_T2F *pVertices = (ccV2F_C4B_T2F*)mappedResource.pData;
+        memcpy(pVertices, m_pBuffer, sizeof(ccV2F_C4B_T2F)*m_nBufferCount);
+        if (CC_CONTENT_SCALE_FACTOR() != 1.0f)
+        {
+            for (unsigned int i = 0; i < m_nBufferCount; i++)
+            {
+                pVertices[i].vertices = v2fmult(pVertices[i].vertices, CC_CONTENT_SCALE_FACTOR());
+            }
+        }
+        CCID3D11DeviceContext->Unmap(m_pVertexBuffer, 0);
         m_bDirty = false;
     }
-#if CC_TEXTURE_ATLAS_USE_VAO     
-    ccGLBindVAO(m_uVao);
-#else
-    ccGLEnableVertexAttribs(kCCVertexAttribFlag_PosColorTex);
-    glBindBuffer(GL_ARRAY_BUFFER, m_uVbo);
-    // vertex
-    glVertexAttribPointer(kCCVertexAttrib_Position, 2, GL_FLOAT, GL_FALSE, sizeof(ccV2F_C4B_T2F), (GLvoid *)offsetof(ccV2F_C4B_T2F, vertices));
-    
-    // color
-    glVertexAttribPointer(kCCVertexAttrib_Color, 4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(ccV2F_C4B_T2F), (GLvoid *)offsetof(ccV2F_C4B_T2F, colors));
-    
-    // texcood
-    glVertexAttribPointer(kCCVertexAttrib_TexCoords, 2, GL_FLOAT, GL_FALSE, sizeof(ccV2F_C4B_T2F), (GLvoid *)offsetof(ccV2F_C4B_T2F, texCoords));
-#endif
 
-    glDrawArrays(GL_TRIANGLES, 0, m_nBufferCount);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    
+    mDXDrawNode.Render(m_pVertexBuffer, m_nBufferCount);
     CC_INCREMENT_GL_DRAWS(1);
-    CHECK_GL_ERROR_DEBUG();
 }
 
 void CCDrawNode::draw()
 {
-    ccGLBlendFunc(m_sBlendFunc.src, m_sBlendFunc.dst);
-    
-    getShaderProgram()->use();
-    getShaderProgram()->setUniformsForBuiltins();
-    
+    bool newBlend = false;
+    if (m_sBlendFunc.src != CC_BLEND_SRC || m_sBlendFunc.dst != CC_BLEND_DST)
+    {
+        newBlend = true;
+        CCD3DCLASS->D3DBlendFunc(m_sBlendFunc.src, m_sBlendFunc.dst);
+    }
+
     render();
+
+    if (newBlend)
+    {
+        CCD3DCLASS->D3DBlendFunc(CC_BLEND_SRC, CC_BLEND_DST);
+    }
+}
+
+bool CCDrawNode::getRenderState(ccRenderState *pState)
+{
+    pState->shader = kCCRenderShaderDrawNode;
+    pState->texture = NULL;
+    pState->blendFunc = m_sBlendFunc;
+    return true;
+}
+
+bool CCDrawNode::getCullingRectInPixels(CCRect *pRect)
+{
+    if (m_nBufferCount == 0)
+    {
+        *pRect = CCRectZero;
+        return true;
+    }
+
+    float fMinX = m_pBuffer[0].vertices.x, fMinY = m_pBuffer[0].vertices.y;
+    float fMaxX = fMinX, fMaxY = fMinY;
+    for (unsigned int i = 1; i < m_nBufferCount; i++)
+    {
+        fMinX = MIN(fMinX, m_pBuffer[i].vertices.x);
+        fMinY = MIN(fMinY, m_pBuffer[i].vertices.y);
+        fMaxX = MAX(fMaxX, m_pBuffer[i].vertices.x);
+        fMaxY = MAX(fMaxY, m_pBuffer[i].vertices.y);
+    }
+    // the vertices are in points
+    *pRect = CCRectMake(fMinX * CC_CONTENT_SCALE_FACTOR(), fMinY * CC_CONTENT_SCALE_FACTOR(),
+        (fMaxX - fMinX) * CC_CONTENT_SCALE_FACTOR(), (fMaxY - fMinY) * CC_CONTENT_SCALE_FACTOR());
+    return true;
 }
 
 void CCDrawNode::drawDot(const CCPoint &pos, float radius, const ccColor4F &color)
@@ -245,6 +347,7 @@ void CCDrawNode::drawDot(const CCPoint &pos, float radius, const ccColor4F &colo
 	m_nBufferCount += vertex_count;
 	
 	m_bDirty = true;
+	markCullingBoundsDirty();
 }
 
 void CCDrawNode::drawSegment(const CCPoint &from, const CCPoint &to, float radius, const ccColor4F &color)
@@ -318,10 +421,26 @@ void CCDrawNode::drawSegment(const CCPoint &from, const CCPoint &to, float radiu
 	m_nBufferCount += vertex_count;
 	
 	m_bDirty = true;
+	markCullingBoundsDirty();
 }
 
 void CCDrawNode::drawPolygon(CCPoint *verts, unsigned int count, const ccColor4F &fillColor, float borderWidth, const ccColor4F &borderColor)
 {
+    if (count < 3)
+    {
+        return;
+    }
+
+    // the edge normals must point out of the polygon, whatever its winding
+    float area2 = 0.0f;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        const CCPoint &p0 = verts[i];
+        const CCPoint &p1 = verts[(i+1)%count];
+        area2 += p0.x * p1.y - p1.x * p0.y;
+    }
+    float winding = (area2 > 0.0f ? 1.0f : -1.0f);
+
     struct ExtrudeVerts {ccVertex2F offset, n;};
 	struct ExtrudeVerts* extrude = (struct ExtrudeVerts*)malloc(sizeof(struct ExtrudeVerts)*count);
 	memset(extrude, 0, sizeof(struct ExtrudeVerts)*count);
@@ -332,15 +451,15 @@ void CCDrawNode::drawPolygon(CCPoint *verts, unsigned int count, const ccColor4F
 		ccVertex2F v1 = __v2f(verts[i]);
 		ccVertex2F v2 = __v2f(verts[(i+1)%count]);
         
-		ccVertex2F n1 = v2fnormalize(v2fperp(v2fsub(v1, v0)));
-		ccVertex2F n2 = v2fnormalize(v2fperp(v2fsub(v2, v1)));
+		ccVertex2F n1 = v2fmult(v2fnormalize(v2fperp(v2fsub(v1, v0))), -winding);
+		ccVertex2F n2 = v2fmult(v2fnormalize(v2fperp(v2fsub(v2, v1))), -winding);
 		
 		ccVertex2F offset = v2fmult(v2fadd(n1, n2), 1.0/(v2fdot(n1, n2) + 1.0));
         struct ExtrudeVerts tmp = {offset, n2};
 		extrude[i] = tmp;
 	}
 	
-	bool outline = (fillColor.a > 0.0 && borderWidth > 0.0);
+	bool outline = (borderColor.a > 0.0 && borderWidth > 0.0);
 	
 	unsigned int triangle_count = 3*count - 2;
 	unsigned int vertex_count = 3*triangle_count;
@@ -349,12 +468,16 @@ void CCDrawNode::drawPolygon(CCPoint *verts, unsigned int count, const ccColor4F
 	ccV2F_C4B_T2F_Triangle *triangles = (ccV2F_C4B_T2F_Triangle *)(m_pBuffer + m_nBufferCount);
 	ccV2F_C4B_T2F_Triangle *cursor = triangles;
 	
+	vector<unsigned int> indices((count-2)*3);
+	ccTriangulatePolygon(verts, count, winding, &indices[0]);
+
 	float inset = (outline == 0.0 ? 0.5 : 0.0);
 	for(unsigned int i = 0; i < count-2; i++)
     {
-		ccVertex2F v0 = v2fsub(__v2f(verts[0  ]), v2fmult(extrude[0  ].offset, inset));
-		ccVertex2F v1 = v2fsub(__v2f(verts[i+1]), v2fmult(extrude[i+1].offset, inset));
-		ccVertex2F v2 = v2fsub(__v2f(verts[i+2]), v2fmult(extrude[i+2].offset, inset));
+		unsigned int i0 = indices[i*3], i1 = indices[i*3+1], i2 = indices[i*3+2];
+		ccVertex2F v0 = v2fsub(__v2f(verts[i0]), v2fmult(extrude[i0].offset, inset));
+		ccVertex2F v1 = v2fsub(__v2f(verts[i1]), v2fmult(extrude[i1].offset, inset));
+		ccVertex2F v2 = v2fsub(__v2f(verts[i2]), v2fmult(extrude[i2].offset, inset));
 		
         ccV2F_C4B_T2F_Triangle tmp = {
             {v0, ccc4BFromccc4F(fillColor), __t(v2fzero)},
@@ -422,6 +545,7 @@ void CCDrawNode::drawPolygon(CCPoint *verts, unsigned int count, const ccColor4F
 	m_nBufferCount += vertex_count;
 	
 	m_bDirty = true;
+	markCullingBoundsDirty();
 
     free(extrude);
 }
@@ -430,6 +554,7 @@ void CCDrawNode::clear()
 {
     m_nBufferCount = 0;
     m_bDirty = true;
+    markCullingBoundsDirty();
 }
 
 ccBlendFunc CCDrawNode::getBlendFunc() const
@@ -442,4 +567,71 @@ void CCDrawNode::setBlendFunc(const ccBlendFunc &blendFunc)
     m_sBlendFunc = blendFunc;
 }
 
+// implementation of CCDXDrawNode
+
+CCDXDrawNode::CCDXDrawNode()
+{
+	m_pProgram = 0;
+	mIsInit = FALSE;
+}
+
+CCDXDrawNode::~CCDXDrawNode()
+{
+	FreeBuffer();
+}
+
+void CCDXDrawNode::FreeBuffer()
+{
+	CC_SAFE_RELEASE_NULL(m_pProgram);
+}
+
+void CCDXDrawNode::setIsInit(bool isInit)
+{
+	mIsInit = isInit;
+}
+
+bool CCDXDrawNode::InitializeShader()
+{
+	m_pProgram = CCShaderCache::sharedShaderCache()->programForKey(kCCShader_DrawNode);
+	CC_SAFE_RETAIN(m_pProgram);
+
+	return m_pProgram != NULL;
+}
+
+bool CCDXDrawNode::SetShaderParameters(XMMATRIX &viewMatrix,XMMATRIX &projectionMatrix)
+{
+	return CCShaderCache::sharedShaderCache()->useMatrixBuffer(viewMatrix, projectionMatrix);
+}
+
+void CCDXDrawNode::Render(ID3D11Buffer *vertexBuffer, unsigned int count)
+{
+	if ( !mIsInit )
+	{
+		mIsInit = TRUE;
+		FreeBuffer();
+		InitializeShader();
+	}
+	if ( !m_pProgram )
+	{
+		return;
+	}
+
+	XMMATRIX viewMatrix, projectionMatrix;
+	CCD3DCLASS->GetViewMatrix(viewMatrix);
+	CCD3DCLASS->GetProjectionMatrix(projectionMatrix);
+	if (! SetShaderParameters(viewMatrix, projectionMatrix))
+	{
+		return;
+	}
+
+	unsigned int stride = sizeof(ccV2F_C4B_T2F);
+	unsigned int offset = 0;
+	ccDXBindVertexBuffer(vertexBuffer, stride, offset);
+	ccDXSetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	m_pProgram->use();
+	CCID3D11DeviceContext->Draw(count, 0);
+}
+
 NS_CC_END
+
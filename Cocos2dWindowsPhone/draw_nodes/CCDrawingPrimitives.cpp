@@ -31,8 +31,10 @@
 #include <string.h>
 #include <cmath>
 #include "DirectXHelper.h"
-#include "BasicLoader.h"
+#include "CCShaderCache.h"
+#include "ccDXStateCache.h"
 #include "DirectXRender.h"
+#include "support/CCProfiling.h"
 //#include "CCGLProgram.h"
 //#include "CCShaderCache.h"
 
@@ -49,9 +51,8 @@ static CCDrawingPrimitive *pSharedDrawingPrimitive = NULL;
 static bool s_bInitialized = false;
 //static CCGLProgram* s_pShader = NULL;
 static int s_nColorLocation = -1;
-static ccColor4F s_tColor = {1.0f,1.0f,1.0f,1.0f};
 static int s_nPointSizeLocation = -1;
-//static GLfloat s_fPointSize = 1.0f;
+static CCfloat s_fPointSize = 1.0f;
 static void lazy_init( void )
 {
 
@@ -70,24 +71,44 @@ static void lazy_init( void )
      //   s_bInitialized = true;
    // }
 }
+// the vertex buffer starts with room for this many vertices, and doubles when a primitive needs more
+#define CC_DRAWING_PRIMITIVE_INITIAL_CAPACITY 1024
+
+static inline CCDrawingPrimitive::VertexType* ccAllocPrimitiveVertices(D3D11_PRIMITIVE_TOPOLOGY topology, unsigned int count)
+{
+	return CCDrawingPrimitive::sharedDrawingPrimitive()->allocVertices(topology, count);
+}
+
+// writes a vertex of the current color at a point measured in points
+static inline void ccSetPrimitiveVertex(CCDrawingPrimitive::VertexType *vertex, float x, float y)
+{
+	vertex->position = XMFLOAT3(x * CC_CONTENT_SCALE_FACTOR(), y * CC_CONTENT_SCALE_FACTOR(), 1.0f);
+	vertex->color = pSharedDrawingPrimitive->getCurrentColor();
+}
+
 void ccDrawPoint(const CCPoint& point)
 {
-	ccVertex2F* vertice = new ccVertex2F[1];
-	vertice[0].x = point.x * CC_CONTENT_SCALE_FACTOR();
-	vertice[0].y = point.y * CC_CONTENT_SCALE_FACTOR();
-	CCDrawingPrimitive::Drawing(vertice, 1, DrawingPoints);	
+	CCDrawingPrimitive::VertexType *vertices = ccAllocPrimitiveVertices(D3D11_PRIMITIVE_TOPOLOGY_POINTLIST, 1);
+	if (! vertices)
+	{
+		return;
+	}
+
+	ccSetPrimitiveVertex(vertices, point.x, point.y);
 }
 
 void ccDrawPoints(const CCPoint *points, unsigned int numberOfPoints)
 {
-	ccVertex2F* vertices = new ccVertex2F[numberOfPoints];
-	for (unsigned int i=0;i<numberOfPoints;i++)
+	CCDrawingPrimitive::VertexType *vertices = ccAllocPrimitiveVertices(D3D11_PRIMITIVE_TOPOLOGY_POINTLIST, numberOfPoints);
+	if (! vertices)
 	{
-		vertices[i].x = points[i].x * CC_CONTENT_SCALE_FACTOR();
-		vertices[i].y = points[i].y * CC_CONTENT_SCALE_FACTOR();
+		return;
 	}
 
-	CCDrawingPrimitive::Drawing(vertices, numberOfPoints,DrawingPoints);	
+	for (unsigned int i=0;i<numberOfPoints;i++)
+	{
+		ccSetPrimitiveVertex(&vertices[i], points[i].x, points[i].y);
+	}
 }
 
 
@@ -99,14 +120,14 @@ void ccLineWidth( const CCfloat width )
 /** draws a line given the origin and destination point measured in points */
 void ccDrawLine(const CCPoint& origin, const CCPoint& destination)
 {
-	ccVertex2F vertices[2] = 
+	CCDrawingPrimitive::VertexType *vertices = ccAllocPrimitiveVertices(D3D11_PRIMITIVE_TOPOLOGY_LINELIST, 2);
+	if (! vertices)
 	{
-		{origin.x * CC_CONTENT_SCALE_FACTOR(), origin.y * CC_CONTENT_SCALE_FACTOR()},
-		{destination.x * CC_CONTENT_SCALE_FACTOR(), destination.y * CC_CONTENT_SCALE_FACTOR()},
-	};
-
-	CCDrawingPrimitive::Drawing(vertices, 2, DrawingLines);
+		return;
+	}
 
+	ccSetPrimitiveVertex(&vertices[0], origin.x, origin.y);
+	ccSetPrimitiveVertex(&vertices[1], destination.x, destination.y);
 }
 
 void ccDrawPoly(const CCPoint *poli, int numberOfPoints, bool closePolygon){
@@ -114,99 +135,142 @@ void ccDrawPoly(const CCPoint *poli, int numberOfPoints, bool closePolygon){
 }
 void ccDrawPoly(const CCPoint *poli, int numberOfPoints, bool closePolygon, bool fill)
 {
-
-	if (closePolygon)
+	if (fill && numberOfPoints >= 3)
 	{
-		ccVertex2F* vertices = new ccVertex2F[numberOfPoints+1];
-		for (int i=0;i<numberOfPoints;i++)
+		// a fan from the first point, as a list of triangles
+		CCDrawingPrimitive::VertexType *vertices = ccAllocPrimitiveVertices(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST, (numberOfPoints-2)*3);
+		if (! vertices)
 		{
-			vertices[i].x = poli[i].x * CC_CONTENT_SCALE_FACTOR();
-			vertices[i].y = poli[i].y * CC_CONTENT_SCALE_FACTOR();
+			return;
 		}
-		vertices[numberOfPoints].x = poli[0].x * CC_CONTENT_SCALE_FACTOR();
-		vertices[numberOfPoints].y = poli[0].y * CC_CONTENT_SCALE_FACTOR();
-		CCDrawingPrimitive::Drawing(vertices, numberOfPoints+1,DrawingPolyClosed);
-	} 
-	else
-	{
-		ccVertex2F* vertices = new ccVertex2F[numberOfPoints];
-		for (int i=0;i<numberOfPoints;i++)
+
+		for (int i=1;i<numberOfPoints-1;i++)
 		{
-			vertices[i].x = poli[i].x * CC_CONTENT_SCALE_FACTOR();
-			vertices[i].y = poli[i].y * CC_CONTENT_SCALE_FACTOR();
+			ccSetPrimitiveVertex(vertices++, poli[0].x, poli[0].y);
+			ccSetPrimitiveVertex(vertices++, poli[i].x, poli[i].y);
+			ccSetPrimitiveVertex(vertices++, poli[i+1].x, poli[i+1].y);
 		}
-		CCDrawingPrimitive::Drawing(vertices, numberOfPoints,DrawingPolyOpened);
+		return;
+	}
+
+	int segments = closePolygon ? numberOfPoints : numberOfPoints-1;
+	if (numberOfPoints < 2)
+	{
+		return;
 	}
 
+	CCDrawingPrimitive::VertexType *vertices = ccAllocPrimitiveVertices(D3D11_PRIMITIVE_TOPOLOGY_LINELIST, segments*2);
+	if (! vertices)
+	{
+		return;
+	}
+
+	for (int i=0;i<segments;i++)
+	{
+		const CCPoint& next = poli[(i+1) % numberOfPoints];
+		ccSetPrimitiveVertex(vertices++, poli[i].x, poli[i].y);
+		ccSetPrimitiveVertex(vertices++, next.x, next.y);
+	}
 }
 
 void ccDrawCircle(const CCPoint& center, float r, float a, int segs, bool drawLineToCenter)
 {
-	int additionalSegment = 1;
-	if (drawLineToCenter)
+	if (segs <= 0)
 	{
-		++additionalSegment;
+		return;
 	}
 
-	const float coef = 2.0f * (float) (M_PI) /segs;
-
-	ccVertex2F* vertices = new ccVertex2F[segs+1];
-	if( ! vertices )
+	int lines = drawLineToCenter ? segs+1 : segs;
+	CCDrawingPrimitive::VertexType *vertices = ccAllocPrimitiveVertices(D3D11_PRIMITIVE_TOPOLOGY_LINELIST, lines*2);
+	if (! vertices)
 	{
 		return;
 	}
 
-	for(int i=0;i<=segs;i++)
+	const float coef = 2.0f * (float) (M_PI) /segs;
+
+	float x = r * cosf(a) + center.x;
+	float y = r * sinf(a) + center.y;
+	for(int i=1;i<=segs;i++)
 	{
 		float rads = i*coef;
-		vertices[i].x = (r * cosf(rads + a) + center.x) * CC_CONTENT_SCALE_FACTOR();
-		vertices[i].y = (r * sinf(rads + a) + center.y) * CC_CONTENT_SCALE_FACTOR();
-
+		ccSetPrimitiveVertex(vertices++, x, y);
+		x = r * cosf(rads + a) + center.x;
+		y = r * sinf(rads + a) + center.y;
+		ccSetPrimitiveVertex(vertices++, x, y);
 	}
-	vertices[segs+1].x = center.x * CC_CONTENT_SCALE_FACTOR();
-	vertices[segs+1].y = center.y * CC_CONTENT_SCALE_FACTOR();	
-
-	CCDrawingPrimitive::Drawing(vertices, segs+additionalSegment,DrawingPolyOpened);
 
+	if (drawLineToCenter)
+	{
+		ccSetPrimitiveVertex(vertices++, x, y);
+		ccSetPrimitiveVertex(vertices++, center.x, center.y);
+	}
 }
 
 void ccDrawQuadBezier(const CCPoint& origin, const CCPoint& control, const CCPoint& destination, int segments)
 {
-	ccVertex2F* vertices = new ccVertex2F[segments + 1];
-
-	float t = 0.0f;
-	for(int i = 0; i < segments; i++)
+	if (segments <= 0)
 	{
-		float x = powf(1 - t, 2) * origin.x + 2.0f * (1 - t) * t * control.x + t * t * destination.x;
-		float y = powf(1 - t, 2) * origin.y + 2.0f * (1 - t) * t * control.y + t * t * destination.y;
-		vertices[i].x = x * CC_CONTENT_SCALE_FACTOR();
-		vertices[i].y = y * CC_CONTENT_SCALE_FACTOR();
-		t += 1.0f / segments;
+		return;
 	}
 
-	vertices[segments].x = destination.x  * CC_CONTENT_SCALE_FACTOR();
-	vertices[segments].y = destination.y  * CC_CONTENT_SCALE_FACTOR();
+	CCDrawingPrimitive::VertexType *vertices = ccAllocPrimitiveVertices(D3D11_PRIMITIVE_TOPOLOGY_LINELIST, segments*2);
+	if (! vertices)
+	{
+		return;
+	}
 
-	CCDrawingPrimitive::Drawing(vertices, segments+1,DrawingPolyOpened);		
+	float x = origin.x;
+	float y = origin.y;
+	for(int i = 1; i <= segments; i++)
+	{
+		ccSetPrimitiveVertex(vertices++, x, y);
+		if (i == segments)
+		{
+			x = destination.x;
+			y = destination.y;
+		}
+		else
+		{
+			float t = (float)i / segments;
+			x = powf(1 - t, 2) * origin.x + 2.0f * (1 - t) * t * control.x + t * t * destination.x;
+			y = powf(1 - t, 2) * origin.y + 2.0f * (1 - t) * t * control.y + t * t * destination.y;
+		}
+		ccSetPrimitiveVertex(vertices++, x, y);
+	}
 }
 
 void ccDrawCubicBezier(const CCPoint& origin, const CCPoint& control1, const CCPoint& control2, const CCPoint& destination, int segments)
 {
-	ccVertex2F *vertices = new ccVertex2F[segments + 1];
+	if (segments <= 0)
+	{
+		return;
+	}
 
-	float t = 0;
-	for(int i = 0; i < segments; ++i)
+	CCDrawingPrimitive::VertexType *vertices = ccAllocPrimitiveVertices(D3D11_PRIMITIVE_TOPOLOGY_LINELIST, segments*2);
+	if (! vertices)
 	{
-		float x = powf(1 - t, 3) * origin.x + 3.0f * powf(1 - t, 2) * t * control1.x + 3.0f * (1 - t) * t * t * control2.x + t * t * t * destination.x;
-		float y = powf(1 - t, 3) * origin.y + 3.0f * powf(1 - t, 2) * t * control1.y + 3.0f * (1 - t) * t * t * control2.y + t * t * t * destination.y;
-		vertices[i].x = x * CC_CONTENT_SCALE_FACTOR();
-		vertices[i].y = y * CC_CONTENT_SCALE_FACTOR();
-		t += 1.0f / segments;
+		return;
 	}
-	vertices[segments].x = destination.x  * CC_CONTENT_SCALE_FACTOR();
-	vertices[segments].y = destination.y  * CC_CONTENT_SCALE_FACTOR();
 
-	CCDrawingPrimitive::Drawing(vertices, segments+1,DrawingPolyOpened);
+	float x = origin.x;
+	float y = origin.y;
+	for(int i = 1; i <= segments; i++)
+	{
+		ccSetPrimitiveVertex(vertices++, x, y);
+		if (i == segments)
+		{
+			x = destination.x;
+			y = destination.y;
+		}
+		else
+		{
+			float t = (float)i / segments;
+			x = powf(1 - t, 3) * origin.x + 3.0f * powf(1 - t, 2) * t * control1.x + 3.0f * (1 - t) * t * t * control2.x + t * t * t * destination.x;
+			y = powf(1 - t, 3) * origin.y + 3.0f * powf(1 - t, 2) * t * control1.y + 3.0f * (1 - t) * t * t * control2.y + t * t * t * destination.y;
+		}
+		ccSetPrimitiveVertex(vertices++, x, y);
+	}
 }
 void ccDrawCatmullRom( CCPointArray *points, unsigned int segments )
 {
@@ -218,122 +282,146 @@ void ccDrawCardinalSpline( CCPointArray *config, float tension,  unsigned int se
    CCAssert(false,"Not implemented!");
 }
 
-void CCDrawingPrimitive::D3DColor4f(float red, float green, float blue, float alpha)
+void ccDrawFlush( void )
 {
-	if (! pSharedDrawingPrimitive)
+	if (pSharedDrawingPrimitive)
 	{
-		pSharedDrawingPrimitive = new CCDrawingPrimitive();
+		pSharedDrawingPrimitive->flush();
 	}
+}
 
-	pSharedDrawingPrimitive->m_currentColor.x = red;
-	pSharedDrawingPrimitive->m_currentColor.y = green;
-	pSharedDrawingPrimitive->m_currentColor.z = blue;
-	pSharedDrawingPrimitive->m_currentColor.w = alpha;
-};
-
-void CCDrawingPrimitive::Drawing(ccVertex2F *vertices, unsigned int numberOfPoints, DXDrawingType type)
+CCDrawingPrimitive* CCDrawingPrimitive::sharedDrawingPrimitive()
 {
-
 	if (! pSharedDrawingPrimitive)
 	{
 		pSharedDrawingPrimitive = new CCDrawingPrimitive();
 	}
-	pSharedDrawingPrimitive->m_DarwingType = type;
-	pSharedDrawingPrimitive->m_vertexAmount = numberOfPoints;
-	pSharedDrawingPrimitive->m_vertices = vertices;
-	pSharedDrawingPrimitive->Render();
 
+	return pSharedDrawingPrimitive;
 }
 
-void CCDrawingPrimitive::Drawing3D(ccVertex3F *vertices, unsigned int numberOfPoints, DXDrawingType type)
+void CCDrawingPrimitive::D3DColor4f(float red, float green, float blue, float alpha)
 {
+	// the color goes with each vertex: the batch doesn't need to be drawn
+	CCDrawingPrimitive *pPrimitive = sharedDrawingPrimitive();
+	pPrimitive->m_currentColor.x = red;
+	pPrimitive->m_currentColor.y = green;
+	pPrimitive->m_currentColor.z = blue;
+	pPrimitive->m_currentColor.w = alpha;
+};
 
-	if (! pSharedDrawingPrimitive)
+static inline float ccPrimitiveVertexZ(const ccVertex2F &vertex)
+{
+	return 1.0f;
+}
+
+static inline float ccPrimitiveVertexZ(const ccVertex3F &vertex)
+{
+	return vertex.z;
+}
+
+// appends vertices already scaled to pixels, strips turned into lists to share the batch
+template <typename T>
+static void ccAppendPrimitiveVertices(const T *vertices, unsigned int numberOfPoints, DXDrawingType type)
+{
+	D3D11_PRIMITIVE_TOPOLOGY topology;
+	unsigned int count;
+	switch (type)
+	{
+	case DrawingPoints:
+		topology = D3D11_PRIMITIVE_TOPOLOGY_POINTLIST;
+		count = numberOfPoints;
+		break;
+	case DrawingLines:
+		topology = D3D11_PRIMITIVE_TOPOLOGY_LINELIST;
+		count = numberOfPoints - numberOfPoints % 2;
+		break;
+	case DrawingTrangles:
+		topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+		count = numberOfPoints - numberOfPoints % 3;
+		break;
+	default:
+		// DrawingPolyClosed and DrawingPolyOpened are line strips
+		topology = D3D11_PRIMITIVE_TOPOLOGY_LINELIST;
+		count = numberOfPoints > 1 ? (numberOfPoints-1)*2 : 0;
+		break;
+	}
+
+	CCDrawingPrimitive *pPrimitive = CCDrawingPrimitive::sharedDrawingPrimitive();
+	CCDrawingPrimitive::VertexType *pVertices = pPrimitive->allocVertices(topology, count);
+	if (! pVertices)
 	{
-		pSharedDrawingPrimitive = new CCDrawingPrimitive();
+		return;
 	}
-	pSharedDrawingPrimitive->m_DarwingType = type;
-	pSharedDrawingPrimitive->m_vertexAmount = numberOfPoints;
-	pSharedDrawingPrimitive->m_vertices3D = vertices;
-	pSharedDrawingPrimitive->Render3D();
 
+	const XMFLOAT4& color = pPrimitive->getCurrentColor();
+	for (unsigned int i=0; i<count; i++)
+	{
+		// a strip repeats the end of each segment as the start of the next one
+		const T& vertex = (topology == D3D11_PRIMITIVE_TOPOLOGY_LINELIST && type != DrawingLines) ? vertices[(i+1)/2] : vertices[i];
+		pVertices[i].position = XMFLOAT3(vertex.x, vertex.y, ccPrimitiveVertexZ(vertex));
+		pVertices[i].color = color;
+	}
 }
 
-CCDrawingPrimitive::CCDrawingPrimitive()
+void CCDrawingPrimitive::Drawing(ccVertex2F *vertices, unsigned int numberOfPoints, DXDrawingType type)
 {
+	ccAppendPrimitiveVertices(vertices, numberOfPoints, type);
+}
+
+void CCDrawingPrimitive::Drawing3D(ccVertex3F *vertices, unsigned int numberOfPoints, DXDrawingType type)
+{
+	ccAppendPrimitiveVertices(vertices, numberOfPoints, type);
+}
 
+CCDrawingPrimitive::CCDrawingPrimitive()
+: m_pProgram(NULL)
+, m_vertexBuffer(NULL)
+, m_uBufferCapacity(0)
+, m_uBufferOffset(0)
+, m_bDiscardBuffer(true)
+, m_pMappedVertices(NULL)
+, m_eBatchTopology(D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED)
+, m_uBatchCount(0)
+{
 	InitializeShader();
-	initVertexBuffer(200);
+	initVertexBuffer(CC_DRAWING_PRIMITIVE_INITIAL_CAPACITY);
 
 	m_currentColor = XMFLOAT4(1.0, 1.0, 1.0, 1.0);
 }
 
 CCDrawingPrimitive::~CCDrawingPrimitive()
 {
+	if (m_pMappedVertices)
+	{
+		CCID3D11DeviceContext->Unmap(m_vertexBuffer, 0);
+		m_pMappedVertices = NULL;
+	}
+
 	// Release the vertex buffer.
 	if(m_vertexBuffer)
 	{
 		m_vertexBuffer->Release();
 		m_vertexBuffer = 0;
 	}
-	/*
-	if ( m_indexBuffer )
-	{
-	m_indexBuffer->Release();
-	m_indexBuffer = 0;
-	}
-	*/
-	if(m_matrixBuffer)
-	{
-		m_matrixBuffer->Release();
-		m_matrixBuffer = 0;
-	}
-	//*
-	// Release the layout.
-	if(m_layout)
-	{
-		m_layout->Release();
-		m_layout = 0;
-	}
-
-	// Release the pixel shader.
-	if(m_pixelShader)
-	{
-		m_pixelShader->Release();
-		m_pixelShader = 0;
-	}
-
-	// Release the vertex shader.
-	if(m_vertexShader)
-	{
-		m_vertexShader->Release();
-		m_vertexShader = 0;
-	}
-	//*/
-	m_vertices =NULL;
+	CC_SAFE_RELEASE_NULL(m_pProgram);
 }
 
 void CCDrawingPrimitive::initVertexBuffer(unsigned int numberOfPoints)
 {
+	D3D11_BUFFER_DESC vertexBufferDesc;
+	HRESULT result;
 
-	VertexType* verticesT = new VertexType[numberOfPoints];
-	if ( !verticesT )
+	if (m_vertexBuffer)
 	{
-		return;
-	}
-	memset(verticesT, 0, (sizeof(VertexType) * numberOfPoints));
-	/*
-	for (int i=0; i<numberOfPoints; i++)
-	{
-	verticesT[i].position = XMFLOAT3((vertices[i]).x, (vertices[i]).y, 1.0f);
-	verticesT[i].color = m_currentColor;
+		m_vertexBuffer->Release();
+		m_vertexBuffer = 0;
 	}
-	*/
-	D3D11_BUFFER_DESC vertexBufferDesc;
-	D3D11_SUBRESOURCE_DATA vertexData;
-	HRESULT result;
+	m_uBufferCapacity = 0;
+	m_uBufferOffset = 0;
+	m_bDiscardBuffer = true;
 
-	// Set up the description of the static vertex buffer.
+	// Set up the description of the dynamic vertex buffer, filled by allocVertices.
 	vertexBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
 	vertexBufferDesc.ByteWidth = sizeof(VertexType)*numberOfPoints;
 	vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
@@ -341,232 +429,129 @@ void CCDrawingPrimitive::initVertexBuffer(unsigned int numberOfPoints)
 	vertexBufferDesc.MiscFlags = 0;
 	vertexBufferDesc.StructureByteStride = 0;
 
-	// Give the subresource structure a pointer to the vertex data.
-	vertexData.pSysMem = verticesT;
-	vertexData.SysMemPitch = 0;
-	vertexData.SysMemSlicePitch = 0;
-
 	// Now create the vertex buffer.
-	result = CCID3D11Device->CreateBuffer(&vertexBufferDesc, &vertexData, &m_vertexBuffer);
-	if(FAILED(result))
-	{
-		// clean up allocated resources
-		delete[] verticesT;
-		return ;
-	}
-
-	if ( verticesT )
-	{
-		delete[] verticesT;
-		verticesT = 0;
-	}
-	/*
-	DWORD indices[] = {
-	0, 1, 2,
-	0, 2, 3,
-	};
-
-	D3D11_BUFFER_DESC indexBufferDesc;
-	D3D11_SUBRESOURCE_DATA indexData;
-	ZeroMemory( &indexBufferDesc, sizeof(indexBufferDesc) );
-
-	indexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	indexBufferDesc.ByteWidth = sizeof(DWORD) * 2 * 3;
-	indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	indexBufferDesc.CPUAccessFlags = 0;
-	indexBufferDesc.MiscFlags = 0;
-
-	indexData.pSysMem = indices;
-	pDevice->CreateBuffer(&indexBufferDesc, &indexData, &m_indexBuffer);
-	*/
-	D3D11_BUFFER_DESC matrixBufferDesc;
-	ZeroMemory( &matrixBufferDesc, sizeof( D3D11_BUFFER_DESC ) );
-	matrixBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
-	matrixBufferDesc.ByteWidth = sizeof(MatrixBufferType);
-	matrixBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	matrixBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-	matrixBufferDesc.MiscFlags = 0;
-	matrixBufferDesc.StructureByteStride = 0;
-
-	// Create the constant buffer pointer so we can access the vertex shader constant buffer from within this class.
-	result = CCID3D11Device->CreateBuffer(&matrixBufferDesc, NULL, &m_matrixBuffer);
+	result = CCID3D11Device->CreateBuffer(&vertexBufferDesc, NULL, &m_vertexBuffer);
 	if(FAILED(result))
 	{
+		m_vertexBuffer = 0;
 		return ;
 	}
+	m_uBufferCapacity = numberOfPoints;
 }
 
-void CCDrawingPrimitive::RenderVertexBuffer()
+CCDrawingPrimitive::VertexType* CCDrawingPrimitive::allocVertices(D3D11_PRIMITIVE_TOPOLOGY topology, unsigned int count)
 {
-
-	VertexType* verticesTmp;
-	// Create the vertex array.
-	verticesTmp = new VertexType[m_vertexAmount];
-	if(!verticesTmp)
+	if (count == 0)
 	{
-		return ;
+		return NULL;
 	}
 
-	memset(verticesTmp, 0, (sizeof(VertexType) * m_vertexAmount));
+	XMMATRIX viewMatrix, projectionMatrix;
+	XMFLOAT4X4 view, projection;
+	CCD3DCLASS->GetViewMatrix(viewMatrix);
+	CCD3DCLASS->GetProjectionMatrix(projectionMatrix);
+	XMStoreFloat4x4(&view, viewMatrix);
+	XMStoreFloat4x4(&projection, projectionMatrix);
 
-	for (int i=0; i<m_vertexAmount; i++)
+	if (m_uBatchCount > 0
+		&& (topology != m_eBatchTopology
+			|| memcmp(&view, &m_tBatchView, sizeof(view)) != 0
+			|| memcmp(&projection, &m_tBatchProjection, sizeof(projection)) != 0))
 	{
-		verticesTmp[i].position = XMFLOAT3((m_vertices[i]).x, (m_vertices[i]).y, 1.0f);
-		verticesTmp[i].color = m_currentColor;
+		flush();
 	}
 
-	D3D11_MAPPED_SUBRESOURCE mappedResource;
-	VertexType* verticesPtr;
-	if(FAILED(CCID3D11DeviceContext->Map(m_vertexBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource)))
+	if (! m_pMappedVertices && CCID3D11DeviceContext->GetType() == D3D11_DEVICE_CONTEXT_DEFERRED)
 	{
-		// clean up allocated resources
-		delete[] verticesTmp;
-		return;
+		// a command list may only write without overwrite after it discarded the buffer
+		m_uBufferOffset = 0;
+		m_bDiscardBuffer = true;
 	}
-	verticesPtr = (VertexType*)mappedResource.pData;
-	memcpy(verticesPtr, (void*)verticesTmp, (sizeof(VertexType) * m_vertexAmount));
-	CCID3D11DeviceContext->Unmap(m_vertexBuffer, 0);
 
-	if ( verticesTmp )
+	if (m_uBufferOffset + m_uBatchCount + count > m_uBufferCapacity)
 	{
-		delete[] verticesTmp;
-		verticesTmp = 0;
+		// the batch must be contiguous: draw it, and start over at the beginning of the buffer
+		flush();
+		if (count > m_uBufferCapacity)
+		{
+			unsigned int capacity = MAX(m_uBufferCapacity, CC_DRAWING_PRIMITIVE_INITIAL_CAPACITY);
+			while (capacity < count)
+			{
+				capacity *= 2;
+			}
+			initVertexBuffer(capacity);
+			if (! m_vertexBuffer)
+			{
+				return NULL;
+			}
+		}
+		m_uBufferOffset = 0;
+		m_bDiscardBuffer = true;
 	}
 
-	////////////////////////
-	unsigned int stride;
-	unsigned int offset;
-	// Set vertex buffer stride and offset.
-	stride = sizeof(VertexType); 
-	offset = 0;
-
-	// Set the vertex buffer to active in the input assembler so it can be rendered.
-	CCID3D11DeviceContext->IASetVertexBuffers(0, 1, &m_vertexBuffer, &stride, &offset);
-
-	//CCID3D11DeviceContext->IASetIndexBuffer( m_indexBuffer, DXGI_FORMAT_R32_UINT, 0);
-
-	// Set the type of primitive that should be rendered from this vertex buffer, in this case triangles.
-	if (m_DarwingType==DrawingPoints)
-	{
-		CCID3D11DeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_POINTLIST);
-	} 
-	else if(m_DarwingType==DrawingLines)
+	if (! m_pMappedVertices)
 	{
-		CCID3D11DeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
-	}
-	else if(m_DarwingType==DrawingTrangles)
-	{
-		CCID3D11DeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-	}
-	else if(m_DarwingType==DrawingPolyClosed)
-	{
-		CCID3D11DeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP);
-	}
-	else if(m_DarwingType==DrawingPolyOpened)
-	{
-		CCID3D11DeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP);
+		// the vertices drawn before are never written again until the buffer is discarded
+		D3D11_MAPPED_SUBRESOURCE mappedResource;
+		D3D11_MAP mapType = m_bDiscardBuffer ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+		if(FAILED(CCID3D11DeviceContext->Map(m_vertexBuffer, 0, mapType, 0, &mappedResource)))
+		{
+			return NULL;
+		}
+		m_pMappedVertices = (VertexType*)mappedResource.pData;
+		m_bDiscardBuffer = false;
 	}
 
-	return;
+	m_eBatchTopology = topology;
+	m_tBatchView = view;
+	m_tBatchProjection = projection;
+
+	VertexType *pVertices = m_pMappedVertices + m_uBufferOffset + m_uBatchCount;
+	m_uBatchCount += count;
+	return pVertices;
 }
 
-void CCDrawingPrimitive::RenderVertexBuffer3D()
+void CCDrawingPrimitive::flush()
 {
-
-	VertexType* verticesTmp;
-	// Create the vertex array.
-	verticesTmp = new VertexType[m_vertexAmount];
-	if(!verticesTmp)
-	{
-		return ;
-	}
-
-	memset(verticesTmp, 0, (sizeof(VertexType) * m_vertexAmount));
-
-	for (int i=0; i<m_vertexAmount; i++)
+	if (m_pMappedVertices)
 	{
-		verticesTmp[i].position = XMFLOAT3((m_vertices3D[i]).x, (m_vertices3D[i]).y, (m_vertices3D[i]).z);
-		verticesTmp[i].color = m_currentColor;
+		CCID3D11DeviceContext->Unmap(m_vertexBuffer, 0);
+		m_pMappedVertices = NULL;
 	}
 
-	D3D11_MAPPED_SUBRESOURCE mappedResource;
-	VertexType* verticesPtr;
-	if(FAILED(CCID3D11DeviceContext->Map(m_vertexBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource)))
+	if (m_uBatchCount == 0)
 	{
-		// clean up allocated resources
-		delete[] verticesTmp;
 		return;
 	}
-	verticesPtr = (VertexType*)mappedResource.pData;
-	memcpy(verticesPtr, (void*)verticesTmp, (sizeof(VertexType) * m_vertexAmount));
-	CCID3D11DeviceContext->Unmap(m_vertexBuffer, 0);
-
-	if ( verticesTmp )
-	{
-		delete[] verticesTmp;
-		verticesTmp = 0;
-	}
 
-	////////////////////////
-	unsigned int stride;
-	unsigned int offset;
-	// Set vertex buffer stride and offset.
-	stride = sizeof(VertexType); 
-	offset = 0;
+	CC_PROFILER_START("CCDrawingPrimitive - flush");
 
-	// Set the vertex buffer to active in the input assembler so it can be rendered.
-	CCID3D11DeviceContext->IASetVertexBuffers(0, 1, &m_vertexBuffer, &stride, &offset);
+	XMMATRIX viewMatrix = XMLoadFloat4x4(&m_tBatchView);
+	XMMATRIX projectionMatrix = XMLoadFloat4x4(&m_tBatchProjection);
+	if (m_pProgram && SetShaderParameters(viewMatrix, projectionMatrix))
+	{
+		unsigned int stride = sizeof(VertexType);
+		unsigned int offset = 0;
 
-	//CCID3D11DeviceContext->IASetIndexBuffer( m_indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+		// Set the vertex buffer to active in the input assembler so it can be rendered.
+		ccDXBindVertexBuffer(m_vertexBuffer, stride, offset);
+		ccDXSetPrimitiveTopology(m_eBatchTopology);
 
-	// Set the type of primitive that should be rendered from this vertex buffer, in this case triangles.
-	if (m_DarwingType==DrawingPoints)
-	{
-		CCID3D11DeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_POINTLIST);
-	} 
-	else if(m_DarwingType==DrawingLines)
-	{
-		CCID3D11DeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
-	}
-	else if(m_DarwingType==DrawingTrangles)
-	{
-		CCID3D11DeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-	}
-	else if(m_DarwingType==DrawingPolyClosed)
-	{
-		CCID3D11DeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP);
-	}
-	else if(m_DarwingType==DrawingPolyOpened)
-	{
-		CCID3D11DeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP);
+		RenderShader();
 	}
 
-	return;
+	m_uBufferOffset += m_uBatchCount;
+	m_uBatchCount = 0;
+
+	CC_PROFILER_STOP("CCDrawingPrimitive - flush");
 }
 
 bool CCDrawingPrimitive::InitializeShader()
 {
-	BasicLoader^ loader = ref new BasicLoader(CCID3D11Device);
-	D3D11_INPUT_ELEMENT_DESC layoutDesc[] =
-	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
-	};
+	m_pProgram = CCShaderCache::sharedShaderCache()->programForKey(kCCShader_Drawing);
+	CC_SAFE_RETAIN(m_pProgram);
 
-	loader->LoadShader(
-		L"CCDrawingVertexShader.cso",
-		layoutDesc,
-		ARRAYSIZE(layoutDesc),
-		&m_vertexShader,
-		&m_layout
-		);
-
-	loader->LoadShader(
-		L"CCDrawingPixelShader.cso",
-		&m_pixelShader
-		);
-
-	return true;
+	return m_pProgram != NULL;
 }
 
 void CCDrawingPrimitive::OutputShaderErrorMessage(ID3D10Blob* errorMessage,WCHAR* shaderFilename)
@@ -605,92 +590,24 @@ void CCDrawingPrimitive::OutputShaderErrorMessage(ID3D10Blob* errorMessage,WCHAR
 
 bool CCDrawingPrimitive::SetShaderParameters(XMMATRIX &viewMatrix, XMMATRIX &projectionMatrix)
 {
-	D3D11_MAPPED_SUBRESOURCE mappedResource;
-	unsigned int bufferNumber;
-
-	viewMatrix = XMMatrixTranspose(viewMatrix);
-	projectionMatrix = XMMatrixTranspose(projectionMatrix);
-
-	MatrixBufferType* dataPtr;
-	if(FAILED(CCID3D11DeviceContext->Map(m_matrixBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource))){return false;}
-	dataPtr = (MatrixBufferType*)mappedResource.pData;
-	dataPtr->view = viewMatrix;
-	dataPtr->projection = projectionMatrix;
-	CCID3D11DeviceContext->Unmap(m_matrixBuffer, 0);
-	bufferNumber = 0;
-	CCID3D11DeviceContext->VSSetConstantBuffers(bufferNumber, 1, &m_matrixBuffer);
-
-	return true;
+	return CCShaderCache::sharedShaderCache()->useMatrixBuffer(viewMatrix, projectionMatrix);
 }
 
 void CCDrawingPrimitive::RenderShader()
 {
-	// Set the vertex input layout.
-	CCID3D11DeviceContext->IASetInputLayout(m_layout);
-
-	// Set the vertex and pixel shaders that will be used to render this triangle.
-	CCID3D11DeviceContext->VSSetShader(m_vertexShader, NULL, 0);
-	CCID3D11DeviceContext->PSSetShader(m_pixelShader, NULL, 0);
+	// Set the vertex input layout and the vertex and pixel shaders that will be used to render this triangle.
+	m_pProgram->use();
 
-	// Render the triangle.
-	//CCID3D11DeviceContext->DrawIndexed( 6, 0, 0 );
-	CCID3D11DeviceContext->Draw( m_vertexAmount, 0 );
+	// Render the batch, where it was written in the vertex buffer.
+	CCID3D11DeviceContext->Draw( m_uBatchCount, m_uBufferOffset );
 
 	return;
 }
 
 
-void CCDrawingPrimitive::Render()
-{
-	XMMATRIX viewMatrix, projectionMatrix;
-	bool result;
-
-	// Get the world, view, and projection matrices from the camera and d3d objects.
-	CCD3DCLASS->GetViewMatrix(viewMatrix);
-	CCD3DCLASS->GetProjectionMatrix(projectionMatrix);
-
-	// Put the model vertex and index buffers on the graphics pipeline to prepare them for drawing.
-	RenderVertexBuffer();
-
-	// Set the shader parameters that it will use for rendering.
-	result = SetShaderParameters(viewMatrix, projectionMatrix);
-	if(!result)
-	{
-		return ;
-	}
-
-	// Now render the prepared buffers with the shader.
-	RenderShader();
-}
-
-void CCDrawingPrimitive::Render3D()
-{
-	XMMATRIX viewMatrix, projectionMatrix;
-	bool result;
-
-	// Get the world, view, and projection matrices from the camera and d3d objects.
-	CCD3DCLASS->GetViewMatrix(viewMatrix);
-	CCD3DCLASS->GetProjectionMatrix(projectionMatrix);
-
-	// Put the model vertex and index buffers on the graphics pipeline to prepare them for drawing.
-	RenderVertexBuffer3D();
-
-	// Set the shader parameters that it will use for rendering.
-	result = SetShaderParameters(viewMatrix, projectionMatrix);
-	if(!result)
-	{
-		return ;
-	}
-
-	// Now render the prepared buffers with the shader.
-	RenderShader();
-}
 void ccDrawColor4B( CCubyte r, CCubyte g, CCubyte b, CCubyte a )
 {
-    s_tColor.r = r/255.0f;
-    s_tColor.g = g/255.0f;
-    s_tColor.b = b/255.0f;
-    s_tColor.a = a/255.0f;
+    CCDrawingPrimitive::D3DColor4f(r/255.0f, g/255.0f, b/255.0f, a/255.0f);
 }
 void ccPointSize( CCfloat pointSize )
 {
@@ -24,6 +24,7 @@
 #include "CCTexture2D.h"
 #include "platform.h"
 #include "CCDirector.h"
+#include "ccDXStateCache.h"
 
 NS_CC_BEGIN
 	CCGrabber::CCGrabber(void)
@@ -40,7 +41,7 @@ NS_CC_BEGIN
 	
 	void CCGrabber::beforeRender(CCTexture2D *pTexture)
 	{
-		CCID3D11DeviceContext->OMSetRenderTargets(1, &m_renderTargetView, m_depthStencilView);
+		ccDXSetRenderTarget(m_renderTargetView, m_depthStencilView);
 		CCD3DCLASS->D3DClearColor(0.0f,0.0f,0.0f,1.0f);
 		CCD3DCLASS->clearRender(m_renderTargetView);
 		CCID3D11DeviceContext->ClearDepthStencilView(m_depthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
@@ -23,12 +23,14 @@
 #include "CCGrid.h"
 #include "CCDirector.h"
 #include "CCGrabber.h"
+#include "CCRenderQueue.h"
 #include "support/ccUtils.h"
 #include "CCGL.h"
 #include "CCPointExtension.h"
 #include "CCFileUtils.h"
 #include "DirectXHelper.h"
-#include "BasicLoader.h"
+#include "CCShaderCache.h"
+#include "ccDXStateCache.h"
 
 using namespace std;
 using namespace DirectX;
@@ -163,10 +165,7 @@ CCGridBase::~CCGridBase(void)
 
 	CC_SAFE_RELEASE_NULL_DX(m_vertexBuffer);
 	CC_SAFE_RELEASE_NULL_DX(m_indexBuffer);
-	CC_SAFE_RELEASE_NULL_DX(m_matrixBuffer);
-	CC_SAFE_RELEASE_NULL_DX(m_layout);
-	CC_SAFE_RELEASE_NULL_DX(m_pixelShader);
-	CC_SAFE_RELEASE_NULL_DX(m_vertexShader);
+	CC_SAFE_RELEASE_NULL(m_pProgram);
 }
 
 // properties
@@ -259,12 +258,16 @@ void CCGridBase::set3DProjection()
 
 void CCGridBase::beforeDraw(void)
 {
+	// what was queued before goes to the current target
+	CCRenderQueue::sharedRenderQueue()->flush();
 	set2DProjection();
 	m_pGrabber->beforeRender(m_pTexture);
 }
 
 void CCGridBase::afterDraw(cocos2d::CCNode *pTarget)
 {
+	// the target must be drawn in the grid texture before it is released
+	CCRenderQueue::sharedRenderQueue()->flush();
 	m_pGrabber->afterRender(m_pTexture);
 
 	set3DProjection();
@@ -423,61 +426,22 @@ void CCGrid3D::RenderVertexBuffer()
 	offset = 0;
 
 	// Set the vertex buffer to active in the input assembler so it can be rendered.
-	CCID3D11DeviceContext->IASetVertexBuffers(0, 1, &m_vertexBuffer, &stride, &offset);
+	ccDXBindVertexBuffer(m_vertexBuffer, stride, offset);
 
-	CCID3D11DeviceContext->IASetIndexBuffer( m_indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	ccDXBindIndexBuffer(m_indexBuffer, DXGI_FORMAT_R32_UINT);
 
 	// Set the type of primitive that should be rendered from this vertex buffer, in this case triangles.
-	CCID3D11DeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	ccDXSetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
 	return;
 }
 
 bool CCGridBase::InitializeShader()
 {
-	HRESULT result;
-	ID3D10Blob* errorMessage;
-	D3D11_BUFFER_DESC matrixBufferDesc;
-	// Initialize the pointers this function will use to null.
-	errorMessage = 0;
-
-	BasicLoader^ loader = ref new BasicLoader(CCID3D11Device);
-	D3D11_INPUT_ELEMENT_DESC layoutDesc[] = 
-	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		//{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
-	};
-
-	loader->LoadShader(
-		L"CCGridVertexShader.cso",
-		layoutDesc,
-		ARRAYSIZE(layoutDesc),
-		&m_vertexShader,
-		&m_layout
-		);
+	m_pProgram = CCShaderCache::sharedShaderCache()->programForKey(kCCShader_Grid);
+	CC_SAFE_RETAIN(m_pProgram);
 
-	loader->LoadShader(
-		L"CCGridPixelShader.cso",
-		&m_pixelShader
-		);
-
-	// Setup the description of the dynamic matrix constant buffer that is in the vertex shader.
-	matrixBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
-	matrixBufferDesc.ByteWidth = sizeof(MatrixBufferType);
-	matrixBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	matrixBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-	matrixBufferDesc.MiscFlags = 0;
-	matrixBufferDesc.StructureByteStride = 0;
-
-	// Create the constant buffer pointer so we can access the vertex shader constant buffer from within this class.
-	result = CCID3D11Device->CreateBuffer(&matrixBufferDesc, NULL, &m_matrixBuffer);
-	if(FAILED(result))
-	{
-		return false;
-	}
-
-	return true;
+	return m_pProgram != NULL;
 }
 
 void CCGridBase::OutputShaderErrorMessage(ID3D10Blob* errorMessage, HWND hwnd, WCHAR* shaderFilename)
@@ -516,50 +480,21 @@ void CCGridBase::OutputShaderErrorMessage(ID3D10Blob* errorMessage, HWND hwnd, W
 
 bool CCGridBase::SetShaderParameters(XMMATRIX &viewMatrix, XMMATRIX &projectionMatrix, ID3D11ShaderResourceView* texture)
 {
-	HRESULT result;
-	D3D11_MAPPED_SUBRESOURCE mappedResource;
-	MatrixBufferType* dataPtr;
-	unsigned int bufferNumber;
-
-	// Transpose the matrices to prepare them for the shader.
-	viewMatrix = XMMatrixTranspose(viewMatrix);
-	projectionMatrix = XMMatrixTranspose(projectionMatrix);
-
-	// Lock the constant buffer so it can be written to.
-	result = CCID3D11DeviceContext->Map(m_matrixBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-	if(FAILED(result))
+	if (! CCShaderCache::sharedShaderCache()->useMatrixBuffer(viewMatrix, projectionMatrix))
 	{
 		return false;
 	}
 
-	// Get a pointer to the data in the constant buffer.
-	dataPtr = (MatrixBufferType*)mappedResource.pData;
-
-	// Copy the matrices into the constant buffer.
-	dataPtr->view = viewMatrix;
-	dataPtr->projection = projectionMatrix;
-
-	// Unlock the constant buffer.
-	CCID3D11DeviceContext->Unmap(m_matrixBuffer, 0);
-
-	// Set the position of the constant buffer in the vertex shader.
-	bufferNumber = 0;
-
-	// Now set the constant buffer in the vertex shader with the updated values.
-	CCID3D11DeviceContext->VSSetConstantBuffers(bufferNumber, 1, &m_matrixBuffer);
-
 	// Set shader texture resource in the pixel shader.
-	CCID3D11DeviceContext->PSSetShaderResources(0, 1, &texture);
+	ccDXBindTexture2D(texture);
 
 	return true;
 }
 
 void CCGridBase::RenderShader()
 {
-	CCID3D11DeviceContext->IASetInputLayout(m_layout);
-	CCID3D11DeviceContext->VSSetShader(m_vertexShader, NULL, 0);
-	CCID3D11DeviceContext->PSSetShader(m_pixelShader, NULL, 0);
-	CCID3D11DeviceContext->PSSetSamplers(0, 1, m_pTexture->GetSamplerState());
+	m_pProgram->use();
+	ccDXBindSampler(*m_pTexture->GetSamplerState());
 	CCID3D11DeviceContext->DrawIndexed( m_indexCount, 0, 0 );
 }
 
@@ -574,6 +509,10 @@ void CCGridBase::Render()
 	// 		{
 	// 			CCDirector::sharedDirector()->setDepthTest(false);
 	// 		}
+	if ( !m_pProgram )
+	{
+		return;
+	}
 	XMMATRIX viewMatrix, projectionMatrix;
 
 	// Get the world, view, and projection matrices from the camera and d3d objects.
@@ -584,7 +523,10 @@ void CCGridBase::Render()
 	RenderVertexBuffer();
 
 	// Set the shader parameters that it will use for rendering.
-	SetShaderParameters(viewMatrix, projectionMatrix, m_pTexture->getTextureResource());
+	if ( !SetShaderParameters(viewMatrix, projectionMatrix, m_pTexture->getTextureResource()) )
+	{
+		return;
+	}
 
 	// Now render the prepared buffers with the shader.
 	RenderShader();
@@ -1037,12 +979,12 @@ void CCTiledGrid3D::RenderVertexBuffer()
 	offset = 0;
 
 	// Set the vertex buffer to active in the input assembler so it can be rendered.
-	CCID3D11DeviceContext->IASetVertexBuffers(0, 1, &m_vertexBuffer, &stride, &offset);
+	ccDXBindVertexBuffer(m_vertexBuffer, stride, offset);
 
-	CCID3D11DeviceContext->IASetIndexBuffer( m_indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	ccDXBindIndexBuffer(m_indexBuffer, DXGI_FORMAT_R32_UINT);
 
 	// Set the type of primitive that should be rendered from this vertex buffer, in this case triangles.
-	CCID3D11DeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	ccDXSetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
 	return;
 }
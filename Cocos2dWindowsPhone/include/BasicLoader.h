@@ -28,6 +28,12 @@ public:
 
 	static void purgeCachedFileData();
 
+	// reads the compiled shaders saved by saveCachedFileData, if the package has the same version
+	static bool loadCachedFileData(const char *pszPath);
+
+	// saves the compiled shaders read so far in a single file
+	static bool saveCachedFileData(const char *pszPath);
+
    
 private:
 	Microsoft::WRL::ComPtr<ID3D11Device> m_d3dDevice;
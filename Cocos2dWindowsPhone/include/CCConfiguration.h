@@ -72,6 +72,7 @@ protected:
 	CCint			m_nMaxTextureSize;
 	CCint			m_nMaxModelviewStackDepth;
 	bool			m_bSupportsPVRTC;
+	int				m_nSupportsBCTextures;
 	bool			m_bSupportsNPOT;
 	bool			m_bSupportsBGRA8888;
 	bool			m_bSupportsDiscardFramebuffer;
@@ -118,6 +119,11 @@ public:
 		return m_bSupportsPVRTC;
 	}
 
+	/** Whether or not BC1 (DXT1) and BC3 (DXT5) compressed textures can be sampled.
+	 No device samples ETC2: CCTexturePVR decodes those textures to RGBA8888.
+	 */
+	bool isSupportsBCTextures(void);
+
 	/** Whether or not BGRA8888 textures are supported.
 	 @since v0.99.2
 	 */
@@ -36,9 +36,12 @@ class CCData : public CCObject
 {
 public:
 	CCData(void);
+	/** takes the ownership of a buffer allocated with new[] */
+	CCData(unsigned char *pBytes, unsigned long nSize);
 	~CCData(void);
 	
 	void* bytes(void);
+	unsigned long getSize(void) { return m_nSize; }
 
 public:
 	static CCData* dataWithBytes(unsigned char *pBytes, int size);
@@ -46,6 +49,7 @@ public:
 
 private:
 	char *m_pData;
+	unsigned long m_nSize;
 };
 NS_CC_END
 
@@ -213,8 +213,8 @@ public:
 	inline ccDirectorProjection getProjection(void) { return m_eProjection; }
 	void setProjection(ccDirectorProjection kProjection);
 
-    /** How many frames were called since the director started */
-    
+    /** How many frames were drawn since the director started */
+    inline unsigned int getTotalFrames(void) { return m_uTotalFrames; }
     
 	/** Whether or not the replaced scene will receive the cleanup message.
 	 If the new scene is pushed, then the old scene won't receive the "cleanup" message.
@@ -440,6 +440,8 @@ protected:
 	
 	CCLabelTTF *m_pSPFLabel;
 	CCLabelTTF *m_pDrawsLabel;
+	/* blend and depth stencil states requested in the frame, and how many were redundant */
+	CCLabelTTF *m_pStateLabel;
 	void purgeDirector();
 	bool m_bPurgeDirecotorInNextLoop; // this flag will be set to true in end()
 	
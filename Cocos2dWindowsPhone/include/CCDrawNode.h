@@ -35,17 +35,23 @@
 
 NS_CC_BEGIN
 
+class CCDXDrawNode;
+
 /** CCDrawNode
  Node that draws dots, segments and polygons.
  Faster than the "drawing primitives" since they it draws everything in one single batch.
+
+ The shapes are kept in a vertex buffer of the node: it is written when shapes were added or cleared
+ since the last draw, and drawn in one call. Dots, segments and the edges of polygons are antialiased,
+ from feature level 9_3 on.
  
  @since v2.1
  */
 class CC_DLL CCDrawNode : public CCNode
 {
 protected:
-    unsigned int      m_uVao;
-    unsigned int      m_uVbo;
+    ID3D11Buffer    *m_pVertexBuffer;
+    unsigned int    m_uVertexBufferCapacity;
     
     unsigned int    m_uBufferCapacity;
     unsigned int         m_nBufferCount;
@@ -61,6 +67,9 @@ public:
     
     virtual bool init();
     virtual void draw();
+    virtual bool getRenderState(ccRenderState *pState);
+    /** the bounds of the geometry drawn, rather than the content size */
+    virtual bool getCullingRectInPixels(CCRect *pRect);
     
     /** draw a dot at a position, with a given radius and color */
     void drawDot(const CCPoint &pos, float radius, const ccColor4F &color);
@@ -68,7 +77,9 @@ public:
     /** draw a segment with a radius and color */
     void drawSegment(const CCPoint &from, const CCPoint &to, float radius, const ccColor4F &color);
     
-    /** draw a polygon with a fill color and line color */
+    /** draw a polygon with a fill color and line color.
+     The polygon may be concave, in either winding, but its edges must not cross.
+     */
     void drawPolygon(CCPoint *verts, unsigned int count, const ccColor4F &fillColor, float borderWidth, const ccColor4F &borderColor);
     
     /** Clear the geometry in the node's buffer. */
@@ -82,6 +93,28 @@ public:
 private:
     void ensureCapacity(unsigned int count);
     void render();
+
+    static CCDXDrawNode mDXDrawNode;
+};
+
+class CCDXProgram;
+
+/** program shared by the CCDrawNode instances */
+class CC_DLL CCDXDrawNode
+{
+public:
+	CCDXProgram* m_pProgram;
+
+	CCDXDrawNode();
+	~CCDXDrawNode();
+	void FreeBuffer();
+	void setIsInit(bool isInit);
+	bool InitializeShader();
+	bool SetShaderParameters(DirectX::XMMATRIX &viewMatrix,DirectX::XMMATRIX &projectionMatrix);
+	/** draws count vertices of ccV2F_C4B_T2F triangles from vertexBuffer */
+	void Render(ID3D11Buffer *vertexBuffer, unsigned int count);
+private:
+	bool mIsInit;
 };
 
 NS_CC_END
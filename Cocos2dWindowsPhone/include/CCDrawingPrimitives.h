@@ -41,10 +41,11 @@ THE SOFTWARE.
  - ccDrawQuadBezier
  - ccDrawCubicBezier
  
- You can change the color, width and other property by calling the
- glColor4ub(), glLineWidth(), glPointSize().
+ You can change the color by calling ccDrawColor4B() or CCDrawingPrimitive::D3DColor4f().
  
- @warning These functions draws the Line, Point, Polygon, immediately. They aren't batched. If you are going to make a game that depends on these primitives, I suggest creating a batch.
+ The primitives aren't drawn one by one: their vertices are written straight into a shared vertex
+ buffer and drawn in one call per run of points, lines or triangles under the same transform.
+ The batch is drawn after the node that adds to it is drawn, or by ccDrawFlush().
  */
 
 #include "CCGeometry.h"	// for CCPoint
@@ -103,53 +104,67 @@ enum DXDrawingType
 	DrawingPolyOpened  = 4
 };
 
+/** draws the primitives batched so far. Call it before drawing in another way outside of CCNode::draw,
+ for the primitives to be drawn first. */
+void CC_DLL ccDrawFlush( void );
+
+class CCDXProgram;
+
 class CC_DLL CCDrawingPrimitive
 {
 public:
+	struct VertexType
+	{
+		DirectX::XMFLOAT3 position;
+		DirectX::XMFLOAT4 color;
+	};
+
 	static void D3DColor4f(float red, float green, float blue, float alpha);
 	static void Drawing(ccVertex2F *vertices, unsigned int numberOfPoints, DXDrawingType Type);
 	static void Drawing3D(ccVertex3F *vertices, unsigned int numberOfPoints, DXDrawingType Type);
 
+	/** the shared instance, that batches the primitives */
+	static CCDrawingPrimitive* sharedDrawingPrimitive();
+
 	CCDrawingPrimitive();
 	~CCDrawingPrimitive();
 
+	/** Returns room for count vertices of topology at the end of the batch, inside the mapped vertex buffer,
+	 or NULL if the buffer can't be mapped. The batch is drawn first if it has another topology or transform.
+	 */
+	VertexType* allocVertices(D3D11_PRIMITIVE_TOPOLOGY topology, unsigned int count);
+	/** draws the batch */
+	void flush();
+
+	inline const DirectX::XMFLOAT4& getCurrentColor() { return m_currentColor; }
+
 	void initVertexBuffer(unsigned int numberOfPoints);
 	bool InitializeShader();
 
-	void RenderVertexBuffer();
-	void RenderVertexBuffer3D();
 	bool SetShaderParameters(DirectX::XMMATRIX &viewMatrix, DirectX::XMMATRIX &projectionMatrix);
 	void RenderShader();
-	void Render();
-	void Render3D();
 	void OutputShaderErrorMessage(ID3D10Blob* errorMessage,WCHAR* shaderFilename);
 
 	//BOOL initialized;
-	ID3D11VertexShader* m_vertexShader;
-	ID3D11PixelShader* m_pixelShader;
-	ID3D11InputLayout* m_layout;
+	CCDXProgram* m_pProgram;
 	ID3D11Buffer* m_vertexBuffer;
 	//ID3D11Buffer* m_indexBuffer;
-	ID3D11Buffer* m_matrixBuffer;
 
-	DXDrawingType  m_DarwingType;
-	int	m_vertexAmount;
-	ccVertex2F *m_vertices;
-	ccVertex3F *m_vertices3D;
 	DirectX::XMFLOAT4 m_currentColor;
 
-	struct MatrixBufferType
-	{
-		DirectX::XMMATRIX view;
-		DirectX::XMMATRIX projection;
-	};
-
-	struct VertexType
-	{
-		DirectX::XMFLOAT3 position;
-		DirectX::XMFLOAT4 color;
-	};
-
+private:
+	// the vertex buffer is a ring: batches are written after the previous ones, and it is
+	// discarded when the next batch doesn't fit at its end
+	unsigned int m_uBufferCapacity;
+	unsigned int m_uBufferOffset;
+	bool m_bDiscardBuffer;
+	VertexType *m_pMappedVertices;
+
+	// the batch: m_uBatchCount vertices from m_uBufferOffset, with the transform they were added under
+	D3D11_PRIMITIVE_TOPOLOGY m_eBatchTopology;
+	unsigned int m_uBatchCount;
+	DirectX::XMFLOAT4X4 m_tBatchView;
+	DirectX::XMFLOAT4X4 m_tBatchProjection;
 };
 
 NS_CC_END
@@ -146,9 +146,29 @@ public:
     virtual ~CCEGLView();
 
     ID3D11Device* GetDevice();
+	/** the context to draw with: the deferred context while CCRenderPipeline records */
 	ID3D11DeviceContext* GetDeviceContext();
+	/** the context that executes on the GPU. It belongs to the render thread while CCRenderPipeline
+	 is enabled: call CCRenderPipeline::sync before using it. */
+	ID3D11DeviceContext* GetImmediateDeviceContext();
 	ID3D11DepthStencilView* GetDepthStencilView();
 
+	/** Starts recording in the deferred context, with the states of the immediate context.
+	 Returns false if the deferred context can't be created. */
+	bool BeginDeferredContext();
+	/** Returns the commands recorded since the last call, NULL if none. The states are kept. */
+	ID3D11CommandList* FinishCommandList();
+	/** Stops recording: the immediate context takes the states of the deferred context.
+	 The recorded commands must have been finished and executed. */
+	void EndDeferredContext();
+	/** whether the driver records command lists itself, rather than the runtime */
+	bool HasDriverCommandLists();
+	/** Presents the back buffer and returns the result without handling it, from any thread */
+	HRESULT PresentBackBuffer();
+	/** Handles the result of PresentBackBuffer on the main thread. When the device was lost, the
+	 deferred context is dropped and the view takes the new device. Returns true if it was lost. */
+	bool HandlePresentResult(HRESULT hr);
+
     CCSize  getSize();
     CCSize  getSizeInPixel();
     bool    isOpenGLReady();
@@ -256,6 +276,10 @@ protected:
 private:
     ID3D11Device1*           m_d3dDevice;
     ID3D11DeviceContext1*    m_d3dContext;
+    ID3D11DeviceContext1*    m_d3dDeferredContext;
+    bool                     m_bDeferredContext;
+    // -1 until the device was asked
+    int                      m_nDriverCommandLists;
     IDXGISwapChain1*         m_swapChain;
     ID3D11RenderTargetView*  m_renderTargetView;
     ID3D11DepthStencilView*  m_depthStencilView;
@@ -24,6 +24,18 @@
 
 NS_CC_BEGIN;
 
+class CCData;
+class CCMappedFile;
+
+/** @brief Counters of the file data cache of CCFileUtils */
+typedef struct _ccFileDataCacheStats
+{
+	unsigned int  uHits;
+	unsigned int  uMisses;
+	unsigned int  uEvictions;
+	unsigned int  uEntries;
+	unsigned long uBytes;
+} ccFileDataCacheStats;
 
 //! @brief  Helper class to handle file operations
 class CC_DLL CCFileUtils
@@ -47,10 +59,41 @@ public:
 	*/
 	static unsigned char* getFileData(const char* pszFileName, const char* pszMode, unsigned long * pSize);
 	static unsigned char* getFileDataPlatform(const char* pszFileName, const char* pszMode, unsigned long * pSize);
+
+	/**
+	@brief Get resource file data as a shared, immutable buffer, without copying it
+	@param[in]  pszFileName The resource file name which contain the path
+	@return the data, zero terminated, or NULL if the file can't be read
+	@warning The data is retained for the caller, who must release() it.
+	Files are kept in a cache of CC_FILE_DATA_CACHE_SIZE bytes, the least recently used dropped first;
+	getFileData also copies from it when the file is there.
+	*/
+	static CCData* getFileDataBlob(const char* pszFileName);
+
+	/**
+	@brief Map a resource file in memory, read only
+	@param[in]  pszFileName The resource file name which contain the path
+	@return a view of the whole file, or NULL if the file can't be read
+	@warning The view is retained for the caller, who must release() it.
+	Where the platform can't map files, or the mapping fails, the view holds a buffered read instead.
+	Unlike getFileData, the bytes are not zero terminated.
+	*/
+	static CCMappedFile* mapFile(const char* pszFileName);
+
+	/** drops a file from the file data cache, e.g. after writing it */
+	static void removeCachedFileData(const char* pszFileName);
+
+	/** drops every file from the file data cache */
 	static void purgeCachedFileData();
 
+	/** sets the byte budget of the file data cache, dropping files if needed */
+	static void setFileDataCacheLimit(unsigned long uBytes);
+
+	static ccFileDataCacheStats getFileDataCacheStats();
+
 	/**
 	@brief Get resource file data from zip file
+	The archive is opened and indexed on the first call, then kept open; see ZipFile.
 	@param[in]  pszFileName The resource file name which contain the relative path of zip file
 	@param[out] pSize If get the file data succeed the it will be the data size,or it will be 0
 	@return if success,the pointer of data will be returned,or NULL is returned
@@ -58,6 +101,9 @@ public:
 	*/
 	static unsigned char* getFileDataFromZip(const char* pszZipFilePath, const char* pszFileName, unsigned long * pSize);
 
+	/** Closes the archives kept open by getFileDataFromZip. No other thread may be reading from them. */
+	static void purgeCachedZipFiles();
+
 	/** removes the suffix from a path
 	* On RetinaDisplay it will remove the -hd suffix
 	* On iPad it will remove the -ipad suffix
@@ -204,12 +250,34 @@ public:
     const std::vector<std::string>& getSearchResolutionsOrder();
 
 	static void setResourcePath(const char *pszResourcePath);
+
+	/** Returns the absolute path relative resource paths are resolved against, ending with a separator. */
+	static std::string getResourceRootPath();
+
+	/** Returns the path of a file in the first search path and resolution directory that has it,
+	 or the file name itself if none has it. Results are cached until the search paths, the
+	 resolutions order or the filename lookup dictionary change. Can be called from any thread.
+	 */
 	std::string fullPathForFilename(const char* pszFileName);
+
+	/** Lists the files of every search path once, so fullPathForFilename no longer probes the file system for them.
+	 Call it at startup, after setting the search paths; search paths added later are probed until it is called again.
+	 */
+	void buildResourceIndex();
+
+	/** Loads the list of the files shipped under the resource root, one path relative to it per line.
+	 Lines starting with '#' are ignored. Like buildResourceIndex() without walking the directories;
+	 the list then stands for every relative search path.
+	 @return false if the manifest can't be read
+	 */
+	bool loadResourceManifest(const char* pszManifest);
+
 	std::string getPathForFilename(const std::string& filename, const std::string& resourceDirectory, const std::string& searchPath);
 	/**
 	@brief   Generate a CCDictionary pointer by file
-	@param   pFileName  The file name of *.plist file
+	@param   pFileName  The file name of *.plist file, XML or binary
 	@return  The CCDictionary pointer generated from the file
+	@see CCPlistDocument, which reads the values without building the tree
 	*/
 	static CCDictionary *dictionaryWithContentsOfFile(const char *pFileName);
 
@@ -262,6 +330,26 @@ public:
 	std::string m_obDirectory;
 };
 
+/** @brief A read only view of a whole file, returned by CCFileUtils::mapFile */
+class CC_DLL CCMappedFile : public CCObject
+{
+public:
+	CCMappedFile();
+	virtual ~CCMappedFile();
+
+	inline const unsigned char* getBytes(void) { return m_pBytes; }
+	inline unsigned long getSize(void) { return m_uSize; }
+	/** false if the view fell back to a buffered read */
+	inline bool isMapped(void) { return m_bMapped; }
+
+protected:
+	friend class CCFileUtils;
+
+	unsigned char *m_pBytes;
+	unsigned long  m_uSize;
+	bool           m_bMapped;
+};
+
 class CCFileData
 {
 public:
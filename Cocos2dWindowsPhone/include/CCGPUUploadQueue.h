@@ -0,0 +1,126 @@
+/*
+* cocos2d-x   http://www.cocos2d-x.org
+*
+* Copyright (c) 2010-2011 - cocos2d-x community
+*
+* Portions Copyright (c) Microsoft Open Technologies, Inc.
+* All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on an
+* "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and limitations under the License.
+*/
+
+#ifndef __CCGPU_UPLOAD_QUEUE_H__
+#define __CCGPU_UPLOAD_QUEUE_H__
+
+#include <list>
+#include <map>
+#include "CCObject.h"
+#include "ccConfig.h"
+
+NS_CC_BEGIN
+
+class CCTexture2D;
+
+/** @brief Object whose GPU resources can be created by CCGPUUploadQueue */
+class CC_DLL CCGPUUploadDelegate
+{
+public:
+    virtual ~CCGPUUploadDelegate() {}
+
+    /** Creates the textures and buffers of the object. Called by the queue at the start of a frame,
+     or right away when the queue doesn't defer uploads. */
+    virtual void uploadGPUResources() = 0;
+};
+
+/** @brief Counters exposed by CCGPUUploadQueue */
+typedef struct _ccGPUUploadStats
+{
+    //! uploads waiting for a frame
+    unsigned int uPending;
+    unsigned int uPendingBytes;
+    //! uploads and bytes processed by the last frame
+    unsigned int uUploadedLastFrame;
+    unsigned int uUploadedBytesLastFrame;
+} ccGPUUploadStats;
+
+/** @brief Singleton that spreads the creation of GPU resources over frames.
+*
+* Resources are queued where they would have been created and created in order by
+* CCDirector::drawScene, before the scene is drawn, until the bytes of the frame are spent.
+* The first pending upload of a frame is always processed, whatever its size, so the queue
+* can't stall.
+* CCTexture2D queues its creation when setDeferredUpload was called, as CCTextureCache does for
+* the images it loads; until then the texture draws with the placeholder texture.
+*
+* With a budget of 0 bytes, the default (see CC_GPU_UPLOAD_BYTES_PER_FRAME), nothing is deferred.
+*/
+class CC_DLL CCGPUUploadQueue : public CCObject
+{
+public:
+    CCGPUUploadQueue();
+    virtual ~CCGPUUploadQueue();
+
+    /** Returns the shared instance of the queue */
+    static CCGPUUploadQueue * sharedGPUUploadQueue();
+
+    /** purges the queue. The pending uploads are processed first, the placeholder texture released. */
+    static void purgeSharedGPUUploadQueue();
+
+    /** bytes of resources created per frame, 0 to create them right away */
+    inline unsigned int getBytesPerFrame(void) { return m_uBytesPerFrame; }
+    /** Sets the bytes of resources created per frame. Setting 0 processes the pending uploads. */
+    void setBytesPerFrame(unsigned int uBytes);
+
+    /** Queues the creation of the resources of pDelegate, weighing uBytes against the budget.
+     A delegate already queued keeps its place.
+     @return false if the queue doesn't defer uploads: the caller creates its resources right away
+     */
+    bool addUpload(CCGPUUploadDelegate *pDelegate, unsigned int uBytes);
+
+    /** Drops the pending upload of pDelegate, if any. Delegates destroyed before their upload call it. */
+    void removeUpload(CCGPUUploadDelegate *pDelegate);
+
+    /** Processes the pending upload of pDelegate now, for objects whose resources are needed right away */
+    void flushUpload(CCGPUUploadDelegate *pDelegate);
+
+    /** Processes every pending upload */
+    void flushUploads(void);
+
+    /** Processes the pending uploads in order until the budget of the frame is spent.
+     CCDirector::drawScene calls it once per frame. */
+    void processUploads(void);
+
+    /** 1x1 transparent texture drawn in place of the textures whose upload is pending */
+    CCTexture2D* getPlaceholderTexture(void);
+
+    inline const ccGPUUploadStats& getStats(void) { return m_tStats; }
+
+private:
+    typedef struct _ccGPUUpload
+    {
+        CCGPUUploadDelegate *pDelegate;
+        unsigned int         uBytes;
+    } ccGPUUpload;
+
+    typedef std::list<ccGPUUpload> UploadList;
+
+    // removes the front upload and processes it
+    void processFrontUpload(void);
+
+    UploadList m_tUploads;
+    std::map<CCGPUUploadDelegate*, UploadList::iterator> m_tUploadsByDelegate;
+    unsigned int m_uBytesPerFrame;
+    CCTexture2D *m_pPlaceholderTexture;
+    ccGPUUploadStats m_tStats;
+};
+
+NS_CC_END
+
+#endif // __CCGPU_UPLOAD_QUEUE_H__
@@ -0,0 +1,172 @@
+/*
+* cocos2d-x   http://www.cocos2d-x.org
+*
+* Copyright (c) 2010-2011 - cocos2d-x community
+*
+* Portions Copyright (c) Microsoft Open Technologies, Inc.
+* All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on an
+* "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and limitations under the License.
+*/
+
+#ifndef __CCGLYPH_ATLAS_CACHE_H__
+#define __CCGLYPH_ATLAS_CACHE_H__
+
+#include <map>
+#include <string>
+#include <vector>
+#include "CCObject.h"
+#include "CCGeometry.h"
+#include "ccConfig.h"
+#include "CCTextLayoutCache.h"
+
+NS_CC_BEGIN
+
+class CCTexture2D;
+
+/**
+ * @addtogroup GUI
+ * @{
+ * @addtogroup label
+ * @{
+ */
+
+/** @brief A rasterized glyph stored in one of the glyph atlas pages.
+ All values are in pixels; the rect is in page coordinates, top-down.
+ */
+typedef struct _ccGlyphInfo
+{
+    unsigned int uPage;
+    CCRect       rect;
+    int          nLeft;
+    int          nTop;
+    int          nAdvance;
+} ccGlyphInfo;
+
+/** @brief Counters exposed by CCGlyphAtlasCache */
+typedef struct _ccGlyphAtlasStats
+{
+    unsigned int uHits;
+    unsigned int uMisses;
+    unsigned int uEvictions;
+    //! lookups that returned NULL
+    unsigned int uFailures;
+    unsigned int uPages;
+    unsigned int uGlyphs;
+    unsigned int uBytes;
+} ccGlyphAtlasStats;
+
+/** @brief Singleton that rasterizes glyphs once and keeps them in shared RGBA8888 pages.
+*
+* Glyphs are keyed by (font, pixel size, character) and packed in shelves. Pages are
+* allocated on demand up to CC_GLYPH_ATLAS_MAX_PAGES; when they are all full the least
+* recently used page that was not drawn in the current frame is evicted, and the generation
+* of that page changes so only the labels drawing from it look their glyphs up again.
+*
+* Glyphs are white with the coverage in alpha, not premultiplied:
+* use the blending mode (CC_SRC_ALPHA, CC_ONE_MINUS_SRC_ALPHA).
+*/
+class CC_DLL CCGlyphAtlasCache : public CCObject, public CCTextLayoutFont
+{
+public:
+    CCGlyphAtlasCache();
+    virtual ~CCGlyphAtlasCache();
+
+    char * description(void);
+
+    /** Returns the shared instance of the cache */
+    static CCGlyphAtlasCache * sharedGlyphAtlasCache();
+
+    /** purges the cache. It releases the retained instance and all its pages. */
+    static void purgeSharedGlyphAtlasCache();
+
+    /** Selects the font used by the following glyphForChar calls.
+     The size is the one the text painter expects, as passed to CCImage::initWithString.
+     */
+    bool setFont(const char *fontName, unsigned int fontSize);
+
+    /** Returns the glyph of the current font, rasterizing it if needed.
+     Returns NULL if the glyph can't be cached right now, e.g. every page is in use this frame.
+     The pointer stays valid until the glyph's page is evicted or the cache is cleared.
+     */
+    const ccGlyphInfo* glyphForChar(unsigned int charCode);
+
+    /** line height of the current font in pixels */
+    inline int getLineHeight(void) { return m_nLineHeight; }
+    /** ascender of the current font in pixels */
+    inline int getAscender(void) { return m_nAscender; }
+
+    /** Changes every time the glyphs of the page are removed, 0 if the page doesn't exist.
+     Generations are never reused, even across purges.
+     */
+    unsigned int getPageGeneration(unsigned int page);
+
+    inline const ccGlyphAtlasStats& getStats(void) { return m_tStats; }
+
+    /** texture of a page, NULL if the page doesn't exist */
+    CCTexture2D* textureForPage(unsigned int page);
+
+    /** marks a page as used in the current frame so it is not evicted */
+    void touchPage(unsigned int page);
+
+    /** removes every glyph and releases all the pages */
+    void removeAllGlyphs(void);
+
+    // CCTextLayoutFont, for the current font
+    virtual const char* getLayoutFontKey(void);
+    virtual bool getGlyphMetrics(unsigned short c, ccTextGlyphMetrics *pMetrics);
+    virtual int getKerningAmount(unsigned short first, unsigned short second);
+
+private:
+    typedef struct _ccGlyphShelf
+    {
+        unsigned int y;
+        unsigned int height;
+        unsigned int x;
+    } ccGlyphShelf;
+
+    typedef struct _ccGlyphAtlasPage
+    {
+        CCTexture2D               *pTexture;
+        std::vector<ccGlyphShelf>  shelves;
+        unsigned int               uNextShelfY;
+        unsigned int               uLastUsedFrame;
+        unsigned int               uGeneration;
+    } ccGlyphAtlasPage;
+
+    bool allocateInPage(ccGlyphAtlasPage *page, unsigned int w, unsigned int h, unsigned int *x, unsigned int *y);
+    bool allocate(unsigned int w, unsigned int h, unsigned int *page, unsigned int *x, unsigned int *y);
+    bool addPage(void);
+    bool evictPage(unsigned int *page);
+
+protected:
+    std::map<unsigned long long, ccGlyphInfo> m_tGlyphs;
+    std::vector<ccGlyphAtlasPage>             m_tPages;
+    std::map<std::string, unsigned int>       m_tFontIds;
+
+    std::string       m_sFontName;
+    //! font the painter actually loaded for m_sFontName, so reselecting it is a no-op
+    std::wstring      m_sPainterFontName;
+    std::string       m_sLayoutKey;
+    unsigned int      m_uFontSize;
+    unsigned long long m_uFontKey;
+    int               m_nLineHeight;
+    int               m_nAscender;
+    unsigned int      m_uGeneration;
+    ccGlyphAtlasStats m_tStats;
+};
+
+// end of label group
+/// @}
+/// @}
+
+NS_CC_END
+
+#endif // __CCGLYPH_ATLAS_CACHE_H__
@@ -38,6 +38,7 @@ THE SOFTWARE.
 NS_CC_BEGIN
 class CCTexture2D;
 class CCGrabber;
+class CCDXProgram;
 
 /** Base class for other
 */
@@ -103,21 +104,13 @@ protected:
 	virtual void RenderVertexBuffer();
 	void Render();
 
-	ID3D11VertexShader* m_vertexShader;
-	ID3D11PixelShader* m_pixelShader;
-	ID3D11InputLayout* m_layout;
-	ID3D11Buffer* m_matrixBuffer;
+	CCDXProgram* m_pProgram;
 
 	void OutputShaderErrorMessage(ID3D10Blob* errorMessage, HWND hwnd, WCHAR* shaderFilename);
 	bool InitializeShader();
 	bool SetShaderParameters(DirectX::XMMATRIX &viewMatrix, DirectX::XMMATRIX &projectionMatrix, ID3D11ShaderResourceView* texture);
 	void RenderShader();
 
-	struct MatrixBufferType
-	{
-		DirectX::XMMATRIX view;
-		DirectX::XMMATRIX projection;
-	};
 	struct VertexType
 	{
 		DirectX::XMFLOAT3 position;
@@ -26,6 +26,25 @@
 
 NS_CC_BEGIN;
 
+class CCImage;
+
+/**
+@brief Receives the rows of an image while it is decoded, see CCImage::initWithImageFileThreadSafe.
+ Rows are premultiplied RGBA8888 for images with alpha, RGB888 otherwise.
+*/
+class CC_DLL CCImageDecodeDelegate
+{
+public:
+    virtual ~CCImageDecodeDelegate() {}
+
+    /** called once the header is read: width, height, alpha and bits per component of pImage are set.
+     @return false to stop decoding */
+    virtual bool imageWillDecode(CCImage *pImage) = 0;
+
+    /** called for each row, top to bottom. The row may be modified, it is only valid during the call */
+    virtual void imageDidDecodeRow(CCImage *pImage, unsigned int row, unsigned char *pPixels) = 0;
+};
+
 class CC_DLL CCImage : public CCObject
 {
 public:
@@ -70,6 +89,15 @@ public:
 	 */
 	bool initWithImageFileThreadSafe(const char *fullpath, EImageFormat imageType = kFmtPng);
 
+	/**
+	 @brief Decodes a png or jpg file row by row into pDelegate, without keeping the pixels:
+	        getData() stays NULL. It is thread safe, as long as pDelegate is.
+	 @param fullpath  full path of the file
+	 @param imageType kFmtPng or kFmtJpg
+	 @return  true if the whole image was decoded
+	 */
+	bool initWithImageFileThreadSafe(const char *fullpath, EImageFormat imageType, CCImageDecodeDelegate *pDelegate);
+
     /**
     @brief  Load image from stream buffer.
 
@@ -122,8 +150,9 @@ public:
     CC_SYNTHESIZE_READONLY(int,     m_nBitsPerComponent,   BitsPerComponent);
 
 protected:
-    bool _initWithJpgData(void *pData, int nDatalen);
-    bool _initWithPngData(void *pData, int nDatalen);
+    // rows go to pDelegate, or into m_pData when it is NULL
+    bool _initWithJpgData(void *pData, int nDatalen, CCImageDecodeDelegate *pDelegate = NULL);
+    bool _initWithPngData(void *pData, int nDatalen, CCImageDecodeDelegate *pDelegate = NULL);
 
 	// @warning kFmtRawData only support RGBA8888
 	bool _initWithRawData(void *pData, int nDatalen, int nWidth, int nHeight, int nBitsPerComponent);
@@ -34,6 +34,7 @@ Use any of these editors to generate BMFonts:
 #define __CCBITMAP_FONT_ATLAS_H__
 
 #include "CCSpriteBatchNode.h"
+#include "CCTextLayoutCache.h"
 #include "uthash.h"
 #include <map>
 #include <sstream>
@@ -105,7 +106,7 @@ typedef struct _KerningHashElement
 /** @brief CCBMFontConfiguration has parsed configuration of the the .fnt file
 @since v0.8
 */
-class CC_DLL CCBMFontConfiguration : public CCObject
+class CC_DLL CCBMFontConfiguration : public CCObject, public CCTextLayoutFont
 {
     // XXX: Creating a public interface so that the bitmapFontArray[] is accessible
 public://@public
@@ -123,6 +124,8 @@ public://@public
     
     // Character Set defines the letters that actually exist in the font
     std::set<unsigned int> *m_pCharacterSet;
+    //! FNT file the configuration was parsed from
+    std::string m_sFntFile;
 public:
     CCBMFontConfiguration();
     virtual ~CCBMFontConfiguration();
@@ -138,6 +141,11 @@ public:
     inline void setAtlasName(const char* atlasName) { m_sAtlasName = atlasName; }
     
     std::set<unsigned int>* getCharacterSet() const;
+
+    // CCTextLayoutFont
+    virtual const char* getLayoutFontKey(void);
+    virtual bool getGlyphMetrics(unsigned short c, ccTextGlyphMetrics *pMetrics);
+    virtual int getKerningAmount(unsigned short first, unsigned short second);
 private:
     std::set<unsigned int>* parseConfigFile(const char *controlFile);
     void parseCharacterDefinition(std::string line, ccBMFontDef *characterDefinition);
@@ -210,6 +218,9 @@ protected:
     
     // reused char
     CCSprite *m_pReusedChar;
+
+    // lines of the current string, shared through CCTextLayoutCache
+    CCTextLayout *m_pLayout;
     
 public:
     CCLabelBMFont();
@@ -266,8 +277,6 @@ public:
 private:
     char * atlasNameFromFntFile(const char *fntFile);
     int kerningAmountForFirst(unsigned short first, unsigned short second);
-    float getLetterPosXLeft( CCSprite* characterSprite );
-    float getLetterPosXRight( CCSprite* characterSprite );
 
 };
 
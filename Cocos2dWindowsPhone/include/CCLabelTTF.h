@@ -27,8 +27,10 @@ THE SOFTWARE.
 
 #ifndef __CCLABEL_H__
 #define __CCLABEL_H__
+#include <vector>
 #include "CCSprite.h"
 #include "CCTexture2D.h"
+#include "CCTextLayoutCache.h"
 
 NS_CC_BEGIN
 /**
@@ -92,7 +94,7 @@ public:
     static CCLabelTTF * create();
 
     /** changes the string to render
-    * @warning Changing the string is as expensive as creating a new CCLabelTTF. To obtain better performance use CCLabelAtlas
+    * @warning Without CC_LABELTTF_USE_GLYPH_ATLAS, changing the string is as expensive as creating a new CCLabelTTF. To obtain better performance use CCLabelAtlas
     */
     virtual void setString(const char *label);
     virtual const char* getString(void);
@@ -112,8 +114,14 @@ public:
     const char* getFontName();
     void setFontName(const char *fontName);
 
+    /** draws the cached glyph quads, or the label texture when the glyph atlas can't be used */
+    virtual void draw(void);
+
 private:
     bool updateTexture();
+    bool updateGlyphQuads();
+    bool glyphPagesChanged();
+    void updateGlyphColors();
 protected:
     /** Dimensions of the label in Points */
     CCSize m_tDimensions;
@@ -127,6 +135,17 @@ protected:
     float m_fFontSize;
     
     std::string m_string;
+
+    /** glyph quads, one CCTextureAtlas per glyph atlas page, keyed by page */
+    CCDictionary *m_pGlyphAtlases;
+    /** whether the label is drawn from the glyph atlas */
+    bool m_bUseGlyphAtlas;
+    /** generation of every glyph atlas page the quads were built with, indexed by page, 0 if unused */
+    std::vector<unsigned int> m_tGlyphPageGenerations;
+    /** color baked in the glyph quads */
+    ccColor4B m_tGlyphColor;
+    /** lines of the current string, shared through CCTextLayoutCache */
+    CCTextLayout *m_pTextLayout;
 };
 
 
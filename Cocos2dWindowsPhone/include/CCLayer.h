@@ -194,6 +194,7 @@ public:
 	virtual ~CCLayerColor();
 
 	virtual void draw();
+	virtual bool getRenderState(ccRenderState *pState);
 	virtual void setContentSize(const CCSize& var);
 
 	    //@deprecated: This interface will be deprecated sooner or later.
@@ -235,14 +236,13 @@ protected:
 	static CCDXLayerColor mDXLayerColor;
 };
 
+class CCDXProgram;
+
 class CC_DLL CCDXLayerColor
 {
 public:
 	ID3D11Buffer *m_vertexBuffer;
-	ID3D11VertexShader* m_vertexShader;
-	ID3D11PixelShader* m_pixelShader;
-	ID3D11InputLayout* m_layout;
-	ID3D11Buffer* m_matrixBuffer;
+	CCDXProgram* m_pProgram;
 
 	CCDXLayerColor();
 	~CCDXLayerColor();
@@ -256,11 +256,6 @@ public:
 	void RenderShader();
 	void Render(ccVertex2F* squareVertices,ccColor4B* squareColors);
 private:
-	struct MatrixBufferType
-	{
-		DirectX::XMMATRIX view;
-		DirectX::XMMATRIX projection;
-	};
 	struct VertexType
 	{
 		DirectX::XMFLOAT3 position;
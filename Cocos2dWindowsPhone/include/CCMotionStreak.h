@@ -77,6 +77,8 @@ public:
     virtual void setPosition(const CCPoint& position);
     virtual void draw();
     virtual void update(float delta);
+    //! the streak is drawn in world space: it is never culled
+    virtual bool getCullingRectInPixels(CCRect *pRect);
 
     /* Implement interfaces */
     virtual CCTexture2D* getTexture(void);
@@ -33,6 +33,7 @@ THE SOFTWARE.
 #include "CCArray.h"
 #include "CCGL.h"
 #include "CCScriptSupport.h"
+#include "CCRenderQueue.h"
 #include "kazmath/kazmath.h"
 NS_CC_BEGIN
 class CCCamera;
@@ -55,6 +56,15 @@ enum {
 	kCCNodeOnExit
 };
 
+/** @brief Counters of the viewport culling done by CCNode::visit, since the start of the frame */
+typedef struct _ccCullingStats
+{
+	//! subtrees tested against the screen
+	unsigned int uTested;
+	//! subtrees skipped because they were off-screen
+	unsigned int uCulled;
+} ccCullingStats;
+
 /** @brief CCNode is the main element. Anything thats gets drawn or contains things that get drawn is a CCNode.
 The most popular CCNodes are: CCScene, CCLayer, CCSprite, CCMenu.
 
@@ -271,12 +281,24 @@ protected:
 	bool m_bIsTransformDirty;
 	bool m_bIsInverseDirty;
 
+	bool m_bCullingEnabled;
+	bool m_bCullingBoundsDirty;
+	bool m_bCullingBounded;
+	// see subtreeBoundsInPixels
+	CCRect m_tCullingBounds;
+
 #ifdef	CC_NODE_TRANSFORM_USING_AFFINE_MATRIX
 	bool m_bIsTransformGLDirty;
 #endif
 
 	int m_nScriptHandler;
 
+	// marks the cached bounds of the node and its ancestors as dirty
+	void markCullingBoundsDirty(void);
+
+	// whether the subtree is off-screen with the current matrices, set by transform. Counted in the culling stats.
+	bool isCulled(void);
+
 public:
 
 	//! lazy allocs
@@ -426,9 +448,41 @@ public:
 	*/
 	virtual void draw(void);
 
+	/** Fills the state the node draws with, for CCRenderQueue to sort its draws by.
+	Returns false, the default, when the node draws in its own way: it is then never batched with other nodes.
+	@since v2.1
+	*/
+	virtual bool getRenderState(ccRenderState *pState);
+
 	/** recursive method that visit its children and draw them */
 	virtual void visit(void);
 
+	/** Whether visit skips the node and its children when their bounds are off-screen. false by default.
+	The bounds are the content size of the node and of its descendants, see getCullingRectInPixels.
+	Nodes with a camera or a grid are never culled.
+	@since v2.1
+	*/
+	inline bool isCullingEnabled(void) { return m_bCullingEnabled; }
+	inline void setCullingEnabled(bool bEnabled) { m_bCullingEnabled = bEnabled; }
+
+	/** Gets the rect the node draws in, in its own space and in pixels: its content size by default.
+	Nodes that draw outside of their content size override it, and return false if they can draw anywhere,
+	which keeps their ancestors from being culled.
+	@since v2.1
+	*/
+	virtual bool getCullingRectInPixels(CCRect *pRect);
+
+	/** Gets the bounds of the node and its descendants, in the space of the node and in pixels.
+	They are cached until a node of the subtree moves, resizes or changes its children.
+	Returns false if the subtree can draw anywhere.
+	@since v2.1
+	*/
+	bool subtreeBoundsInPixels(CCRect *pRect);
+
+	/** culling counters of the current frame, reset by CCDirector when it starts drawing a scene */
+	static const ccCullingStats& getCullingStats(void);
+	static void resetCullingStats(void);
+
 	// transformations
 
 	/** performs OpenGL view-matrix transformation based on position, scale, rotation and other attributes. */
@@ -421,6 +421,9 @@ public:
     virtual void update(float dt);
     virtual void updateWithNoTime(void);
 
+    //! particles fly outside of the content size: the system is never culled
+    virtual bool getCullingRectInPixels(CCRect *pRect);
+
 protected:
     virtual void updateBlendFunc();
 };
@@ -97,16 +97,15 @@ public:
 };
 
 
+class CCDXProgram;
+
 class CC_DLL CCDXParticleSystemQuad
 {
 public:
 	CCDXParticleSystemQuad();
 	~CCDXParticleSystemQuad();
 
-	ID3D11VertexShader* m_vertexShader;
-	ID3D11PixelShader* m_pixelShader;
-	ID3D11InputLayout* m_inputLayout;
-	ID3D11Buffer* m_matrixBuffer;
+	CCDXProgram* m_pProgram;
 	ID3D11Buffer* m_indexBuffer;
 	ID3D11Buffer* m_vertexBuffer;
 
@@ -122,11 +121,6 @@ public:
 	void Render(ccV2F_C4B_T2F_Quad *quad,unsigned short* indices,unsigned int uTotalParticles,unsigned int particleIdx,CCTexture2D* texture);
 
 private:
-	struct MatrixBufferType
-	{
-		DirectX::XMMATRIX view;
-		DirectX::XMMATRIX projection;
-	};
 	struct VertexType
 	{
 		DirectX::XMFLOAT2 position;
@@ -0,0 +1,178 @@
+/*
+* cocos2d-x   http://www.cocos2d-x.org
+*
+* Copyright (c) 2010-2011 - cocos2d-x community
+*
+* Portions Copyright (c) Microsoft Open Technologies, Inc.
+* All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on an
+* "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and limitations under the License.
+*/
+
+#ifndef __CCPLIST_DOCUMENT_H__
+#define __CCPLIST_DOCUMENT_H__
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "CCObject.h"
+
+NS_CC_BEGIN
+
+class CCDictionary;
+class CCArray;
+class CCPlistDocument;
+
+/**
+ * @addtogroup data_structures
+ * @{
+ */
+
+typedef enum
+{
+    kCCPlistTypeNull = 0,
+    kCCPlistTypeDictionary,
+    kCCPlistTypeArray,
+    kCCPlistTypeString,
+    kCCPlistTypeInteger,
+    kCCPlistTypeReal,
+    kCCPlistTypeBool,
+    kCCPlistTypeData,
+} CCPlistType;
+
+/** @brief A value of a CCPlistDocument.
+ Values are small handles into the document: copy them freely, but don't use them once
+ the document is released. Reading a missing key or index returns a null value, whose
+ accessors return 0, false and "" like CCDictionary::valueForKey does.
+ */
+class CC_DLL CCPlistValue
+{
+public:
+    CCPlistValue() : m_pDocument(NULL), m_uNode(0) {}
+
+    CCPlistType getType(void) const;
+    inline bool isNull(void) const { return getType() == kCCPlistTypeNull; }
+
+    /** numbers are returned as parsed; strings are converted like CCString does */
+    int intValue(void) const;
+    float floatValue(void) const;
+    double doubleValue(void) const;
+    bool boolValue(void) const;
+
+    /** text of a string, "" for the other types */
+    const char* getCString(void) const;
+    /** bytes of a string or a data value */
+    const unsigned char* getBytes(void) const;
+    unsigned int length(void) const;
+
+    /** number of elements of an array or entries of a dictionary */
+    unsigned int count(void) const;
+    CCPlistValue objectAtIndex(unsigned int index) const;
+    /** key of the entry at index of a dictionary, in file order */
+    const char* keyAtIndex(unsigned int index) const;
+    CCPlistValue objectForKey(const char *key) const;
+
+    /** Builds the CCDictionary/CCArray/CCString tree of the value, the way the SAX loader did:
+     numbers and booleans become CCStrings, data CCData.
+     @return a new object the caller must release(), or NULL for a null value
+     */
+    CCObject* copyObject(void) const;
+
+private:
+    friend class CCPlistDocument;
+    CCPlistValue(const CCPlistDocument *pDocument, unsigned int uNode) : m_pDocument(pDocument), m_uNode(uNode) {}
+
+    const CCPlistDocument *m_pDocument;
+    unsigned int m_uNode;
+};
+
+/** @brief A property list loaded into a compact, typed and read only document.
+*
+* XML (<plist>) and binary (bplist00) property lists are parsed straight from the file data
+* into flat tables: numbers are parsed once, strings and data live in one pool and each
+* distinct dictionary key is stored once, so looking a key up compares offsets.
+* Nothing is allocated per value; the CCDictionary of the root is only built if a caller
+* asks for it.
+*/
+class CC_DLL CCPlistDocument : public CCObject
+{
+public:
+    CCPlistDocument();
+    virtual ~CCPlistDocument();
+
+    /** loads a property list, the file name being resolved like CCFileUtils::dictionaryWithContentsOfFile does */
+    static CCPlistDocument* create(const char *pszFile);
+
+    /** loads the file at a full path */
+    bool initWithContentsOfFile(const char *pszFullPath);
+    /** parses an XML or binary property list in memory */
+    bool initWithData(const unsigned char *pData, unsigned long nSize);
+
+    inline CCPlistValue getRoot(void) const { return CCPlistValue(this, m_uRoot); }
+
+    /** The root converted to a CCDictionary on first use, NULL if the root is not a dictionary.
+     The document keeps the ownership.
+     */
+    CCDictionary* getRootDictionary(void);
+    /** The root converted to a CCArray on first use, NULL if the root is not an array. */
+    CCArray* getRootArray(void);
+
+    /** bytes used by the tables of the document */
+    unsigned int getMemoryUsage(void) const;
+
+private:
+    friend class CCPlistValue;
+    friend class CCPlistXMLReader;
+    friend class CCPlistBinaryReader;
+
+    typedef struct _ccPlistNode
+    {
+        unsigned int type;
+        //! children of a container, bytes of a string or data
+        unsigned int count;
+        union
+        {
+            long long    integer;
+            double       real;
+            //! first entry of a container, pool offset of a string or data
+            unsigned int first;
+        } u;
+    } ccPlistNode;
+
+    typedef struct _ccPlistEntry
+    {
+        //! pool offset of the interned key, 0 in arrays
+        unsigned int key;
+        unsigned int node;
+    } ccPlistEntry;
+
+    static const ccPlistNode s_nullNode;
+
+    void clear(void);
+    unsigned int addNode(unsigned int type);
+    unsigned int addString(const char *pText, unsigned int uLength);
+    unsigned int internKey(const char *pText, unsigned int uLength);
+    const ccPlistNode* nodeAt(unsigned int uNode) const;
+    CCObject* copyNode(unsigned int uNode) const;
+
+    std::vector<ccPlistNode>  m_tNodes;
+    std::vector<ccPlistEntry> m_tEntries;
+    std::vector<char>         m_tPool;
+    std::unordered_map<std::string, unsigned int> m_tKeys;
+    unsigned int m_uRoot;
+    CCObject    *m_pRootObject;
+};
+
+// end of data_structures group
+/// @}
+
+NS_CC_END
+
+#endif // __CCPLIST_DOCUMENT_H__
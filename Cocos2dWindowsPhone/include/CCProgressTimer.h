@@ -111,14 +111,13 @@ protected:
 	CC_PROPERTY(CCPoint, m_tMidpoint, Midpoint);
 };
 
+class CCDXProgram;
+
 class CC_DLL CCDXProgressTimer
 {
 public:
 	ID3D11Buffer *m_vertexBuffer;
-	ID3D11VertexShader* m_vertexShader;
-	ID3D11PixelShader* m_pixelShader;
-	ID3D11InputLayout* m_layout;
-	ID3D11Buffer* m_matrixBuffer;
+	CCDXProgram* m_pProgram;
 
 	CCDXProgressTimer();
 	~CCDXProgressTimer();
@@ -133,11 +132,6 @@ public:
 	void Render(ccV2F_C4B_T2F *vertexData,int& vertexDataCount,CCProgressTimerType eType,CCSprite *pSprite);
 	int m_nVertexDataCount2;
 private:
-	struct MatrixBufferType
-	{
-		DirectX::XMMATRIX view;
-		DirectX::XMMATRIX projection;
-	};
 	struct VertexType
 	{
 		DirectX::XMFLOAT3 position;
@@ -0,0 +1,102 @@
+/*
+* cocos2d-x   http://www.cocos2d-x.org
+*
+* Copyright (c) 2010-2011 - cocos2d-x community
+*
+* Portions Copyright (c) Microsoft Open Technologies, Inc.
+* All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on an
+* "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and limitations under the License.
+*/
+
+#ifndef __CCRENDER_PIPELINE_H__
+#define __CCRENDER_PIPELINE_H__
+
+#include <d3d11_1.h>
+#include "CCObject.h"
+#include "ccConfig.h"
+
+NS_CC_BEGIN
+
+/** @brief Counters exposed by CCRenderPipeline */
+typedef struct _ccRenderPipelineStats
+{
+    //! frames handed to the render thread
+    unsigned int uFrames;
+    //! sync points hit by the last frame
+    unsigned int uSyncsLastFrame;
+    //! milliseconds the last frame waited for the render thread to present the one before
+    float fWaitLastFrame;
+} ccRenderPipelineStats;
+
+/** @brief Singleton that overlaps the update of a frame with the rendering of the one before.
+*
+* When it is enabled, CCEGLView records the draws of the main thread in a deferred context.
+* At the end of CCDirector::drawScene, the commands of the frame are handed to a render thread,
+* which executes them and presents while the main thread runs the scheduler, the actions and
+* the visit of the next frame. One frame is in flight at most.
+*
+* The render thread only reports the result of the present: a lost device is recreated on the
+* main thread, by presentFrame or sync, once the frame has been waited for.
+*
+* The immediate context belongs to the render thread meanwhile. Code that needs the GPU
+* results on the CPU, like the read backs of CCRenderTexture and CCTexture2D, or that draws
+* through Direct2D, like the text rendering, calls sync first.
+*/
+class CC_DLL CCRenderPipeline : public CCObject
+{
+public:
+    CCRenderPipeline();
+    virtual ~CCRenderPipeline();
+
+    /** Returns the shared instance of the pipeline */
+    static CCRenderPipeline * sharedRenderPipeline();
+
+    /** purges the pipeline. The frame in flight is presented and the recorded commands executed first. */
+    static void purgeSharedRenderPipeline();
+
+    /** whether the frames are recorded and presented by the render thread. CC_ENABLE_RENDER_PIPELINE by default. */
+    inline bool isEnabled(void) { return m_bRecording; }
+    /** Enables the pipeline. Disabling it waits for the render thread and executes the recorded commands. */
+    void setEnabled(bool bEnabled);
+
+    /** Ends the frame: the render thread executes its commands and presents them.
+     Presents right away when the pipeline is disabled. CCDirector::drawScene calls it.
+     */
+    void presentFrame(void);
+
+    /** Sync point: waits for the render thread and executes the commands recorded so far.
+     The immediate context of CCEGLView is then idle and up to date until the frame is presented.
+     */
+    void sync(void);
+
+    inline const ccRenderPipelineStats& getStats(void) { return m_tStats; }
+
+private:
+    // executes m_pCommandList and presents, on a thread of the pool
+    static void CALLBACK renderFrame(PTP_CALLBACK_INSTANCE pInstance, PVOID pContext, PTP_WORK pWork);
+
+    // waits for the frame in flight, if any, and handles its present. Returns false if the device was lost.
+    bool waitForRenderThread(void);
+
+    bool m_bRecording;
+    bool m_bFrameInFlight;
+    PTP_WORK m_pWork;
+    // commands handed to the render thread
+    ID3D11CommandList *m_pCommandList;
+    // result of the present of the render thread
+    HRESULT m_hPresentResult;
+    unsigned int m_uSyncs;
+    ccRenderPipelineStats m_tStats;
+};
+
+NS_CC_END
+
+#endif // __CCRENDER_PIPELINE_H__
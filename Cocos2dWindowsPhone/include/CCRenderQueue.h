@@ -0,0 +1,155 @@
+/*
+* cocos2d-x   http://www.cocos2d-x.org
+*
+* Copyright (c) 2010-2011 - cocos2d-x community
+*
+* Portions Copyright (c) Microsoft Open Technologies, Inc.
+* All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on an
+* "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and limitations under the License.
+*/
+
+#ifndef __CCRENDER_QUEUE_H__
+#define __CCRENDER_QUEUE_H__
+
+#include <map>
+#include <vector>
+#include <directxmath.h>
+#include "CCObject.h"
+#include "ccTypes.h"
+#include "ccConfig.h"
+
+NS_CC_BEGIN
+
+class CCNode;
+class CCTexture2D;
+
+/** renderers a node can draw with, as reported by CCNode::getRenderState */
+typedef enum
+{
+    //! the node draws in its own way: its commands are never grouped with others
+    kCCRenderShaderNone = 0,
+    kCCRenderShaderSprite,
+    kCCRenderShaderLayerColor,
+    kCCRenderShaderTextureAtlas,
+    kCCRenderShaderDrawNode,
+} ccRenderShader;
+
+/** @brief State a node draws with, used to sort its render command */
+typedef struct _ccRenderState
+{
+    //! commands of a layer are drawn after every command of the lower layers. 0 by default.
+    unsigned char layer;
+    //! one of ccRenderShader
+    unsigned char shader;
+    //! texture sampled by the node, NULL if none
+    CCTexture2D  *texture;
+    ccBlendFunc   blendFunc;
+} ccRenderState;
+
+/** @brief Counters exposed by CCRenderQueue */
+typedef struct _ccRenderQueueStats
+{
+    //! commands drawn by the flushes of the frame
+    unsigned int uCommands;
+    //! runs of commands of the same state drawn by the flushes of the frame
+    unsigned int uBatches;
+} ccRenderQueueStats;
+
+/** @brief Singleton that collects the draws of a frame as sortable render commands.
+*
+* When it is enabled, CCNode::visit queues a command with the node and its transform instead of
+* calling draw. flush sorts the commands by a 64 bits key, from the most significant bits:
+* layer (8), depth (20), shader (8), texture (20) and blend function (8), and draws them.
+* The depth is the place of the command in the scene graph when the order is strict. Otherwise
+* it is the first batch of commands the command can join without being drawn before something
+* it overlaps on screen, so blended nodes keep their order wherever it shows.
+* Each command is still drawn by its own node: sorting only brings the commands of the same state
+* next to each other, so the state caches skip the changes between them.
+* Plain containers (CCNode, CCLayer, CCScene, CCMenu and the like) draw nothing and are not queued.
+*
+* The queue is flushed at the end of CCDirector::drawScene and by the code that changes the
+* render target: CCGridBase and CCRenderTexture.
+*/
+class CC_DLL CCRenderQueue : public CCObject
+{
+public:
+    CCRenderQueue();
+    virtual ~CCRenderQueue();
+
+    /** Returns the shared instance of the queue */
+    static CCRenderQueue * sharedRenderQueue();
+
+    /** purges the queue. The queued commands are drawn first. */
+    static void purgeSharedRenderQueue();
+
+    /** whether the nodes are queued. CC_ENABLE_RENDER_QUEUE by default. */
+    inline bool isEnabled(void) { return m_bEnabled; }
+    /** Enables the queue. Disabling it draws the queued commands. */
+    void setEnabled(bool bEnabled);
+
+    /** whether the commands are drawn in the order of the scene graph. CC_RENDER_QUEUE_STRICT_ORDER by default. */
+    inline bool isStrictOrder(void) { return m_bStrictOrder; }
+    inline void setStrictOrder(bool bStrictOrder) { m_bStrictOrder = bStrictOrder; }
+
+    /** Queues the draw of pNode with the current view and projection matrices.
+     The node is drawn right away when the queue is disabled or being flushed, and skipped when it is a plain container.
+     */
+    void addCommand(CCNode *pNode);
+
+    /** Sorts and draws the queued commands */
+    void flush(void);
+
+    /** counters of the frame, added up by each flush */
+    inline const ccRenderQueueStats& getStats(void) { return m_tStats; }
+    /** Resets the counters, at the start of a frame */
+    inline void resetStats(void) { memset(&m_tStats, 0, sizeof(m_tStats)); }
+
+private:
+    typedef struct _ccRenderCommand
+    {
+        CCNode *pNode;
+        DirectX::XMFLOAT4X4 tView;
+        DirectX::XMFLOAT4X4 tProjection;
+        //! layer, shader, texture and blend bits of the key
+        unsigned long long uState;
+        //! false if the command can be grouped with no other
+        bool bMergeable;
+        //! bounds on screen, in normalized device coordinates
+        CCRect tBounds;
+    } ccRenderCommand;
+
+    typedef struct _ccRenderBatch
+    {
+        unsigned long long uState;
+        bool bMergeable;
+        CCRect tBounds;
+    } ccRenderBatch;
+
+    unsigned int textureId(CCTexture2D *pTexture);
+    unsigned int blendId(const ccBlendFunc& blendFunc);
+    // index of the batch the command is drawn with, in a frame that isn't strictly ordered
+    unsigned int batchForCommand(const ccRenderCommand& command);
+
+    bool m_bEnabled;
+    bool m_bStrictOrder;
+    bool m_bFlushing;
+    std::vector<ccRenderCommand> m_tCommands;
+    // key and index of each command, sorted by flush
+    std::vector<std::pair<unsigned long long, unsigned int> > m_tKeys;
+    std::vector<ccRenderBatch> m_tBatches;
+    std::map<CCTexture2D*, unsigned int> m_tTextureIds;
+    std::map<unsigned int, unsigned int> m_tBlendIds;
+    ccRenderQueueStats m_tStats;
+};
+
+NS_CC_END
+
+#endif // __CCRENDER_QUEUE_H__
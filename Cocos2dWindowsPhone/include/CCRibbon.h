@@ -79,6 +79,8 @@ public:
 	float sideOfLine(const CCPoint& p, const CCPoint& l1, const CCPoint& l2);
 	// super method
 	virtual void draw();
+	//! the segments are drawn in world space: the ribbon is never culled
+	virtual bool getCullingRectInPixels(CCRect *pRect);
 private:
 	/** rotates a point around 0, 0 */
 	CCPoint rotatePoint(const CCPoint& vec, float rotation);
@@ -125,15 +127,13 @@ public:
 	static CCDXRibbonSegment mDXRibbonSegment;
 };
 
+class CCDXProgram;
+
 class CC_DLL CCDXRibbonSegment
 {
 public:
 	ID3D11Buffer *m_vertexBuffer;
-
-	ID3D11VertexShader* m_vertexShader;
-	ID3D11PixelShader* m_pixelShader;
-	ID3D11InputLayout* m_layout;
-	ID3D11Buffer* m_matrixBuffer;
+	CCDXProgram* m_pProgram;
 
 	CCDXRibbonSegment();
 	~CCDXRibbonSegment();
@@ -147,11 +147,6 @@ public:
 	void RenderShader(unsigned int begin,unsigned int end,CCTexture2D* texture);
 	void Render(CCfloat* verts,CCfloat* coords,CCubyte* colors,unsigned int begin,unsigned int end,CCTexture2D* texture);
 private:
-	struct MatrixBufferType
-	{
-		DirectX::XMMATRIX view;
-		DirectX::XMMATRIX projection;
-	};
 	struct VertexType
 	{
 		DirectX::XMFLOAT3 position;
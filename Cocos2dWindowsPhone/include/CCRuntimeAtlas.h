@@ -0,0 +1,155 @@
+/*
+* cocos2d-x   http://www.cocos2d-x.org
+*
+* Copyright (c) 2010-2011 - cocos2d-x community
+*
+* Portions Copyright (c) Microsoft Open Technologies, Inc.
+* All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on an
+* "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and limitations under the License.
+*/
+
+#ifndef __CCRUNTIME_ATLAS_H__
+#define __CCRUNTIME_ATLAS_H__
+
+#include <map>
+#include <string>
+#include <vector>
+#include "CCObject.h"
+#include "ccConfig.h"
+
+NS_CC_BEGIN
+
+class CCTexture2D;
+class CCSpriteFrame;
+class CCImage;
+
+/** @brief Counters exposed by CCRuntimeAtlas */
+typedef struct _ccRuntimeAtlasStats
+{
+    unsigned int uImages;
+    unsigned int uPages;
+    //! images that didn't fit and were given their own texture
+    unsigned int uFallbacks;
+    unsigned int uRepacks;
+    //! pixels of the pages covered by images, padding included
+    unsigned int uUsedPixels;
+} ccRuntimeAtlasStats;
+
+/** @brief Singleton that packs small images into shared RGBA8888 pages at runtime.
+*
+* Images are loaded like CCTextureCache::addImage does, keyed by their full path, and placed with
+* the MaxRects algorithm (best short side fit). Each image is extruded by CC_RUNTIME_ATLAS_EXTRUDE
+* pixels and separated from its neighbours by CC_RUNTIME_ATLAS_PADDING transparent pixels, so
+* linear filtering doesn't bleed. Sprites made from the returned frames share the page textures,
+* so a CCSpriteBatchNode can draw them in one call.
+*
+* When no page has room, the pages that have lost images and that no sprite uses any more are
+* repacked on the GPU; then a page is added, up to CC_RUNTIME_ATLAS_MAX_PAGES. Images that still
+* don't fit, or that are bigger than a page, get their own texture from CCTextureCache.
+*
+* Pixels are premultiplied: use the blending mode (CC_ONE, CC_ONE_MINUS_SRC_ALPHA).
+*/
+class CC_DLL CCRuntimeAtlas : public CCObject
+{
+public:
+    CCRuntimeAtlas();
+    virtual ~CCRuntimeAtlas();
+
+    char * description(void);
+
+    /** Returns the shared instance of the atlas */
+    static CCRuntimeAtlas * sharedRuntimeAtlas();
+
+    /** purges the atlas. It releases the retained instance and all its pages. */
+    static void purgeSharedRuntimeAtlas();
+
+    /** Returns the sprite frame of an image file, packing the image if it isn't in the atlas yet.
+     Supported image extensions: .png, .jpg
+     @return the frame, owned by the atlas, or NULL if the image can't be loaded
+     */
+    CCSpriteFrame* addImage(const char *pszFile);
+
+    /** Packs an image already in memory under a key.
+     @return the frame, owned by the atlas, or NULL if the image isn't valid
+     */
+    CCSpriteFrame* addUIImage(CCImage *pImage, const char *pszKey);
+
+    /** Returns the frame of an image already in the atlas, NULL otherwise */
+    CCSpriteFrame* spriteFrameForKey(const char *pszKey);
+
+    /** Removes an image. Sprites may still show it: its space is only reused once no sprite uses its page. */
+    void removeImageForKey(const char *pszKey);
+
+    /** Removes every image and releases the pages */
+    void removeAllImages(void);
+
+    /** Repacks the pages that lost images and that no sprite uses, and releases the empty ones.
+     It runs by itself when the pages are full.
+     @return the number of pages repacked or released
+     */
+    unsigned int defragment(void);
+
+    /** number of pages */
+    inline unsigned int getPageCount(void) { return (unsigned int)m_tPages.size(); }
+    /** texture of a page, NULL if the page doesn't exist */
+    CCTexture2D* textureForPage(unsigned int page);
+
+    inline const ccRuntimeAtlasStats& getStats(void) { return m_tStats; }
+
+private:
+    typedef struct _ccAtlasRect
+    {
+        unsigned int x;
+        unsigned int y;
+        unsigned int width;
+        unsigned int height;
+    } ccAtlasRect;
+
+    typedef struct _ccAtlasPage
+    {
+        CCTexture2D              *pTexture;
+        std::vector<ccAtlasRect>  freeRects;
+        //! rects of removed images, kept out of freeRects while the page may still be on screen
+        std::vector<ccAtlasRect>  pendingRects;
+        //! pixels freed by removed images since the page was last packed
+        unsigned int              uFreedPixels;
+    } ccAtlasPage;
+
+    typedef struct _ccAtlasEntry
+    {
+        CCSpriteFrame *pFrame;
+        //! -1 for the images that have their own texture
+        int            nPage;
+        //! padded and extruded rect in the page
+        ccAtlasRect    rect;
+    } ccAtlasEntry;
+
+    CCSpriteFrame* addRGBA8888Image(const unsigned char *pData, unsigned int width, unsigned int height, const std::string& key);
+    bool allocate(unsigned int width, unsigned int height, int *pPage, ccAtlasRect *pRect);
+    bool addPage(void);
+    bool repackPage(unsigned int page);
+    bool isPageInUse(unsigned int page);
+    void reclaimPendingRects(unsigned int page);
+    void releasePage(unsigned int page);
+
+    static bool findPosition(const std::vector<ccAtlasRect>& freeRects, unsigned int width, unsigned int height, ccAtlasRect *pRect);
+    static void placeRect(std::vector<ccAtlasRect>& freeRects, const ccAtlasRect& used);
+    static void pruneFreeRects(std::vector<ccAtlasRect>& freeRects);
+
+protected:
+    std::map<std::string, ccAtlasEntry> m_tEntries;
+    std::vector<ccAtlasPage>            m_tPages;
+    ccRuntimeAtlasStats                 m_tStats;
+};
+
+NS_CC_END
+
+#endif // __CCRUNTIME_ATLAS_H__
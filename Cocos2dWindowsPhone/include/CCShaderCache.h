@@ -27,20 +27,60 @@ THE SOFTWARE.
 #ifndef __CCSHADERCACHE_H__
 #define __CCSHADERCACHE_H__
 
+#include <d3d11_1.h>
+#include <directxmath.h>
 #include "CCDictionary.h"
+#include "ccConfig.h"
 
 NS_CC_BEGIN
 
-class CCGLProgram;
-
 /**
  * @addtogroup shaders
  * @{
  */
 
+// keys of the default programs
+#define kCCShader_Sprite                "ShaderSprite"
+#define kCCShader_TextureAtlas          "ShaderTextureAtlas"
+#define kCCShader_Particle              "ShaderParticle"
+#define kCCShader_ProgressTimer         "ShaderProgressTimer"
+#define kCCShader_Grid                  "ShaderGrid"
+#define kCCShader_LayerColor            "ShaderLayerColor"
+#define kCCShader_Drawing               "ShaderDrawing"
+#define kCCShader_DrawNode              "ShaderDrawNode"
+
+/** CCDXProgram
+ The vertex shader, the pixel shader and the input layout a renderer draws with.
+ Every vertex shader reads the view and projection matrices from the constant buffer of CCShaderCache.
+ */
+class CC_DLL CCDXProgram : public CCObject
+{
+public:
+    CCDXProgram();
+    virtual ~CCDXProgram();
+
+    /** Initializes the program with the compiled shaders of the package and the layout of the vertices it draws */
+    bool initWithShaderFiles(const wchar_t *pszVertexShaderFile, const wchar_t *pszPixelShaderFile,
+        const D3D11_INPUT_ELEMENT_DESC *pLayoutDesc, unsigned int uLayoutElements);
+
+    /** Binds the input layout and the shaders, and sets the requested blend and depth stencil states, through the state cache */
+    void use(void);
+
+    inline ID3D11VertexShader* getVertexShader(void) { return m_pVertexShader; }
+    inline ID3D11PixelShader* getPixelShader(void) { return m_pPixelShader; }
+    inline ID3D11InputLayout* getInputLayout(void) { return m_pInputLayout; }
+
+private:
+    ID3D11VertexShader *m_pVertexShader;
+    ID3D11PixelShader *m_pPixelShader;
+    ID3D11InputLayout *m_pInputLayout;
+};
+
 /** CCShaderCache
- Singleton that stores manages GL shaders
- @since v2.0
+ Singleton that stores the programs of the renderers, so each shader is created once,
+ and the constant buffer of the view and projection matrices they share.
+ When CC_ENABLE_SHADER_BINARY_CACHE is enabled, the compiled shaders are saved in a single
+ file of the writable path the first time, and read from it at once on the next launches.
  */
 class CC_DLL CCShaderCache : public CCObject 
 {
@@ -56,22 +96,28 @@ public:
 
     /** loads the default shaders */
     void loadDefaultShaders();
-    
-    /** reload the default shaders */
-    void reloadDefaultShaders();
 
-    /** returns a GL program for a given key */
-    CCGLProgram * programForKey(const char* key);
+    /** returns a program for a given key */
+    CCDXProgram * programForKey(const char* key);
+
+    /** adds a CCDXProgram to the cache for a given name */
+    void addProgram(CCDXProgram* program, const char* key);
 
-    /** adds a CCGLProgram to the cache for a given name */
-    void addProgram(CCGLProgram* program, const char* key);
+    /** Binds the matrix constant buffer to the vertex shader, with the view and projection matrices.
+     The buffer is only written when the matrices changed since the last time, or when it is bound anew.
+     */
+    bool useMatrixBuffer(DirectX::CXMMATRIX viewMatrix, DirectX::CXMMATRIX projectionMatrix);
 
 private:
     bool init();
-    void loadDefaultShader(CCGLProgram *program, int type);
+    void loadDefaultProgram(const char *key, const wchar_t *pszVertexShaderFile, const wchar_t *pszPixelShaderFile,
+        const D3D11_INPUT_ELEMENT_DESC *pLayoutDesc, unsigned int uLayoutElements);
 
     CCDictionary* m_pPrograms;
-
+    ID3D11Buffer* m_pMatrixBuffer;
+    // matrices in the buffer, transposed
+    DirectX::XMFLOAT4X4 m_tView;
+    DirectX::XMFLOAT4X4 m_tProjection;
 };
 
 // end of shaders group
@@ -95,6 +95,7 @@ class CC_DLL CCSprite : public CCNode, public CCTextureProtocol, public CCRGBAPr
 	CC_PROPERTY_PASS_BY_REF(ccColor3B, m_sColor, Color);
 public:
 	virtual void draw(void);
+	virtual bool getRenderState(ccRenderState *pState);
 
 public:
 	// attributes
@@ -430,14 +431,11 @@ protected:
 	static CCDXSprite mDXSprite;
 };
 
+class CCDXProgram;
+
 class CC_DLL CCDXSprite
 {
 private:
-	_declspec(align(16)) struct MatrixBufferType
-	{
-		DirectX::XMMATRIX view;
-		DirectX::XMMATRIX projection;
-	};
 	_declspec(align(16)) struct VertexType
 	{
 		DirectX::XMFLOAT3 position;
@@ -450,13 +448,12 @@ private:
 	};
 
 	bool mIsInit;
+	// istexture[0] of the texture color buffer, -1 until it is written
+	int m_iTextureColor;
 public:
 	ID3D11Buffer *m_vertexBuffer;
 	ID3D11Buffer* m_indexBuffer;
-	ID3D11VertexShader* m_vertexShader;
-	ID3D11PixelShader* m_pixelShader;
-	ID3D11InputLayout* m_layout;
-	ID3D11Buffer* m_matrixBuffer;
+	CCDXProgram* m_pProgram;
 	ID3D11Buffer* m_textureColorBuffer;
 
 	CCDXSprite();
@@ -138,6 +138,7 @@ public:
 	virtual void removeChild(CCNode* child, bool cleanup);
 	virtual void removeAllChildrenWithCleanup(bool cleanup);
 	virtual void draw(void);
+	virtual bool getRenderState(ccRenderState *pState);
 
 protected:
 	/* IMPORTANT XXX IMPORTNAT:
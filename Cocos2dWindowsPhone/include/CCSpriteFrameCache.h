@@ -44,6 +44,7 @@ THE SOFTWARE.
 
 NS_CC_BEGIN
 class CCSprite;
+class CCPlistValue;
 
 /** @brief Singleton that handles the loading of the sprite frames.
  It saves in a cache the sprite frames.
@@ -55,9 +56,9 @@ public:
 	bool init(void);
 	~CCSpriteFrameCache(void);
 private:
-	/*Adds multiple Sprite Frames with a dictionary. The texture will be associated with the created sprite frames.
+	/*Adds multiple Sprite Frames from the typed document of a plist. The texture will be associated with the created sprite frames.
 	 */
-	void addSpriteFramesWithDictionary(CCDictionary *pobDictionary, CCTexture2D *pobTexture);
+	void addSpriteFramesWithPlist(const CCPlistValue& plist, CCTexture2D *pobTexture);
 public:
 	/** Adds multiple Sprite Frames from a plist file.
 	 * A texture will be loaded automatically. The texture name will composed by replacing the .plist suffix with .png
@@ -73,6 +74,23 @@ public:
 	/** Adds multiple Sprite Frames from a plist file. The texture will be associated with the created sprite frames. */
 	void addSpriteFramesWithFile(const char *pszPlist, CCTexture2D *pobTexture);
 
+	/** Adds multiple Sprite Frames from a binary sprite sheet (.ccsf) written by writeBinarySpriteFramesFile.
+	 * The frames are read straight from the frame table, without building a dictionary.
+	 * The texture is the one recorded by the converter, or the file name with the suffix replaced by .png.
+	 * addSpriteFramesWithFile also accepts .ccsf files.
+	 */
+	void addSpriteFramesWithBinaryFile(const char *pszFile);
+
+	/** Adds multiple Sprite Frames from a binary sprite sheet (.ccsf). The texture will be associated with the created sprite frames. */
+	void addSpriteFramesWithBinaryFile(const char *pszFile, CCTexture2D *pobTexture);
+
+	/** Converts a Zwoptex/TexturePacker plist (formats 0 to 3) to the binary sprite sheet format.
+	 * Meant to be run offline, e.g. from a desktop build of the tools, and the .ccsf shipped instead of the .plist.
+	 * The file is written in the byte order of the machine running the converter, i.e. little endian.
+	 * @return false if the plist can't be read or the output can't be written
+	 */
+	static bool writeBinarySpriteFramesFile(const char *pszPlist, const char *pszOutFile);
+
 	/** Adds an sprite frame with a given name.
 	 If the name already exists, then the contents of the old name will be replaced with the new one.
 	 */
@@ -106,6 +124,12 @@ private:
 	* @since v0.99.5
 	*/
 	void removeSpriteFramesFromDictionary(CCDictionary *dictionary);
+
+	/* Adds the frames of a binary sprite sheet already in memory. */
+	void addSpriteFramesWithBinaryData(const unsigned char *pData, unsigned long nSize, CCTexture2D *pobTexture);
+
+	/* Removes the frames of a binary sprite sheet already in memory. */
+	void removeSpriteFramesFromBinaryData(const unsigned char *pData, unsigned long nSize);
 public:
 	/** Removes all Sprite Frames associated with the specified textures.
 	* It is convinient to call this method when a specific texture needs to be removed.
@@ -30,13 +30,37 @@ THE SOFTWARE.
 #include "CCAtlasNode.h"
 #include "CCSpriteBatchNode.h"
 #include "CCTMXXMLParser.h"
+#include "ccConfig.h"
 NS_CC_BEGIN
 
 class CCTMXMapInfo;
 class CCTMXLayerInfo;
 class CCTMXTilesetInfo;
+class CCTextureAtlas;
 struct _ccCArray;
 
+/** quad index of a chunk tile that has no quad */
+#define kCCTMXTileNoQuad    0x7fff
+/** set on the quad index of a chunk tile queued for an in place update */
+#define kCCTMXTileQueued    0x8000
+
+/** @brief A rectangular block of tiles of a CCTMXLayer with its own quads.
+ The atlas is NULL until the chunk has been visible at least once, and for chunks without tiles.
+ A tile keeps its quad index until the chunk is regenerated, so editing it only rewrites that quad.
+ */
+typedef struct _ccTMXTileChunk
+{
+    CCTextureAtlas  *pAtlas;
+    //! quad index of every tile of the chunk, row major
+    unsigned short  *pQuadIndices;
+    //! index of the first quad of every row of the chunk, CC_TMX_LAYER_CHUNK_SIZE + 1 entries
+    unsigned short  *pRowQuads;
+    //! chunk-local indices of the tiles whose quad has to be rewritten
+    struct _ccCArray *pDirtyTiles;
+    //! the quads have to be (re)generated from the GID map
+    bool            bDirty;
+} ccTMXTileChunk;
+
 /**
  * @addtogroup tilemap_parallax_nodes
  * @{
@@ -44,8 +68,14 @@ struct _ccCArray;
 
 /** @brief CCTMXLayer represents the TMX layer.
 
-It is a subclass of CCSpriteBatchNode. By default the tiles are rendered using a CCTextureAtlas.
-If you modify a tile on runtime, then, that tile will become a CCSprite, otherwise no CCSprite objects are created.
+It is a subclass of CCSpriteBatchNode. The layer is split into chunks of CC_TMX_LAYER_CHUNK_SIZE x CC_TMX_LAYER_CHUNK_SIZE tiles,
+each one rendered with its own CCTextureAtlas. Only the chunks that intersect the screen are drawn, and the quads of a chunk are
+generated the first time it becomes visible, so memory and draw time grow with the viewport instead of the map size.
+When the tiles can overlap (isometric and hexagonal maps, tiles bigger than the map tiles, tiles converted into CCSprite),
+the quads of the visible chunks are gathered row by row, in the z order of the map, and drawn at once instead of chunk by chunk.
+If you ask for a tile with tileAt(), then that tile will become a CCSprite, otherwise no CCSprite objects are created.
+Editing tiles with setTileGID(), setTileGIDs() or removeTileAt() only updates the GID map and the quad of the tile in its chunk,
+so an edit costs the same regardless of the map size.
 The benefits of using CCSprite objects as tiles are:
 - tiles (CCSprite) can be rotated/scaled/moved with a nice API
 
@@ -98,6 +128,8 @@ public:
     /** dealloc the map that contains the tile position from memory.
     Unless you want to know at runtime the tiles positions, you can safely call this method.
     If you are going to call layer->tileGIDAt() then, don't release the map
+    @warning the chunks that were not generated yet are built before the map is released, so the
+    memory savings of lazy chunk generation are lost.
     */
     void releaseMap();
 
@@ -124,6 +156,7 @@ public:
     /** sets the tile gid (gid = tile global id) at a given tile coordinate.
     The Tile GID can be obtained by using the method "tileGIDAt" or by using the TMX editor -> Tileset Mgr +1.
     If a tile is already placed at that position, then it will be removed.
+    No CCSprite is created: the quad of the tile is rewritten the next time its chunk is drawn.
     */
     void setTileGID(unsigned int gid, const CCPoint& tileCoordinate);
 
@@ -136,6 +169,12 @@ public:
 
     void setTileGID(unsigned int gid, const CCPoint& tileCoordinate, ccTMXTileFlags flags);
 
+    /** sets the gids (including the tile flags) of a rectangle of tiles.
+     gids holds size.width * size.height values in row major order. A gid of 0 removes the tile.
+     Tiles converted into CCSprite by tileAt() are updated as with setTileGID.
+     */
+    void setTileGIDs(const unsigned int *gids, const CCPoint& origin, const CCSize& size);
+
     /** removes a tile at given tile coordinate */
     void removeTileAt(const CCPoint& tileCoordinate);
 
@@ -148,6 +187,16 @@ public:
     /** Creates the tiles */
     void setupTiles();
 
+    /** draws the visible chunks, and the tiles converted into CCSprite in their z order */
+    virtual void draw(void);
+
+    /** number of chunks the layer is split into */
+    inline unsigned int getChunkCount() { return m_uChunksWide * m_uChunksHigh; }
+    /** number of chunks whose quads have already been generated */
+    unsigned int getBuiltChunkCount();
+    /** number of chunks drawn in the last frame */
+    inline unsigned int getVisibleChunkCount() { return m_uVisibleChunks; }
+
     /** CCTMXLayer doesn't support adding a CCSprite manually.
     @warning addchild(z, tag); is not supported on CCTMXLayer. Instead of setTileGID.
     */
@@ -164,19 +213,29 @@ private:
 
     CCPoint calculateLayerOffset(const CCPoint& offset);
 
-    /* optimization methods */
-    CCSprite* appendTileForGID(unsigned int gid, const CCPoint& pos);
-    CCSprite* insertTileForGID(unsigned int gid, const CCPoint& pos);
-    CCSprite* updateTileForGID(unsigned int gid, const CCPoint& pos);
+    CCPoint positionInPixelsAt(const CCPoint& pos);
+
+    /* chunk methods */
+    ccTMXTileChunk* chunkForTile(unsigned int x, unsigned int y);
+    void markTileDirty(unsigned int x, unsigned int y);
+    void buildChunk(unsigned int cx, unsigned int cy);
+    void updateDirtyTiles(unsigned int cx, unsigned int cy);
+    bool hasSpriteForZ(unsigned int z);
+    void fillQuadForGID(ccV3F_C4B_T2F_Quad *quad, unsigned int gid, unsigned int x, unsigned int y);
+    bool visibleTileRange(int *x0, int *y0, int *x1, int *y1);
+    bool needsOrderedDraw();
+    unsigned int chunkQuadForColumn(ccTMXTileChunk *chunk, unsigned int row, unsigned int column);
+    void drawOrdered(int cx0, int cy0, int cx1, int cy1);
+    void gatherOrderedQuads(int cx0, int cy0, int cx1, int cy1);
+    void setTileGIDAndFlags(unsigned int gidAndFlags, unsigned int x, unsigned int y);
+    void releaseChunks();
 
     /* The layer recognizes some special properties, like cc_vertez */
     void parseInternalProperties();
     void setupTileSprite(CCSprite* sprite, CCPoint pos, unsigned int gid);
-    CCSprite* reusedTileWithRect(CCRect rect);
     int vertexZForPos(const CCPoint& pos);
 
     // index
-    unsigned int atlasIndexForExistantZ(unsigned int z);
     unsigned int atlasIndexForNewZ(int z);
 protected:
     //! name of the layer
@@ -191,9 +250,20 @@ protected:
     int                    m_nVertexZvalue;
     bool                m_bUseAutomaticVertexZ;
 	float				m_fAlphaFuncValue;
-    //! used for optimization
-    CCSprite            *m_pReusedTile;
+    //! z of the tiles converted into CCSprite, sorted. Maps the quads of m_pobTextureAtlas to tiles.
     ccCArray            *m_pAtlasIndexArray;
+
+    //! chunks, row major, m_uChunksWide * m_uChunksHigh entries
+    ccTMXTileChunk      *m_pChunks;
+    unsigned int        m_uChunksWide;
+    unsigned int        m_uChunksHigh;
+    unsigned int        m_uVisibleChunks;
+    //! quads of the visible chunks and of the converted tiles, gathered in z order when they can overlap
+    CCTextureAtlas      *m_pOrderedAtlas;
+    //! chunks gathered in m_pOrderedAtlas: cx0, cy0, cx1, cy1
+    int                 m_nOrderedChunks[4];
+    //! a visible chunk changed since its quads were gathered
+    bool                m_bOrderedDirty;
     
     // used for retina display
     float               m_fContentScaleFactor;            
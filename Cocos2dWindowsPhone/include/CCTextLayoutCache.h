@@ -0,0 +1,179 @@
+/*
+* cocos2d-x   http://www.cocos2d-x.org
+*
+* Copyright (c) 2010-2011 - cocos2d-x community
+*
+* Portions Copyright (c) Microsoft Open Technologies, Inc.
+* All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on an
+* "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and limitations under the License.
+*/
+
+#ifndef __CCTEXT_LAYOUT_CACHE_H__
+#define __CCTEXT_LAYOUT_CACHE_H__
+
+#include <map>
+#include <string>
+#include <vector>
+#include "CCObject.h"
+#include "ccTypes.h"
+#include "ccConfig.h"
+
+NS_CC_BEGIN
+
+/**
+ * @addtogroup GUI
+ * @{
+ * @addtogroup label
+ * @{
+ */
+
+/** @brief Horizontal metrics of a glyph, in pixels */
+typedef struct _ccTextGlyphMetrics
+{
+    //! offset from the pen position to the left edge of the glyph image
+    int xOffset;
+    //! width of the glyph image
+    int width;
+    //! amount the pen moves after the glyph
+    int xAdvance;
+} ccTextGlyphMetrics;
+
+/** @brief A font as seen by CCTextLayoutCache.
+ Implemented by CCBMFontConfiguration and, for the current font, by CCGlyphAtlasCache.
+ */
+class CC_DLL CCTextLayoutFont
+{
+public:
+    virtual ~CCTextLayoutFont() {}
+
+    /** name identifying the font and its size; part of the cache key */
+    virtual const char* getLayoutFontKey(void) = 0;
+    /** fills the metrics of a character. Characters the font doesn't have are skipped. */
+    virtual bool getGlyphMetrics(unsigned short c, ccTextGlyphMetrics *pMetrics) = 0;
+    /** extra horizontal space between two characters, in pixels */
+    virtual int getKerningAmount(unsigned short first, unsigned short second) = 0;
+};
+
+/** @brief A character placed by the layout */
+typedef struct _ccTextLayoutGlyph
+{
+    //! index of the character in the laid out text
+    unsigned int uIndex;
+    unsigned short c;
+    unsigned int uLine;
+    //! pen position in pixels, relative to the start of the line; add the line offset to align it
+    float x;
+    ccTextGlyphMetrics metrics;
+} ccTextLayoutGlyph;
+
+/** @brief A line of the layout */
+typedef struct _ccTextLayoutLine
+{
+    unsigned int uFirstGlyph;
+    unsigned int uGlyphCount;
+    //! index in the text where the line starts
+    unsigned int uFirstChar;
+    //! width of the line in pixels
+    float fWidth;
+    //! shift applied to every glyph of the line by the alignment, in pixels
+    float fOffset;
+} ccTextLayoutLine;
+
+/** @brief Wrapped and aligned lines of a text. Layouts are immutable once built. */
+class CC_DLL CCTextLayout : public CCObject
+{
+public:
+    CCTextLayout();
+    virtual ~CCTextLayout();
+
+    inline unsigned int getGlyphCount(void) { return (unsigned int)m_tGlyphs.size(); }
+    inline const ccTextLayoutGlyph& getGlyph(unsigned int index) { return m_tGlyphs[index]; }
+
+    /** there is always at least one line, possibly empty */
+    inline unsigned int getLineCount(void) { return (unsigned int)m_tLines.size(); }
+    inline const ccTextLayoutLine& getLine(unsigned int index) { return m_tLines[index]; }
+
+    /** width of the longest line in pixels */
+    inline float getWidth(void) { return m_fWidth; }
+
+protected:
+    friend class CCTextLayoutCache;
+
+    std::vector<unsigned short>    m_tText;
+    std::string                    m_sFontKey;
+    float                          m_fMaxWidth;
+    CCTextAlignment                m_eAlignment;
+    bool                           m_bLineBreakWithoutSpaces;
+
+    std::vector<ccTextLayoutGlyph> m_tGlyphs;
+    std::vector<ccTextLayoutLine>  m_tLines;
+    float                          m_fWidth;
+    unsigned int                   m_uLastUsed;
+};
+
+/** @brief Singleton that breaks texts into lines and aligns them, keeping the result.
+*
+* Layouts are keyed by text, font, maximum width, alignment and line break mode, and
+* the CC_TEXT_LAYOUT_CACHE_SIZE most recently used ones are kept. When a label passes
+* its previous layout, only the lines from the first changed character on are laid out again.
+*/
+class CC_DLL CCTextLayoutCache : public CCObject
+{
+public:
+    CCTextLayoutCache();
+    virtual ~CCTextLayoutCache();
+
+    char * description(void);
+
+    /** Returns the shared instance of the cache */
+    static CCTextLayoutCache * sharedTextLayoutCache();
+
+    /** purges the cache. It releases the retained instance. */
+    static void purgeSharedTextLayoutCache();
+
+    /** Returns the layout of a UTF-16 text.
+     @param maxWidth lines are wrapped at this width in pixels; 0 or less doesn't wrap
+     @param pPrevious layout of an earlier text of the same label; the lines before the first difference are reused
+     The cache keeps the ownership of the returned layout: retain it to keep it.
+     */
+    CCTextLayout* layoutForText(const unsigned short *text, unsigned int length, CCTextLayoutFont *pFont,
+                                float maxWidth, CCTextAlignment alignment, bool lineBreakWithoutSpaces,
+                                CCTextLayout *pPrevious = NULL);
+
+    /** forgets a layout, e.g. when it was built with metrics that turned out to be temporary */
+    void removeLayout(CCTextLayout *pLayout);
+
+    /** forgets every layout. Layouts retained by labels stay valid. */
+    void removeAllLayouts(void);
+
+    inline unsigned int getHits(void) { return m_uHits; }
+    inline unsigned int getMisses(void) { return m_uMisses; }
+    /** number of misses that reused lines of a previous layout */
+    inline unsigned int getPartialLayouts(void) { return m_uPartialLayouts; }
+
+private:
+    void layoutLines(CCTextLayout *pLayout, CCTextLayoutFont *pFont, CCTextLayout *pPrevious);
+
+protected:
+    std::map<std::string, CCTextLayout*> m_tLayouts;
+    unsigned int m_uClock;
+    unsigned int m_uHits;
+    unsigned int m_uMisses;
+    unsigned int m_uPartialLayouts;
+};
+
+// end of label group
+/// @}
+/// @}
+
+NS_CC_END
+
+#endif // __CCTEXT_LAYOUT_CACHE_H__
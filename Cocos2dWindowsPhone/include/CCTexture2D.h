@@ -32,11 +32,12 @@ THE SOFTWARE.
 #include "ccTypes.h"
 
 #include "CCConfiguration.h"
+#include "CCImage.h"
+#include "CCGPUUploadQueue.h"
 
 #include <vector>
 
 NS_CC_BEGIN
-class CCImage;
 
 //CONSTANTS:
 
@@ -65,6 +66,16 @@ typedef enum {
 	kCCTexture2DPixelFormat_PVRTC4,
 	//! 2-bit PVRTC-compressed texture: PVRTC2
 	kCCTexture2DPixelFormat_PVRTC2,
+	//! 4-bit BC1 (DXT1) compressed texture, with 1-bit alpha
+	kCCTexture2DPixelFormat_BC1,
+	//! 8-bit BC3 (DXT5) compressed texture
+	kCCTexture2DPixelFormat_BC3,
+	//! 4-bit ETC2 compressed texture, ETC1 included; decoded to RGBA8888 on load
+	kCCTexture2DPixelFormat_ETC2_RGB,
+	//! 4-bit ETC2 compressed texture with 1-bit alpha; decoded to RGBA8888 on load
+	kCCTexture2DPixelFormat_ETC2_RGB_A1,
+	//! 8-bit ETC2 + EAC alpha compressed texture; decoded to RGBA8888 on load
+	kCCTexture2DPixelFormat_ETC2_RGBA,
 
 	//! Default texture format: RGBA8888
 	kCCTexture2DPixelFormat_Default = kCCTexture2DPixelFormat_RGBA8888,
@@ -99,7 +110,7 @@ typedef struct _ccTexParams {
 * Depending on how you create the CCTexture2D object, the actual image area of the texture might be smaller than the texture dimensions i.e. "contentSize" != (pixelsWide, pixelsHigh) and (maxS, maxT) != (1.0, 1.0).
 * Be aware that the content of the generated textures will be upside-down!
 */
-class CC_DLL CCTexture2D : public CCObject
+class CC_DLL CCTexture2D : public CCObject, public CCGPUUploadDelegate
 {
 	/** pixel format of the texture */
 	CC_PROPERTY_READONLY(CCTexture2DPixelFormat, m_ePixelFormat, PixelFormat)
@@ -118,6 +129,8 @@ class CC_DLL CCTexture2D : public CCObject
 	/** texture max T */
 	CC_PROPERTY(CCfloat, m_fMaxT, MaxT)
     bool hasPremultipliedAlpha();
+	/** for textures filled with premultiplied data through initWithData or updateWithData */
+	void setHasPremultipliedAlpha(bool hasPremultipliedAlpha);
 	CC_PROPERTY(ccResolutionType, m_eResolutionType, ResolutionType);
 public:
 
@@ -136,6 +149,16 @@ public:
 	/** Intializes with a texture2d with data */
 	bool initWithData(const void* data, CCTexture2DPixelFormat pixelFormat, unsigned int pixelsWide, unsigned int pixelsHigh, const CCSize& contentSize);
 
+	/** Intializes a texture with its mipmap levels, level i being max(pixelsWide >> i, 1) x max(pixelsHigh >> i, 1) pixels.
+	 Lets precomputed mipmaps be uploaded as they are. The texture is sampled with trilinear filtering if there is more than one level.
+	 */
+	bool initWithMipmaps(const void** levels, unsigned int levelCount, CCTexture2DPixelFormat pixelFormat, unsigned int pixelsWide, unsigned int pixelsHigh, const CCSize& contentSize);
+
+	/** Replaces a sub-rectangle of the texture with tightly packed data in the texture's pixel format.
+	 Useful for textures that are filled incrementally, like glyph atlases.
+	 */
+	bool updateWithData(const void* data, unsigned int x, unsigned int y, unsigned int width, unsigned int height);
+
 	/**
 	Drawing extensions to make it easy to draw basic quads using a CCTexture2D object.
 	These functions require CC_TEXTURE_2D and both CC_VERTEX_ARRAY and CC_TEXTURE_COORD_ARRAY client states to be enabled.
@@ -154,6 +177,11 @@ public:
 
 	bool initWithImage(CCImage *uiImage, ccResolutionType resolution);
 
+	/** Initializes a texture from a png or jpg file. The rows are converted to the texture format
+	 and padded to its size while they are decoded, without keeping a decoded copy of the image.
+	 */
+	bool initWithImageFile(const char *fullpath, CCImage::EImageFormat imageType, ccResolutionType resolution);
+
 
     /** Initializes a texture from a string with dimensions, alignment, font name and font size */
     bool initWithString(const char *text,  const char *fontName, float fontSize, const CCSize& dimensions, CCTextAlignment hAlignment, CCVerticalTextAlignment vAlignment);
@@ -199,7 +227,9 @@ public:
 
 
 	/** Generates mipmap images for the texture.
-	It only works if the texture size is POT (power of 2).
+	It only works if the texture size is POT (power of 2) and 32-bit.
+	The texture is read back from the GPU to be filtered, so prefer setGenerateMipmapsOnLoad for textures loaded from images.
+	Use a mipmap min filter (CC_LINEAR_MIPMAP_LINEAR...) to sample the mipmaps.
 	@since v0.99.0
 	*/
 	void generateMipmap();
@@ -208,6 +238,27 @@ public:
 	@since v1.0
 	*/
     unsigned int bitsPerPixelForFormat();  
+
+	/** returns the bytes of video memory used by the texture, mipmaps included */
+	unsigned int getMemoryUsage();
+
+	/** returns the number of mipmap levels of the texture, 1 without mipmaps */
+	inline unsigned int getMipmapLevels() { return m_uMipmapLevels; }
+
+	/** returns the frame (CCDirector::getTotalFrames) the texture was last bound for drawing, or created in */
+	inline unsigned int getLastUsedFrame() { return m_uLastUsedFrame; }
+
+	/** Makes the following inits queue the creation of the texture in CCGPUUploadQueue, when it defers uploads,
+	 instead of creating it right away. The texture draws with the placeholder of the queue until then;
+	 updateWithData and generateMipmap create it first.
+	 */
+	inline void setDeferredUpload(bool deferred) { m_bDeferredUpload = deferred; }
+	inline bool isDeferredUpload() { return m_bDeferredUpload; }
+	/** whether the creation of the texture is waiting in CCGPUUploadQueue */
+	inline bool isUploadPending() { return m_pPendingLevels != NULL; }
+
+	/** creates the pending texture, from CCGPUUploadQueue */
+	virtual void uploadGPUResources();
     
 	/** sets the default pixel format for UIImagescontains alpha channel.
 	If the UIImage contains alpha channel, then the options are:
@@ -217,6 +268,10 @@ public:
 	- generate 16-bit textures: kCCTexture2DPixelFormat_RGB5A1
 	- generate 16-bit textures: kCCTexture2DPixelFormat_RGB565
 	- generate 8-bit textures: kCCTexture2DPixelFormat_A8 (only use it if you use just 1 color)
+	- generate 4-bit textures: kCCTexture2DPixelFormat_BC1 (alpha is cut at 50%)
+	- generate 8-bit textures: kCCTexture2DPixelFormat_BC3
+	The BC formats are compressed on the CPU when the image is loaded, which takes longer,
+	and fall back to RGBA8888 when the device can't sample them.
 
 	How does it work ?
 	- If the image is an RGBA (with Alpha) then the default pixel format will be used (it can be a 8-bit, 16-bit or 32-bit texture)
@@ -231,6 +286,13 @@ public:
 	*/
 	static CCTexture2DPixelFormat defaultAlphaPixelFormat();
 
+	/** builds (or not) the mipmaps of the POT textures loaded from images, while they are decoded.
+	 The levels are filtered in RGBA8888 then converted to the pixel format of the texture; see CC_TEXTURE_MIPMAP_GAMMA_CORRECT.
+	 By default it is disabled.
+	 */
+	static void setGenerateMipmapsOnLoad(bool generateMipmaps);
+	static bool doesGenerateMipmapsOnLoad();
+
 	/** treats (or not) PVR files as if they have alpha premultiplied.
 	 Since it is impossible to know at runtime if the PVR images have the alpha channel premultiplied, it is
 	 possible load them as if they have (or not) the alpha channel premultiplied.
@@ -243,6 +305,12 @@ public:
 
 private:
 	bool initPremultipliedATextureWithImage(CCImage * image, unsigned int pixelsWide, unsigned int pixelsHigh);
+	// uploads premultiplied pixels laid out at the POT size, in RGBA8888 if pixelFormat is block compressed
+	// or mipmaps are generated, in pixelFormat otherwise
+	bool initWithTextureLayout(const unsigned char *data, CCTexture2DPixelFormat pixelFormat, unsigned int POTWide, unsigned int POTHigh, const CCSize& imageSize);
+	bool createTextureResource(const void** levels, unsigned int levelCount, CCTexture2DPixelFormat pixelFormat, unsigned int pixelsWide, unsigned int pixelsHigh);
+	// keeps a copy of the levels and queues their upload; false if CCGPUUploadQueue doesn't defer uploads
+	bool queueTextureResource(const void** levels, unsigned int levelCount, CCTexture2DPixelFormat pixelFormat, unsigned int pixelsWide, unsigned int pixelsHigh);
     
     // By default PVR images are treated as if they don't have the alpha channel premultiplied
     bool m_bPVRHaveAlphaPremultiplied;
@@ -258,6 +326,13 @@ private:
 
 	    /** whether or not the texture has their Alpha premultiplied */
     bool m_bHasPremultipliedAlpha;
+
+	unsigned int m_uMipmapLevels;
+	unsigned int m_uLastUsedFrame;
+
+	bool m_bDeferredUpload;
+	// copy of the levels of a texture whose creation is queued, end to end
+	unsigned char *m_pPendingLevels;
 	/*
 	ID3D11Buffer *m_vertexBuffer;
 	ID3D11Buffer* m_indexBuffer;
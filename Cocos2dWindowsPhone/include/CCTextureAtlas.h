@@ -188,15 +188,14 @@ private:
 	static CCDXTextureAtlas mDXTextureAtlas;
 };
 
+class CCDXProgram;
+
 class CC_DLL CCDXTextureAtlas
 {
 public:
 	ID3D11Buffer *m_vertexBuffer;
 	ID3D11Buffer* m_indexBuffer;
-	ID3D11VertexShader* m_vertexShader;
-	ID3D11PixelShader* m_pixelShader;
-	ID3D11InputLayout* m_layout;
-	ID3D11Buffer* m_matrixBuffer;
+	CCDXProgram* m_pProgram;
 
 	CCDXTextureAtlas();
 	~CCDXTextureAtlas();
@@ -210,11 +209,6 @@ public:
 	void RenderShader(CCTexture2D* texture,unsigned int n, unsigned int start);
 	void Render(ccV3F_C4B_T2F_Quad* quads,unsigned short* indices,unsigned int capacity,CCTexture2D* texture,unsigned int n, unsigned int start);
 private:
-	struct MatrixBufferType
-	{
-		DirectX::XMMATRIX view;
-		DirectX::XMMATRIX projection;
-	};
 	struct VertexType
 	{
 		DirectX::XMFLOAT3 position;
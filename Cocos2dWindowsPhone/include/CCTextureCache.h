@@ -28,6 +28,7 @@ THE SOFTWARE.
 #define __CCTEXTURE_CACHE_H__
 
 #include <string>
+#include <map>
 #include "CCObject.h"
 #include "CCDictionary.h"
 #include "CCTexture2D.h"
@@ -42,6 +43,14 @@ NS_CC_BEGIN
 class CCLock;
 class CCImage;
 
+/** How a texture loaded from a file is reloaded once CCTextureCache evicted it */
+typedef struct _ccTextureReloadInfo
+{
+	CCTexture2DPixelFormat pixelFormat;
+	bool                   mipmaps;
+	bool                   evicted;
+} ccTextureReloadInfo;
+
 /** @brief Singleton that handles the loading of textures
 * Once the texture is loaded, the next time it will return
 * a reference of the previously loaded texture reducing GPU & CPU memory
@@ -52,11 +61,16 @@ protected:
 	CCDictionary * m_pTextures;
 	//pthread_mutex_t				*m_pDictLock;
 
+	// textures loaded from files, by key
+	std::map<std::string, ccTextureReloadInfo> m_tReloadInfos;
+	unsigned int m_uMemoryBudget;
 
 private:
 	// @todo void addImageWithAsyncObject(CCAsyncObject* async);
     void addImageAsyncCallBack(ccTime dt);
 
+	void checkMemoryBudget();
+
 public:
 
 	CCTextureCache();
@@ -77,6 +91,7 @@ public:
 	*  object and it will return it. It will use the filename as a key.
 	* Otherwise it will return a reference of a previosly loaded image.
 	* Supported image extensions: .png, .bmp, .tiff, .jpeg, .pvr, .gif
+	* When CCGPUUploadQueue defers uploads, the texture is created at the start of a later frame.
 	*/
 	CCTexture2D* addImage(const char* fileimage);
 
@@ -141,6 +156,28 @@ public:
 	*/
 	void dumpCachedTextureInfo();
 
+	/** Returns the bytes of video memory used by the cached textures */
+	unsigned int getMemoryUsage();
+
+	/** Sets the video memory the cached textures should fit in, 0 for no limit.
+	* Past it, adding a texture evicts the unused ones as trimMemory does.
+	* Defaults to CC_TEXTURE_CACHE_MEMORY_BUDGET.
+	*/
+	void setMemoryBudget(unsigned int uBytes);
+	unsigned int getMemoryBudget();
+
+	/** Evicts unused textures loaded from files, least recently drawn first, until the cache uses at most uBytes.
+	* A texture is unused when only the cache retains it; textures drawn or created in the current frame are kept.
+	* An evicted texture is loaded again, in the same pixel format, the next time it is added.
+	* @return the bytes released
+	*/
+	unsigned int trimMemory(unsigned int uBytes);
+
+	/** Low memory callback: evicts every unused texture loaded from a file.
+	* It is called when the application is suspended, and when the process comes close to its memory limit.
+	*/
+	void didReceiveMemoryWarning();
+
 #ifdef CC_SUPPORT_PVRTC
 	/** Returns a Texture2D object given an PVRTC RAW filename
 	* If the file image was not previously loaded, it will create a new CCTexture2D
@@ -36,6 +36,7 @@ NS_CC_BEGIN
 
 //Forward definition for CCData
 class CCData;
+class CCMappedFile;
 
 /**
  @brief Structure which can tell where mimap begins and how long is it
@@ -56,25 +57,23 @@ enum {
 
 /** CCTexturePVR
      
- Object that loads PVR images.
+ Object that loads PVR images, version 2 and version 3 files, optionally in .ccz or .gz archives.
 
  Supported PVR formats:
     - RGBA8888
-    - BGRA8888
     - RGBA4444
     - RGBA5551
     - RGB565
     - A8
-    - I8
     - AI88
-    - PVRTC 4BPP
-    - PVRTC 2BPP
+    - BC1 (DXT1), BC3 (DXT5 and DXT4), version 3 only
+    - ETC1, ETC2 RGB, ETC2 RGB A1, ETC2 RGBA, version 3 only
+
+ BC1 and BC3 levels are uploaded as they are when the device supports them. The other compressed
+ formats are decoded to RGBA8888 on the CPU, on every core, so they only save storage and loading time.
      
  Limitations:
-    Pre-generated mipmaps, such as PVR textures with mipmap levels embedded in file,
-    are only supported if all individual sprites are of _square_ size. 
-    To use mipmaps with non-square textures, instead call CCTexture2D#generateMipmap on the sheet texture itself
-    (and to save space, save the PVR sprite sheet without mip maps included).
+    Only POT textures are supported. Of the files holding several surfaces or faces, the first one is used.
 */
 class CC_DLL CCTexturePVR : public CCObject
 {
@@ -98,6 +97,13 @@ public:
 	// cocos2d integration
 	CC_PROPERTY(bool, m_bRetainName, RetainName);
 
+	/** number of levels in getMipmaps, at least 1 */
+	inline unsigned int getNumberOfMipmaps() { return m_uNumberOfMipmaps; }
+	/** the levels, largest first, in getFormat; valid until the object is released */
+	inline const CCPVRMipmap* getMipmaps() { return m_asMipmaps; }
+	/** whether the file says its colors are premultiplied */
+	inline bool isForcePremultipliedAlpha() { return m_bForcePremultipliedAlpha; }
+
 protected:
 
 	/*
@@ -107,16 +113,20 @@ protected:
 		and alpha presence
 	*/
     bool unpackPVRData(unsigned char* data, unsigned int len);
+    bool unpackPVRv2Data(unsigned char* data, unsigned int len);
+    bool unpackPVRv3Data(unsigned char* data, unsigned int len);
 
 	/*
-		Binds all mipmaps to the GL state machine as separate
-		textures
+		Decodes the mipmaps to RGBA8888 when the device can't sample
+		their format: always for ETC2, and for BC1 and BC3 without
+		device support
 	*/
-	bool createGLTexture();
+	bool decodeMipmapsIfNeeded();
 
 	/*
-		Index to the tableFormats array. Which tells us what exact 
-		format is file which initializes this object. 
+		Index to the tableFormats array (tableFormatsV3 for version 3
+		files). Which tells us what exact format is file which
+		initializes this object.
 	*/
 	unsigned int m_uTableFormatIndex;
 
@@ -131,6 +141,16 @@ protected:
 		and lenght of data which represents one mipmap.
 	*/
 	struct CCPVRMipmap m_asMipmaps[CC_PVRMIPMAP_MAX];
+
+	bool m_bForcePremultipliedAlpha;
+
+	/*
+		Where the mipmaps are: the mapped file, or the inflated
+		archive, and the decoded levels
+	*/
+	CCMappedFile *m_pFile;
+	unsigned char *m_pData;
+	unsigned char *m_pDecodedData;
 };
 NS_CC_END 
 
@@ -42,6 +42,7 @@ NS_CC_BEGIN;
 
 class CCEGLView;
 class CCImage;
+class CCGlyphAtlasCache;
 
 // Helper class that initializes the DirectX APIs in the sample apps.
 public ref class DirectXRender sealed
@@ -57,6 +58,10 @@ public:
 	void CreateWindowSizeDependentResources();
 	void Render();
 	void Present();
+	// Presents without handling the failures, so that it can run on the render thread
+	HRESULT PresentBackBuffer();
+	// Recreates the device when it was lost, throws on the other failures. Main thread only.
+	void HandlePresentResult(HRESULT hr);
 	void SetBackBufferRenderTarget();
 	void CloseWindow();
 	bool GetWindowsClosedState();
@@ -71,6 +76,7 @@ private:
 private:
 	friend class cocos2d::CCEGLView;
 	friend class cocos2d::CCImage;
+	friend class cocos2d::CCGlyphAtlasCache;
 
 
 #if WINAPI_FAMILY == WINAPI_FAMILY_PHONE_APP
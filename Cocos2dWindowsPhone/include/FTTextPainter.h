@@ -89,6 +89,13 @@ internal:
 	bool SetFont(Platform::String^ fontName, UINT nSize);
 	Platform::Array<byte>^  DrawTextToImage(Platform::String ^text, Windows::Foundation::Size* tSize, TextAlignment alignment);
 
+	// renders a single glyph of the current font; the bitmap stays valid until the next FreeType call
+	bool RenderGlyph(UINT charCode, FT_Bitmap* bitmap, INT* left, INT* top, INT* advance);
+	INT GetLineHeight();
+	INT GetAscender();
+	// name of the loaded face, the default font's when the requested one couldn't be loaded
+	Platform::String^ GetFontName();
+
 private:
 	FT_Library				m_textLibrary;
 	FT_Face					m_fontFace;
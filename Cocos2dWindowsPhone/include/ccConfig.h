@@ -254,6 +254,155 @@ Platforms: Only used on ARM Neon architectures like iPhone 3GS or newer and iPad
 #define CC_USE_LA88_LABELS_ON_NEON_ARCH 0
 #endif
 
+/** @def CC_LABELTTF_USE_GLYPH_ATLAS
+If enabled, CCLabelTTF renders its text as quads of cached glyphs taken from the shared
+CCGlyphAtlasCache instead of rasterizing a new texture every time the string changes.
+Labels fall back to the texture path when a glyph can't be cached.
+
+To enable set it to a value different than 0. Enabled by default.
+*/
+#ifndef CC_LABELTTF_USE_GLYPH_ATLAS
+#define CC_LABELTTF_USE_GLYPH_ATLAS 1
+#endif
+
+/** @def CC_GLYPH_ATLAS_PAGE_SIZE
+Width and height in pixels of each RGBA8888 page of the glyph atlas.
+*/
+#ifndef CC_GLYPH_ATLAS_PAGE_SIZE
+#define CC_GLYPH_ATLAS_PAGE_SIZE 512
+#endif
+
+/** @def CC_GLYPH_ATLAS_MAX_PAGES
+Maximum number of glyph atlas pages. Once every page is full, the least recently used
+page is evicted. Each page costs CC_GLYPH_ATLAS_PAGE_SIZE^2 * 4 bytes of texture memory.
+*/
+#ifndef CC_GLYPH_ATLAS_MAX_PAGES
+#define CC_GLYPH_ATLAS_MAX_PAGES 4
+#endif
+
+/** @def CC_RUNTIME_ATLAS_PAGE_SIZE
+Width and height in pixels of each RGBA8888 page of CCRuntimeAtlas, capped to the maximum texture size.
+*/
+#ifndef CC_RUNTIME_ATLAS_PAGE_SIZE
+#define CC_RUNTIME_ATLAS_PAGE_SIZE 1024
+#endif
+
+/** @def CC_RUNTIME_ATLAS_MAX_PAGES
+Maximum number of CCRuntimeAtlas pages. Each page costs CC_RUNTIME_ATLAS_PAGE_SIZE^2 * 4 bytes of
+texture memory; images that don't fit once they are all full get a texture of their own.
+*/
+#ifndef CC_RUNTIME_ATLAS_MAX_PAGES
+#define CC_RUNTIME_ATLAS_MAX_PAGES 4
+#endif
+
+/** @def CC_RUNTIME_ATLAS_EXTRUDE
+Pixels of CCRuntimeAtlas images repeated around their edges, so that linear filtering at the
+borders of a sprite samples the sprite itself.
+*/
+#ifndef CC_RUNTIME_ATLAS_EXTRUDE
+#define CC_RUNTIME_ATLAS_EXTRUDE 1
+#endif
+
+/** @def CC_RUNTIME_ATLAS_PADDING
+Transparent pixels left between the extruded images of CCRuntimeAtlas.
+*/
+#ifndef CC_RUNTIME_ATLAS_PADDING
+#define CC_RUNTIME_ATLAS_PADDING 1
+#endif
+
+/** @def CC_GPU_UPLOAD_BYTES_PER_FRAME
+Default bytes of GPU resources CCGPUUploadQueue creates per frame. The textures loaded by
+CCTextureCache are then created at the start of a frame instead of where they are loaded, and
+draw with a transparent placeholder until then. 0 creates them right away.
+*/
+#ifndef CC_GPU_UPLOAD_BYTES_PER_FRAME
+#define CC_GPU_UPLOAD_BYTES_PER_FRAME 0
+#endif
+
+/** @def CC_TMX_LAYER_CHUNK_SIZE
+Width and height, in tiles, of the chunks a CCTMXLayer is split into.
+Every chunk owns its own quads, which are only generated once the chunk becomes visible.
+It can't be greater than 128, since the quad indices of a chunk are stored in 15 bits.
+*/
+#ifndef CC_TMX_LAYER_CHUNK_SIZE
+#define CC_TMX_LAYER_CHUNK_SIZE 32
+#endif
+
+/** @def CC_ENABLE_RENDER_QUEUE
+If enabled, CCNode::visit doesn't draw the nodes: it queues render commands in CCRenderQueue, which
+sorts them by state before drawing them. Disabled by default: the nodes draw during the visit.
+*/
+#ifndef CC_ENABLE_RENDER_QUEUE
+#define CC_ENABLE_RENDER_QUEUE 0
+#endif
+
+/** @def CC_RENDER_QUEUE_STRICT_ORDER
+If enabled, CCRenderQueue draws its commands in the order of the scene graph. Otherwise a command
+may be drawn earlier, next to commands of the same state, when it doesn't overlap what it skips.
+*/
+#ifndef CC_RENDER_QUEUE_STRICT_ORDER
+#define CC_RENDER_QUEUE_STRICT_ORDER 0
+#endif
+
+/** @def CC_ENABLE_RENDER_PIPELINE
+If enabled, CCRenderPipeline records the frames in a deferred context and a render thread executes
+and presents each one while the main thread updates the next. Disabled by default.
+*/
+#ifndef CC_ENABLE_RENDER_PIPELINE
+#define CC_ENABLE_RENDER_PIPELINE 0
+#endif
+
+/** @def CC_ENABLE_DX_STATE_CACHE
+If enabled, the renderers skip the binds of the shaders, buffers and textures that are already bound,
+through the functions of ccDXStateCache.h, and the blend and depth stencil states requested by the
+nodes are only set before the next draw, when they changed. Enabled by default.
+*/
+#ifndef CC_ENABLE_DX_STATE_CACHE
+#define CC_ENABLE_DX_STATE_CACHE 1
+#endif
+
+/** @def CC_ENABLE_SHADER_BINARY_CACHE
+If enabled, CCShaderCache saves the compiled shaders in a single file of the writable path, and reads
+them from it on the next launches. The file is only invalidated by the version of the package, which
+must change with the shaders. Disabled by default.
+*/
+#ifndef CC_ENABLE_SHADER_BINARY_CACHE
+#define CC_ENABLE_SHADER_BINARY_CACHE 0
+#endif
+
+/** @def CC_TEXT_LAYOUT_CACHE_SIZE
+Number of text layouts (wrapped and aligned lines) kept by CCTextLayoutCache for
+CCLabelBMFont and CCLabelTTF. The least recently used layout is dropped past this count.
+*/
+#ifndef CC_TEXT_LAYOUT_CACHE_SIZE
+#define CC_TEXT_LAYOUT_CACHE_SIZE 256
+#endif
+
+/** @def CC_FILE_DATA_CACHE_SIZE
+Byte budget of the file data cache of CCFileUtils. Past it, the least recently used files
+are dropped from the cache; buffers still held by their users stay valid.
+*/
+#ifndef CC_FILE_DATA_CACHE_SIZE
+#define CC_FILE_DATA_CACHE_SIZE (4 * 1024 * 1024)
+#endif
+
+/** @def CC_TEXTURE_MIPMAP_GAMMA_CORRECT
+If enabled, the mipmaps built by CCTexture2D are averaged in linear space and weighted by alpha,
+which keeps them from darkening. Disable it to average the bytes directly, which is faster.
+*/
+#ifndef CC_TEXTURE_MIPMAP_GAMMA_CORRECT
+#define CC_TEXTURE_MIPMAP_GAMMA_CORRECT 1
+#endif
+
+/** @def CC_TEXTURE_CACHE_MEMORY_BUDGET
+Default video memory budget, in bytes, of CCTextureCache. Past it, the least recently drawn
+textures that nothing retains are evicted, to be reloaded when they are added again.
+0 disables the budget.
+*/
+#ifndef CC_TEXTURE_CACHE_MEMORY_BUDGET
+#define CC_TEXTURE_CACHE_MEMORY_BUDGET 0
+#endif
+
 /** @def CC_SPRITE_DEBUG_DRAW
  If enabled, all subclasses of CCSprite will draw a bounding box
  Useful for debugging purposes only. It is recommened to leave it disabled.
@@ -0,0 +1,149 @@
+/*
+* cocos2d-x   http://www.cocos2d-x.org
+*
+* Copyright (c) 2010-2011 - cocos2d-x community
+*
+* Portions Copyright (c) Microsoft Open Technologies, Inc.
+* All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on an
+* "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and limitations under the License.
+*/
+
+#ifndef __CCDXSTATE_H__
+#define __CCDXSTATE_H__
+
+#include <d3d11_1.h>
+#include "CCPlatformMacros.h"
+#include "ccConfig.h"
+
+NS_CC_BEGIN
+
+/**
+ * @addtogroup shaders
+ * @{
+ */
+
+/** @file ccDXStateCache.h
+ The Direct3D counterpart of ccGLStateCache: the renderers bind their shaders, buffers and
+ textures through these functions, which skip the calls that bind what is already bound.
+ The cache follows the device context of CCEGLView: it starts over when the context changes.
+ Every function binds slot 0 of its stage, the only one the renderers use.
+
+ The blend and depth stencil states are requested by description. Their state objects are
+ created once and found again by a hash of the description, and the requested states only
+ reach the context before the next draw, so the nodes that set a state and restore the
+ default one after drawing don't change it back and forth between draws.
+*/
+
+/** @brief Counters of the blend and depth stencil states, since the start of the frame */
+typedef struct _ccDXStateStats
+{
+    //! blend and depth stencil states requested by the nodes
+    unsigned int uRequests;
+    //! blend state changes that reached the device context
+    unsigned int uBlendChanges;
+    //! depth stencil state changes that reached the device context
+    unsigned int uDepthStencilChanges;
+    //! state objects created, not reset with the frame
+    unsigned int uStateObjects;
+} ccDXStateStats;
+
+/** Invalidates the state cache: the next binds reach the device context.
+ Called when the context state was changed behind the cache, like by a command list or Direct2D.
+ */
+void CC_DLL ccDXInvalidateStateCache(void);
+
+/** Binds the input layout in case it is different than the current one.
+ If CC_ENABLE_DX_STATE_CACHE is disabled, it will call IASetInputLayout() directly.
+ */
+void CC_DLL ccDXSetInputLayout(ID3D11InputLayout *pInputLayout);
+
+/** Binds the vertex shader in case it is different than the current one.
+ If CC_ENABLE_DX_STATE_CACHE is disabled, it will call VSSetShader() directly.
+ */
+void CC_DLL ccDXSetVertexShader(ID3D11VertexShader *pVertexShader);
+
+/** Binds the pixel shader in case it is different than the current one.
+ If CC_ENABLE_DX_STATE_CACHE is disabled, it will call PSSetShader() directly.
+ */
+void CC_DLL ccDXSetPixelShader(ID3D11PixelShader *pPixelShader);
+
+/** Binds the vertex buffer in case it, its stride or its offset are different than the current ones.
+ If CC_ENABLE_DX_STATE_CACHE is disabled, it will call IASetVertexBuffers() directly.
+ */
+void CC_DLL ccDXBindVertexBuffer(ID3D11Buffer *pBuffer, unsigned int uStride, unsigned int uOffset);
+
+/** Binds the index buffer in case it or its format are different than the current ones.
+ If CC_ENABLE_DX_STATE_CACHE is disabled, it will call IASetIndexBuffer() directly.
+ */
+void CC_DLL ccDXBindIndexBuffer(ID3D11Buffer *pBuffer, DXGI_FORMAT eFormat);
+
+/** Sets the primitive topology in case it is different than the current one.
+ If CC_ENABLE_DX_STATE_CACHE is disabled, it will call IASetPrimitiveTopology() directly.
+ */
+void CC_DLL ccDXSetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY eTopology);
+
+/** Binds the constant buffer of the vertex shader in case it is different than the current one.
+ If CC_ENABLE_DX_STATE_CACHE is disabled, it will call VSSetConstantBuffers() directly.
+ @return false if the buffer was already bound. A dynamic buffer bound anew may be bound to a
+ new command list, which must discard it before the shaders read it.
+ */
+bool CC_DLL ccDXBindVSConstantBuffer(ID3D11Buffer *pBuffer);
+
+/** Binds the constant buffer of the pixel shader in case it is different than the current one.
+ If CC_ENABLE_DX_STATE_CACHE is disabled, it will call PSSetConstantBuffers() directly.
+ */
+void CC_DLL ccDXBindPSConstantBuffer(ID3D11Buffer *pBuffer);
+
+/** Binds the texture to the pixel shader in case it is different than the current one.
+ If CC_ENABLE_DX_STATE_CACHE is disabled, it will call PSSetShaderResources() directly.
+ */
+void CC_DLL ccDXBindTexture2D(ID3D11ShaderResourceView *pTexture);
+
+/** Binds the sampler to the pixel shader in case it is different than the current one.
+ If CC_ENABLE_DX_STATE_CACHE is disabled, it will call PSSetSamplers() directly.
+ */
+void CC_DLL ccDXBindSampler(ID3D11SamplerState *pSampler);
+
+/** Binds the render target and the depth stencil view. Always calls OMSetRenderTargets():
+ it unbinds the texture of the render target from the pixel shader, which the cache forgets.
+ */
+void CC_DLL ccDXSetRenderTarget(ID3D11RenderTargetView *pRenderTargetView, ID3D11DepthStencilView *pDepthStencilView);
+
+/** Requests the blend state of the description, set before the next draw.
+ The description is compared byte for byte: zero it before filling it, padding included.
+ If CC_ENABLE_DX_STATE_CACHE is disabled, it will call OMSetBlendState() right away.
+ */
+void CC_DLL ccDXSetBlendState(const D3D11_BLEND_DESC &tDesc);
+
+/** Requests the depth stencil state of the description, set before the next draw.
+ The description is compared byte for byte: zero it before filling it, padding included.
+ If CC_ENABLE_DX_STATE_CACHE is disabled, it will call OMSetDepthStencilState() right away.
+ */
+void CC_DLL ccDXSetDepthStencilState(const D3D11_DEPTH_STENCIL_DESC &tDesc, unsigned int uStencilRef);
+
+/** Sets the blend and depth stencil states requested since the last draw, in case they are
+ different than the current ones. CCDXProgram::use calls it before each draw.
+ */
+void CC_DLL ccDXCommitStates(void);
+
+/** Releases the state objects created for the requested states */
+void CC_DLL ccDXPurgeStateObjects(void);
+
+/** counters of the current frame, reset by CCDirector when it starts drawing a scene */
+CC_DLL const ccDXStateStats& ccDXGetStateStats(void);
+void CC_DLL ccDXResetStateStats(void);
+
+// end of shaders group
+/// @}
+
+NS_CC_END
+
+#endif /* __CCDXSTATE_H__ */
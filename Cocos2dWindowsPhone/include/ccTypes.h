@@ -117,6 +117,15 @@ static inline ccColor4F ccc4FFromccc4B(ccColor4B c)
 	return c4;
 }
 
+/** Returns a ccColor4B from a ccColor4F.
+ @since v2.1
+ */
+static inline ccColor4B ccc4BFromccc4F(ccColor4F c)
+{
+	ccColor4B ret = {(CCubyte)(c.r*255), (CCubyte)(c.g*255), (CCubyte)(c.b*255), (CCubyte)(c.a*255)};
+	return ret;
+}
+
 /** returns YES if both ccColor4F are equal. Otherwise it returns NO.
  @since v0.99.1
  */
@@ -256,6 +265,17 @@ typedef struct _ccV3F_C4B_T2F
 	ccTex2F			texCoords;			// 8 byts
 } ccV3F_C4B_T2F;
 
+//! a triangle of ccV2F_C4B_T2F points
+typedef struct _ccV2F_C4B_T2F_Triangle
+{
+	//! Point A
+	ccV2F_C4B_T2F a;
+	//! Point B
+	ccV2F_C4B_T2F b;
+	//! Point C
+	ccV2F_C4B_T2F c;
+} ccV2F_C4B_T2F_Triangle;
+
 //! 4 ccVertex2FTex2FColor4B Quad
 typedef struct _ccV2F_C4B_T2F_Quad
 {
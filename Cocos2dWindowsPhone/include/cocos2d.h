@@ -82,7 +82,7 @@ THE SOFTWARE.
 
 // draw nodes
 #include "CCDrawingPrimitives.h"
-//#include "CCDrawNode.h" // Faster than the "drawing primitives" since they it draws everything in one single batch
+#include "CCDrawNode.h" // Faster than the "drawing primitives" since they it draws everything in one single batch
 
 // effects
 #include "CCGrabber.h"
@@ -103,6 +103,14 @@ THE SOFTWARE.
 #include "CCLabelAtlas.h"
 #include "CCLabelTTF.h"
 #include "CCLabelBMFont.h"
+#include "CCGlyphAtlasCache.h"
+#include "CCRuntimeAtlas.h"
+#include "CCGPUUploadQueue.h"
+#include "CCRenderQueue.h"
+#include "CCRenderPipeline.h"
+#include "CCShaderCache.h"
+#include "ccDXStateCache.h"
+#include "CCTextLayoutCache.h"
 
 // layers_scenes_transitions_nodes
 #include "CCLayer.h"
@@ -131,6 +139,7 @@ THE SOFTWARE.
 // platform
 #include "CCCommon.h"
 #include "CCFileUtils.h"
+#include "CCPlistDocument.h"
 #include "CCImage.h"
 //#include "CCSAXParser.h"
 //#include "CCThread.h"
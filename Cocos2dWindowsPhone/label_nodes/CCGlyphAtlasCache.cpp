@@ -0,0 +1,415 @@
+/*
+* cocos2d-x   http://www.cocos2d-x.org
+*
+* Copyright (c) 2010-2011 - cocos2d-x community
+*
+* Portions Copyright (c) Microsoft Open Technologies, Inc.
+* All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on an
+* "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and limitations under the License.
+*/
+
+#include "pch.h"
+#include "CCGlyphAtlasCache.h"
+#include "CCTexture2D.h"
+#include "CCDirector.h"
+#include "CCCommon.h"
+#include "CCString.h"
+#include "DirectXRender.h"
+
+NS_CC_BEGIN
+
+// transparent border kept around every glyph so linear filtering doesn't pick up the neighbours
+#define CC_GLYPH_PADDING 1
+
+static CCGlyphAtlasCache *g_sharedGlyphAtlasCache = NULL;
+// generations keep growing across purges so labels never match a fresh page by accident
+static unsigned int s_uLastGeneration = 0;
+
+CCGlyphAtlasCache * CCGlyphAtlasCache::sharedGlyphAtlasCache()
+{
+    if (!g_sharedGlyphAtlasCache)
+        g_sharedGlyphAtlasCache = new CCGlyphAtlasCache();
+
+    return g_sharedGlyphAtlasCache;
+}
+
+void CCGlyphAtlasCache::purgeSharedGlyphAtlasCache()
+{
+    CC_SAFE_RELEASE_NULL(g_sharedGlyphAtlasCache);
+}
+
+CCGlyphAtlasCache::CCGlyphAtlasCache()
+: m_uFontSize(0)
+, m_uFontKey(0)
+, m_nLineHeight(0)
+, m_nAscender(0)
+, m_uGeneration(s_uLastGeneration)
+{
+    CCAssert(g_sharedGlyphAtlasCache == NULL, "Attempted to allocate a second instance of a singleton.");
+
+    memset(&m_tStats, 0, sizeof(m_tStats));
+}
+
+CCGlyphAtlasCache::~CCGlyphAtlasCache()
+{
+    CCLOGINFO("cocos2d: deallocing CCGlyphAtlasCache.");
+    removeAllGlyphs();
+    s_uLastGeneration = m_uGeneration;
+}
+
+char * CCGlyphAtlasCache::description(void)
+{
+    char *ret = new char[100];
+    sprintf(ret, "<CCGlyphAtlasCache | Number of glyphs = %u | Number of pages = %u>", m_tStats.uGlyphs, m_tStats.uPages);
+    return ret;
+}
+
+bool CCGlyphAtlasCache::setFont(const char *fontName, unsigned int fontSize)
+{
+    CCAssert(fontName != NULL, "Invalid font name");
+
+    if (m_nLineHeight > 0 && m_uFontSize == fontSize && m_sFontName.compare(fontName) == 0)
+    {
+        return true;
+    }
+
+#if WINAPI_FAMILY == WINAPI_FAMILY_PHONE_APP
+    FTTextPainter^ painter = DirectXRender::SharedDXRender()->m_textPainter;
+
+    std::wstring wStrFontName = CCUtf8ToUnicode(fontName);
+    if (!painter->SetFont(ref new Platform::String(wStrFontName.c_str()), fontSize))
+    {
+        CCLog("Can't find font(%s), using system default", fontName);
+    }
+    // a missing font leaves the default one loaded under the default name
+    m_sPainterFontName = painter->GetFontName()->Data();
+
+    unsigned int fontId;
+    std::map<std::string, unsigned int>::iterator it = m_tFontIds.find(fontName);
+    if (it != m_tFontIds.end())
+    {
+        fontId = it->second;
+    }
+    else
+    {
+        fontId = (unsigned int)m_tFontIds.size();
+        m_tFontIds[fontName] = fontId;
+    }
+
+    m_sFontName = fontName;
+    m_uFontSize = fontSize;
+    m_sLayoutKey = CCString::createWithFormat("%s@%u", fontName, fontSize)->getCString();
+    m_uFontKey = ((unsigned long long)(fontId & 0xffff) << 48) | ((unsigned long long)(fontSize & 0xffff) << 32);
+    m_nLineHeight = painter->GetLineHeight();
+    m_nAscender = painter->GetAscender();
+
+    return m_nLineHeight > 0;
+#else
+    // only the FreeType painter can rasterize single glyphs
+    return false;
+#endif
+}
+
+const ccGlyphInfo* CCGlyphAtlasCache::glyphForChar(unsigned int charCode)
+{
+    CCAssert(m_nLineHeight > 0, "CCGlyphAtlasCache: setFont must be called first");
+
+    unsigned long long key = m_uFontKey | charCode;
+    std::map<unsigned long long, ccGlyphInfo>::iterator it = m_tGlyphs.find(key);
+    if (it != m_tGlyphs.end())
+    {
+        m_tStats.uHits++;
+        if (it->second.rect.size.width > 0)
+        {
+            touchPage(it->second.uPage);
+        }
+        return &it->second;
+    }
+
+    m_tStats.uMisses++;
+
+#if WINAPI_FAMILY == WINAPI_FAMILY_PHONE_APP
+    FTTextPainter^ painter = DirectXRender::SharedDXRender()->m_textPainter;
+
+    // CCImage::initWithString may have switched the painter to another font
+    painter->SetFont(ref new Platform::String(m_sPainterFontName.c_str()), m_uFontSize);
+
+    FT_Bitmap bitmap;
+    INT left, top, advance;
+    if (!painter->RenderGlyph(charCode, &bitmap, &left, &top, &advance))
+    {
+        m_tStats.uFailures++;
+        return NULL;
+    }
+
+    ccGlyphInfo glyph;
+    glyph.uPage = 0;
+    glyph.rect = CCRectZero;
+    glyph.nLeft = left;
+    glyph.nTop = top;
+    glyph.nAdvance = advance;
+
+    unsigned int w = (unsigned int)bitmap.width;
+    unsigned int h = (unsigned int)bitmap.rows;
+
+    // blanks only need their metrics
+    if (w > 0 && h > 0)
+    {
+        unsigned int paddedW = w + 2 * CC_GLYPH_PADDING;
+        unsigned int paddedH = h + 2 * CC_GLYPH_PADDING;
+        unsigned int page, x, y;
+        if (!allocate(paddedW, paddedH, &page, &x, &y))
+        {
+            m_tStats.uFailures++;
+            return NULL;
+        }
+
+        // white texels with the coverage in alpha; the border is cleared so evicted glyphs don't leak in
+        unsigned char *pixels = new unsigned char[paddedW * paddedH * 4];
+        memset(pixels, 0, paddedW * paddedH * 4);
+        for (unsigned int row = 0; row < h; row++)
+        {
+            const unsigned char *src = bitmap.buffer + row * bitmap.pitch;
+            unsigned char *dst = pixels + ((row + CC_GLYPH_PADDING) * paddedW + CC_GLYPH_PADDING) * 4;
+            for (unsigned int col = 0; col < w; col++)
+            {
+                dst[0] = 255;
+                dst[1] = 255;
+                dst[2] = 255;
+                dst[3] = src[col];
+                dst += 4;
+            }
+        }
+
+        m_tPages[page].pTexture->updateWithData(pixels, x, y, paddedW, paddedH);
+        delete [] pixels;
+
+        glyph.uPage = page;
+        glyph.rect = CCRectMake((float)(x + CC_GLYPH_PADDING), (float)(y + CC_GLYPH_PADDING), (float)w, (float)h);
+        touchPage(page);
+    }
+
+    ccGlyphInfo *pRet = &(m_tGlyphs[key] = glyph);
+    m_tStats.uGlyphs = (unsigned int)m_tGlyphs.size();
+    return pRet;
+#else
+    m_tStats.uFailures++;
+    return NULL;
+#endif
+}
+
+const char* CCGlyphAtlasCache::getLayoutFontKey(void)
+{
+    return m_sLayoutKey.c_str();
+}
+
+bool CCGlyphAtlasCache::getGlyphMetrics(unsigned short c, ccTextGlyphMetrics *pMetrics)
+{
+    const ccGlyphInfo *pGlyph = glyphForChar(c);
+    if (! pGlyph)
+    {
+        return false;
+    }
+
+    pMetrics->xOffset = pGlyph->nLeft;
+    pMetrics->width = (int)pGlyph->rect.size.width;
+    pMetrics->xAdvance = pGlyph->nAdvance;
+    return true;
+}
+
+int CCGlyphAtlasCache::getKerningAmount(unsigned short first, unsigned short second)
+{
+    // the FreeType painter doesn't apply kerning either
+    return 0;
+}
+
+CCTexture2D* CCGlyphAtlasCache::textureForPage(unsigned int page)
+{
+    return page < m_tPages.size() ? m_tPages[page].pTexture : NULL;
+}
+
+unsigned int CCGlyphAtlasCache::getPageGeneration(unsigned int page)
+{
+    return page < m_tPages.size() ? m_tPages[page].uGeneration : 0;
+}
+
+void CCGlyphAtlasCache::touchPage(unsigned int page)
+{
+    if (page < m_tPages.size())
+    {
+        m_tPages[page].uLastUsedFrame = CCDirector::sharedDirector()->getTotalFrames();
+    }
+}
+
+void CCGlyphAtlasCache::removeAllGlyphs(void)
+{
+    for (unsigned int i = 0; i < m_tPages.size(); i++)
+    {
+        CC_SAFE_RELEASE(m_tPages[i].pTexture);
+    }
+    m_tPages.clear();
+    m_tGlyphs.clear();
+
+    m_tStats.uPages = 0;
+    m_tStats.uGlyphs = 0;
+    m_tStats.uBytes = 0;
+}
+
+bool CCGlyphAtlasCache::allocateInPage(ccGlyphAtlasPage *page, unsigned int w, unsigned int h, unsigned int *x, unsigned int *y)
+{
+    // best fit among the open shelves: the one wasting the least height
+    int best = -1;
+    for (unsigned int i = 0; i < page->shelves.size(); i++)
+    {
+        ccGlyphShelf &shelf = page->shelves[i];
+        if (shelf.height >= h && shelf.x + w <= CC_GLYPH_ATLAS_PAGE_SIZE)
+        {
+            if (best < 0 || shelf.height < page->shelves[best].height)
+            {
+                best = (int)i;
+            }
+        }
+    }
+
+    if (best < 0)
+    {
+        if (page->uNextShelfY + h > CC_GLYPH_ATLAS_PAGE_SIZE)
+        {
+            return false;
+        }
+
+        ccGlyphShelf shelf;
+        shelf.y = page->uNextShelfY;
+        shelf.height = h;
+        shelf.x = 0;
+        page->shelves.push_back(shelf);
+        page->uNextShelfY += h;
+        best = (int)page->shelves.size() - 1;
+    }
+
+    ccGlyphShelf &shelf = page->shelves[best];
+    *x = shelf.x;
+    *y = shelf.y;
+    shelf.x += w;
+
+    return true;
+}
+
+bool CCGlyphAtlasCache::allocate(unsigned int w, unsigned int h, unsigned int *page, unsigned int *x, unsigned int *y)
+{
+    if (w > CC_GLYPH_ATLAS_PAGE_SIZE || h > CC_GLYPH_ATLAS_PAGE_SIZE)
+    {
+        return false;
+    }
+
+    for (unsigned int i = 0; i < m_tPages.size(); i++)
+    {
+        if (allocateInPage(&m_tPages[i], w, h, x, y))
+        {
+            *page = i;
+            return true;
+        }
+    }
+
+    if (m_tPages.size() < CC_GLYPH_ATLAS_MAX_PAGES)
+    {
+        if (!addPage())
+        {
+            return false;
+        }
+        *page = (unsigned int)m_tPages.size() - 1;
+    }
+    else if (!evictPage(page))
+    {
+        return false;
+    }
+
+    return allocateInPage(&m_tPages[*page], w, h, x, y);
+}
+
+bool CCGlyphAtlasCache::addPage(void)
+{
+    unsigned int bytes = CC_GLYPH_ATLAS_PAGE_SIZE * CC_GLYPH_ATLAS_PAGE_SIZE * 4;
+    unsigned char *data = new unsigned char[bytes];
+    memset(data, 0, bytes);
+
+    CCTexture2D *texture = new CCTexture2D();
+    bool bRet = texture->initWithData(data, kCCTexture2DPixelFormat_RGBA8888,
+                                      CC_GLYPH_ATLAS_PAGE_SIZE, CC_GLYPH_ATLAS_PAGE_SIZE,
+                                      CCSizeMake((float)CC_GLYPH_ATLAS_PAGE_SIZE, (float)CC_GLYPH_ATLAS_PAGE_SIZE));
+    delete [] data;
+
+    if (!bRet)
+    {
+        texture->release();
+        return false;
+    }
+
+    ccGlyphAtlasPage page;
+    page.pTexture = texture;
+    page.uNextShelfY = 0;
+    page.uLastUsedFrame = CCDirector::sharedDirector()->getTotalFrames();
+    page.uGeneration = ++m_uGeneration;
+    m_tPages.push_back(page);
+
+    m_tStats.uPages = (unsigned int)m_tPages.size();
+    m_tStats.uBytes += bytes;
+
+    return true;
+}
+
+bool CCGlyphAtlasCache::evictPage(unsigned int *page)
+{
+    // pages used in the current frame hold glyphs that labels have already laid out
+    unsigned int frame = CCDirector::sharedDirector()->getTotalFrames();
+    int victim = -1;
+    for (unsigned int i = 0; i < m_tPages.size(); i++)
+    {
+        if (m_tPages[i].uLastUsedFrame == frame)
+        {
+            continue;
+        }
+        if (victim < 0 || m_tPages[i].uLastUsedFrame < m_tPages[victim].uLastUsedFrame)
+        {
+            victim = (int)i;
+        }
+    }
+
+    if (victim < 0)
+    {
+        return false;
+    }
+
+    std::map<unsigned long long, ccGlyphInfo>::iterator it = m_tGlyphs.begin();
+    while (it != m_tGlyphs.end())
+    {
+        if (it->second.uPage == (unsigned int)victim && it->second.rect.size.width > 0)
+        {
+            m_tGlyphs.erase(it++);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    m_tPages[victim].shelves.clear();
+    m_tPages[victim].uNextShelfY = 0;
+    m_tPages[victim].uGeneration = ++m_uGeneration;
+
+    m_tStats.uEvictions++;
+    m_tStats.uGlyphs = (unsigned int)m_tGlyphs.size();
+
+    *page = (unsigned int)victim;
+    return true;
+}
+
+NS_CC_END
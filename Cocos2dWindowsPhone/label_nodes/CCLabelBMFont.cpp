@@ -413,6 +413,8 @@ bool CCBMFontConfiguration::initWithFNTfile(const char *FNTfile)
         return false;
     }
 
+    m_sFntFile = FNTfile;
+
     return true;
 }
 
@@ -421,6 +423,44 @@ std::set<unsigned int>* CCBMFontConfiguration::getCharacterSet() const
     return m_pCharacterSet;
 }
 
+const char* CCBMFontConfiguration::getLayoutFontKey(void)
+{
+    return m_sFntFile.c_str();
+}
+
+bool CCBMFontConfiguration::getGlyphMetrics(unsigned short c, ccTextGlyphMetrics *pMetrics)
+{
+    tCCFontDefHashElement *element = NULL;
+
+    // unichar is a short, and an int is needed on HASH_FIND_INT
+    unsigned int key = c;
+    HASH_FIND_INT(m_pFontDefDictionary, &key, element);
+    if (! element)
+    {
+        CCLOG("cocos2d: LabelBMFont: characer not found %d", c);
+        return false;
+    }
+
+    pMetrics->xOffset = element->fontDef.xOffset;
+    pMetrics->width = (int)element->fontDef.rect.size.width;
+    pMetrics->xAdvance = element->fontDef.xAdvance;
+    return true;
+}
+
+int CCBMFontConfiguration::getKerningAmount(unsigned short first, unsigned short second)
+{
+    int ret = 0;
+    unsigned int key = (first<<16) | (second & 0xffff);
+
+    if( m_pKerningDictionary ) {
+        tCCKerningHashElement *element = NULL;
+        HASH_FIND_INT(m_pKerningDictionary, &key, element);        
+        if(element)
+            ret = element->amount;
+    }
+    return ret;
+}
+
 CCBMFontConfiguration::CCBMFontConfiguration()
 : m_pFontDefDictionary(NULL)
 , m_nCommonHeight(0)
@@ -474,37 +514,31 @@ void CCBMFontConfiguration::purgeFontDefDictionary()
 std::set<unsigned int>* CCBMFontConfiguration::parseConfigFile(const char *controlFile)
 {    
     std::string fullpath = CCFileUtils::sharedFileUtils()->fullPathForFilename(controlFile);
-    CCString *contents = CCString::createWithContentsOfFile(fullpath.c_str());
+    CCMappedFile *contents = CCFileUtils::mapFile(fullpath.c_str());
 
     CCAssert(contents, "CCBMFontConfiguration::parseConfigFile | Open file error.");
     
-    set<unsigned int> *validCharsString = new set<unsigned int>();
-
     if (!contents)
     {
         CCLOG("cocos2d: Error parsing FNTfile %s", controlFile);
         return NULL;
     }
 
-    // parse spacing / padding
+    set<unsigned int> *validCharsString = new set<unsigned int>();
+
+    // parse spacing / padding, a line at a time straight from the file
     std::string line;
-    std::string strLeft = contents->getCString();
-    while (strLeft.length() > 0)
+    const char *pLeft = (const char*)contents->getBytes();
+    const char *pEnd = pLeft + contents->getSize();
+    while (pLeft < pEnd)
     {
-        int pos = strLeft.find('\n');
-
-        if (pos != (int)std::string::npos)
+        const char *pEol = (const char*)memchr(pLeft, '\n', pEnd - pLeft);
+        if (! pEol)
         {
-            // the data is more than a line.get one line
-            line = strLeft.substr(0, pos);
-            strLeft = strLeft.substr(pos + 1);
-        }
-        else
-        {
-            // get the left data
-            line = strLeft;
-            strLeft.erase();
+            pEol = pEnd;
         }
+        line.assign(pLeft, pEol);
+        pLeft = pEol + 1;
 
         if(line.substr(0,strlen("info face")) == "info face") 
         {
@@ -546,6 +580,7 @@ std::set<unsigned int>* CCBMFontConfiguration::parseConfigFile(const char *contr
             this->parseKerningEntry(line);
         }
     }
+    contents->release();
     
     return validCharsString;
 }
@@ -820,6 +855,8 @@ CCLabelBMFont::CCLabelBMFont()
 , m_sString(NULL)
 , m_bLineBreakWithoutSpaces(false)
 , m_tImageOffset(CCPointZero)
+, m_pReusedChar(NULL)
+, m_pLayout(NULL)
 {
 
 }
@@ -827,6 +864,7 @@ CCLabelBMFont::CCLabelBMFont()
 CCLabelBMFont::~CCLabelBMFont()
 {
     CC_SAFE_RELEASE(m_pReusedChar);
+    CC_SAFE_RELEASE(m_pLayout);
     CC_SAFE_DELETE(m_sString);
     CC_SAFE_RELEASE(m_pConfiguration);
 }
@@ -834,79 +872,49 @@ CCLabelBMFont::~CCLabelBMFont()
 // LabelBMFont - Atlas generation
 int CCLabelBMFont::kerningAmountForFirst(unsigned short first, unsigned short second)
 {
-    int ret = 0;
-    unsigned int key = (first<<16) | (second & 0xffff);
-
-    if( m_pConfiguration->m_pKerningDictionary ) {
-        tCCKerningHashElement *element = NULL;
-        HASH_FIND_INT(m_pConfiguration->m_pKerningDictionary, &key, element);        
-        if(element)
-            ret = element->amount;
-    }
-    return ret;
+    return m_pConfiguration->getKerningAmount(first, second);
 }
 
 void CCLabelBMFont::createFontChars()
 {
-    int nextFontPositionX = 0;
-    int nextFontPositionY = 0;
-    //unsigned short prev = -1;
-    int kerningAmount = 0;
-
-    CCSize tmpSize = CCSizeZero;
-
-    int longestLine = 0;
-    unsigned int totalHeight = 0;
-
-    unsigned int quantityOfLines = 1;
-    unsigned int stringLen = cc_wcslen(m_sString);
+    unsigned int stringLen = m_sString ? cc_wcslen(m_sString) : 0;
     if (stringLen == 0)
     {
         return;
     }
 
-    set<unsigned int> *charSet = m_pConfiguration->getCharacterSet();
-
-    for (unsigned int i = 0; i < stringLen - 1; ++i)
+    // Line breaks, kerning and alignment come from the shared layout cache, in pixels.
+    // The width is in points and applies to the scaled label.
+    float maxWidth = 0;
+    if (m_fWidth > 0 && m_fScaleX != 0)
     {
-        unsigned short c = m_sString[i];
-        if (c == '\n')
-        {
-            quantityOfLines++;
-        }
+        maxWidth = m_fWidth / m_fScaleX * CC_CONTENT_SCALE_FACTOR();
     }
 
-    totalHeight = m_pConfiguration->m_nCommonHeight * quantityOfLines;
-    nextFontPositionY = 0-(m_pConfiguration->m_nCommonHeight - m_pConfiguration->m_nCommonHeight * quantityOfLines);
+    CCTextLayout *pLayout = CCTextLayoutCache::sharedTextLayoutCache()->layoutForText(m_sString, stringLen, m_pConfiguration,
+                                                                                      maxWidth, m_pAlignment, m_bLineBreakWithoutSpaces,
+                                                                                      m_pLayout);
+    CC_SAFE_RETAIN(pLayout);
+    CC_SAFE_RELEASE(m_pLayout);
+    m_pLayout = pLayout;
+
+    unsigned int quantityOfLines = m_pLayout->getLineCount();
     
     CCRect rect;
     ccBMFontDef fontDef;
 
-    for (unsigned int i= 0; i < stringLen; i++)
+    for (unsigned int g = 0; g < m_pLayout->getGlyphCount(); g++)
     {
-        unsigned short c = m_sString[i];
-
-        if (c == '\n')
-        {
-            nextFontPositionX = 0;
-            nextFontPositionY -= m_pConfiguration->m_nCommonHeight;
-            continue;
-        }
-        
-        if (charSet->find(c) == charSet->end())
-        {
-            CCLOG("CCLabelBMFont: Attempted to use character not defined in this bitmap: %d", c);
-            continue;      
-        }
+        const ccTextLayoutGlyph &glyph = m_pLayout->getGlyph(g);
+        unsigned int i = glyph.uIndex;
 
         tCCFontDefHashElement *element = NULL;
 
         // unichar is a short, and an int is needed on HASH_FIND_INT
-        unsigned int key = c;
+        unsigned int key = glyph.c;
         HASH_FIND_INT(m_pConfiguration->m_pFontDefDictionary, &key, element);
         if (! element)
         {
-            CCLOG("cocos2d: LabelBMFont: characer not found %d", c);
             continue;
         }
 
@@ -952,16 +960,16 @@ void CCLabelBMFont::createFontChars()
             fontChar->setOpacity(255);
         }
 
+        // lines go from the top down
+        int nextFontPositionY = m_pConfiguration->m_nCommonHeight * (int)(quantityOfLines - 1 - glyph.uLine);
+        float nextFontPositionX = glyph.x + m_pLayout->getLine(glyph.uLine).fOffset;
+
         // See issue 1343. cast( signed short + unsigned integer ) == unsigned integer (sign is lost!)
         int yOffset = m_pConfiguration->m_nCommonHeight - fontDef.yOffset;
-        CCPoint fontPos = ccp( (float)nextFontPositionX + fontDef.xOffset + fontDef.rect.size.width*0.5f + kerningAmount,
+        CCPoint fontPos = ccp( nextFontPositionX + fontDef.xOffset + fontDef.rect.size.width*0.5f,
             (float)nextFontPositionY + yOffset - rect.size.height*0.5f * CC_CONTENT_SCALE_FACTOR() );
         fontChar->setPosition(CC_POINT_PIXELS_TO_POINTS(fontPos));
 
-        // update kerning
-        nextFontPositionX += fontDef.xAdvance + kerningAmount;
-        //prev = c;
-
         // Apply label properties
         fontChar->setOpacityModifyRGB(m_bIsOpacityModifyRGB);
         // Color MUST be set before opacity, since opacity might change color if OpacityModifyRGB is on
@@ -974,29 +982,15 @@ void CCLabelBMFont::createFontChars()
             fontChar->setOpacity(m_cOpacity);
         }
 
-        if (longestLine < nextFontPositionX)
-        {
-            longestLine = nextFontPositionX;
-        }
-        
         if (! hasSprite)
         {
             updateQuadFromSprite(fontChar, i);
         }
     }
 
-    // If the last character processed has an xAdvance which is less that the width of the characters image, then we need
-    // to adjust the width of the string to take this into account, or the character will overlap the end of the bounding
-    // box
-    if (fontDef.xAdvance < fontDef.rect.size.width)
-    {
-        tmpSize.width = longestLine + fontDef.rect.size.width - fontDef.xAdvance;
-    }
-    else
-    {
-        tmpSize.width = longestLine;
-    }
-    tmpSize.height = totalHeight;
+    CCSize tmpSize;
+    tmpSize.width = m_pLayout->getWidth();
+    tmpSize.height = (float)(m_pConfiguration->m_nCommonHeight * quantityOfLines);
 
     this->setContentSize(CC_SIZE_PIXELS_TO_POINTS(tmpSize));
 }
@@ -1036,10 +1030,8 @@ void CCLabelBMFont::updateString(bool fromUpdate)
             }
         }
     }
+    // wrapping and alignment are part of the layout
     this->createFontChars();
-
-    if (!fromUpdate)
-        updateLabel();
 }
 
 const char* CCLabelBMFont::getString(void)
@@ -1138,237 +1130,8 @@ void CCLabelBMFont::setAnchorPoint(const CCPoint& point)
 // LabelBMFont - Alignment
 void CCLabelBMFont::updateLabel()
 {
-    this->setString(m_sInitialString.c_str(), true);
-
-    if (m_fWidth > 0)
-    {
-        // Step 1: Make multiline
-        vector<unsigned short> str_whole = cc_utf16_vec_from_utf16_str(m_sString);
-        unsigned int stringLength = str_whole.size();
-        vector<unsigned short> multiline_string;
-        multiline_string.reserve( stringLength );
-        vector<unsigned short> last_word;
-        last_word.reserve( stringLength );
-
-        unsigned int line = 1, i = 0;
-        bool start_line = false, start_word = false;
-        float startOfLine = -1, startOfWord = -1;
-        int skip = 0;
-
-        CCArray* children = getChildren();
-        for (unsigned int j = 0; j < children->count(); j++)
-        {
-            CCSprite* characterSprite;
-
-            while (!(characterSprite = (CCSprite*)this->getChildByTag(j + skip)))
-                skip++;
-
-            if (!characterSprite->isVisible())
-                continue;
-
-            if (i >= stringLength)
-                break;
-
-            unsigned short character = str_whole[i];
-
-            if (!start_word)
-            {
-                startOfWord = getLetterPosXLeft( characterSprite );
-                start_word = true;
-            }
-            if (!start_line)
-            {
-                startOfLine = startOfWord;
-                start_line = true;
-            }
-
-            // Newline.
-            if (character == '\n')
-            {
-                cc_utf8_trim_ws(&last_word);
-
-                last_word.push_back('\n');
-                multiline_string.insert(multiline_string.end(), last_word.begin(), last_word.end());
-                last_word.clear();
-                start_word = false;
-                start_line = false;
-                startOfWord = -1;
-                startOfLine = -1;
-                i++;
-                line++;
-
-                if (i >= stringLength)
-                    break;
-
-                character = str_whole[i];
-
-                if (!startOfWord)
-                {
-                    startOfWord = getLetterPosXLeft( characterSprite );
-                    start_word = true;
-                }
-                if (!startOfLine)
-                {
-                    startOfLine  = startOfWord;
-                    start_line = true;
-                }
-            }
-
-            // Whitespace.
-            if (isspace_unicode(character))
-            {
-                last_word.push_back(character);
-                multiline_string.insert(multiline_string.end(), last_word.begin(), last_word.end());
-                last_word.clear();
-                start_word = false;
-                startOfWord = -1;
-                i++;
-                continue;
-            }
-
-            // Out of bounds.
-            if ( getLetterPosXRight( characterSprite ) - startOfLine > m_fWidth )
-            {
-                if (!m_bLineBreakWithoutSpaces)
-                {
-                    last_word.push_back(character);
-
-                    int found = cc_utf8_find_last_not_char(multiline_string, ' ');
-                    if (found != -1)
-                        cc_utf8_trim_ws(&multiline_string);
-                    else
-                        multiline_string.clear();
-
-                    if (multiline_string.size() > 0)
-                        multiline_string.push_back('\n');
-
-                    line++;
-                    start_line = false;
-                    startOfLine = -1;
-                    i++;
-                }
-                else
-                {
-                    cc_utf8_trim_ws(&last_word);
-
-                    last_word.push_back('\n');
-                    multiline_string.insert(multiline_string.end(), last_word.begin(), last_word.end());
-                    last_word.clear();
-                    start_word = false;
-                    start_line = false;
-                    startOfWord = -1;
-                    startOfLine = -1;
-                    line++;
-
-                    if (i >= stringLength)
-                        break;
-
-                    if (!startOfWord)
-                    {
-                        startOfWord = getLetterPosXLeft( characterSprite );
-                        start_word = true;
-                    }
-                    if (!startOfLine)
-                    {
-                        startOfLine  = startOfWord;
-                        start_line = true;
-                    }
-
-                    j--;
-                }
-
-                continue;
-            }
-            else
-            {
-                // Character is normal.
-                last_word.push_back(character);
-                i++;
-                continue;
-            }
-        }
-
-        multiline_string.insert(multiline_string.end(), last_word.begin(), last_word.end());
-
-        int size = multiline_string.size();
-        unsigned short* str_new = new unsigned short[size + 1];
-
-        for (int i = 0; i < size; ++i)
-        {
-            str_new[i] = multiline_string[i];
-        }
-
-        str_new[size] = 0;
-
-        CC_SAFE_DELETE_ARRAY(m_sString);
-        m_sString = str_new;
-        updateString(true);
-    }
-
-    // Step 2: Make alignment
-    if (m_pAlignment != kCCTextAlignmentLeft)
-    {
-        int i = 0;
-
-        int lineNumber = 0;
-        int str_len = cc_wcslen(m_sString);
-        vector<unsigned short> last_line;
-        for (int ctr = 0; ctr <= str_len; ++ctr)
-        {
-            if (m_sString[ctr] == '\n' || m_sString[ctr] == 0)
-            {
-                float lineWidth = 0.0f;
-                unsigned int line_length = last_line.size();
-				// if last line is empty we must just increase lineNumber and work with next line
-                if (line_length == 0)
-                {
-                    lineNumber++;
-                    continue;
-                }
-                int index = i + line_length - 1 + lineNumber;
-                if (index < 0) continue;
-
-                CCSprite* lastChar = (CCSprite*)getChildByTag(index);
-                if ( lastChar == NULL )
-                    continue;
-
-                lineWidth = lastChar->getPosition().x + lastChar->getContentSize().width/2.0f;
-
-                float shift = 0;
-                switch (m_pAlignment)
-                {
-                case kCCTextAlignmentCenter:
-                    shift = getContentSize().width/2.0f - lineWidth/2.0f;
-                    break;
-                case kCCTextAlignmentRight:
-                    shift = getContentSize().width - lineWidth;
-                    break;
-                default:
-                    break;
-                }
-
-                if (shift != 0)
-                {
-                    for (unsigned j = 0; j < line_length; j++)
-                    {
-                        index = i + j + lineNumber;
-                        if (index < 0) continue;
-
-                        CCSprite* characterSprite = (CCSprite*)getChildByTag(index);
-                        characterSprite->setPosition(ccpAdd(characterSprite->getPosition(), ccp(shift, 0.0f)));
-                    }
-                }
-
-                i += line_length;
-                lineNumber++;
-
-                last_line.clear();
-                continue;
-            }
-
-            last_line.push_back(m_sString[ctr]);
-        }
-    }
+    // m_sString is never rewritten with line breaks, so it only needs to be laid out again
+    this->updateString(true);
 }
 
 // LabelBMFont - Alignment
@@ -1408,16 +1171,6 @@ void CCLabelBMFont::setScaleY(float scaleY)
     updateLabel();
 }
 
-float CCLabelBMFont::getLetterPosXLeft( CCSprite* sp )
-{
-    return sp->getPosition().x * m_fScaleX - (sp->getContentSize().width * m_fScaleX * sp->getAnchorPoint().x);
-}
-
-float CCLabelBMFont::getLetterPosXRight( CCSprite* sp )
-{
-    return sp->getPosition().x * m_fScaleX + (sp->getContentSize().width * m_fScaleX * sp->getAnchorPoint().x);
-}
-
 // LabelBMFont - FntFile
 void CCLabelBMFont::setFntFile(const char* fntFile)
 {
@@ -21,6 +21,9 @@
 #include "pch.h"
 #include "CCLabelTTF.h"
 #include "CCDirector.h"
+#include "CCGlyphAtlasCache.h"
+#include "CCTextureAtlas.h"
+#include "CCTextLayoutCache.h"
 
 NS_CC_BEGIN
 
@@ -39,12 +42,18 @@ CCLabelTTF::CCLabelTTF()
 , m_pFontName(NULL)
 , m_fFontSize(0.0)
 , m_string("")
+, m_pGlyphAtlases(NULL)
+, m_bUseGlyphAtlas(false)
+, m_pTextLayout(NULL)
 {
+    m_tGlyphColor = ccc4(0, 0, 0, 0);
 }
 
 CCLabelTTF::~CCLabelTTF()
 {
     CC_SAFE_DELETE(m_pFontName);
+    CC_SAFE_RELEASE(m_pGlyphAtlases);
+    CC_SAFE_RELEASE(m_pTextLayout);
 }
 
 CCLabelTTF * CCLabelTTF::node()
@@ -255,6 +264,14 @@ bool CCLabelTTF::updateTexture()
 {
     bool bRet = false;
     CCTexture2D *tex;
+
+#if CC_LABELTTF_USE_GLYPH_ATLAS
+    if (this->updateGlyphQuads())
+    {
+        return true;
+    }
+#endif
+    m_bUseGlyphAtlas = false;
     
     do
     {
@@ -282,4 +299,240 @@ bool CCLabelTTF::updateTexture()
     return bRet;
 }
 
+bool CCLabelTTF::updateGlyphQuads()
+{
+    m_bUseGlyphAtlas = false;
+
+    CCGlyphAtlasCache *pCache = CCGlyphAtlasCache::sharedGlyphAtlasCache();
+    if (! pCache->setFont(m_pFontName->c_str(), (unsigned int)(m_fFontSize * CC_CONTENT_SCALE_FACTOR())))
+    {
+        return false;
+    }
+
+    // lines are wrapped at the label width, in pixels
+    CCSize dimensions = CC_SIZE_POINTS_TO_PIXELS(m_tDimensions);
+    std::wstring text = CCUtf8ToUnicode(m_string.c_str());
+    CCTextLayoutCache *pLayoutCache = CCTextLayoutCache::sharedTextLayoutCache();
+    unsigned int uFailures = pCache->getStats().uFailures;
+    CCTextLayout *pLayout = pLayoutCache->layoutForText((const unsigned short*)text.c_str(), (unsigned int)text.size(), pCache,
+                                                        dimensions.width, m_hAlignment, false, m_pTextLayout);
+    if (uFailures != pCache->getStats().uFailures)
+    {
+        // some glyph couldn't be cached and is missing from the layout
+        pLayoutCache->removeLayout(pLayout);
+        return false;
+    }
+    CC_SAFE_RETAIN(pLayout);
+    CC_SAFE_RELEASE(m_pTextLayout);
+    m_pTextLayout = pLayout;
+
+    int lineHeight = pCache->getLineHeight();
+    float textHeight = (float)(lineHeight * m_pTextLayout->getLineCount());
+    float width = dimensions.width > 0 ? dimensions.width : m_pTextLayout->getWidth();
+    float height = dimensions.height > 0 ? dimensions.height : textHeight;
+
+    // the layout aligns lines within the longest one, place that block in the label
+    float offsetX = 0;
+    if (m_hAlignment == kCCTextAlignmentCenter)
+    {
+        offsetX = (width - m_pTextLayout->getWidth()) / 2;
+    }
+    else if (m_hAlignment == kCCTextAlignmentRight)
+    {
+        offsetX = width - m_pTextLayout->getWidth();
+    }
+
+    float offsetY = 0;
+    if (m_vAlignment == kCCVerticalTextAlignmentCenter)
+    {
+        offsetY = floorf((height - textHeight) / 2);
+    }
+    else if (m_vAlignment == kCCVerticalTextAlignmentBottom)
+    {
+        offsetY = height - textHeight;
+    }
+
+    if (! m_pGlyphAtlases)
+    {
+        m_pGlyphAtlases = new CCDictionary();
+    }
+
+    CCDictElement *pElement = NULL;
+    CCDICT_FOREACH(m_pGlyphAtlases, pElement)
+    {
+        ((CCTextureAtlas*)pElement->getObject())->removeAllQuads();
+    }
+
+    const ccColor3B& color = getColor();
+    m_tGlyphColor = ccc4(color.r, color.g, color.b, getOpacity());
+
+    for (unsigned int i = 0; i < m_pTextLayout->getGlyphCount(); i++)
+    {
+        const ccTextLayoutGlyph &placed = m_pTextLayout->getGlyph(i);
+        const ccGlyphInfo *pGlyph = pCache->glyphForChar(placed.c);
+        if (! pGlyph)
+        {
+            return false;
+        }
+
+        const ccGlyphInfo &glyph = *pGlyph;
+        if (glyph.rect.size.width <= 0)
+        {
+            continue;
+        }
+
+        CCTexture2D *pTexture = pCache->textureForPage(glyph.uPage);
+        CCTextureAtlas *pAtlas = (CCTextureAtlas*)m_pGlyphAtlases->objectForKey((int)glyph.uPage);
+        if (! pAtlas)
+        {
+            pAtlas = new CCTextureAtlas();
+            pAtlas->initWithTexture(pTexture, m_pTextLayout->getGlyphCount());
+            m_pGlyphAtlases->setObject(pAtlas, (int)glyph.uPage);
+            pAtlas->release();
+        }
+        else if (pAtlas->getTexture() != pTexture)
+        {
+            pAtlas->setTexture(pTexture);
+        }
+
+        float left = floorf(offsetX + m_pTextLayout->getLine(placed.uLine).fOffset + placed.x) + glyph.nLeft;
+        float right = left + glyph.rect.size.width;
+        float top = height - (offsetY + placed.uLine * lineHeight + pCache->getAscender() - glyph.nTop);
+        float bottom = top - glyph.rect.size.height;
+
+        float pageWide = (float)pTexture->getPixelsWide();
+        float pageHigh = (float)pTexture->getPixelsHigh();
+        float texLeft = glyph.rect.origin.x / pageWide;
+        float texRight = (glyph.rect.origin.x + glyph.rect.size.width) / pageWide;
+        float texTop = glyph.rect.origin.y / pageHigh;
+        float texBottom = (glyph.rect.origin.y + glyph.rect.size.height) / pageHigh;
+
+        ccV3F_C4B_T2F_Quad quad;
+        quad.bl.vertices = vertex3(left, bottom, m_fVertexZ);
+        quad.br.vertices = vertex3(right, bottom, m_fVertexZ);
+        quad.tl.vertices = vertex3(left, top, m_fVertexZ);
+        quad.tr.vertices = vertex3(right, top, m_fVertexZ);
+        quad.bl.texCoords.u = texLeft;
+        quad.bl.texCoords.v = texBottom;
+        quad.br.texCoords.u = texRight;
+        quad.br.texCoords.v = texBottom;
+        quad.tl.texCoords.u = texLeft;
+        quad.tl.texCoords.v = texTop;
+        quad.tr.texCoords.u = texRight;
+        quad.tr.texCoords.v = texTop;
+        quad.bl.colors = m_tGlyphColor;
+        quad.br.colors = m_tGlyphColor;
+        quad.tl.colors = m_tGlyphColor;
+        quad.tr.colors = m_tGlyphColor;
+
+        if (pAtlas->getTotalQuads() == pAtlas->getCapacity())
+        {
+            pAtlas->resizeCapacity(pAtlas->getCapacity() * 2 + 1);
+        }
+        pAtlas->insertQuad(&quad, pAtlas->getTotalQuads());
+    }
+
+    // keep a texture around so the sprite blend func and getTexture() stay meaningful
+    CCTexture2D *pPage = pCache->textureForPage(0);
+    if (pPage)
+    {
+        this->setTexture(pPage);
+    }
+    this->setTextureRectInPixels(CCRectMake(0, 0, width, height), false, CCSizeMake(width, height));
+
+    // pages touched by this layout can't be evicted in the same frame, so the quads stay valid
+    m_tGlyphPageGenerations.assign(CC_GLYPH_ATLAS_MAX_PAGES, 0);
+    CCDictElement *pUsed = NULL;
+    CCDICT_FOREACH(m_pGlyphAtlases, pUsed)
+    {
+        unsigned int page = (unsigned int)pUsed->getIntKey();
+        if (((CCTextureAtlas*)pUsed->getObject())->getTotalQuads() > 0 && page < m_tGlyphPageGenerations.size())
+        {
+            m_tGlyphPageGenerations[page] = pCache->getPageGeneration(page);
+        }
+    }
+    m_bUseGlyphAtlas = true;
+    return true;
+}
+
+bool CCLabelTTF::glyphPagesChanged()
+{
+    CCGlyphAtlasCache *pCache = CCGlyphAtlasCache::sharedGlyphAtlasCache();
+    for (unsigned int page = 0; page < m_tGlyphPageGenerations.size(); page++)
+    {
+        if (m_tGlyphPageGenerations[page] != 0 && m_tGlyphPageGenerations[page] != pCache->getPageGeneration(page))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void CCLabelTTF::updateGlyphColors()
+{
+    const ccColor3B& color = getColor();
+    m_tGlyphColor = ccc4(color.r, color.g, color.b, getOpacity());
+
+    CCDictElement *pElement = NULL;
+    CCDICT_FOREACH(m_pGlyphAtlases, pElement)
+    {
+        CCTextureAtlas *pAtlas = (CCTextureAtlas*)pElement->getObject();
+        ccV3F_C4B_T2F_Quad *quads = pAtlas->getQuads();
+        for (unsigned int i = 0; i < pAtlas->getTotalQuads(); i++)
+        {
+            quads[i].bl.colors = m_tGlyphColor;
+            quads[i].br.colors = m_tGlyphColor;
+            quads[i].tl.colors = m_tGlyphColor;
+            quads[i].tr.colors = m_tGlyphColor;
+        }
+    }
+}
+
+void CCLabelTTF::draw(void)
+{
+    if (m_bUseGlyphAtlas)
+    {
+        // a page the quads use was evicted (or the cache cleared) since they were built
+        if (this->glyphPagesChanged() && ! this->updateGlyphQuads())
+        {
+            this->updateTexture();
+        }
+    }
+
+    if (! m_bUseGlyphAtlas)
+    {
+        CCSprite::draw();
+        return;
+    }
+
+    const ccColor3B& color = getColor();
+    if (color.r != m_tGlyphColor.r || color.g != m_tGlyphColor.g || color.b != m_tGlyphColor.b || getOpacity() != m_tGlyphColor.a)
+    {
+        this->updateGlyphColors();
+    }
+
+    bool newBlend = m_sBlendFunc.src != CC_BLEND_SRC || m_sBlendFunc.dst != CC_BLEND_DST;
+    if (newBlend)
+    {
+        CCD3DCLASS->D3DBlendFunc(m_sBlendFunc.src, m_sBlendFunc.dst);
+    }
+
+    CCGlyphAtlasCache *pCache = CCGlyphAtlasCache::sharedGlyphAtlasCache();
+    CCDictElement *pElement = NULL;
+    CCDICT_FOREACH(m_pGlyphAtlases, pElement)
+    {
+        CCTextureAtlas *pAtlas = (CCTextureAtlas*)pElement->getObject();
+        if (pAtlas->getTotalQuads() > 0)
+        {
+            pCache->touchPage((unsigned int)pElement->getIntKey());
+            pAtlas->drawQuads();
+        }
+    }
+
+    if (newBlend)
+    {
+        CCD3DCLASS->D3DBlendFunc(CC_BLEND_SRC, CC_BLEND_DST);
+    }
+}
+
 NS_CC_END
\ No newline at end of file
@@ -0,0 +1,367 @@
+/*
+* cocos2d-x   http://www.cocos2d-x.org
+*
+* Copyright (c) 2010-2011 - cocos2d-x community
+*
+* Portions Copyright (c) Microsoft Open Technologies, Inc.
+* All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on an
+* "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and limitations under the License.
+*/
+
+#include "pch.h"
+#include "CCTextLayoutCache.h"
+#include "ccMacros.h"
+
+NS_CC_BEGIN
+
+// Same set as CCLabelBMFont used for its word wrap.
+// Reference: http://en.wikipedia.org/wiki/Whitespace_character#Unicode
+static bool isspace_unicode(unsigned short ch)
+{
+    return  (ch >= 0x0009 && ch <= 0x000D) || ch == 0x0020 || ch == 0x0085 || ch == 0x00A0 || ch == 0x1680
+        || (ch >= 0x2000 && ch <= 0x200A) || ch == 0x2028 || ch == 0x2029 || ch == 0x202F
+        ||  ch == 0x205F || ch == 0x3000;
+}
+
+// ends the line made of the glyphs from firstGlyph on
+static void closeLine(const std::vector<ccTextLayoutGlyph> &glyphs, std::vector<ccTextLayoutLine> &lines,
+                      unsigned int firstGlyph, unsigned int firstChar)
+{
+    ccTextLayoutLine line;
+    line.uFirstGlyph = firstGlyph;
+    line.uGlyphCount = (unsigned int)glyphs.size() - firstGlyph;
+    line.uFirstChar = firstChar;
+    line.fWidth = 0;
+    line.fOffset = 0;
+    if (line.uGlyphCount > 0)
+    {
+        const ccTextLayoutGlyph &last = glyphs.back();
+        line.fWidth = MAX(last.x + last.metrics.xAdvance, last.x + last.metrics.xOffset + last.metrics.width);
+    }
+    lines.push_back(line);
+}
+
+//
+// CCTextLayout
+//
+CCTextLayout::CCTextLayout()
+: m_fMaxWidth(0)
+, m_eAlignment(kCCTextAlignmentLeft)
+, m_bLineBreakWithoutSpaces(false)
+, m_fWidth(0)
+, m_uLastUsed(0)
+{
+}
+
+CCTextLayout::~CCTextLayout()
+{
+}
+
+//
+// CCTextLayoutCache
+//
+static CCTextLayoutCache *g_sharedTextLayoutCache = NULL;
+
+CCTextLayoutCache * CCTextLayoutCache::sharedTextLayoutCache()
+{
+    if (!g_sharedTextLayoutCache)
+        g_sharedTextLayoutCache = new CCTextLayoutCache();
+
+    return g_sharedTextLayoutCache;
+}
+
+void CCTextLayoutCache::purgeSharedTextLayoutCache()
+{
+    CC_SAFE_RELEASE_NULL(g_sharedTextLayoutCache);
+}
+
+CCTextLayoutCache::CCTextLayoutCache()
+: m_uClock(0)
+, m_uHits(0)
+, m_uMisses(0)
+, m_uPartialLayouts(0)
+{
+    CCAssert(g_sharedTextLayoutCache == NULL, "Attempted to allocate a second instance of a singleton.");
+}
+
+CCTextLayoutCache::~CCTextLayoutCache()
+{
+    CCLOGINFO("cocos2d: deallocing CCTextLayoutCache.");
+    removeAllLayouts();
+}
+
+char * CCTextLayoutCache::description(void)
+{
+    char *ret = new char[100];
+    sprintf(ret, "<CCTextLayoutCache | Number of layouts = %u>", (unsigned int)m_tLayouts.size());
+    return ret;
+}
+
+CCTextLayout* CCTextLayoutCache::layoutForText(const unsigned short *text, unsigned int length, CCTextLayoutFont *pFont,
+                                               float maxWidth, CCTextAlignment alignment, bool lineBreakWithoutSpaces,
+                                               CCTextLayout *pPrevious)
+{
+    CCAssert(pFont != NULL, "CCTextLayoutCache: font must not be NULL");
+    CCAssert(text != NULL || length == 0, "CCTextLayoutCache: invalid text");
+
+    if (maxWidth < 0)
+    {
+        maxWidth = 0;
+    }
+
+    const char *fontKey = pFont->getLayoutFontKey();
+
+    // font, parameters and the raw UTF-16 text
+    char params[64];
+    sprintf(params, "|%.2f|%d|%d|", maxWidth, (int)alignment, lineBreakWithoutSpaces ? 1 : 0);
+    std::string key(fontKey);
+    key.append(params);
+    key.append((const char*)text, length * sizeof(unsigned short));
+
+    m_uClock++;
+
+    std::map<std::string, CCTextLayout*>::iterator it = m_tLayouts.find(key);
+    if (it != m_tLayouts.end())
+    {
+        m_uHits++;
+        it->second->m_uLastUsed = m_uClock;
+        return it->second;
+    }
+
+    m_uMisses++;
+
+    CCTextLayout *pLayout = new CCTextLayout();
+    if (length > 0)
+    {
+        pLayout->m_tText.assign(text, text + length);
+    }
+    pLayout->m_sFontKey = fontKey;
+    pLayout->m_fMaxWidth = maxWidth;
+    pLayout->m_eAlignment = alignment;
+    pLayout->m_bLineBreakWithoutSpaces = lineBreakWithoutSpaces;
+    pLayout->m_uLastUsed = m_uClock;
+
+    if (pPrevious && (pPrevious->m_sFontKey != pLayout->m_sFontKey
+        || pPrevious->m_fMaxWidth != maxWidth
+        || pPrevious->m_eAlignment != alignment
+        || pPrevious->m_bLineBreakWithoutSpaces != lineBreakWithoutSpaces))
+    {
+        pPrevious = NULL;
+    }
+
+    layoutLines(pLayout, pFont, pPrevious);
+
+    // keep the cache bounded: drop the least recently used layout
+    if (m_tLayouts.size() >= CC_TEXT_LAYOUT_CACHE_SIZE)
+    {
+        std::map<std::string, CCTextLayout*>::iterator oldest = m_tLayouts.begin();
+        for (it = m_tLayouts.begin(); it != m_tLayouts.end(); ++it)
+        {
+            if (it->second->m_uLastUsed < oldest->second->m_uLastUsed)
+            {
+                oldest = it;
+            }
+        }
+        oldest->second->release();
+        m_tLayouts.erase(oldest);
+    }
+
+    m_tLayouts[key] = pLayout;
+    return pLayout;
+}
+
+void CCTextLayoutCache::removeLayout(CCTextLayout *pLayout)
+{
+    std::map<std::string, CCTextLayout*>::iterator it;
+    for (it = m_tLayouts.begin(); it != m_tLayouts.end(); ++it)
+    {
+        if (it->second == pLayout)
+        {
+            pLayout->release();
+            m_tLayouts.erase(it);
+            break;
+        }
+    }
+}
+
+void CCTextLayoutCache::removeAllLayouts(void)
+{
+    std::map<std::string, CCTextLayout*>::iterator it;
+    for (it = m_tLayouts.begin(); it != m_tLayouts.end(); ++it)
+    {
+        it->second->release();
+    }
+    m_tLayouts.clear();
+}
+
+void CCTextLayoutCache::layoutLines(CCTextLayout *pLayout, CCTextLayoutFont *pFont, CCTextLayout *pPrevious)
+{
+    const std::vector<unsigned short> &text = pLayout->m_tText;
+    std::vector<ccTextLayoutGlyph> &glyphs = pLayout->m_tGlyphs;
+    std::vector<ccTextLayoutLine> &lines = pLayout->m_tLines;
+    float maxWidth = pLayout->m_fMaxWidth;
+    unsigned int length = (unsigned int)text.size();
+
+    unsigned int start = 0;
+    unsigned int lineNumber = 0;
+
+    // Reuse the lines of the previous layout that end before the first changed character.
+    // The break at the end of a line depends on the first word of the next one, so the line
+    // just before the change is laid out again too.
+    if (pPrevious && pPrevious->m_tLines.size() > 1)
+    {
+        unsigned int prefix = 0;
+        unsigned int common = MIN(length, (unsigned int)pPrevious->m_tText.size());
+        while (prefix < common && text[prefix] == pPrevious->m_tText[prefix])
+        {
+            prefix++;
+        }
+
+        unsigned int changedLine = 0;
+        while (changedLine + 1 < pPrevious->m_tLines.size() && pPrevious->m_tLines[changedLine + 1].uFirstChar <= prefix)
+        {
+            changedLine++;
+        }
+
+        if (changedLine >= 2)
+        {
+            lineNumber = changedLine - 1;
+            const ccTextLayoutLine &resume = pPrevious->m_tLines[lineNumber];
+            start = resume.uFirstChar;
+            lines.assign(pPrevious->m_tLines.begin(), pPrevious->m_tLines.begin() + lineNumber);
+            glyphs.assign(pPrevious->m_tGlyphs.begin(), pPrevious->m_tGlyphs.begin() + resume.uFirstGlyph);
+            m_uPartialLayouts++;
+        }
+    }
+
+    glyphs.reserve(length);
+
+    float pen = 0;
+    unsigned short prev = 0;
+    unsigned int lineFirstGlyph = (unsigned int)glyphs.size();
+    unsigned int lineFirstChar = start;
+    int lastSpace = -1;
+
+    for (unsigned int i = start; i <= length; i++)
+    {
+        // like a trailing newline in CCLabelBMFont, it doesn't open an empty last line
+        if (i == length && length > 0 && text[length - 1] == '\n' && ! lines.empty())
+        {
+            break;
+        }
+
+        if (i == length || text[i] == '\n')
+        {
+            closeLine(glyphs, lines, lineFirstGlyph, lineFirstChar);
+
+            lineNumber++;
+            lineFirstGlyph = (unsigned int)glyphs.size();
+            lineFirstChar = i + 1;
+            pen = 0;
+            prev = 0;
+            lastSpace = -1;
+            continue;
+        }
+
+        unsigned short c = text[i];
+        ccTextGlyphMetrics metrics;
+        if (! pFont->getGlyphMetrics(c, &metrics))
+        {
+            continue;
+        }
+
+        bool isSpace = isspace_unicode(c);
+        float x = pen + (prev ? pFont->getKerningAmount(prev, c) : 0);
+
+        if (maxWidth > 0 && ! isSpace && glyphs.size() > lineFirstGlyph
+            && x + metrics.xOffset + metrics.width > maxWidth)
+        {
+            std::vector<ccTextLayoutGlyph> word;
+            unsigned int cut = (unsigned int)glyphs.size();
+
+            if (! pLayout->m_bLineBreakWithoutSpaces && lastSpace >= 0)
+            {
+                // move the word after the last space to the next line
+                word.assign(glyphs.begin() + lastSpace + 1, glyphs.end());
+                cut = (unsigned int)lastSpace + 1;
+            }
+
+            // trailing whitespace doesn't count in the line
+            while (cut > lineFirstGlyph && isspace_unicode(glyphs[cut - 1].c))
+            {
+                cut--;
+            }
+            glyphs.resize(cut);
+
+            closeLine(glyphs, lines, lineFirstGlyph, lineFirstChar);
+
+            lineNumber++;
+            lineFirstGlyph = (unsigned int)glyphs.size();
+            lineFirstChar = word.empty() ? i : word[0].uIndex;
+            pen = 0;
+            prev = 0;
+            lastSpace = -1;
+
+            for (unsigned int w = 0; w < word.size(); w++)
+            {
+                ccTextLayoutGlyph &glyph = word[w];
+                glyph.x = pen + (prev ? pFont->getKerningAmount(prev, glyph.c) : 0);
+                glyph.uLine = lineNumber;
+                glyphs.push_back(glyph);
+                pen = glyph.x + glyph.metrics.xAdvance;
+                prev = glyph.c;
+            }
+
+            x = pen + (prev ? pFont->getKerningAmount(prev, c) : 0);
+        }
+
+        ccTextLayoutGlyph glyph;
+        glyph.uIndex = i;
+        glyph.c = c;
+        glyph.uLine = lineNumber;
+        glyph.x = x;
+        glyph.metrics = metrics;
+        glyphs.push_back(glyph);
+
+        pen = x + metrics.xAdvance;
+        prev = c;
+        if (isSpace)
+        {
+            lastSpace = (int)glyphs.size() - 1;
+        }
+    }
+
+    // alignment within the longest line
+    pLayout->m_fWidth = 0;
+    for (unsigned int i = 0; i < lines.size(); i++)
+    {
+        pLayout->m_fWidth = MAX(pLayout->m_fWidth, lines[i].fWidth);
+    }
+
+    for (unsigned int i = 0; i < lines.size(); i++)
+    {
+        ccTextLayoutLine &line = lines[i];
+        switch (pLayout->m_eAlignment)
+        {
+        case kCCTextAlignmentCenter:
+            line.fOffset = (pLayout->m_fWidth - line.fWidth) / 2.0f;
+            break;
+        case kCCTextAlignmentRight:
+            line.fOffset = pLayout->m_fWidth - line.fWidth;
+            break;
+        default:
+            line.fOffset = 0;
+            break;
+        }
+    }
+}
+
+NS_CC_END
@@ -35,7 +35,8 @@ THE SOFTWARE.
 #include "CCFileUtils.h"
 #include "DirectXHelper.h"
 #include <fstream>
-#include "BasicLoader.h"
+#include "CCShaderCache.h"
+#include "ccDXStateCache.h"
 
 using namespace std;
 using namespace DirectX;
@@ -668,14 +669,26 @@ void CCLayerColor::draw()
 	glEnable(CC_TEXTURE_2D);=*/
 }
 
+bool CCLayerColor::getRenderState(ccRenderState *pState)
+{
+	pState->shader = kCCRenderShaderLayerColor;
+	pState->texture = NULL;
+	// the blend function draw sets
+	if( m_tBlendFunc.src == CC_BLEND_SRC && m_tBlendFunc.dst == CC_BLEND_DST && m_cOpacity != 255 ) {
+		pState->blendFunc.src = CC_SRC_ALPHA;
+		pState->blendFunc.dst = CC_ONE_MINUS_SRC_ALPHA;
+	}
+	else {
+		pState->blendFunc = m_tBlendFunc;
+	}
+	return true;
+}
+
 
 
 CCDXLayerColor::CCDXLayerColor()
 {
-	m_vertexShader = 0;
-	m_pixelShader = 0;
-	m_layout = 0;
-	m_matrixBuffer = 0;
+	m_pProgram = 0;
 	m_vertexBuffer = 0;
 	mIsInit = FALSE;
 }
@@ -686,10 +699,7 @@ CCDXLayerColor::~CCDXLayerColor()
 void CCDXLayerColor::FreeBuffer()
 {
 	CC_SAFE_RELEASE_NULL_DX(m_vertexBuffer);
-	CC_SAFE_RELEASE_NULL_DX(m_matrixBuffer);
-	CC_SAFE_RELEASE_NULL_DX(m_layout);
-	CC_SAFE_RELEASE_NULL_DX(m_pixelShader);
-	CC_SAFE_RELEASE_NULL_DX(m_vertexShader);
+	CC_SAFE_RELEASE_NULL(m_pProgram);
 }
 void CCDXLayerColor::setIsInit(bool isInit)
 {
@@ -743,64 +753,18 @@ void CCDXLayerColor::RenderVertexBuffer(ccVertex2F* squareVertices,ccColor4B* sq
 	unsigned int offset;
 	stride = sizeof(VertexType); 
 	offset = 0;
-	CCID3D11DeviceContext->IASetVertexBuffers(0, 1, &m_vertexBuffer, &stride, &offset);
-	CCID3D11DeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+	ccDXBindVertexBuffer(m_vertexBuffer, stride, offset);
+	ccDXSetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
 
 	return;
 }
 
 bool CCDXLayerColor::InitializeShader()
 {
-	HRESULT result;
-	ID3D10Blob* errorMessage;
-	//ID3D10Blob* vertexShaderBuffer;
-	//ID3D10Blob* pixelShaderBuffer;
-	D3D11_BUFFER_DESC matrixBufferDesc;
-	//D3D11_SAMPLER_DESC samplerDesc;
+	m_pProgram = CCShaderCache::sharedShaderCache()->programForKey(kCCShader_LayerColor);
+	CC_SAFE_RETAIN(m_pProgram);
 
-
-	// Initialize the pointers this function will use to null.
-	errorMessage = 0;
-	//vertexShaderBuffer = 0;
-	//pixelShaderBuffer = 0;
-
-		 BasicLoader^ loader = ref new BasicLoader(CCID3D11Device);
-		 D3D11_INPUT_ELEMENT_DESC layoutDesc[] = 
-		 {
-			 { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-			 { "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		 };
-
-		 loader->LoadShader(
-			 L"CCLayerColorVertexShader.cso",
-			 layoutDesc,
-			 ARRAYSIZE(layoutDesc),
-			 &m_vertexShader,
-			 &m_layout
-			 );
-
-		 loader->LoadShader(
-			 L"CCLayerColorPixelShader.cso",
-			 &m_pixelShader
-			 );
-
-
-	// Setup the description of the dynamic matrix constant buffer that is in the vertex shader.
-	matrixBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
-	matrixBufferDesc.ByteWidth = sizeof(MatrixBufferType);
-	matrixBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	matrixBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-	matrixBufferDesc.MiscFlags = 0;
-	matrixBufferDesc.StructureByteStride = 0;
-
-	// Create the constant buffer pointer so we can access the vertex shader constant buffer from within this class.
-	result = CCID3D11Device->CreateBuffer(&matrixBufferDesc, NULL, &m_matrixBuffer);
-	if(FAILED(result))
-	{
-		return false;
-	}
-
-	return true;
+	return m_pProgram != NULL;
 }
 
 void CCDXLayerColor::OutputShaderErrorMessage(ID3D10Blob* errorMessage, HWND hwnd, WCHAR* shaderFilename)
@@ -841,47 +805,12 @@ void CCDXLayerColor::OutputShaderErrorMessage(ID3D10Blob* errorMessage, HWND hwn
 
 bool CCDXLayerColor::SetShaderParameters(XMMATRIX &viewMatrix,XMMATRIX &projectionMatrix)
 {
-	HRESULT result;
-	D3D11_MAPPED_SUBRESOURCE mappedResource;
-	MatrixBufferType* dataPtr;
-	unsigned int bufferNumber;
-
-
-	// Transpose the matrices to prepare them for the shader.
-	viewMatrix = XMMatrixTranspose(viewMatrix);
-	projectionMatrix = XMMatrixTranspose(projectionMatrix);
-
-	// Lock the constant buffer so it can be written to.
-	result = CCID3D11DeviceContext->Map(m_matrixBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-	if(FAILED(result))
-	{
-		return false;
-	}
-
-	// Get a pointer to the data in the constant buffer.
-	dataPtr = (MatrixBufferType*)mappedResource.pData;
-
-	// Copy the matrices into the constant buffer.
-	dataPtr->view = viewMatrix;
-	dataPtr->projection = projectionMatrix;
-
-	// Unlock the constant buffer.
-	CCID3D11DeviceContext->Unmap(m_matrixBuffer, 0);
-
-	// Set the position of the constant buffer in the vertex shader.
-	bufferNumber = 0;
-
-	// Now set the constant buffer in the vertex shader with the updated values.
-	CCID3D11DeviceContext->VSSetConstantBuffers(bufferNumber, 1, &m_matrixBuffer);
-
-	return true;
+	return CCShaderCache::sharedShaderCache()->useMatrixBuffer(viewMatrix, projectionMatrix);
 }
 
 void CCDXLayerColor::RenderShader()
 {
-	CCID3D11DeviceContext->IASetInputLayout(m_layout);
-	CCID3D11DeviceContext->VSSetShader(m_vertexShader, NULL, 0);
-	CCID3D11DeviceContext->PSSetShader(m_pixelShader, NULL, 0);
+	m_pProgram->use();
 	CCID3D11DeviceContext->Draw(4,0);
 }
 
@@ -895,12 +824,19 @@ void CCDXLayerColor::Render(ccVertex2F* squareVertices,ccColor4B* squareColors)
 		initVertexBuffer();
 		InitializeShader();
 	}
+	if ( !m_pProgram )
+	{
+		return;
+	}
 	
 	XMMATRIX viewMatrix, projectionMatrix;
 	CCD3DCLASS->GetViewMatrix(viewMatrix);
 	CCD3DCLASS->GetProjectionMatrix(projectionMatrix);
 	RenderVertexBuffer(squareVertices,squareColors);
-	SetShaderParameters(viewMatrix, projectionMatrix);
+	if ( !SetShaderParameters(viewMatrix, projectionMatrix) )
+	{
+		return;
+	}
 	RenderShader();
 }
 
@@ -337,6 +337,12 @@ void CCMotionStreak::reset()
     m_uNuPoints = 0;
 }
 
+bool CCMotionStreak::getCullingRectInPixels(CCRect *pRect)
+{
+    CC_UNUSED_PARAM(pRect);
+    return false;
+}
+
 void CCMotionStreak::draw()
 {
 	CCAssert("Unfinished");
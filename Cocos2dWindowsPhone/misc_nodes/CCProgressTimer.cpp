@@ -28,7 +28,8 @@
 #include <float.h>
 #include "CCFileUtils.h"
 #include "DirectXHelper.h"
-#include "BasicLoader.h"
+#include "CCShaderCache.h"
+#include "ccDXStateCache.h"
 
 using namespace std;
 using namespace DirectX;
@@ -660,10 +661,7 @@ void CCProgressTimer::draw(void)
 
 CCDXProgressTimer::CCDXProgressTimer()
 {
-	m_vertexShader = 0;
-	m_pixelShader = 0;
-	m_layout = 0;
-	m_matrixBuffer = 0;
+	m_pProgram = 0;
 	m_vertexBuffer = 0;
 	mIsInit = FALSE;
 }
@@ -674,10 +672,7 @@ CCDXProgressTimer::~CCDXProgressTimer()
 void CCDXProgressTimer::FreeBuffer()
 {
 	CC_SAFE_RELEASE_NULL_DX(m_vertexBuffer);
-	CC_SAFE_RELEASE_NULL_DX(m_matrixBuffer);
-	CC_SAFE_RELEASE_NULL_DX(m_layout);
-	CC_SAFE_RELEASE_NULL_DX(m_pixelShader);
-	CC_SAFE_RELEASE_NULL_DX(m_vertexShader);
+	CC_SAFE_RELEASE_NULL(m_pProgram);
 }
 
 void CCDXProgressTimer::setIsInit(bool isInit)
@@ -689,8 +684,8 @@ void CCDXProgressTimer::RenderVertexBuffer()
 {
 	unsigned int stride = sizeof(VertexType); 
 	unsigned int offset = 0;
-	CCID3D11DeviceContext->IASetVertexBuffers(0, 1, &m_vertexBuffer, &stride, &offset);
-	CCID3D11DeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+	ccDXBindVertexBuffer(m_vertexBuffer, stride, offset);
+	ccDXSetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
 }
 
 void CCDXProgressTimer::initVertexBuffer(ccV2F_C4B_T2F *vertexData,int& vertexDataCount,CCProgressTimerType eType)
@@ -837,49 +832,10 @@ void CCDXProgressTimer::initVertexBuffer(ccV2F_C4B_T2F *vertexData,int& vertexDa
 
 bool CCDXProgressTimer::InitializeShader()
 {
-	HRESULT result;
-	ID3D10Blob* errorMessage;
-	D3D11_BUFFER_DESC matrixBufferDesc;
-	// Initialize the pointers this function will use to null.
-	errorMessage = 0;
-
-	BasicLoader^ loader = ref new BasicLoader(CCID3D11Device);
-	D3D11_INPUT_ELEMENT_DESC layoutDesc[] = 
-	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
-	};
-
-	loader->LoadShader(
-		L"CCProgressTimerVertexShader.cso",
-		layoutDesc,
-		ARRAYSIZE(layoutDesc),
-		&m_vertexShader,
-		&m_layout
-		);
-
-	loader->LoadShader(
-		L"CCProgressTimerPixelShader.cso",
-		&m_pixelShader
-		);
-
-	// Setup the description of the dynamic matrix constant buffer that is in the vertex shader.
-	matrixBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
-	matrixBufferDesc.ByteWidth = sizeof(MatrixBufferType);
-	matrixBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	matrixBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-	matrixBufferDesc.MiscFlags = 0;
-	matrixBufferDesc.StructureByteStride = 0;
-
-	// Create the constant buffer pointer so we can access the vertex shader constant buffer from within this class.
-	result = CCID3D11Device->CreateBuffer(&matrixBufferDesc, NULL, &m_matrixBuffer);
-	if(FAILED(result))
-	{
-		return false;
-	}
+	m_pProgram = CCShaderCache::sharedShaderCache()->programForKey(kCCShader_ProgressTimer);
+	CC_SAFE_RETAIN(m_pProgram);
 
-	return true;
+	return m_pProgram != NULL;
 }
 
 void CCDXProgressTimer::OutputShaderErrorMessage(ID3D10Blob* errorMessage, HWND hwnd, WCHAR* shaderFilename)
@@ -920,51 +876,21 @@ void CCDXProgressTimer::OutputShaderErrorMessage(ID3D10Blob* errorMessage, HWND
 
 bool CCDXProgressTimer::SetShaderParameters(XMMATRIX &viewMatrix,XMMATRIX &projectionMatrix, ID3D11ShaderResourceView* texture)
 {
-	HRESULT result;
-	D3D11_MAPPED_SUBRESOURCE mappedResource;
-	MatrixBufferType* dataPtr;
-	unsigned int bufferNumber;
-
-
-	// Transpose the matrices to prepare them for the shader.
-	viewMatrix = XMMatrixTranspose(viewMatrix);
-	projectionMatrix = XMMatrixTranspose(projectionMatrix);
-
-	// Lock the constant buffer so it can be written to.
-	result = CCID3D11DeviceContext->Map(m_matrixBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-	if(FAILED(result))
+	if (! CCShaderCache::sharedShaderCache()->useMatrixBuffer(viewMatrix, projectionMatrix))
 	{
 		return false;
 	}
 
-	// Get a pointer to the data in the constant buffer.
-	dataPtr = (MatrixBufferType*)mappedResource.pData;
-
-	// Copy the matrices into the constant buffer.
-	dataPtr->view = viewMatrix;
-	dataPtr->projection = projectionMatrix;
-
-	// Unlock the constant buffer.
-	CCID3D11DeviceContext->Unmap(m_matrixBuffer, 0);
-
-	// Set the position of the constant buffer in the vertex shader.
-	bufferNumber = 0;
-
-	// Now set the constant buffer in the vertex shader with the updated values.
-	CCID3D11DeviceContext->VSSetConstantBuffers(bufferNumber, 1, &m_matrixBuffer);
-
 	// Set shader texture resource in the pixel shader.
-	CCID3D11DeviceContext->PSSetShaderResources(0, 1, &texture);
+	ccDXBindTexture2D(texture);
 
 	return true;
 }
 
 void CCDXProgressTimer::RenderShader(int& vertexDataCount,CCSprite *pSprite)
 {
-	CCID3D11DeviceContext->IASetInputLayout(m_layout);
-	CCID3D11DeviceContext->VSSetShader(m_vertexShader, NULL, 0);
-	CCID3D11DeviceContext->PSSetShader(m_pixelShader, NULL, 0);
-	CCID3D11DeviceContext->PSSetSamplers(0, 1, pSprite->getTexture()->GetSamplerState());
+	m_pProgram->use();
+	ccDXBindSampler(*pSprite->getTexture()->GetSamplerState());
 	CCID3D11DeviceContext->Draw(vertexDataCount,0);
 	return;
 }
@@ -978,6 +904,10 @@ void CCDXProgressTimer::Render(ccV2F_C4B_T2F *vertexData,int& vertexDataCount,CC
 		FreeBuffer();
 		InitializeShader();
 	}
+	if ( !m_pProgram )
+	{
+		return;
+	}
 	initVertexBuffer(vertexData,vertexDataCount,eType);
 	XMMATRIX viewMatrix, projectionMatrix;
 
@@ -989,7 +919,10 @@ void CCDXProgressTimer::Render(ccV2F_C4B_T2F *vertexData,int& vertexDataCount,CC
 	RenderVertexBuffer();
 
 	// Set the shader parameters that it will use for rendering.
-	 SetShaderParameters(viewMatrix, projectionMatrix, pSprite->getTexture()->getTextureResource());
+	if ( !SetShaderParameters(viewMatrix, projectionMatrix, pSprite->getTexture()->getTextureResource()) )
+	{
+		return;
+	}
 
 	// Now render the prepared buffers with the shader.
 	RenderShader(vertexDataCount,pSprite);
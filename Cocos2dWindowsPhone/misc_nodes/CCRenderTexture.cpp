@@ -29,6 +29,10 @@
 #include "CCTextureCache.h"
 #include "CCFileUtils.h"
 #include "CCGL.h"
+#include "CCDrawingPrimitives.h"
+#include "CCRenderQueue.h"
+#include "CCRenderPipeline.h"
+#include "ccDXStateCache.h"
 
 namespace cocos2d { 
 
@@ -139,6 +143,10 @@ bool CCRenderTexture::initWithWidthAndHeight(int w, int h, CCTexture2DPixelForma
 
 void CCRenderTexture::begin()
 {
+	// the nodes queued and the primitives batched so far go to the current target
+	CCRenderQueue::sharedRenderQueue()->flush();
+	ccDrawFlush();
+
 	// Save the current matrix
 	CCD3DCLASS->D3DPushMatrix();
 	SetRenderTarget(CCD3DCLASS->GetDeviceContext(), CCD3DCLASS->GetDepthStencilView());
@@ -169,7 +177,10 @@ void CCRenderTexture::beginWithClear(float r, float g, float b, float a)
 
 void CCRenderTexture::end(bool bIsTOCacheTexture)
 {
-	
+	// the nodes queued and the primitives batched since begin go to the texture
+	CCRenderQueue::sharedRenderQueue()->flush();
+	ccDrawFlush();
+
 	// Restore the original matrix and viewport
 	CCD3DCLASS->D3DPopMatrix();
 	CCD3DCLASS->SetBackBufferRenderTarget();
@@ -326,14 +337,16 @@ bool CCRenderTexture::getUIImageFromBuffer(CCImage *pImage, int x, int y, int nW
 			// e_fail
 		}
 
-		eglView->GetDeviceContext()->CopyResource(pStagingTexture, tmpResource);
+		// read back on the CPU: the commands recorded so far must have run
+		CCRenderPipeline::sharedRenderPipeline()->sync();
+		eglView->GetImmediateDeviceContext()->CopyResource(pStagingTexture, tmpResource);
 
-		eglView->GetDeviceContext()->Map(pStagingTexture, 0, D3D11_MAP_READ, 0, &Subresource);
+		eglView->GetImmediateDeviceContext()->Map(pStagingTexture, 0, D3D11_MAP_READ, 0, &Subresource);
 
 		//void* pData = Subresource.pData;
 		memcpy(pTempData,Subresource.pData,sizeof(byte)*nReadBufferWidth * nReadBufferHeight * 4);
 
-		eglView->GetDeviceContext()->Unmap(pStagingTexture, 0);
+		eglView->GetImmediateDeviceContext()->Unmap(pStagingTexture, 0);
 
 		if ( pStagingTexture )
 		{
@@ -473,13 +486,15 @@ void CCRenderTexture::CopyResource()
 		// e_fail
 	}
 
-	eglView->GetDeviceContext()->CopyResource(pStagingTexture, tmpResource);
+	// read back on the CPU: the commands recorded so far must have run
+	CCRenderPipeline::sharedRenderPipeline()->sync();
+	eglView->GetImmediateDeviceContext()->CopyResource(pStagingTexture, tmpResource);
 
-	eglView->GetDeviceContext()->Map(pStagingTexture, 0, D3D11_MAP_READ, 0, &Subresource);
+	eglView->GetImmediateDeviceContext()->Map(pStagingTexture, 0, D3D11_MAP_READ, 0, &Subresource);
 
 	void* pData = Subresource.pData;
 
-	eglView->GetDeviceContext()->Unmap(pStagingTexture, 0);
+	eglView->GetImmediateDeviceContext()->Unmap(pStagingTexture, 0);
 
 	if ( pStagingTexture )
 	{
@@ -533,7 +548,8 @@ void CCRenderTexture::Shutdown()
 void CCRenderTexture::SetRenderTarget(ID3D11DeviceContext* deviceContext, ID3D11DepthStencilView* depthStencilView)
 {
 	// Bind the render target view and depth stencil buffer to the output render pipeline.
-	deviceContext->OMSetRenderTargets(1, &m_renderTargetView, depthStencilView);
+	CC_UNUSED_PARAM(deviceContext);
+	ccDXSetRenderTarget(m_renderTargetView, depthStencilView);
 
 	return;
 }
@@ -27,11 +27,15 @@
 #include "CCFileUtils.h"
 #include "DirectXHelper.h"
 #include <fstream>
-#include "BasicLoader.h"
+#include "CCShaderCache.h"
+#include "ccDXStateCache.h"
 
 using namespace std;
 using namespace DirectX;
 
+// key of the ribbon program in CCShaderCache
+#define kCCShader_RibbonSegment "ShaderRibbonSegment"
+
 namespace cocos2d {
 
 /*
@@ -267,6 +271,12 @@ void CCRibbon::addPointAt(CCPoint location, float width)
 	seg->m_uEnd++;
 }
 
+bool CCRibbon::getCullingRectInPixels(CCRect *pRect)
+{
+	CC_UNUSED_PARAM(pRect);
+	return false;
+}
+
 void CCRibbon::draw()
 {
 	CCNode::draw();
@@ -440,10 +450,7 @@ void CCRibbonSegment::draw(float curTime, float fadeTime, const ccColor4B& color
 
 CCDXRibbonSegment::CCDXRibbonSegment()
 {
-	m_vertexShader = 0;
-	m_pixelShader = 0;
-	m_layout = 0;
-	m_matrixBuffer = 0;
+	m_pProgram = 0;
 	m_vertexBuffer = 0;
 	mIsInit = FALSE;
 }
@@ -454,10 +461,7 @@ CCDXRibbonSegment::~CCDXRibbonSegment()
 void CCDXRibbonSegment::FreeBuffer()
 {
 	CC_SAFE_RELEASE_NULL_DX(m_vertexBuffer);
-	CC_SAFE_RELEASE_NULL_DX(m_matrixBuffer);
-	CC_SAFE_RELEASE_NULL_DX(m_layout);
-	CC_SAFE_RELEASE_NULL_DX(m_pixelShader);
-	CC_SAFE_RELEASE_NULL_DX(m_vertexShader);
+	CC_SAFE_RELEASE_NULL(m_pProgram);
 }
 
 void CCDXRibbonSegment::setIsInit(bool isInit)
@@ -508,8 +512,8 @@ void CCDXRibbonSegment::RenderVertexBuffer(CCfloat* verts,CCfloat* coords,CCubyt
 	unsigned int offset;
 	stride = sizeof(VertexType); 
 	offset = 0;
-	CCID3D11DeviceContext->IASetVertexBuffers(0, 1, &m_vertexBuffer, &stride, &offset);
-	CCID3D11DeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+	ccDXBindVertexBuffer(m_vertexBuffer, stride, offset);
+	ccDXSetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
 
 	return;
 }
@@ -535,56 +539,30 @@ void CCDXRibbonSegment::initVertexBuffer()
 
 bool CCDXRibbonSegment::InitializeShader()
 {
-	HRESULT result;
-	ID3D10Blob* errorMessage;
-	//ID3D10Blob* vertexShaderBuffer;
-	//ID3D10Blob* pixelShaderBuffer;
-	D3D11_BUFFER_DESC matrixBufferDesc;
-	//D3D11_SAMPLER_DESC samplerDesc;
-
-	// Initialize the pointers this function will use to null.
-	errorMessage = 0;
-	//vertexShaderBuffer = 0;
-	//pixelShaderBuffer = 0;
-
-	BasicLoader^ loader = ref new BasicLoader(CCID3D11Device);
-	D3D11_INPUT_ELEMENT_DESC layoutDesc[] = 
+	// the ribbon shaders aren't part of the default programs: the first segment adds them to the cache
+	CCShaderCache *pShaderCache = CCShaderCache::sharedShaderCache();
+	m_pProgram = pShaderCache->programForKey(kCCShader_RibbonSegment);
+	if ( !m_pProgram )
 	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
-	};
-
-	loader->LoadShader(
-		L"CCRibbonSegmentVertexShader.cso",
-		layoutDesc,
-		ARRAYSIZE(layoutDesc),
-		&m_vertexShader,
-		&m_layout
-		);
-
-	loader->LoadShader(
-		L"CCRibbonSegmentPixelShader.cso",
-		&m_pixelShader
-		);
-
-
-	// Setup the description of the dynamic matrix constant buffer that is in the vertex shader.
-	matrixBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
-	matrixBufferDesc.ByteWidth = sizeof(MatrixBufferType);
-	matrixBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	matrixBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-	matrixBufferDesc.MiscFlags = 0;
-	matrixBufferDesc.StructureByteStride = 0;
-
-	// Create the constant buffer pointer so we can access the vertex shader constant buffer from within this class.
-	result = CCID3D11Device->CreateBuffer(&matrixBufferDesc, NULL, &m_matrixBuffer);
-	if(FAILED(result))
-	{
-		return false;
+		D3D11_INPUT_ELEMENT_DESC layoutDesc[] = 
+		{
+			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+			{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+			{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+		};
+
+		CCDXProgram *pProgram = new CCDXProgram();
+		if ( pProgram->initWithShaderFiles(L"CCRibbonSegmentVertexShader.cso", L"CCRibbonSegmentPixelShader.cso",
+			layoutDesc, ARRAYSIZE(layoutDesc)) )
+		{
+			pShaderCache->addProgram(pProgram, kCCShader_RibbonSegment);
+			m_pProgram = pProgram;
+		}
+		pProgram->release();
 	}
+	CC_SAFE_RETAIN(m_pProgram);
 
-	return true;
+	return m_pProgram != NULL;
 }
 
 void CCDXRibbonSegment::OutputShaderErrorMessage(ID3D10Blob* errorMessage, HWND hwnd, WCHAR* shaderFilename)
@@ -625,34 +603,19 @@ void CCDXRibbonSegment::OutputShaderErrorMessage(ID3D10Blob* errorMessage, HWND
 
 bool CCDXRibbonSegment::SetShaderParameters(XMMATRIX &viewMatrix, XMMATRIX &projectionMatrix, ID3D11ShaderResourceView* texture)
 {
-	D3D11_MAPPED_SUBRESOURCE mappedResource;
-	MatrixBufferType* dataPtr;
-	unsigned int bufferNumber;
-
-	// Transpose the matrices to prepare them for the shader.
-	viewMatrix = XMMatrixTranspose(viewMatrix);
-	projectionMatrix = XMMatrixTranspose(projectionMatrix);
-
-	// Lock the constant buffer so it can be written to.
-	if(FAILED(CCID3D11DeviceContext->Map(m_matrixBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource))){return false;}
-	dataPtr = (MatrixBufferType*)mappedResource.pData;
-	dataPtr->view = viewMatrix;
-	dataPtr->projection = projectionMatrix;
-	CCID3D11DeviceContext->Unmap(m_matrixBuffer, 0);
-
-	bufferNumber = 0;
-	CCID3D11DeviceContext->VSSetConstantBuffers(bufferNumber, 1, &m_matrixBuffer);
-	CCID3D11DeviceContext->PSSetShaderResources(0, 1, &texture);
+	if (! CCShaderCache::sharedShaderCache()->useMatrixBuffer(viewMatrix, projectionMatrix))
+	{
+		return false;
+	}
+	ccDXBindTexture2D(texture);
 
 	return true;
 }
 
 void CCDXRibbonSegment::RenderShader(unsigned int begin,unsigned int end,CCTexture2D* texture)
 {
-	CCID3D11DeviceContext->IASetInputLayout(m_layout);
-	CCID3D11DeviceContext->VSSetShader(m_vertexShader, NULL, 0);
-	CCID3D11DeviceContext->PSSetShader(m_pixelShader, NULL, 0);
-	CCID3D11DeviceContext->PSSetSamplers(0, 1, texture->GetSamplerState());
+	m_pProgram->use();
+	ccDXBindSampler(*texture->GetSamplerState());
 	CCID3D11DeviceContext->Draw((end - begin)*2,begin*2);
 
 	return;
@@ -669,6 +632,10 @@ void CCDXRibbonSegment::Render(CCfloat* verts,CCfloat* coords,CCubyte* colors,un
 		initVertexBuffer();
 		InitializeShader();
 	}
+	if ( !m_pProgram )
+	{
+		return;
+	}
 	
 	XMMATRIX viewMatrix, projectionMatrix;
 
@@ -680,7 +647,10 @@ void CCDXRibbonSegment::Render(CCfloat* verts,CCfloat* coords,CCubyte* colors,un
 	RenderVertexBuffer(verts,coords,colors);
 
 	// Set the shader parameters that it will use for rendering.
-	SetShaderParameters(viewMatrix, projectionMatrix, texture->getTextureResource());
+	if ( !SetShaderParameters(viewMatrix, projectionMatrix, texture->getTextureResource()) )
+	{
+		return;
+	}
 
 	// Now render the prepared buffers with the shader.
 	RenderShader(begin,end,texture);
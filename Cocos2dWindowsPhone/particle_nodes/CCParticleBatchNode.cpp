@@ -35,6 +35,7 @@
 #include "CCGrid.h"
 #include "CCPointExtension.h"
 #include "CCParticleSystem.h"
+#include "CCRenderQueue.h"
 //#include "CCShaderCache.h"
 //#include "CCGLProgram.h"
 //#include "ccGLStateCache.h"
@@ -150,7 +151,8 @@ void CCParticleBatchNode::visit()
 
     transform();
 
-    draw();
+    // draw now or when the render queue is flushed, in the order of the other queued nodes
+    CCRenderQueue::sharedRenderQueue()->addCommand(this);
 
     if ( m_pGrid && m_pGrid->isActive())
     {
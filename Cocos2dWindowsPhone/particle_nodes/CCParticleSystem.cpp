@@ -572,6 +572,12 @@ bool CCParticleSystem::isFull()
     return (m_uParticleCount == m_uTotalParticles);
 }
 
+bool CCParticleSystem::getCullingRectInPixels(CCRect *pRect)
+{
+    CC_UNUSED_PARAM(pRect);
+    return false;
+}
+
 // ParticleSystem - MainLoop
 void CCParticleSystem::update(float dt)
 {
@@ -28,7 +28,8 @@
 #include "CCDirector.h"
 #include "CCFileUtils.h"
 #include "DirectXHelper.h"
-#include "BasicLoader.h"
+#include "CCShaderCache.h"
+#include "ccDXStateCache.h"
 
 using namespace std;
 using namespace DirectX;
@@ -340,10 +341,7 @@ void CCParticleSystemQuad::draw()
 
 CCDXParticleSystemQuad::CCDXParticleSystemQuad()
 {
-	m_vertexShader = 0;
-	m_pixelShader = 0;
-	m_inputLayout = 0;
-	m_matrixBuffer = 0;
+	m_pProgram = 0;
 	m_indexBuffer = 0;
 	m_vertexBuffer = 0;
 	//there is no any allocated memory yet
@@ -359,10 +357,7 @@ void CCDXParticleSystemQuad::FreeBuffer()
 {
 	CC_SAFE_RELEASE_NULL_DX(m_vertexBuffer);
 	CC_SAFE_RELEASE_NULL_DX(m_indexBuffer);
-	CC_SAFE_RELEASE_NULL_DX(m_matrixBuffer);
-	CC_SAFE_RELEASE_NULL_DX(m_inputLayout);
-	CC_SAFE_RELEASE_NULL_DX(m_pixelShader);
-	CC_SAFE_RELEASE_NULL_DX(m_vertexShader);
+	CC_SAFE_RELEASE_NULL(m_pProgram);
 }
 
 void CCDXParticleSystemQuad::setIsInit(bool isInit)
@@ -482,58 +477,22 @@ void CCDXParticleSystemQuad::RenderVertexBuffer(ccV2F_C4B_T2F_Quad *quad,unsigne
 	offset = 0;
 
 	// Set the vertex buffer to active in the input assembler so it can be rendered.
-	CCID3D11DeviceContext->IASetVertexBuffers(0, 1, &m_vertexBuffer, &stride, &offset);
+	ccDXBindVertexBuffer(m_vertexBuffer, stride, offset);
 
-	CCID3D11DeviceContext->IASetIndexBuffer( m_indexBuffer, DXGI_FORMAT_R16_UINT, 0);
+	ccDXBindIndexBuffer(m_indexBuffer, DXGI_FORMAT_R16_UINT);
 
 	// Set the type of primitive that should be rendered from this vertex buffer, in this case triangles.
-	CCID3D11DeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	ccDXSetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
 	return;
 }
 
 bool CCDXParticleSystemQuad::InitializeShader()
 {
-	HRESULT result;
-	D3D11_BUFFER_DESC matrixBufferDesc;
-
-	 BasicLoader^ loader = ref new BasicLoader(CCID3D11Device);
-	 D3D11_INPUT_ELEMENT_DESC layoutDesc[] = 
-	 {
-		 { "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		 { "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		 { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
-	 };
-
-	 loader->LoadShader(
-		 L"CCParticleVertexShader.cso",
-		 layoutDesc,
-		 ARRAYSIZE(layoutDesc),
-		 &m_vertexShader,
-		 &m_inputLayout
-		 );
-
-	 loader->LoadShader(
-		 L"CCParticlePixelShader.cso",
-		 &m_pixelShader
-		 );	
-
-	// Setup the description of the dynamic matrix constant buffer that is in the vertex shader.
-	matrixBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
-	matrixBufferDesc.ByteWidth = sizeof(MatrixBufferType);
-	matrixBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	matrixBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-	matrixBufferDesc.MiscFlags = 0;
-	matrixBufferDesc.StructureByteStride = 0;
-
-	// Create the constant buffer pointer so we can access the vertex shader constant buffer from within this class.
-	result = CCID3D11Device->CreateBuffer(&matrixBufferDesc, NULL, &m_matrixBuffer);
-	if(FAILED(result))
-	{
-		return false;
-	}
+	m_pProgram = CCShaderCache::sharedShaderCache()->programForKey(kCCShader_Particle);
+	CC_SAFE_RETAIN(m_pProgram);
 
-	return true;
+	return m_pProgram != NULL;
 }
 
 void CCDXParticleSystemQuad::OutputShaderErrorMessage(ID3D10Blob* errorMessage, HWND hwnd, WCHAR* shaderFilename)
@@ -572,55 +531,25 @@ void CCDXParticleSystemQuad::OutputShaderErrorMessage(ID3D10Blob* errorMessage,
 
 bool CCDXParticleSystemQuad::SetShaderParameters(XMMATRIX &viewMatrix,XMMATRIX &projectionMatrix, ID3D11ShaderResourceView* texture)
 {
-	HRESULT result;
-	D3D11_MAPPED_SUBRESOURCE mappedResource;
-	MatrixBufferType* dataPtr;
-	unsigned int bufferNumber;
-
-	// Transpose the matrices to prepare them for the shader.
-	viewMatrix = XMMatrixTranspose(viewMatrix);
-	projectionMatrix = XMMatrixTranspose(projectionMatrix);
-
-	// Lock the constant buffer so it can be written to.
-	result = CCID3D11DeviceContext->Map(m_matrixBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-	if(FAILED(result))
+	// Set the matrices in the constant buffer of the vertex shader.
+	if (! CCShaderCache::sharedShaderCache()->useMatrixBuffer(viewMatrix, projectionMatrix))
 	{
 		return false;
 	}
 
-	// Get a pointer to the data in the constant buffer.
-	dataPtr = (MatrixBufferType*)mappedResource.pData;
-
-	// Copy the matrices into the constant buffer.
-	dataPtr->view = viewMatrix;
-	dataPtr->projection = projectionMatrix;
-
-	// Unlock the constant buffer.
-	CCID3D11DeviceContext->Unmap(m_matrixBuffer, 0);
-
-	// Set the position of the constant buffer in the vertex shader.
-	bufferNumber = 0;
-
-	// Now set the constant buffer in the vertex shader with the updated values.
-	CCID3D11DeviceContext->VSSetConstantBuffers(bufferNumber, 1, &m_matrixBuffer);
-
 	// Set shader texture resource in the pixel shader.
-	CCID3D11DeviceContext->PSSetShaderResources(0, 1, &texture);
+	ccDXBindTexture2D(texture);
 
 	return true;
 }
 
 void CCDXParticleSystemQuad::RenderShader(unsigned int particleIdx,CCTexture2D* texture)
 {
-	// Set the vertex input layout.
-	CCID3D11DeviceContext->IASetInputLayout(m_inputLayout);
-
-	// Set the vertex and pixel shaders that will be used to render this triangle.
-	CCID3D11DeviceContext->VSSetShader(m_vertexShader, NULL, 0);
-	CCID3D11DeviceContext->PSSetShader(m_pixelShader, NULL, 0);
+	// Set the vertex input layout and the vertex and pixel shaders that will be used to render this triangle.
+	m_pProgram->use();
 
 	// Set the sampler state in the pixel shader.
-	CCID3D11DeviceContext->PSSetSamplers(0, 1, texture->GetSamplerState());
+	ccDXBindSampler(*texture->GetSamplerState());
 	//CCLog("CCDXParticleSystemQuad:RenderShader(idx:%d, m_indexCount:)",particleIdx);
 	// Render the triangle.
 	CCID3D11DeviceContext->DrawIndexed((particleIdx*6),0, 0 );
@@ -639,6 +568,10 @@ void CCDXParticleSystemQuad::Render(ccV2F_C4B_T2F_Quad *quad,unsigned short* ind
 		initVertexAndIndexBuffer(indices, uTotalParticles);
 		InitializeShader();
 	}
+	if ( !m_pProgram )
+	{
+		return;
+	}
 	
 	if(m_uMaxTotalParticles < uTotalParticles)
 	{
@@ -651,8 +584,10 @@ void CCDXParticleSystemQuad::Render(ccV2F_C4B_T2F_Quad *quad,unsigned short* ind
 	CCD3DCLASS->GetViewMatrix(viewMatrix);
 	CCD3DCLASS->GetProjectionMatrix(projectionMatrix);
 	RenderVertexBuffer(quad, uTotalParticles);
-	SetShaderParameters(viewMatrix, projectionMatrix, texture->getTextureResource());
-	RenderShader(particleIdx, texture);
+	if ( SetShaderParameters(viewMatrix, projectionMatrix, texture->getTextureResource()) )
+	{
+		RenderShader(particleIdx, texture);
+	}
 }
 
 NS_CC_END
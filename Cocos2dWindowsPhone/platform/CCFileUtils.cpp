@@ -25,12 +25,16 @@
 
 
 
-#include <stack>
+#include <list>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "CCLibxml2.h"
 #include "CCString.h"
-#include "CCSAXParser.h"
-//#include "support/zip_support/unzip.h"
+#include "CCData.h"
+#include "CCPlistDocument.h"
+#include "support/zip_support/ZipUtils.h"
 
 NS_CC_BEGIN;
 //static ZipFile *s_pZipFile = NULL;
@@ -38,274 +42,120 @@ static CCFileUtils* s_pFileUtils = NULL;
 static const char *__suffixiPhoneRetinaDisplay = "-hd";
 static const char *__suffixiPad = "-ipad";
 static const char *__suffixiPadRetinaDisplay = "-ipadhd";
-static std::map<std::string, std::string> s_fullPathCache;
-typedef enum 
-{
-    SAX_NONE = 0,
-    SAX_KEY,
-    SAX_DICT,
-    SAX_INT,
-    SAX_REAL,
-    SAX_STRING,
-    SAX_ARRAY
-}CCSAXState;
-
-typedef enum
+/*
+ Resource resolution index.
+
+ s_fullPathCache maps a logical file name to the path fullPathForFilename resolved it to,
+ hits and misses alike, and is dropped whenever the search paths change.
+ Candidates are checked against lists of the files known to exist instead of the file
+ system when a list covers their search path: s_indexedFiles holds the search paths walked
+ by buildResourceIndex(), s_manifestFiles the resource root as listed by loadResourceManifest().
+ Everything is guarded by a reader/writer lock so loader threads can resolve names.
+ */
+static std::unordered_map<std::string, std::string> s_fullPathCache;
+static std::unordered_set<std::string> s_indexedFiles;
+static std::set<std::string> s_indexedSearchPaths;
+static std::unordered_set<std::string> s_manifestFiles;
+static bool s_bResourceManifestLoaded = false;
+static unsigned int s_uResourceIndexGeneration = 0;
+static SRWLOCK s_resourceIndexLock = SRWLOCK_INIT;
+
+class CCScopedSharedLock
 {
-    SAX_RESULT_NONE = 0,
-    SAX_RESULT_DICT,
-    SAX_RESULT_ARRAY
-}CCSAXResult;
+public:
+    CCScopedSharedLock(SRWLOCK *pLock) : m_pLock(pLock) { AcquireSRWLockShared(m_pLock); }
+    ~CCScopedSharedLock() { ReleaseSRWLockShared(m_pLock); }
+private:
+    SRWLOCK *m_pLock;
+};
 
-class CCDictMaker : public CCSAXDelegator
+class CCScopedExclusiveLock
 {
 public:
-    CCSAXResult m_eResultType;
-    CCArray* m_pRootArray;
-    CCDictionary *m_pRootDict;
-    CCDictionary *m_pCurDict;
-    std::stack<CCDictionary*> m_tDictStack;
-    std::string m_sCurKey;///< parsed key
-    CCSAXState m_tState;
-    CCArray *m_pArray;
-
-    std::stack<CCArray*> m_tArrayStack;
-    std::stack<CCSAXState>  m_tStateStack;
-	
-public:
-    CCDictMaker()
-        : m_eResultType(SAX_RESULT_NONE),
-          m_pRootArray(NULL),
-          m_pRootDict(NULL),
-          m_pCurDict(NULL),
-          m_tState(SAX_NONE),
-          m_pArray(NULL)
-    {
-    }
-
-    ~CCDictMaker()
-    {
-    }
+    CCScopedExclusiveLock(SRWLOCK *pLock) : m_pLock(pLock) { AcquireSRWLockExclusive(m_pLock); }
+    ~CCScopedExclusiveLock() { ReleaseSRWLockExclusive(m_pLock); }
+private:
+    SRWLOCK *m_pLock;
+};
 
-    CCDictionary *dictionaryWithContentsOfFile(const char *pFileName)
+// file names are compared the way the file system does: case insensitive, either separator
+static std::string normalizeResourcePath(const std::string& path)
+{
+    std::string ret = path;
+    for (std::string::iterator it = ret.begin(); it != ret.end(); ++it)
     {
-        m_eResultType = SAX_RESULT_DICT;
-        CCSAXParser parser;
-
-        if (false == parser.init("UTF-8"))
+        if (*it == '\\')
         {
-            return NULL;
+            *it = '/';
         }
-        parser.setDelegator(this);
-
-        parser.parse(pFileName);
-        return m_pRootDict;
-    }
-
-    CCArray* arrayWithContentsOfFile(const char* pFileName)
-    {
-        m_eResultType = SAX_RESULT_ARRAY;
-        CCSAXParser parser;
-
-        if (false == parser.init("UTF-8"))
+        else if (*it >= 'A' && *it <= 'Z')
         {
-            return NULL;
+            *it += 'a' - 'A';
         }
-        parser.setDelegator(this);
-
-        parser.parse(pFileName);
-        return m_pArray;
     }
-	
-    void startElement(void *ctx, const char *name, const char **atts)
-    {
-        CC_UNUSED_PARAM(ctx);
-        CC_UNUSED_PARAM(atts);
-        std::string sName((char*)name);
-        if( sName == "dict" )
-        {
-            m_pCurDict = new CCDictionary();
-            if (m_eResultType == SAX_RESULT_DICT && ! m_pRootDict)
-            {
-				// Because it will call m_pCurDict->release() later, so retain here.
-                m_pRootDict = m_pCurDict;
-				m_pRootDict->retain();
-            }
-            m_tState = SAX_DICT;
-
-            CCSAXState preState = SAX_NONE;
-            if (! m_tStateStack.empty())
-            {
-                preState = m_tStateStack.top();
-            }
+    return ret;
+}
 
-            if (SAX_ARRAY == preState)
-            {
-                // add the dictionary into the array
-                m_pArray->addObject(m_pCurDict);
-            }
-            else if (SAX_DICT == preState)
-            {
-                // add the dictionary into the pre dictionary
-                CCAssert(! m_tDictStack.empty(), "The state is wrong!");
-                CCDictionary* pPreDict = m_tDictStack.top();
-                pPreDict->setObject(m_pCurDict, m_sCurKey);
-            }
+static bool isAbsoluteResourcePath(const std::string& path)
+{
+    return path.length() > 1 && path[1] == ':';
+}
 
-			m_pCurDict->release();
+static std::string absoluteResourcePath(const std::string& path)
+{
+    return isAbsoluteResourcePath(path) ? path : CCFileUtils::getResourceRootPath() + path;
+}
 
-            // record the dict state
-            m_tStateStack.push(m_tState);
-            m_tDictStack.push(m_pCurDict);
-        }
-        else if(sName == "key")
-        {
-            m_tState = SAX_KEY;
-        }
-        else if(sName == "integer")
-        {
-            m_tState = SAX_INT;
-        }
-        else if(sName == "real")
-        {
-            m_tState = SAX_REAL;
-        }
-        else if(sName == "string")
-        {
-            m_tState = SAX_STRING;
-        }
-        else if (sName == "array")
-        {
-            m_tState = SAX_ARRAY;
-            m_pArray = new CCArray();
-            if (m_eResultType == SAX_RESULT_ARRAY && m_pRootArray == NULL)
-            {
-                m_pRootArray = m_pArray;
-                m_pRootArray->retain();
-            }
-            CCSAXState preState = SAX_NONE;
-            if (! m_tStateStack.empty())
-            {
-                preState = m_tStateStack.top();
-            }
+static bool resourceFileExistsOnDisk(const std::string& path)
+{
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    std::wstring wpath = CCUtf8ToUnicode(absoluteResourcePath(path).c_str());
+    return GetFileAttributesExW(wpath.c_str(), GetFileExInfoStandard, &data)
+        && ! (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY);
+}
 
-            //CCSAXState preState = m_tStateStack.empty() ? SAX_DICT : m_tStateStack.top();
-            if (preState == SAX_DICT)
-            {
-                m_pCurDict->setObject(m_pArray, m_sCurKey);
-            }
-            else if (preState == SAX_ARRAY)
-            {
-                CCAssert(! m_tArrayStack.empty(), "The state is worng!");
-                CCArray* pPreArray = m_tArrayStack.top();
-                pPreArray->addObject(m_pArray);
-            }
-            m_pArray->release();
-            // record the array state
-            m_tStateStack.push(m_tState);
-            m_tArrayStack.push(m_pArray);
-        }
-        else
-        {
-            m_tState = SAX_NONE;
-        }
+// adds the files of a directory tree to s_indexedFiles, named by prefix + relative path
+static void indexResourceDirectory(const std::string& directory, const std::string& prefix)
+{
+    WIN32_FIND_DATAW data;
+    std::wstring pattern = CCUtf8ToUnicode((directory + "*").c_str());
+    HANDLE hFind = FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &data, FindExSearchNameMatch, NULL, 0);
+    if (hFind == INVALID_HANDLE_VALUE)
+    {
+        return;
     }
 
-    void endElement(void *ctx, const char *name)
+    do
     {
-        CC_UNUSED_PARAM(ctx);
-        CCSAXState curState = m_tStateStack.empty() ? SAX_DICT : m_tStateStack.top();
-        std::string sName((char*)name);
-        if( sName == "dict" )
+        std::string name = CCUnicodeToUtf8(data.cFileName);
+        if (name == "." || name == "..")
         {
-            m_tStateStack.pop();
-            m_tDictStack.pop();
-            if ( !m_tDictStack.empty())
-            {
-                m_pCurDict = m_tDictStack.top();
-            }
+            continue;
         }
-        else if (sName == "array")
-        {
-            m_tStateStack.pop();
-            m_tArrayStack.pop();
-            if (! m_tArrayStack.empty())
-            {
-                m_pArray = m_tArrayStack.top();
-            }
-        }
-        else if (sName == "true")
-        {
-            CCString *str = new CCString("1");
-            if (SAX_ARRAY == curState)
-            {
-                m_pArray->addObject(str);
-            }
-            else if (SAX_DICT == curState)
-            {
-                m_pCurDict->setObject(str, m_sCurKey);
-            }
-            str->release();
-        }
-        else if (sName == "false")
+
+        if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
         {
-            CCString *str = new CCString("0");
-            if (SAX_ARRAY == curState)
-            {
-                m_pArray->addObject(str);
-            }
-            else if (SAX_DICT == curState)
-            {
-                m_pCurDict->setObject(str, m_sCurKey);
-            }
-            str->release();
+            indexResourceDirectory(directory + name + "/", prefix + name + "/");
         }
-        m_tState = SAX_NONE;
-    }
-
-    void textHandler(void *ctx, const char *ch, int len)
-    {
-        CC_UNUSED_PARAM(ctx);
-        if (m_tState == SAX_NONE)
+        else
         {
-            return;
+            s_indexedFiles.insert(normalizeResourcePath(prefix + name));
         }
+    } while (FindNextFileW(hFind, &data));
 
-        CCSAXState curState = m_tStateStack.empty() ? SAX_DICT : m_tStateStack.top();
-        CCString *pText = new CCString();
-        pText->m_sString = std::string((char*)ch,0,len);
+    FindClose(hFind);
+}
 
-        switch(m_tState)
-        {
-        case SAX_KEY:
-            m_sCurKey = pText->m_sString;
-            break;
-        case SAX_INT:
-        case SAX_REAL:
-        case SAX_STRING:
-            {
-                if (SAX_ARRAY == curState)
-                {
-                    m_pArray->addObject(pText);
-                }
-                else if (SAX_DICT == curState)
-                {
-                    CCAssert(!m_sCurKey.empty(), "not found key : <integet/real>");
-                    m_pCurDict->setObject(pText, m_sCurKey);
-                }
-                break;
-            }
-        default:
-            break;
-        }
-        pText->release();
-    }
-};
+// must be called with the exclusive lock held
+static void invalidateResolvedPaths()
+{
+    s_fullPathCache.clear();
+    ++s_uResourceIndexGeneration;
+}
 
 CCDictionary* ccFileUtils_dictionaryWithContentsOfFileThreadSafe(const char *pFileName)
 {
-    CCDictMaker tMaker;
-    return tMaker.dictionaryWithContentsOfFile(pFileName);
+    return CCFileUtils::dictionaryWithContentsOfFileThreadSafe(pFileName);
 }
 
 std::string CCFileUtils::getPathForFilename(const std::string& filename, const std::string& resourceDirectory, const std::string& searchPath)
@@ -361,47 +211,126 @@ std::string CCFileUtils::fullPathForFilename(const char* pszFileName)
 	CCAssert(pszFileName != NULL, "CCFileUtils: Invalid path");
 
     // Return directly if it's an absolute path.
-    if (strlen(pszFileName) > 3 
-        && pszFileName[0] >= 'a' && pszFileName[0] <= 'z'
-        && pszFileName[0] >= 'A' && pszFileName[0] <= 'Z'
-        && (pszFileName[1] == ':')
-        && (pszFileName[2] == '\\' || pszFileName[2] == '/')
-    )
+    if (isAbsoluteResourcePath(pszFileName))
     {
         //CCLOG("Probably invoking fullPathForFilename recursively, return the full path: %s", pszFileName);
         return pszFileName;
     }
 
-    // Already Cached ?
-    std::map<std::string, std::string>::iterator cacheIter = s_fullPathCache.find(pszFileName);
-    if (cacheIter != s_fullPathCache.end()) {
-        //CCLOG("Return full path from cache: %s", cacheIter->second.c_str());
-        return cacheIter->second;
+    // The file wasn't found, return the file name passed in.
+    std::string fullpath = pszFileName;
+    unsigned int uGeneration = 0;
+    {
+        CCScopedSharedLock lock(&s_resourceIndexLock);
+
+        // Already Cached ?
+        std::unordered_map<std::string, std::string>::iterator cacheIter = s_fullPathCache.find(pszFileName);
+        if (cacheIter != s_fullPathCache.end()) {
+            //CCLOG("Return full path from cache: %s", cacheIter->second.c_str());
+            return cacheIter->second;
+        }
+
+        uGeneration = s_uResourceIndexGeneration;
+        std::string newFileName = getNewFilename(pszFileName);
+        bool bFound = false;
+
+        for (std::vector<std::string>::iterator searchPathsIter = m_searchPathArray.begin();
+             searchPathsIter != m_searchPathArray.end() && ! bFound; ++searchPathsIter) {
+            const std::unordered_set<std::string> *pFiles = NULL;
+            if (s_indexedSearchPaths.count(normalizeResourcePath(*searchPathsIter)))
+            {
+                pFiles = &s_indexedFiles;
+            }
+            else if (s_bResourceManifestLoaded && ! isAbsoluteResourcePath(*searchPathsIter))
+            {
+                pFiles = &s_manifestFiles;
+            }
+
+            for (std::vector<std::string>::iterator resOrderIter = m_searchResolutionsOrderArray.begin();
+                 resOrderIter != m_searchResolutionsOrderArray.end(); ++resOrderIter) {
+
+                std::string path = this->getPathForFilename(newFileName, *resOrderIter, *searchPathsIter);
+
+                if (pFiles ? pFiles->count(normalizeResourcePath(path)) > 0 : resourceFileExistsOnDisk(path))
+                {
+                    fullpath = path;
+                    bFound = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    // Adding the result to cache, unless the search paths changed meanwhile.
+    CCScopedExclusiveLock lock(&s_resourceIndexLock);
+    if (uGeneration == s_uResourceIndexGeneration)
+    {
+        s_fullPathCache[pszFileName] = fullpath;
     }
+    return fullpath;
+}
 
-    std::string newFileName = getNewFilename(pszFileName);
-    std::string fullpath;
-    
-    for (std::vector<std::string>::iterator searchPathsIter = m_searchPathArray.begin();
-         searchPathsIter != m_searchPathArray.end(); ++searchPathsIter) {
-        for (std::vector<std::string>::iterator resOrderIter = m_searchResolutionsOrderArray.begin();
-             resOrderIter != m_searchResolutionsOrderArray.end(); ++resOrderIter) {
+void CCFileUtils::buildResourceIndex()
+{
+    CCScopedExclusiveLock lock(&s_resourceIndexLock);
 
-            fullpath = this->getPathForFilename(newFileName, *resOrderIter, *searchPathsIter);
+    for (std::vector<std::string>::iterator iter = m_searchPathArray.begin(); iter != m_searchPathArray.end(); ++iter)
+    {
+        std::string key = normalizeResourcePath(*iter);
+        if (s_indexedSearchPaths.count(key))
+        {
+            continue;
+        }
+
+        indexResourceDirectory(absoluteResourcePath(*iter), *iter);
+        s_indexedSearchPaths.insert(key);
+    }
+    invalidateResolvedPaths();
+
+    CCLOG("cocos2d: CCFileUtils: %d files indexed", (int)s_indexedFiles.size());
+}
+
+bool CCFileUtils::loadResourceManifest(const char* pszManifest)
+{
+    unsigned long nSize = 0;
+    unsigned char *pBuffer = getFileDataPlatform(pszManifest, "rb", &nSize);
+    if (! pBuffer)
+    {
+        CCLOG("cocos2d: CCFileUtils: Couldn't load resource manifest %s", pszManifest);
+        return false;
+    }
+
+    CCScopedExclusiveLock lock(&s_resourceIndexLock);
+
+    const char *pLine = (const char*)pBuffer;
+    const char *pEnd = pLine + nSize;
+    while (pLine < pEnd)
+    {
+        const char *pEol = pLine;
+        while (pEol < pEnd && *pEol != '\n')
+        {
+            ++pEol;
+        }
 
-    //        if (GetFileAttributesA(fullpath.c_str()) != -1)
-    //        {
-    //            // Adding the full path to cache if the file was found.
-    //            s_fullPathCache.insert(std::pair<std::string, std::string>(pszFileName, fullpath));
-				////CCLOG("Returning path: %s", fullpath.c_str());
-    //            return fullpath;
-    //        }
+        std::string line(pLine, pEol);
+        if (! line.empty() && line[line.length() - 1] == '\r')
+        {
+            line.erase(line.length() - 1);
         }
+        if (! line.empty() && line[0] != '#')
+        {
+            s_manifestFiles.insert(normalizeResourcePath(line));
+        }
+
+        pLine = pEol + 1;
     }
+    CC_SAFE_DELETE_ARRAY(pBuffer);
 
-    // The file wasn't found, return the file name passed in.
-    return pszFileName;
+    s_bResourceManifestLoaded = true;
+    invalidateResolvedPaths();
+    return true;
 }
+
 CCDictionary *CCFileUtils::dictionaryWithContentsOfFile(const char *pFileName)
 {
 	//convert to full path
@@ -415,14 +344,23 @@ CCDictionary *CCFileUtils::dictionaryWithContentsOfFile(const char *pFileName)
 
 CCDictionary *CCFileUtils::dictionaryWithContentsOfFileThreadSafe(const char *pFileName)
 {
-	CCDictMaker tMaker;
-    return tMaker.dictionaryWithContentsOfFile(pFileName);
+    // the typed document is converted once; it is freed as soon as the tree is built
+    CCPlistDocument tDocument;
+    if (! tDocument.initWithContentsOfFile(pFileName) || tDocument.getRoot().getType() != kCCPlistTypeDictionary)
+    {
+        return NULL;
+    }
+    return (CCDictionary*)tDocument.getRoot().copyObject();
 }
 
 CCArray* CCFileUtils::arrayWithContentsOfFileThreadSafe(const char* pFileName)
 {
-    CCDictMaker tMaker;
-    return tMaker.arrayWithContentsOfFile(pFileName);
+    CCPlistDocument tDocument;
+    if (! tDocument.initWithContentsOfFile(pFileName) || tDocument.getRoot().getType() != kCCPlistTypeArray)
+    {
+        return NULL;
+    }
+    return (CCArray*)tDocument.getRoot().copyObject();
 }
 
 CCArray* CCFileUtils::arrayWithContentsOfFile(const char* pFileName)
@@ -435,111 +373,150 @@ CCArray* CCFileUtils::arrayWithContentsOfFile(const char* pFileName)
     return ret;
 }
 
-unsigned int BKDRHash(char *str)
+/*
+ File data cache: immutable blobs keyed by file name, the least recently used at the front
+ of s_fileDataLru. The cache holds one reference on each blob; evicting a file only drops
+ that reference, so the buffers handed out stay valid.
+ */
+typedef struct _ccFileDataCacheEntry
 {
-    unsigned int seed = 131; // 31 131 1313 13131 131313 etc..
-    unsigned int hash = 0;
+    CCData                           *pData;
+    std::list<std::string>::iterator  lru;
+} ccFileDataCacheEntry;
 
-    while (*str)
-    {
-        hash = hash * seed + (*str++);
-    }
+static std::unordered_map<std::string, ccFileDataCacheEntry> s_fileDataCache;
+static std::list<std::string> s_fileDataLru;
+static ccFileDataCacheStats s_tFileDataStats = { 0, 0, 0, 0, 0 };
+static unsigned long s_uFileDataCacheLimit = CC_FILE_DATA_CACHE_SIZE;
+static SRWLOCK s_fileDataLock = SRWLOCK_INIT;
 
-    return (hash & 0x7FFFFFFF);
+// must be called with s_fileDataLock held
+static void evictFileData(std::unordered_map<std::string, ccFileDataCacheEntry>::iterator it)
+{
+    s_tFileDataStats.uBytes -= it->second.pData->getSize();
+    --s_tFileDataStats.uEntries;
+    s_fileDataLru.erase(it->second.lru);
+    it->second.pData->release();
+    s_fileDataCache.erase(it);
 }
 
-class CacheDataInfo
+// must be called with s_fileDataLock held
+static void trimFileData(unsigned long uLimit)
 {
-public:
-    CacheDataInfo()
-    : data(NULL)
-    , size(0)
+    while (s_tFileDataStats.uBytes > uLimit && ! s_fileDataLru.empty())
     {
+        evictFileData(s_fileDataCache.find(s_fileDataLru.front()));
+        ++s_tFileDataStats.uEvictions;
     }
+}
 
-    ~CacheDataInfo()
+// must be called with s_fileDataLock held; returns NULL on a miss
+static CCData* touchFileData(const std::string& key)
+{
+    std::unordered_map<std::string, ccFileDataCacheEntry>::iterator it = s_fileDataCache.find(key);
+    if (it == s_fileDataCache.end())
     {
-        CC_SAFE_DELETE_ARRAY(data);
+        return NULL;
     }
 
-    unsigned char* data;
-    unsigned long size;
-};
+    s_fileDataLru.splice(s_fileDataLru.end(), s_fileDataLru, it->second.lru);
+    ++s_tFileDataStats.uHits;
+    return it->second.pData;
+}
 
-class CacheHandler
+unsigned char* CCFileUtils::getFileData(const char* pszFileName, const char* pszMode, unsigned long * pSize)
 {
-    std::map<unsigned int, CacheDataInfo*> * s_pCache;
-public:
-    CacheHandler() : s_pCache(0)
     {
-
+        // a cached file saves the read; the copy is what this function promises its callers
+        CCScopedExclusiveLock lock(&s_fileDataLock);
+        CCData *pData = touchFileData(pszFileName);
+        if (pData)
+        {
+            // blobs are zero terminated, like the buffers of getFileDataPlatform
+            unsigned char *pBuffer = new unsigned char[pData->getSize() + 1];
+            memcpy(pBuffer, pData->bytes(), pData->getSize() + 1);
+            *pSize = pData->getSize();
+            return pBuffer;
+        }
     }
 
-    ~CacheHandler()
-    {
-        CCFileUtils::purgeCachedFileData();
-        delete s_pCache;
-    }
+    return getFileDataPlatform(pszFileName, pszMode, pSize);
+}
 
-    std::map<unsigned int, CacheDataInfo*>& getCache()
+CCData* CCFileUtils::getFileDataBlob(const char* pszFileName)
+{
+    std::string key = pszFileName;
     {
-        if (! s_pCache)
+        CCScopedExclusiveLock lock(&s_fileDataLock);
+        CCData *pData = touchFileData(key);
+        if (pData)
         {
-            s_pCache = new std::map<unsigned int, CacheDataInfo*>;
+            pData->retain();
+            return pData;
         }
-        return *s_pCache;
+        ++s_tFileDataStats.uMisses;
     }
-};
 
-static CacheHandler s_CacheHandler;
+    unsigned long nSize = 0;
+    unsigned char *pBuffer = getFileDataPlatform(pszFileName, "rb", &nSize);
+    if (! pBuffer)
+    {
+        return NULL;
+    }
+    CCData *pData = new CCData(pBuffer, nSize);
+
+    CCScopedExclusiveLock lock(&s_fileDataLock);
 
-unsigned char* CCFileUtils::getFileData(const char* pszFileName, const char* pszMode, unsigned long * pSize)
-{
-    unsigned char * pBuffer = NULL;
-    std::string strFileName = pszFileName;
-    std::string extension = "";
-    int nExPos = strFileName.rfind('.');
-    if (nExPos != std::string::npos)
+    // another thread may have loaded the file meanwhile
+    std::unordered_map<std::string, ccFileDataCacheEntry>::iterator it = s_fileDataCache.find(key);
+    if (it != s_fileDataCache.end())
     {
-        extension = strFileName.substr(nExPos);
+        pData->release();
+        pData = it->second.pData;
+        pData->retain();
+        return pData;
     }
 
-    do 
+    if (nSize <= s_uFileDataCacheLimit)
     {
-        // only cache plist file data now
-        if (0 != extension.compare(".plist"))
-        {
-            pBuffer = getFileDataPlatform(pszFileName, pszMode, pSize);
-            break;
-        }
+        trimFileData(s_uFileDataCacheLimit - nSize);
 
-        // get data from cache 
-        unsigned int hashKey = BKDRHash((char*)pszFileName);
-        CacheDataInfo* pTemp = NULL;
-        std::map<unsigned int, CacheDataInfo*>::iterator it = s_CacheHandler.getCache().find(hashKey);
-        if (it != s_CacheHandler.getCache().end())
-        {
-            pTemp = it->second;
-            pBuffer = new unsigned char[pTemp->size];
-            memcpy(pBuffer, pTemp->data, pTemp->size);
-            *pSize = pTemp->size;
-            CCLOG("------------- get %s data from cache --------------", pszFileName);
-            break;
-        }
+        ccFileDataCacheEntry entry;
+        entry.pData = pData;
+        entry.lru = s_fileDataLru.insert(s_fileDataLru.end(), key);
+        s_fileDataCache[key] = entry;
+        pData->retain();
 
+        s_tFileDataStats.uBytes += nSize;
+        ++s_tFileDataStats.uEntries;
+    }
 
-        CCLOG("------------- get %s data from file--------------", pszFileName);
-        // get data from file, and cache the data
-        pBuffer = getFileDataPlatform(pszFileName, pszMode, pSize);
-        CacheDataInfo* pCache = new CacheDataInfo();
-        pCache->data = new unsigned char[*pSize];
-        pCache->size = *pSize;
-        memcpy(pCache->data, pBuffer, pCache->size);
-        s_CacheHandler.getCache().insert(std::pair<unsigned int, CacheDataInfo*>(hashKey, pCache));
-    } while (0);
+    return pData;
+}
 
-    return pBuffer;
+void CCFileUtils::removeCachedFileData(const char* pszFileName)
+{
+    CCScopedExclusiveLock lock(&s_fileDataLock);
+    std::unordered_map<std::string, ccFileDataCacheEntry>::iterator it = s_fileDataCache.find(pszFileName);
+    if (it != s_fileDataCache.end())
+    {
+        evictFileData(it);
+    }
 }
+
+void CCFileUtils::setFileDataCacheLimit(unsigned long uBytes)
+{
+    CCScopedExclusiveLock lock(&s_fileDataLock);
+    s_uFileDataCacheLimit = uBytes;
+    trimFileData(uBytes);
+}
+
+ccFileDataCacheStats CCFileUtils::getFileDataCacheStats()
+{
+    CCScopedExclusiveLock lock(&s_fileDataLock);
+    return s_tFileDataStats;
+}
+
 void CCFileUtils::setResourceDirectory(const char* pszResourceDirectory)
 {
 	if (pszResourceDirectory == NULL) return;
@@ -554,6 +531,9 @@ const std::vector<std::string>& CCFileUtils::getSearchPaths()
 }
 void CCFileUtils::setSearchPaths(const std::vector<std::string>& searchPaths)
 {
+	CCScopedExclusiveLock lock(&s_resourceIndexLock);
+	invalidateResolvedPaths();
+
 	bool bExistDefaultRootPath = false;
 
 	m_searchPathArray.clear();
@@ -590,55 +570,55 @@ void CCFileUtils::setSearchPaths(const std::vector<std::string>& searchPaths)
 
 void CCFileUtils::purgeCachedFileData()
 {
-    std::map<unsigned int, CacheDataInfo*>::iterator it;
-    for (it = s_CacheHandler.getCache().begin(); it != s_CacheHandler.getCache().end(); it++)
+    CCScopedExclusiveLock lock(&s_fileDataLock);
+    while (! s_fileDataCache.empty())
     {
-        CacheDataInfo* pCache = it->second;
-        CC_SAFE_DELETE(pCache);
+        evictFileData(s_fileDataCache.begin());
     }
-    s_CacheHandler.getCache().clear();
 }
 
+/*
+ Archives read by getFileDataFromZip stay open, so every entry after the first is found
+ through the index of the archive instead of a scan of its central directory.
+ */
+static std::map<std::string, ZipFile*> s_zipFiles;
+static SRWLOCK s_zipFilesLock = SRWLOCK_INIT;
+
 unsigned char* CCFileUtils::getFileDataFromZip(const char* pszZipFilePath, const char* pszFileName, unsigned long * pSize)
 {
-    unsigned char * pBuffer = NULL;
- /* unzFile pFile = NULL;
     *pSize = 0;
-
-    do 
+    if (! pszZipFilePath || ! pszFileName || ! pszZipFilePath[0])
     {
-        CC_BREAK_IF(!pszZipFilePath || !pszFileName);
-        CC_BREAK_IF(strlen(pszZipFilePath) == 0);
-
-        pFile = unzOpen(pszZipFilePath);
-        CC_BREAK_IF(!pFile);
-
-        int nRet = unzLocateFile(pFile, pszFileName, 1);
-        CC_BREAK_IF(UNZ_OK != nRet);
-
-        char szFilePathA[260];
-        unz_file_info FileInfo;
-        nRet = unzGetCurrentFileInfo(pFile, &FileInfo, szFilePathA, sizeof(szFilePathA), NULL, 0, NULL, 0);
-        CC_BREAK_IF(UNZ_OK != nRet);
-
-        nRet = unzOpenCurrentFile(pFile);
-        CC_BREAK_IF(UNZ_OK != nRet);
+        return NULL;
+    }
 
-        pBuffer = new unsigned char[FileInfo.uncompressed_size];
-        int nSize = 0;
-        nSize = unzReadCurrentFile(pFile, pBuffer, FileInfo.uncompressed_size);
-        CCAssert(nSize == 0 || nSize == (int)FileInfo.uncompressed_size, "the file size is wrong");
+    ZipFile *pZipFile = NULL;
+    {
+        CCScopedExclusiveLock lock(&s_zipFilesLock);
+        std::map<std::string, ZipFile*>::iterator it = s_zipFiles.find(pszZipFilePath);
+        if (it != s_zipFiles.end())
+        {
+            pZipFile = it->second;
+        }
+        else
+        {
+            pZipFile = new ZipFile(pszZipFilePath);
+            s_zipFiles[pszZipFilePath] = pZipFile;
+        }
+    }
 
-        *pSize = FileInfo.uncompressed_size;
-        unzCloseCurrentFile(pFile);
-    } while (0);
+    // ZipFile reads are thread safe; archives are only closed by purgeCachedZipFiles
+    return pZipFile->getFileData(pszFileName, pSize);
+}
 
-    if (pFile)
+void CCFileUtils::purgeCachedZipFiles()
+{
+    CCScopedExclusiveLock lock(&s_zipFilesLock);
+    for (std::map<std::string, ZipFile*>::iterator it = s_zipFiles.begin(); it != s_zipFiles.end(); ++it)
     {
-        unzClose(pFile);
+        delete it->second;
     }
-*/
-    return pBuffer;
+    s_zipFiles.clear();
 }
 
 
@@ -687,6 +667,9 @@ std::string CCFileUtils::getNewFilename(const char* pszFileName)
 
 void CCFileUtils::setSearchResolutionsOrder(const std::vector<std::string>& searchResolutionsOrder)
 {
+    CCScopedExclusiveLock lock(&s_resourceIndexLock);
+    invalidateResolvedPaths();
+
     bool bExistDefault = false;
     m_searchResolutionsOrderArray.clear();
     for (std::vector<std::string>::const_iterator iter = searchResolutionsOrder.begin(); iter != searchResolutionsOrder.end(); ++iter)
@@ -709,6 +692,9 @@ const std::vector<std::string>& CCFileUtils::getSearchResolutionsOrder()
 }
 void CCFileUtils::setFilenameLookupDictionary(CCDictionary* pFilenameLookupDict)
 {
+    CCScopedExclusiveLock lock(&s_resourceIndexLock);
+    invalidateResolvedPaths();
+
     CC_SAFE_RELEASE(m_pFilenameLookupDict);
     m_pFilenameLookupDict = pFilenameLookupDict;
     CC_SAFE_RETAIN(m_pFilenameLookupDict);
@@ -755,16 +741,31 @@ void CCFileUtils::purgeFileUtils()
         CC_SAFE_RELEASE(s_pFileUtils->m_pFilenameLookupDict);
     }
 
+    purgeCachedFileData();
+    purgeCachedZipFiles();
+
+    {
+        CCScopedExclusiveLock lock(&s_resourceIndexLock);
+        s_manifestFiles.clear();
+        s_bResourceManifestLoaded = false;
+    }
+
     CC_SAFE_DELETE(s_pFileUtils);
 }
 
 void CCFileUtils::purgeCachedEntries()
 {
-    s_fullPathCache.clear();
+    CCScopedExclusiveLock lock(&s_resourceIndexLock);
+    invalidateResolvedPaths();
+
+    // the walked directories may have changed; the manifest describes the package and stays
+    s_indexedFiles.clear();
+    s_indexedSearchPaths.clear();
 }
 bool CCFileUtils::init()
 {
-	m_strDefaultResRootPath = "assets/";
+	// relative paths are resolved against getResourceRootPath()
+	m_strDefaultResRootPath = "";
     m_searchPathArray.push_back(m_strDefaultResRootPath);
     m_searchResolutionsOrderArray.push_back("");
 
@@ -22,6 +22,7 @@
 #include "CCStdC.h"
 #include "CCFileUtils.h"
 #include "png.h"
+#include "support/image_support/ccPixelConversion.h"
 #include <string>
 #include <ctype.h>
 
@@ -32,12 +33,6 @@
 #include "jpeglib.h"
 #undef   QGLOBAL_H
 
-#define CC_RGB_PREMULTIPLY_APLHA(vr, vg, vb, va) \
-    (unsigned)(((unsigned)((unsigned char)(vr) * ((unsigned char)(va) + 1)) >> 8) | \
-    ((unsigned)((unsigned char)(vg) * ((unsigned char)(va) + 1) >> 8) << 8) | \
-    ((unsigned)((unsigned char)(vb) * ((unsigned char)(va) + 1) >> 8) << 16) | \
-    ((unsigned)(unsigned char)(va) << 24))
-
 typedef struct 
 {
     unsigned char* data;
@@ -85,15 +80,45 @@ CCImage::~CCImage()
 bool CCImage::initWithImageFile(const char * strPath, EImageFormat eImgFmt/* = eFmtPng*/)
 {
     CC_UNUSED_PARAM(eImgFmt);
-    CCFileData data(CCFileUtils::fullPathFromRelativePath(strPath), "rb");
-    return initWithImageData(data.getBuffer(), data.getSize(), eImgFmt);
+    return initWithImageFileThreadSafe(CCFileUtils::fullPathFromRelativePath(strPath), eImgFmt);
 }
 //
 bool CCImage::initWithImageFileThreadSafe(const char *fullpath, EImageFormat imageType)
 {
 	CC_UNUSED_PARAM(imageType);
-    CCFileData data(fullpath, "rb");
-    return initWithImageData(data.getBuffer(), data.getSize(), imageType);
+    // decode straight from the mapped file, without reading it into a buffer first
+    CCMappedFile *pFile = CCFileUtils::mapFile(fullpath);
+    if (! pFile)
+    {
+        return false;
+    }
+    bool bRet = initWithImageData((void*)pFile->getBytes(), (int)pFile->getSize(), imageType);
+    pFile->release();
+    return bRet;
+}
+
+bool CCImage::initWithImageFileThreadSafe(const char *fullpath, EImageFormat imageType, CCImageDecodeDelegate *pDelegate)
+{
+    CCAssert(pDelegate, "pDelegate can't be NULL");
+    CCMappedFile *pFile = CCFileUtils::mapFile(fullpath);
+    if (! pFile)
+    {
+        return false;
+    }
+    bool bRet = false;
+    if (pFile->getSize() > 0)
+    {
+        if (kFmtPng == imageType)
+        {
+            bRet = _initWithPngData((void*)pFile->getBytes(), (int)pFile->getSize(), pDelegate);
+        }
+        else if (kFmtJpg == imageType)
+        {
+            bRet = _initWithJpgData((void*)pFile->getBytes(), (int)pFile->getSize(), pDelegate);
+        }
+    }
+    pFile->release();
+    return bRet;
 }
 //
 bool CCImage::initWithImageData(void * pData, 
@@ -127,84 +152,86 @@ bool CCImage::initWithImageData(void * pData,
     return bRet;
 }
 
-bool CCImage::_initWithJpgData(void * data, int nSize)
+bool CCImage::_initWithJpgData(void * data, int nSize, CCImageDecodeDelegate *pDelegate)
 {
     /* these are standard libjpeg structures for reading(decompression) */
     struct jpeg_decompress_struct cinfo;
     struct jpeg_error_mgr jerr;
     /* libjpeg data structure for storing one row, that is, scanline of an image */
     JSAMPROW row_pointer[1] = {0};
-    unsigned long location = 0;
-    unsigned int i = 0;
+    unsigned char * pRowData = 0;
+
+    /* here we set up the standard libjpeg error handler */
+    cinfo.err = jpeg_std_error( &jerr );
+    jpeg_create_decompress( &cinfo );
 
     bool bRet = false;
     do 
     {
-        /* here we set up the standard libjpeg error handler */
-        cinfo.err = jpeg_std_error( &jerr );
-
         /* setup decompression process and source, then read JPEG header */
-        jpeg_create_decompress( &cinfo );
-
         jpeg_mem_src( &cinfo, (unsigned char *) data, nSize );
 
         /* reading the image header which contains image information */
         jpeg_read_header( &cinfo, true );
 
-        // we only support RGB or grayscale
-        if (cinfo.jpeg_color_space != JCS_RGB)
-        {
-            if (cinfo.jpeg_color_space == JCS_GRAYSCALE || cinfo.jpeg_color_space == JCS_YCbCr)
-            {
-                cinfo.out_color_space = JCS_RGB;
-            }
-        }
-        else
-        {
-            break;
-        }
+        // libjpeg converts grayscale and YCbCr to RGB, but not CMYK
+        CC_BREAK_IF(cinfo.jpeg_color_space == JCS_CMYK || cinfo.jpeg_color_space == JCS_YCCK);
+        cinfo.out_color_space = JCS_RGB;
 
         /* Start decompression jpeg here */
         jpeg_start_decompress( &cinfo );
 
         /* init image info */
-        m_nWidth  = (short)(cinfo.image_width);
-        m_nHeight = (short)(cinfo.image_height);
+        m_nWidth  = (short)(cinfo.output_width);
+        m_nHeight = (short)(cinfo.output_height);
         m_bHasAlpha = false;
         m_bPreMulti = false;
         m_nBitsPerComponent = 8;
-        row_pointer[0] = new unsigned char[cinfo.output_width*cinfo.output_components];
-        CC_BREAK_IF(! row_pointer[0]);
+        CC_BREAK_IF(pDelegate && ! pDelegate->imageWillDecode(this));
 
-        m_pData = new unsigned char[cinfo.output_width*cinfo.output_height*cinfo.output_components];
-        CC_BREAK_IF(! m_pData);
+        // the scanlines are read straight into the image, or into one row handed to the delegate
+        unsigned int bytesPerRow = cinfo.output_width * cinfo.output_components;
+        if (pDelegate)
+        {
+            pRowData = new unsigned char[bytesPerRow];
+            CC_BREAK_IF(! pRowData);
+        }
+        else
+        {
+            m_pData = new unsigned char[bytesPerRow * cinfo.output_height];
+            CC_BREAK_IF(! m_pData);
+        }
 
-        /* now actually read the jpeg into the raw buffer */
         /* read one scan line at a time */
-        while( cinfo.output_scanline < cinfo.image_height )
+        while( cinfo.output_scanline < cinfo.output_height )
         {
+            unsigned int row = cinfo.output_scanline;
+            row_pointer[0] = pDelegate ? pRowData : m_pData + row * bytesPerRow;
             jpeg_read_scanlines( &cinfo, row_pointer, 1 );
-            for( i=0; i<cinfo.image_width*cinfo.num_components;i++) 
-                m_pData[location++] = row_pointer[0][i];
+            if (pDelegate)
+            {
+                pDelegate->imageDidDecodeRow(this, row, pRowData);
+            }
         }
 
         jpeg_finish_decompress( &cinfo );
-        jpeg_destroy_decompress( &cinfo );
-        /* wrap up decompression, destroy objects, free pointers and close open files */        
         bRet = true;
     } while (0);
 
-    CC_SAFE_DELETE_ARRAY(row_pointer[0]);
+    /* wrap up decompression, destroy objects, free pointers and close open files */
+    jpeg_destroy_decompress( &cinfo );
+    CC_SAFE_DELETE_ARRAY(pRowData);
     return bRet;
 }
 
-bool CCImage::_initWithPngData(void * pData, int nDatalen)
+bool CCImage::_initWithPngData(void * pData, int nDatalen, CCImageDecodeDelegate *pDelegate)
 {
     bool bRet = false;
     png_byte        header[8]   = {0}; 
     png_structp     png_ptr     =   0;
     png_infop       info_ptr    = 0;
-    unsigned char * pImateData  = 0;
+    // assigned after setjmp and freed when libpng longjmps back on an error: volatile keeps its value
+    unsigned char * volatile pImateData = 0;
 
     do 
     {
@@ -213,21 +240,17 @@ bool CCImage::_initWithPngData(void * pData, int nDatalen)
 
        //  check the data is png or not
         memcpy(header, pData, 8);
-		//memcpy(data, pData, 97184);
-
 		CC_BREAK_IF(png_sig_cmp(header, 0, 8));
 
 		// init png_struct
-
-		 png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-		//png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, errPointer, NULL, NULL);
-		//png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, errPointer, (png_voidp)user_error_ptr, user_error_fn, user_warning_fn);
+		png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
 		CC_BREAK_IF(!png_ptr);
 
 		// init png_info
 		info_ptr = png_create_info_struct(png_ptr);
 		CC_BREAK_IF(!info_ptr);
 #if (CC_TARGET_PLATFORM != CC_PLATFORM_BADA)
+        // an error longjmps here: pImateData is then freed below, with png_ptr
         CC_BREAK_IF(setjmp(png_jmpbuf(png_ptr)));
 #endif
         // set the read call back function
@@ -237,62 +260,62 @@ bool CCImage::_initWithPngData(void * pData, int nDatalen)
         imageSource.offset  = 0;
         png_set_read_fn(png_ptr, &imageSource, pngReadCallback);
 
-        // read png
-        // PNG_TRANSFORM_EXPAND: perform set_expand()
-        // PNG_TRANSFORM_PACKING: expand 1, 2 and 4-bit samples to bytes
-        // PNG_TRANSFORM_STRIP_16: strip 16-bit samples to 8 bits
-        // PNG_TRANSFORM_GRAY_TO_RGB: expand grayscale samples to RGB (or GA to RGBA)
-        png_read_png(png_ptr, info_ptr, PNG_TRANSFORM_EXPAND | PNG_TRANSFORM_PACKING 
-            | PNG_TRANSFORM_STRIP_16 | PNG_TRANSFORM_GRAY_TO_RGB, 0);
-
-        int         color_type  = 0;
-        png_uint_32 nWidth = 0;
-        png_uint_32 nHeight = 0;
-        int         nBitsPerComponent = 0;
-        png_get_IHDR(png_ptr, info_ptr, &nWidth, &nHeight, &nBitsPerComponent, &color_type, 0, 0, 0);
+        // read the header, then the rows one by one with the transforms png_read_png used to apply:
+        // expand palettes and low bit depths, strip 16-bit samples to 8 bits,
+        // expand grayscale samples to RGB (or GA to RGBA)
+        png_read_info(png_ptr, info_ptr);
+        png_set_expand(png_ptr);
+        png_set_packing(png_ptr);
+        png_set_strip_16(png_ptr);
+        png_set_gray_to_rgb(png_ptr);
+        int passes = png_set_interlace_handling(png_ptr);
+        png_read_update_info(png_ptr, info_ptr);
 
          //init image info
+        png_uint_32 nWidth  = png_get_image_width(png_ptr, info_ptr);
+        png_uint_32 nHeight = png_get_image_height(png_ptr, info_ptr);
+        m_nBitsPerComponent = png_get_bit_depth(png_ptr, info_ptr);
+        m_nWidth    = (short)nWidth;
+        m_nHeight   = (short)nHeight;
         m_bPreMulti = true;
-        m_bHasAlpha = ( info_ptr->color_type & PNG_COLOR_MASK_ALPHA ) ? true : false;
-
-         //allocate memory and read data
-        int bytesPerComponent = 3;
-        if (m_bHasAlpha)
-        {
-            bytesPerComponent = 4;
-        }
-        pImateData = new unsigned char[nHeight * nWidth * bytesPerComponent];
+        m_bHasAlpha = ( png_get_color_type(png_ptr, info_ptr) & PNG_COLOR_MASK_ALPHA ) ? true : false;
+        CC_BREAK_IF(pDelegate && ! pDelegate->imageWillDecode(this));
+
+        // rows are decoded straight into the image. A delegate gets them one at a time from
+        // a single row, unless the image is interlaced: every pass then updates every row.
+        unsigned int bytesPerRow = (unsigned int)png_get_rowbytes(png_ptr, info_ptr);
+        bool bWholeImage = ! pDelegate || passes > 1;
+        pImateData = new unsigned char[bWholeImage ? nHeight * bytesPerRow : bytesPerRow];
         CC_BREAK_IF(! pImateData);
 
-        png_bytep * rowPointers = png_get_rows(png_ptr, info_ptr);
-
-         //copy data to image info
-        int bytesPerRow = nWidth * bytesPerComponent;
-        if(m_bHasAlpha)
+        for (int pass = 0; pass < passes; ++pass)
         {
-            unsigned int *tmp = (unsigned int *)pImateData;
-            for(unsigned int i = 0; i < nHeight; i++)
+            bool bLastPass = pass == passes - 1;
+            for (unsigned int i = 0; i < nHeight; ++i)
             {
-                for(int j = 0; j < bytesPerRow; j += 4)
+                unsigned char *pRow = bWholeImage ? pImateData + i * bytesPerRow : pImateData;
+                png_read_row(png_ptr, pRow, NULL);
+                if (! bLastPass)
+                {
+                    continue;
+                }
+                if (m_bHasAlpha)
                 {
-                    *tmp++ = CC_RGB_PREMULTIPLY_APLHA( rowPointers[i][j], rowPointers[i][j + 1], 
-                        rowPointers[i][j + 2], rowPointers[i][j + 3]);
+                    ccPremultiplyAlphaRGBA8888(pRow, pRow, nWidth);
+                }
+                if (pDelegate)
+                {
+                    pDelegate->imageDidDecodeRow(this, i, pRow);
                 }
             }
         }
-        else
+        png_read_end(png_ptr, NULL);
+
+        if (! pDelegate)
         {
-            for (unsigned int j = 0; j < nHeight; ++j)
-            {
-                memcpy(pImateData + j * bytesPerRow, rowPointers[j], bytesPerRow);
-            }
+            m_pData     = pImateData;
+            pImateData  = 0;
         }
-
-        m_nBitsPerComponent = nBitsPerComponent;
-        m_nHeight   = (short)nHeight;
-        m_nWidth    = (short)nWidth;
-        m_pData     = pImateData;
-        pImateData  = 0;
         bRet        = true;
     } while (0);
 
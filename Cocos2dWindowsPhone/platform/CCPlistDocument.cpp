@@ -0,0 +1,1047 @@
+/*
+* cocos2d-x   http://www.cocos2d-x.org
+*
+* Copyright (c) 2010-2011 - cocos2d-x community
+*
+* Portions Copyright (c) Microsoft Open Technologies, Inc.
+* All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on an
+* "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and limitations under the License.
+*/
+
+#include "pch.h"
+
+#include "CCPlistDocument.h"
+#include "CCFileUtils.h"
+#include "CCDictionary.h"
+#include "CCArray.h"
+#include "CCString.h"
+#include "CCData.h"
+#include "support/base64.h"
+
+#include <stdlib.h>
+#include <ctype.h>
+
+NS_CC_BEGIN
+
+// containers nested deeper than this are rejected instead of overflowing the stack
+#define CC_PLIST_MAX_DEPTH 512
+
+// appends a code point to a UTF-8 string
+static void appendUTF8(std::string& out, unsigned int c)
+{
+    if (c < 0x80)
+    {
+        out += (char)c;
+    }
+    else if (c < 0x800)
+    {
+        out += (char)(0xC0 | (c >> 6));
+        out += (char)(0x80 | (c & 0x3F));
+    }
+    else if (c < 0x10000)
+    {
+        out += (char)(0xE0 | (c >> 12));
+        out += (char)(0x80 | ((c >> 6) & 0x3F));
+        out += (char)(0x80 | (c & 0x3F));
+    }
+    else
+    {
+        out += (char)(0xF0 | (c >> 18));
+        out += (char)(0x80 | ((c >> 12) & 0x3F));
+        out += (char)(0x80 | ((c >> 6) & 0x3F));
+        out += (char)(0x80 | (c & 0x3F));
+    }
+}
+
+/*
+ XML property list reader.
+
+ Scans the elements of the plist DTD without building a DOM. Containers are open on a stack;
+ their entries are gathered in a scratch list and moved to the document in one block when
+ the container closes, so the entries of each container are contiguous.
+ */
+class CCPlistXMLReader
+{
+public:
+    CCPlistXMLReader(CCPlistDocument *pDocument, const char *pData, unsigned long nSize)
+        : m_pDocument(pDocument)
+        , m_pCur(pData)
+        , m_pEnd(pData + nSize)
+        , m_uKey(0)
+        , m_bHasKey(false)
+    {
+    }
+
+    bool read(void)
+    {
+        std::string name;
+        while (nextTag())
+        {
+            // m_pCur is on '<'
+            if (startsWith("<?"))
+            {
+                skipPast("?>");
+                continue;
+            }
+            if (startsWith("<!--"))
+            {
+                skipPast("-->");
+                continue;
+            }
+            if (startsWith("<!"))
+            {
+                skipPast(">");
+                continue;
+            }
+
+            bool bClosing = m_pCur + 1 < m_pEnd && m_pCur[1] == '/';
+            const char *pName = m_pCur + (bClosing ? 2 : 1);
+            const char *pNameEnd = pName;
+            while (pNameEnd < m_pEnd && *pNameEnd != '>' && *pNameEnd != '/' && ! isspace((unsigned char)*pNameEnd))
+            {
+                ++pNameEnd;
+            }
+            name.assign(pName, pNameEnd - pName);
+
+            const char *pTagEnd = (const char*)memchr(pNameEnd, '>', m_pEnd - pNameEnd);
+            if (! pTagEnd)
+            {
+                return false;
+            }
+            bool bEmpty = pTagEnd[-1] == '/';
+            m_pCur = pTagEnd + 1;
+
+            if (bClosing)
+            {
+                if ((name == "dict" || name == "array") && ! closeContainer())
+                {
+                    return false;
+                }
+                continue;
+            }
+
+            if (name == "plist")
+            {
+                continue;
+            }
+
+            if (name == "dict" || name == "array")
+            {
+                unsigned int uNode = m_pDocument->addNode(name == "dict" ? kCCPlistTypeDictionary : kCCPlistTypeArray);
+                attach(uNode);
+                if (! bEmpty)
+                {
+                    m_tContainers.push_back(uNode);
+                    m_tScratchStarts.push_back((unsigned int)m_tScratch.size());
+                }
+                continue;
+            }
+
+            m_sText.clear();
+            if (! bEmpty && ! readText(name))
+            {
+                return false;
+            }
+
+            if (name == "key")
+            {
+                m_uKey = m_pDocument->internKey(m_sText.c_str(), (unsigned int)m_sText.length());
+                m_bHasKey = true;
+            }
+            else if (name == "string" || name == "date")
+            {
+                unsigned int uNode = m_pDocument->addNode(kCCPlistTypeString);
+                m_pDocument->m_tNodes[uNode].count = (unsigned int)m_sText.length();
+                m_pDocument->m_tNodes[uNode].u.first = m_pDocument->addString(m_sText.c_str(), (unsigned int)m_sText.length());
+                attach(uNode);
+            }
+            else if (name == "integer")
+            {
+                unsigned int uNode = m_pDocument->addNode(kCCPlistTypeInteger);
+                m_pDocument->m_tNodes[uNode].u.integer = _strtoi64(m_sText.c_str(), NULL, 10);
+                attach(uNode);
+            }
+            else if (name == "real")
+            {
+                unsigned int uNode = m_pDocument->addNode(kCCPlistTypeReal);
+                m_pDocument->m_tNodes[uNode].u.real = strtod(m_sText.c_str(), NULL);
+                attach(uNode);
+            }
+            else if (name == "true" || name == "false")
+            {
+                unsigned int uNode = m_pDocument->addNode(kCCPlistTypeBool);
+                m_pDocument->m_tNodes[uNode].u.integer = name == "true" ? 1 : 0;
+                attach(uNode);
+            }
+            else if (name == "data")
+            {
+                unsigned char *pBytes = NULL;
+                int nLength = m_sText.empty() ? 0 : base64Decode((unsigned char*)&m_sText[0], (unsigned int)m_sText.length(), &pBytes);
+                unsigned int uNode = m_pDocument->addNode(kCCPlistTypeData);
+                m_pDocument->m_tNodes[uNode].count = (unsigned int)nLength;
+                m_pDocument->m_tNodes[uNode].u.first = m_pDocument->addString((const char*)pBytes, (unsigned int)nLength);
+                CC_SAFE_DELETE_ARRAY(pBytes);
+                attach(uNode);
+            }
+            else
+            {
+                CCLOG("cocos2d: CCPlistDocument: unknown element <%s> ignored", name.c_str());
+            }
+        }
+
+        return m_pDocument->m_uRoot != 0 && m_tContainers.empty();
+    }
+
+private:
+    bool startsWith(const char *pszPrefix)
+    {
+        size_t len = strlen(pszPrefix);
+        return (size_t)(m_pEnd - m_pCur) >= len && memcmp(m_pCur, pszPrefix, len) == 0;
+    }
+
+    // returns false when the marker is missing: the document is then skipped to its end
+    bool skipPast(const char *pszMarker)
+    {
+        size_t len = strlen(pszMarker);
+        while (m_pCur < m_pEnd && ! startsWith(pszMarker))
+        {
+            ++m_pCur;
+        }
+        if (m_pCur == m_pEnd)
+        {
+            return false;
+        }
+        m_pCur += len;
+        return true;
+    }
+
+    bool nextTag(void)
+    {
+        const char *p = (const char*)memchr(m_pCur, '<', m_pEnd - m_pCur);
+        m_pCur = p ? p : m_pEnd;
+        return p != NULL;
+    }
+
+    // adds a value to the open container, or makes it the root
+    void attach(unsigned int uNode)
+    {
+        if (m_tContainers.empty())
+        {
+            if (! m_pDocument->m_uRoot)
+            {
+                m_pDocument->m_uRoot = uNode;
+            }
+            return;
+        }
+
+        bool bDict = m_pDocument->m_tNodes[m_tContainers.back()].type == kCCPlistTypeDictionary;
+        if (bDict && ! m_bHasKey)
+        {
+            CCLOG("cocos2d: CCPlistDocument: value without a key ignored");
+            return;
+        }
+
+        CCPlistDocument::ccPlistEntry entry = { bDict ? m_uKey : 0, uNode };
+        m_tScratch.push_back(entry);
+        m_bHasKey = false;
+    }
+
+    bool closeContainer(void)
+    {
+        if (m_tContainers.empty())
+        {
+            return false;
+        }
+
+        unsigned int uStart = m_tScratchStarts.back();
+        CCPlistDocument::ccPlistNode& node = m_pDocument->m_tNodes[m_tContainers.back()];
+        node.u.first = (unsigned int)m_pDocument->m_tEntries.size();
+        node.count = (unsigned int)m_tScratch.size() - uStart;
+        m_pDocument->m_tEntries.insert(m_pDocument->m_tEntries.end(), m_tScratch.begin() + uStart, m_tScratch.end());
+
+        m_tScratch.resize(uStart);
+        m_tContainers.pop_back();
+        m_tScratchStarts.pop_back();
+        m_bHasKey = false;
+        return true;
+    }
+
+    // reads the text of an element into m_sText, decoding entities and CDATA, and skips the closing tag
+    bool readText(const std::string& name)
+    {
+        while (m_pCur < m_pEnd)
+        {
+            char c = *m_pCur;
+            if (c == '<')
+            {
+                if (startsWith("<![CDATA["))
+                {
+                    const char *pStart = m_pCur + 9;
+                    if (! skipPast("]]>"))
+                    {
+                        CCLOG("cocos2d: CCPlistDocument: CDATA in <%s> is not closed", name.c_str());
+                        return false;
+                    }
+                    m_sText.append(pStart, m_pCur - 3 - pStart);
+                    continue;
+                }
+                if (startsWith("<!--"))
+                {
+                    skipPast("-->");
+                    continue;
+                }
+                if (! startsWith("</") || (size_t)(m_pEnd - m_pCur) < name.length() + 3
+                    || memcmp(m_pCur + 2, name.c_str(), name.length()) != 0)
+                {
+                    CCLOG("cocos2d: CCPlistDocument: <%s> is not closed", name.c_str());
+                    return false;
+                }
+                skipPast(">");
+                return true;
+            }
+
+            if (c == '&')
+            {
+                decodeEntity();
+                continue;
+            }
+
+            m_sText += c;
+            ++m_pCur;
+        }
+        return false;
+    }
+
+    void decodeEntity(void)
+    {
+        const char *pSemicolon = (const char*)memchr(m_pCur, ';', m_pEnd - m_pCur);
+        if (! pSemicolon || pSemicolon - m_pCur > 10)
+        {
+            m_sText += '&';
+            ++m_pCur;
+            return;
+        }
+
+        std::string entity(m_pCur + 1, pSemicolon - m_pCur - 1);
+        m_pCur = pSemicolon + 1;
+
+        if (entity == "lt")        m_sText += '<';
+        else if (entity == "gt")   m_sText += '>';
+        else if (entity == "amp")  m_sText += '&';
+        else if (entity == "quot") m_sText += '"';
+        else if (entity == "apos") m_sText += '\'';
+        else if (entity.length() > 1 && entity[0] == '#')
+        {
+            bool bHex = entity[1] == 'x' || entity[1] == 'X';
+            appendUTF8(m_sText, (unsigned int)strtoul(entity.c_str() + (bHex ? 2 : 1), NULL, bHex ? 16 : 10));
+        }
+        else
+        {
+            m_sText += '&';
+            m_sText += entity;
+            m_sText += ';';
+        }
+    }
+
+    CCPlistDocument *m_pDocument;
+    const char *m_pCur;
+    const char *m_pEnd;
+    std::vector<unsigned int> m_tContainers;
+    std::vector<unsigned int> m_tScratchStarts;
+    std::vector<CCPlistDocument::ccPlistEntry> m_tScratch;
+    std::string m_sText;
+    unsigned int m_uKey;
+    bool m_bHasKey;
+};
+
+/*
+ Binary property list reader (bplist00).
+
+ The 32 byte trailer gives the size of the offsets and object references, the number of
+ objects, the top object and where the offset table starts. Objects referenced several
+ times are read once and share their node.
+ */
+class CCPlistBinaryReader
+{
+public:
+    CCPlistBinaryReader(CCPlistDocument *pDocument, const unsigned char *pData, unsigned long nSize)
+        : m_pDocument(pDocument)
+        , m_pData(pData)
+        , m_nSize(nSize)
+        , m_uOffsetSize(0)
+        , m_uRefSize(0)
+        , m_uObjectCount(0)
+        , m_uOffsetTable(0)
+    {
+    }
+
+    bool read(void)
+    {
+        if (m_nSize < 8 + 32 || memcmp(m_pData, "bplist00", 8) != 0)
+        {
+            return false;
+        }
+
+        const unsigned char *pTrailer = m_pData + m_nSize - 32;
+        m_uOffsetSize = pTrailer[6];
+        m_uRefSize = pTrailer[7];
+        unsigned long long uObjectCount = readInt(pTrailer + 8, 8);
+        unsigned long long uTop = readInt(pTrailer + 16, 8);
+        m_uOffsetTable = readInt(pTrailer + 24, 8);
+
+        if (m_uOffsetSize < 1 || m_uOffsetSize > 8 || m_uRefSize < 1 || m_uRefSize > 8
+            || uObjectCount == 0 || uObjectCount > 0x7FFFFFFF || uTop >= uObjectCount
+            || m_uOffsetTable < 8 || m_uOffsetTable + uObjectCount * m_uOffsetSize > m_nSize - 32)
+        {
+            CCLOG("cocos2d: CCPlistDocument: invalid binary plist trailer");
+            return false;
+        }
+
+        m_uObjectCount = (unsigned int)uObjectCount;
+        m_tObjectNodes.assign(m_uObjectCount, 0);
+        m_pDocument->m_uRoot = readObject(uTop, 0);
+        return m_pDocument->m_uRoot != 0;
+    }
+
+private:
+    // object references are turned into this while their object is read, to detect cycles
+    enum { kInProgress = 0xFFFFFFFF };
+
+    static unsigned long long readInt(const unsigned char *p, unsigned int uSize)
+    {
+        unsigned long long v = 0;
+        for (unsigned int i = 0; i < uSize; ++i)
+        {
+            v = (v << 8) | p[i];
+        }
+        return v;
+    }
+
+    bool has(const unsigned char *p, unsigned long long uBytes)
+    {
+        return p >= m_pData && (unsigned long long)(p - m_pData) + uBytes <= m_uOffsetTable;
+    }
+
+    // the element count of a marker: its low nibble, or an int object following it when the nibble is 0xF
+    bool readCount(unsigned char marker, const unsigned char **pp, unsigned long long *pCount)
+    {
+        *pCount = marker & 0x0F;
+        if (*pCount != 0x0F)
+        {
+            return true;
+        }
+
+        // counts larger than the file are rejected here, so they can't overflow the size checks
+
+        const unsigned char *p = *pp;
+        if (! has(p, 1) || (p[0] & 0xF0) != 0x10)
+        {
+            return false;
+        }
+        unsigned int uSize = 1 << (p[0] & 0x0F);
+        if (uSize > 8 || ! has(p + 1, uSize))
+        {
+            return false;
+        }
+        *pCount = readInt(p + 1, uSize);
+        *pp = p + 1 + uSize;
+        return *pCount <= m_nSize;
+    }
+
+    unsigned int addBytes(unsigned int type, const char *pBytes, unsigned int uLength)
+    {
+        unsigned int uOffset = m_pDocument->addString(pBytes, uLength);
+        unsigned int uNode = m_pDocument->addNode(type);
+        m_pDocument->m_tNodes[uNode].count = uLength;
+        m_pDocument->m_tNodes[uNode].u.first = uOffset;
+        return uNode;
+    }
+
+    static void utf16ToUTF8(const unsigned char *p, unsigned long long uChars, std::string& out)
+    {
+        out.clear();
+        for (unsigned long long i = 0; i < uChars; ++i)
+        {
+            unsigned int c = (p[i * 2] << 8) | p[i * 2 + 1];
+            if (c >= 0xD800 && c < 0xDC00 && i + 1 < uChars)
+            {
+                unsigned int low = (p[i * 2 + 2] << 8) | p[i * 2 + 3];
+                if (low >= 0xDC00 && low < 0xE000)
+                {
+                    c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                    ++i;
+                }
+            }
+            appendUTF8(out, c);
+        }
+    }
+
+    // reads the key of a dictionary entry, which must be a string
+    bool readKey(unsigned long long uRef, unsigned int *pKey)
+    {
+        const unsigned char *p = NULL;
+        if (uRef >= m_uObjectCount || ! (p = objectAt((unsigned int)uRef)))
+        {
+            return false;
+        }
+
+        unsigned char marker = *p++;
+        unsigned long long uCount = 0;
+        if (! readCount(marker, &p, &uCount))
+        {
+            return false;
+        }
+
+        if ((marker & 0xF0) == 0x50 && has(p, uCount))
+        {
+            *pKey = m_pDocument->internKey((const char*)p, (unsigned int)uCount);
+            return true;
+        }
+        if ((marker & 0xF0) == 0x60 && has(p, uCount * 2))
+        {
+            utf16ToUTF8(p, uCount, m_sText);
+            *pKey = m_pDocument->internKey(m_sText.c_str(), (unsigned int)m_sText.length());
+            return true;
+        }
+        return false;
+    }
+
+    const unsigned char* objectAt(unsigned int uObject)
+    {
+        unsigned long long uOffset = readInt(m_pData + m_uOffsetTable + (unsigned long long)uObject * m_uOffsetSize, m_uOffsetSize);
+        return uOffset >= 8 && uOffset < m_uOffsetTable ? m_pData + uOffset : NULL;
+    }
+
+    // returns the node of an object, 0 if it is invalid
+    unsigned int readObject(unsigned long long uObject, unsigned int uDepth)
+    {
+        if (uObject >= m_uObjectCount || uDepth > CC_PLIST_MAX_DEPTH)
+        {
+            return 0;
+        }
+
+        unsigned int& uCached = m_tObjectNodes[(unsigned int)uObject];
+        if (uCached == kInProgress)
+        {
+            CCLOG("cocos2d: CCPlistDocument: binary plist references itself");
+            return 0;
+        }
+        if (uCached)
+        {
+            return uCached;
+        }
+
+        const unsigned char *p = objectAt((unsigned int)uObject);
+        if (! p)
+        {
+            return 0;
+        }
+
+        unsigned char marker = *p++;
+        unsigned int uNode = 0;
+        switch (marker & 0xF0)
+        {
+        case 0x00:
+            if (marker == 0x08 || marker == 0x09)
+            {
+                uNode = m_pDocument->addNode(kCCPlistTypeBool);
+                m_pDocument->m_tNodes[uNode].u.integer = marker == 0x09 ? 1 : 0;
+            }
+            else
+            {
+                uNode = m_pDocument->addNode(kCCPlistTypeNull);
+            }
+            break;
+        case 0x10:
+        case 0x80:
+            {
+                // ints of 16 bytes keep their low 64 bits; UIDs are read as integers
+                unsigned int uSize = (marker & 0xF0) == 0x80 ? (marker & 0x0F) + 1 : 1 << (marker & 0x0F);
+                if (uSize > 16 || ! has(p, uSize))
+                {
+                    return 0;
+                }
+                unsigned int uUsed = uSize > 8 ? 8 : uSize;
+                uNode = m_pDocument->addNode(kCCPlistTypeInteger);
+                m_pDocument->m_tNodes[uNode].u.integer = (long long)readInt(p + uSize - uUsed, uUsed);
+            }
+            break;
+        case 0x20:
+        case 0x30:
+            {
+                // dates (0x33) are read as their number of seconds since 2001-01-01
+                unsigned int uSize = (marker & 0xF0) == 0x30 ? 8 : 1 << (marker & 0x0F);
+                if ((uSize != 4 && uSize != 8) || ! has(p, uSize))
+                {
+                    return 0;
+                }
+                unsigned long long bits = readInt(p, uSize);
+                double value;
+                if (uSize == 4)
+                {
+                    unsigned int bits32 = (unsigned int)bits;
+                    float f;
+                    memcpy(&f, &bits32, 4);
+                    value = f;
+                }
+                else
+                {
+                    memcpy(&value, &bits, 8);
+                }
+                uNode = m_pDocument->addNode(kCCPlistTypeReal);
+                m_pDocument->m_tNodes[uNode].u.real = value;
+            }
+            break;
+        case 0x40:
+        case 0x50:
+        case 0x60:
+            {
+                unsigned long long uCount = 0;
+                unsigned long long uBytes;
+                if (! readCount(marker, &p, &uCount)
+                    || ! has(p, uBytes = (marker & 0xF0) == 0x60 ? uCount * 2 : uCount))
+                {
+                    return 0;
+                }
+
+                if ((marker & 0xF0) == 0x60)
+                {
+                    utf16ToUTF8(p, uCount, m_sText);
+                    uNode = addBytes(kCCPlistTypeString, m_sText.c_str(), (unsigned int)m_sText.length());
+                }
+                else
+                {
+                    uNode = addBytes((marker & 0xF0) == 0x40 ? kCCPlistTypeData : kCCPlistTypeString, (const char*)p, (unsigned int)uBytes);
+                }
+            }
+            break;
+        case 0xA0:
+        case 0xC0:
+        case 0xD0:
+            {
+                bool bDict = (marker & 0xF0) == 0xD0;
+                unsigned long long uCount = 0;
+                if (! readCount(marker, &p, &uCount) || ! has(p, uCount * m_uRefSize * (bDict ? 2 : 1)))
+                {
+                    return 0;
+                }
+
+                uNode = m_pDocument->addNode(bDict ? kCCPlistTypeDictionary : kCCPlistTypeArray);
+                unsigned int uFirst = (unsigned int)m_pDocument->m_tEntries.size();
+                m_pDocument->m_tNodes[uNode].u.first = uFirst;
+                m_pDocument->m_tNodes[uNode].count = (unsigned int)uCount;
+                m_pDocument->m_tEntries.resize(uFirst + (size_t)uCount);
+
+                uCached = kInProgress;
+                for (unsigned int i = 0; i < uCount; ++i)
+                {
+                    unsigned long long uRef = readInt(p + (bDict ? (uCount + i) : i) * m_uRefSize, m_uRefSize);
+                    unsigned int uKey = 0;
+                    if (bDict && ! readKey(readInt(p + i * m_uRefSize, m_uRefSize), &uKey))
+                    {
+                        return 0;
+                    }
+
+                    unsigned int uChild = readObject(uRef, uDepth + 1);
+                    if (! uChild)
+                    {
+                        return 0;
+                    }
+                    m_pDocument->m_tEntries[uFirst + i].key = uKey;
+                    m_pDocument->m_tEntries[uFirst + i].node = uChild;
+                }
+            }
+            break;
+        default:
+            CCLOG("cocos2d: CCPlistDocument: unsupported binary plist object 0x%02x", marker);
+            return 0;
+        }
+
+        uCached = uNode;
+        return uNode;
+    }
+
+    CCPlistDocument *m_pDocument;
+    const unsigned char *m_pData;
+    unsigned long m_nSize;
+    unsigned int m_uOffsetSize;
+    unsigned int m_uRefSize;
+    unsigned int m_uObjectCount;
+    unsigned long long m_uOffsetTable;
+    std::vector<unsigned int> m_tObjectNodes;
+    std::string m_sText;
+};
+
+// CCPlistValue
+
+CCPlistType CCPlistValue::getType(void) const
+{
+    return m_pDocument ? (CCPlistType)m_pDocument->nodeAt(m_uNode)->type : kCCPlistTypeNull;
+}
+
+int CCPlistValue::intValue(void) const
+{
+    if (! m_pDocument)
+    {
+        return 0;
+    }
+
+    const CCPlistDocument::ccPlistNode *pNode = m_pDocument->nodeAt(m_uNode);
+    switch (pNode->type)
+    {
+    case kCCPlistTypeInteger:
+    case kCCPlistTypeBool:
+        return (int)pNode->u.integer;
+    case kCCPlistTypeReal:
+        return (int)pNode->u.real;
+    case kCCPlistTypeString:
+        return atoi(getCString());
+    default:
+        return 0;
+    }
+}
+
+float CCPlistValue::floatValue(void) const
+{
+    return (float)doubleValue();
+}
+
+double CCPlistValue::doubleValue(void) const
+{
+    if (! m_pDocument)
+    {
+        return 0.0;
+    }
+
+    const CCPlistDocument::ccPlistNode *pNode = m_pDocument->nodeAt(m_uNode);
+    switch (pNode->type)
+    {
+    case kCCPlistTypeInteger:
+    case kCCPlistTypeBool:
+        return (double)pNode->u.integer;
+    case kCCPlistTypeReal:
+        return pNode->u.real;
+    case kCCPlistTypeString:
+        return atof(getCString());
+    default:
+        return 0.0;
+    }
+}
+
+bool CCPlistValue::boolValue(void) const
+{
+    if (getType() == kCCPlistTypeString)
+    {
+        const char *pszText = getCString();
+        return pszText[0] && strcmp(pszText, "0") != 0 && strcmp(pszText, "false") != 0;
+    }
+    return doubleValue() != 0.0;
+}
+
+const char* CCPlistValue::getCString(void) const
+{
+    if (getType() != kCCPlistTypeString)
+    {
+        return "";
+    }
+    return &m_pDocument->m_tPool[m_pDocument->nodeAt(m_uNode)->u.first];
+}
+
+const unsigned char* CCPlistValue::getBytes(void) const
+{
+    CCPlistType type = getType();
+    if (type != kCCPlistTypeString && type != kCCPlistTypeData)
+    {
+        return NULL;
+    }
+    return (const unsigned char*)&m_pDocument->m_tPool[m_pDocument->nodeAt(m_uNode)->u.first];
+}
+
+unsigned int CCPlistValue::length(void) const
+{
+    CCPlistType type = getType();
+    return type == kCCPlistTypeString || type == kCCPlistTypeData ? m_pDocument->nodeAt(m_uNode)->count : 0;
+}
+
+unsigned int CCPlistValue::count(void) const
+{
+    CCPlistType type = getType();
+    return type == kCCPlistTypeDictionary || type == kCCPlistTypeArray ? m_pDocument->nodeAt(m_uNode)->count : 0;
+}
+
+CCPlistValue CCPlistValue::objectAtIndex(unsigned int index) const
+{
+    if (index >= count())
+    {
+        return CCPlistValue();
+    }
+    return CCPlistValue(m_pDocument, m_pDocument->m_tEntries[m_pDocument->nodeAt(m_uNode)->u.first + index].node);
+}
+
+const char* CCPlistValue::keyAtIndex(unsigned int index) const
+{
+    if (getType() != kCCPlistTypeDictionary || index >= count())
+    {
+        return "";
+    }
+    return &m_pDocument->m_tPool[m_pDocument->m_tEntries[m_pDocument->nodeAt(m_uNode)->u.first + index].key];
+}
+
+CCPlistValue CCPlistValue::objectForKey(const char *key) const
+{
+    if (getType() != kCCPlistTypeDictionary || ! key)
+    {
+        return CCPlistValue();
+    }
+
+    std::unordered_map<std::string, unsigned int>::const_iterator it = m_pDocument->m_tKeys.find(key);
+    if (it == m_pDocument->m_tKeys.end())
+    {
+        return CCPlistValue();
+    }
+
+    // the last entry wins, as it did with CCDictionary::setObject
+    const CCPlistDocument::ccPlistNode *pNode = m_pDocument->nodeAt(m_uNode);
+    for (unsigned int i = pNode->count; i > 0; --i)
+    {
+        const CCPlistDocument::ccPlistEntry& entry = m_pDocument->m_tEntries[pNode->u.first + i - 1];
+        if (entry.key == it->second)
+        {
+            return CCPlistValue(m_pDocument, entry.node);
+        }
+    }
+    return CCPlistValue();
+}
+
+CCObject* CCPlistValue::copyObject(void) const
+{
+    return m_pDocument ? m_pDocument->copyNode(m_uNode) : NULL;
+}
+
+// CCPlistDocument
+
+const CCPlistDocument::ccPlistNode CCPlistDocument::s_nullNode = { kCCPlistTypeNull, 0, { 0 } };
+
+CCPlistDocument::CCPlistDocument()
+: m_uRoot(0)
+, m_pRootObject(NULL)
+{
+    clear();
+}
+
+CCPlistDocument::~CCPlistDocument()
+{
+    CC_SAFE_RELEASE(m_pRootObject);
+}
+
+CCPlistDocument* CCPlistDocument::create(const char *pszFile)
+{
+    CCPlistDocument *pRet = new CCPlistDocument();
+    if (pRet->initWithContentsOfFile(CCFileUtils::fullPathFromRelativePath(pszFile)))
+    {
+        pRet->autorelease();
+        return pRet;
+    }
+    CC_SAFE_DELETE(pRet);
+    return NULL;
+}
+
+bool CCPlistDocument::initWithContentsOfFile(const char *pszFullPath)
+{
+    CCData *pData = CCFileUtils::getFileDataBlob(pszFullPath);
+    if (! pData)
+    {
+        CCLOG("cocos2d: CCPlistDocument: can't read %s", pszFullPath);
+        return false;
+    }
+
+    bool bRet = initWithData((const unsigned char*)pData->bytes(), pData->getSize());
+    pData->release();
+    if (! bRet)
+    {
+        CCLOG("cocos2d: CCPlistDocument: %s is not a valid property list", pszFullPath);
+    }
+    return bRet;
+}
+
+bool CCPlistDocument::initWithData(const unsigned char *pData, unsigned long nSize)
+{
+    clear();
+    if (! pData)
+    {
+        return false;
+    }
+
+    bool bRet;
+    if (nSize >= 8 && memcmp(pData, "bplist00", 8) == 0)
+    {
+        CCPlistBinaryReader reader(this, pData, nSize);
+        bRet = reader.read();
+    }
+    else
+    {
+        CCPlistXMLReader reader(this, (const char*)pData, nSize);
+        bRet = reader.read();
+    }
+
+    if (! bRet)
+    {
+        clear();
+    }
+    return bRet;
+}
+
+CCDictionary* CCPlistDocument::getRootDictionary(void)
+{
+    if (getRoot().getType() != kCCPlistTypeDictionary)
+    {
+        return NULL;
+    }
+    if (! m_pRootObject)
+    {
+        m_pRootObject = copyNode(m_uRoot);
+    }
+    return (CCDictionary*)m_pRootObject;
+}
+
+CCArray* CCPlistDocument::getRootArray(void)
+{
+    if (getRoot().getType() != kCCPlistTypeArray)
+    {
+        return NULL;
+    }
+    if (! m_pRootObject)
+    {
+        m_pRootObject = copyNode(m_uRoot);
+    }
+    return (CCArray*)m_pRootObject;
+}
+
+unsigned int CCPlistDocument::getMemoryUsage(void) const
+{
+    return (unsigned int)(m_tNodes.capacity() * sizeof(ccPlistNode)
+        + m_tEntries.capacity() * sizeof(ccPlistEntry)
+        + m_tPool.capacity());
+}
+
+void CCPlistDocument::clear(void)
+{
+    CC_SAFE_RELEASE_NULL(m_pRootObject);
+    m_tNodes.clear();
+    m_tEntries.clear();
+    m_tPool.clear();
+    m_tKeys.clear();
+    m_uRoot = 0;
+
+    // node 0 is the null value and pool offset 0 the empty string
+    m_tNodes.push_back(s_nullNode);
+    m_tPool.push_back('\0');
+}
+
+unsigned int CCPlistDocument::addNode(unsigned int type)
+{
+    ccPlistNode node = s_nullNode;
+    node.type = type;
+    m_tNodes.push_back(node);
+    return (unsigned int)m_tNodes.size() - 1;
+}
+
+unsigned int CCPlistDocument::addString(const char *pText, unsigned int uLength)
+{
+    if (! uLength)
+    {
+        return 0;
+    }
+
+    unsigned int uOffset = (unsigned int)m_tPool.size();
+    m_tPool.insert(m_tPool.end(), pText, pText + uLength);
+    m_tPool.push_back('\0');
+    return uOffset;
+}
+
+unsigned int CCPlistDocument::internKey(const char *pText, unsigned int uLength)
+{
+    std::string key(pText, uLength);
+    std::unordered_map<std::string, unsigned int>::iterator it = m_tKeys.find(key);
+    if (it != m_tKeys.end())
+    {
+        return it->second;
+    }
+
+    unsigned int uOffset = addString(pText, uLength);
+    m_tKeys[key] = uOffset;
+    return uOffset;
+}
+
+const CCPlistDocument::ccPlistNode* CCPlistDocument::nodeAt(unsigned int uNode) const
+{
+    return uNode < m_tNodes.size() ? &m_tNodes[uNode] : &s_nullNode;
+}
+
+CCObject* CCPlistDocument::copyNode(unsigned int uNode) const
+{
+    const ccPlistNode *pNode = nodeAt(uNode);
+    char szNumber[32];
+
+    switch (pNode->type)
+    {
+    case kCCPlistTypeDictionary:
+        {
+            CCDictionary *pDict = new CCDictionary();
+            for (unsigned int i = 0; i < pNode->count; ++i)
+            {
+                const ccPlistEntry& entry = m_tEntries[pNode->u.first + i];
+                CCObject *pObject = copyNode(entry.node);
+                if (pObject)
+                {
+                    pDict->setObject(pObject, std::string(&m_tPool[entry.key]));
+                    pObject->release();
+                }
+            }
+            return pDict;
+        }
+    case kCCPlistTypeArray:
+        {
+            CCArray *pArray = new CCArray(pNode->count);
+            for (unsigned int i = 0; i < pNode->count; ++i)
+            {
+                CCObject *pObject = copyNode(m_tEntries[pNode->u.first + i].node);
+                if (pObject)
+                {
+                    pArray->addObject(pObject);
+                    pObject->release();
+                }
+            }
+            return pArray;
+        }
+    case kCCPlistTypeString:
+        return new CCString(std::string(&m_tPool[pNode->u.first], pNode->count));
+    case kCCPlistTypeInteger:
+        sprintf(szNumber, "%lld", pNode->u.integer);
+        return new CCString(szNumber);
+    case kCCPlistTypeReal:
+        // 15 digits give back the text of the XML numbers
+        sprintf(szNumber, "%.15g", pNode->u.real);
+        return new CCString(szNumber);
+    case kCCPlistTypeBool:
+        return new CCString(pNode->u.integer ? "1" : "0");
+    case kCCPlistTypeData:
+        {
+            unsigned char *pBytes = new unsigned char[pNode->count ? pNode->count : 1];
+            memcpy(pBytes, &m_tPool[pNode->u.first], pNode->count);
+            return new CCData(pBytes, pNode->count);
+        }
+    default:
+        return NULL;
+    }
+}
+
+NS_CC_END
@@ -24,6 +24,7 @@
 #include "CCDictionary.h"
 #include "CCLibxml2.h"
 #include "CCFileUtils.h"
+#include "CCData.h"
 #include "tinyxml\tinyxml.h"
 
 NS_CC_BEGIN;
@@ -100,17 +101,17 @@ bool CCSAXParser::init(const char *pszEncoding)
 
 bool CCSAXParser::parse(const char *pszFile)
 {
-	CCFileData data(pszFile, "rt");
-	unsigned long size = data.getSize();
-	char *pBuffer = (char*) data.getBuffer();
+	// shared with the file data cache: plists read again, e.g. on scene re-entry, are not copied
+	CCData *pData = CCFileUtils::getFileDataBlob(pszFile);
 	
-	if (!pBuffer)
+	if (!pData)
 	{
 		return false;
 	}
 		
 	TiXmlDocument tinyDoc;
-	tinyDoc.Parse(pBuffer,0,TIXML_ENCODING_UTF8);
+	tinyDoc.Parse((const char*)pData->bytes(),0,TIXML_ENCODING_UTF8);
+	pData->release();
 	XmlSaxHander printer;
 	printer.setCCSAXParserImp(this);
 	return tinyDoc.Accept( &printer );	
@@ -91,6 +91,29 @@ public:
 
 static CacheHandler s_CacheHandler;
 
+// "CCSB": header of the file of saveCachedFileData, followed by the hash, the size and the data of each entry
+#define CACHE_FILE_MAGIC 0x42534343
+#define CACHE_FILE_MAX_ENTRY_SIZE (16 * 1024 * 1024)
+
+struct CacheFileHeader
+{
+    unsigned int magic;
+    unsigned short version[4];
+    unsigned int count;
+};
+
+// the file is only read back by the package that wrote it
+static void initCacheFileHeader(CacheFileHeader& header, unsigned int count)
+{
+    PackageVersion version = Package::Current->Id->Version;
+    header.magic = CACHE_FILE_MAGIC;
+    header.version[0] = version.Major;
+    header.version[1] = version.Minor;
+    header.version[2] = version.Build;
+    header.version[3] = version.Revision;
+    header.count = count;
+}
+
 
 BasicLoader::BasicLoader(
     _In_ ID3D11Device* d3dDevice
@@ -358,5 +381,93 @@ void BasicLoader::purgeCachedFileData()
     s_CacheHandler.getCache().clear();
 }
 
+bool BasicLoader::loadCachedFileData(const char *pszPath)
+{
+    FILE *fp = fopen(pszPath, "rb");
+    if (! fp)
+    {
+        return false;
+    }
 
+    // the entries are only added once the whole file was read
+    std::map<unsigned int, CacheDataInfo*> entries;
+    bool bRet = false;
+    do
+    {
+        CacheFileHeader header, expected;
+        initCacheFileHeader(expected, 0);
+        if (fread(&header, sizeof(header), 1, fp) != 1
+            || header.magic != expected.magic
+            || memcmp(header.version, expected.version, sizeof(header.version)) != 0)
+        {
+            break;
+        }
 
+        unsigned int i = 0;
+        for (; i < header.count; i++)
+        {
+            unsigned int entry[2];
+            if (fread(entry, sizeof(entry), 1, fp) != 1 || entry[1] == 0 || entry[1] > CACHE_FILE_MAX_ENTRY_SIZE)
+            {
+                break;
+            }
+            CacheDataInfo* pCache = new CacheDataInfo();
+            pCache->data = new unsigned char[entry[1]];
+            pCache->size = entry[1];
+            if (fread(pCache->data, entry[1], 1, fp) != 1 || entries.find(entry[0]) != entries.end())
+            {
+                delete pCache;
+                break;
+            }
+            entries.insert(std::pair<unsigned int, CacheDataInfo*>(entry[0], pCache));
+        }
+        bRet = (i == header.count);
+    }while(0);
+    fclose(fp);
+
+    std::map<unsigned int, CacheDataInfo*>& cache = s_CacheHandler.getCache();
+    std::map<unsigned int, CacheDataInfo*>::iterator it;
+    for (it = entries.begin(); it != entries.end(); it++)
+    {
+        if (bRet && cache.find(it->first) == cache.end())
+        {
+            cache.insert(*it);
+        }
+        else
+        {
+            delete it->second;
+        }
+    }
+    return bRet;
+}
+
+bool BasicLoader::saveCachedFileData(const char *pszPath)
+{
+    FILE *fp = fopen(pszPath, "wb");
+    if (! fp)
+    {
+        return false;
+    }
+
+    std::map<unsigned int, CacheDataInfo*>& cache = s_CacheHandler.getCache();
+    CacheFileHeader header;
+    initCacheFileHeader(header, cache.size());
+    fwrite(&header, sizeof(header), 1, fp);
+
+    std::map<unsigned int, CacheDataInfo*>::iterator it;
+    for (it = cache.begin(); it != cache.end(); it++)
+    {
+        unsigned int entry[2] = { it->first, it->second->size };
+        fwrite(entry, sizeof(entry), 1, fp);
+        fwrite(it->second->data, it->second->size, 1, fp);
+    }
+
+    bool bRet = ! ferror(fp);
+    fclose(fp);
+    if (! bRet)
+    {
+        // a partial file would be rejected anyway
+        remove(pszPath);
+    }
+    return bRet;
+}
@@ -23,6 +23,7 @@
 
 #include "DirectXRender.h"
 #include "CCDirector.h"
+#include "CCTextureCache.h"
 
 using namespace Windows::UI::Core;
 
@@ -255,6 +256,8 @@ void CCFrameworkView::OnSuspending(
 
     SuspendingDeferral^ deferral = args->SuspendingOperation->GetDeferral();
     //m_renderer->OnSuspending();
+    // suspended applications are the first to be killed when memory runs low
+    CCTextureCache::sharedTextureCache()->didReceiveMemoryWarning();
     deferral->Complete();
     CCLog("CCFrameworkView::-OnSuspending()");
 }
@@ -24,6 +24,7 @@
 #include "CCSet.h"
 #include "ccMacros.h"
 #include "CCDirector.h"
+#include "ccDXStateCache.h"
 #include "CCTouch.h"
 #include "CCTouchDispatcher.h"
 #include "CCIMEDispatcher.h"
@@ -49,6 +50,9 @@ CCEGLView::CCEGLView()
 
     m_d3dDevice = DirectXRender::SharedDXRender()->m_d3dDevice.Get();
     m_d3dContext = DirectXRender::SharedDXRender()->m_d3dContext.Get();
+    m_d3dDeferredContext = NULL;
+    m_bDeferredContext = false;
+    m_nDriverCommandLists = -1;
     m_swapChain = DirectXRender::SharedDXRender()->m_swapChain.Get();
     m_renderTargetView = DirectXRender::SharedDXRender()->m_renderTargetView.Get();
     m_depthStencilView = DirectXRender::SharedDXRender()->m_depthStencilView.Get();
@@ -60,6 +64,7 @@ CCEGLView::CCEGLView()
 
 CCEGLView::~CCEGLView()
 {
+    CC_SAFE_RELEASE_NULL_DX(m_d3dDeferredContext);
 }
 
 ID3D11Device* CCEGLView::GetDevice()
@@ -68,10 +73,111 @@ ID3D11Device* CCEGLView::GetDevice()
 }
 
 ID3D11DeviceContext* CCEGLView::GetDeviceContext()
+{
+    return m_bDeferredContext ? m_d3dDeferredContext : m_d3dContext;
+}
+
+ID3D11DeviceContext* CCEGLView::GetImmediateDeviceContext()
 {
     return m_d3dContext;
 }
 
+// copies the output merger and rasterizer states: the renderers set the rest before each draw
+static void copyContextState(ID3D11DeviceContext *pFrom, ID3D11DeviceContext *pTo)
+{
+    ID3D11RenderTargetView *pRenderTargetViews[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT] = { 0 };
+    ID3D11DepthStencilView *pDepthStencilView = NULL;
+    pFrom->OMGetRenderTargets(D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, pRenderTargetViews, &pDepthStencilView);
+    pTo->OMSetRenderTargets(D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, pRenderTargetViews, pDepthStencilView);
+    for (int i = 0; i < D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT; i++)
+    {
+        CC_SAFE_RELEASE_NULL_DX(pRenderTargetViews[i]);
+    }
+    CC_SAFE_RELEASE_NULL_DX(pDepthStencilView);
+
+    ID3D11BlendState *pBlendState = NULL;
+    float blendFactor[4];
+    UINT sampleMask;
+    pFrom->OMGetBlendState(&pBlendState, blendFactor, &sampleMask);
+    pTo->OMSetBlendState(pBlendState, blendFactor, sampleMask);
+    CC_SAFE_RELEASE_NULL_DX(pBlendState);
+
+    ID3D11DepthStencilState *pDepthStencilState = NULL;
+    UINT stencilRef;
+    pFrom->OMGetDepthStencilState(&pDepthStencilState, &stencilRef);
+    pTo->OMSetDepthStencilState(pDepthStencilState, stencilRef);
+    CC_SAFE_RELEASE_NULL_DX(pDepthStencilState);
+
+    ID3D11RasterizerState *pRasterizerState = NULL;
+    pFrom->RSGetState(&pRasterizerState);
+    pTo->RSSetState(pRasterizerState);
+    CC_SAFE_RELEASE_NULL_DX(pRasterizerState);
+
+    D3D11_VIEWPORT viewports[D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE];
+    UINT uViewports = D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE;
+    pFrom->RSGetViewports(&uViewports, viewports);
+    pTo->RSSetViewports(uViewports, viewports);
+
+    D3D11_RECT scissorRects[D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE];
+    UINT uScissorRects = D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE;
+    pFrom->RSGetScissorRects(&uScissorRects, scissorRects);
+    pTo->RSSetScissorRects(uScissorRects, scissorRects);
+}
+
+bool CCEGLView::BeginDeferredContext()
+{
+    if (m_bDeferredContext)
+    {
+        return true;
+    }
+    if (! m_d3dDeferredContext && FAILED(m_d3dDevice->CreateDeferredContext1(0, &m_d3dDeferredContext)))
+    {
+        CCLOG("cocos2d: CCEGLView: can't create a deferred context");
+        m_d3dDeferredContext = NULL;
+        return false;
+    }
+
+    copyContextState(m_d3dContext, m_d3dDeferredContext);
+    m_bDeferredContext = true;
+    return true;
+}
+
+ID3D11CommandList* CCEGLView::FinishCommandList()
+{
+    ID3D11CommandList *pCommandList = NULL;
+    if (m_bDeferredContext && FAILED(m_d3dDeferredContext->FinishCommandList(TRUE, &pCommandList)))
+    {
+        pCommandList = NULL;
+    }
+    // the dynamic buffers must be discarded again by the next command list
+    ccDXInvalidateStateCache();
+    return pCommandList;
+}
+
+void CCEGLView::EndDeferredContext()
+{
+    if (! m_bDeferredContext)
+    {
+        return;
+    }
+
+    copyContextState(m_d3dDeferredContext, m_d3dContext);
+    // drops the references to the views, so the swap chain buffers can be resized
+    m_d3dDeferredContext->ClearState();
+    m_bDeferredContext = false;
+}
+
+bool CCEGLView::HasDriverCommandLists()
+{
+    if (m_nDriverCommandLists < 0)
+    {
+        D3D11_FEATURE_DATA_THREADING threading = { 0 };
+        m_nDriverCommandLists = SUCCEEDED(m_d3dDevice->CheckFeatureSupport(D3D11_FEATURE_THREADING, &threading, sizeof(threading)))
+            && threading.DriverCommandLists ? 1 : 0;
+    }
+    return m_nDriverCommandLists == 1;
+}
+
 ID3D11DepthStencilView* CCEGLView::GetDepthStencilView()
 {
     return m_depthStencilView;
@@ -223,7 +329,39 @@ void CCEGLView::render()
 }
 void CCEGLView::swapBuffers()
 {
-    DirectXRender::SharedDXRender()->Present();
+    HandlePresentResult(PresentBackBuffer());
+}
+
+HRESULT CCEGLView::PresentBackBuffer()
+{
+    return DirectXRender::SharedDXRender()->PresentBackBuffer();
+}
+
+bool CCEGLView::HandlePresentResult(HRESULT hr)
+{
+    bool bDeviceLost = hr == DXGI_ERROR_DEVICE_REMOVED || hr == DXGI_ERROR_DEVICE_RESET;
+    if (bDeviceLost)
+    {
+        // the deferred context belongs to the lost device
+        m_bDeferredContext = false;
+        CC_SAFE_RELEASE_NULL_DX(m_d3dDeferredContext);
+        // so do the hashed blend and depth-stencil states, purging them also invalidates the cache
+        ccDXPurgeStateObjects();
+    }
+
+    DirectXRender^ render = DirectXRender::SharedDXRender();
+    render->HandlePresentResult(hr);
+
+    if (bDeviceLost)
+    {
+        m_d3dDevice = render->m_d3dDevice.Get();
+        m_d3dContext = render->m_d3dContext.Get();
+        m_nDriverCommandLists = -1;
+        m_swapChain = render->m_swapChain.Get();
+        m_renderTargetView = render->m_renderTargetView.Get();
+        m_depthStencilView = render->m_depthStencilView.Get();
+    }
+    return bDeviceLost;
 }
 
 void CCEGLView::setViewPortInPoints(float x, float y, float w, float h)
@@ -308,7 +446,9 @@ void CCEGLView::setDesignResolution(int dx, int dy)
 
 void CCEGLView::SetBackBufferRenderTarget()
 {
-    m_d3dContext->OMSetRenderTargets(1, &m_renderTargetView, m_depthStencilView);
+    GetDeviceContext()->OMSetRenderTargets(1, &m_renderTargetView, m_depthStencilView);
+    // the view may be set before the director knows it: forgets what the render target unbound
+    ccDXInvalidateStateCache();
 }
 
 void CCEGLView::D3DPerspective( FLOAT fovy, FLOAT aspect, FLOAT zNear, FLOAT zFar)
@@ -384,7 +524,7 @@ void CCEGLView::D3DViewport(int x, int y, int width, int height)
 	viewport.TopLeftY = (float)y;
 
 	// Create the viewport.
-	m_d3dContext->RSSetViewports(1, &viewport);
+	GetDeviceContext()->RSSetViewports(1, &viewport);
 }
 
 void CCEGLView::D3DScissor(int x,int y,int w,int h)
@@ -396,7 +536,7 @@ void CCEGLView::D3DScissor(int x,int y,int w,int h)
 	scissorRects.right = x+w;
 	scissorRects.bottom = y+h;
 
-	m_d3dContext->RSSetScissorRects(1,&scissorRects);
+	GetDeviceContext()->RSSetScissorRects(1,&scissorRects);
 }
 
 void CCEGLView::GetProjectionMatrix(XMMATRIX& projectionMatrix)
@@ -528,12 +668,9 @@ void CCEGLView::D3DMultMatrix(const float *m)
 
 void CCEGLView::D3DDepthFunc(int func)
 {
-	ID3D11DepthStencilState *dss0 = 0;
-	ID3D11DepthStencilState *dss1 = 0;
 	D3D11_DEPTH_STENCIL_DESC dsd;
-	UINT sref;
 	//m_d3dContext->ClearDepthStencilView(m_d3dContext->GetDepthStencilView(), D3D11_CLEAR_DEPTH, 1.0f, 0);
-	m_d3dContext->ClearDepthStencilView(m_depthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+	GetDeviceContext()->ClearDepthStencilView(m_depthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
 	bool en = TRUE;
 	int wm = D3D11_DEPTH_WRITE_MASK_ALL;
 
@@ -550,16 +687,8 @@ void CCEGLView::D3DDepthFunc(int func)
 	default:en = FALSE; wm = D3D11_DEPTH_WRITE_MASK_ZERO;break;
 	}
 
-	m_d3dContext->OMGetDepthStencilState(&dss0,&sref);
-
-	if(dss0)
-		dss0->GetDesc(&dsd);
-	else
-	{
-		ZeroMemory(&dsd,sizeof(D3D11_DEPTH_STENCIL_DESC));
-		sref = 0;
-	}
-
+	// the state cache compares the descriptions byte for byte
+	ZeroMemory(&dsd,sizeof(D3D11_DEPTH_STENCIL_DESC));
 	dsd.DepthEnable = en;
 	dsd.DepthWriteMask = static_cast<D3D11_DEPTH_WRITE_MASK>(wm);
 	dsd.DepthFunc = static_cast<D3D11_COMPARISON_FUNC>(func);
@@ -576,14 +705,7 @@ void CCEGLView::D3DDepthFunc(int func)
 	dsd.BackFace.StencilPassOp = D3D11_STENCIL_OP_DECR;
 	dsd.BackFace.StencilFunc = D3D11_COMPARISON_ALWAYS;
 
-	if(FAILED(m_d3dDevice->CreateDepthStencilState(&dsd,&dss1)))
-		exit(-1);
-	
-	m_d3dContext->OMSetDepthStencilState(dss1,sref);
-
-	if(dss0)
-		dss0->Release();
-	dss1->Release();
+	ccDXSetDepthStencilState(dsd, 0);
 }
 
 void CCEGLView::D3DBlendFunc(int sfactor, int dfactor)
@@ -614,57 +736,37 @@ void CCEGLView::D3DBlendFunc(int sfactor, int dfactor)
 	case CC_ONE_MINUS_DST_ALPHA:	dfactor2=D3D11_BLEND_INV_DEST_ALPHA; dfactor=D3D11_BLEND_INV_DEST_ALPHA;break;
 	}
 
-	ID3D11BlendState* dbs0;
-	ID3D11BlendState* dbs1;
+	// the state cache compares the descriptions byte for byte, and only sets them before the next draw
 	D3D11_BLEND_DESC dbd;
-	float blendFactor[4]={0.0f,0.0f,0.0f,0.0f};
-	UINT sref;
-	m_d3dContext->OMGetBlendState(&dbs0,blendFactor,&sref);
-
-	if(dbs0)
-		dbs0->GetDesc(&dbd);
-	else
+	ZeroMemory(&dbd,sizeof(D3D11_BLEND_DESC));
+	if ( (sfactor==-1) && (dfactor==-1) )
 	{
-		ZeroMemory(&dbd,sizeof(D3D11_BLEND_DESC));
-		sref = 0;
+		dbd.RenderTarget[0].BlendEnable = FALSE;
+		sfactor = dfactor = D3D11_BLEND_ONE;
+		sfactor2 = dfactor2 = D3D11_BLEND_ONE;
 	}
-
-	if ( (dbd.RenderTarget[0].SrcBlend != (D3D11_BLEND)sfactor)|| (dbd.RenderTarget[0].DestBlend != (D3D11_BLEND)dfactor) )
+	else
 	{
-		if ( (sfactor==-1) && (dfactor==-1) )
-		{
-			dbd.RenderTarget[0].BlendEnable = FALSE;
-			sfactor = dfactor = D3D11_BLEND_ONE;
-			sfactor2 = dfactor2 = D3D11_BLEND_ONE;
-		}
-		else
-		{
-			dbd.RenderTarget[0].BlendEnable = TRUE;
-		}
-		dbd.AlphaToCoverageEnable = FALSE;
-		dbd.IndependentBlendEnable = FALSE;
-		dbd.RenderTarget[0].SrcBlend = (D3D11_BLEND)sfactor;
-		dbd.RenderTarget[0].DestBlend = (D3D11_BLEND)dfactor;
-		dbd.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
-		dbd.RenderTarget[0].SrcBlendAlpha = (D3D11_BLEND)sfactor2;
-		dbd.RenderTarget[0].DestBlendAlpha = (D3D11_BLEND)dfactor2;
-		dbd.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
-		dbd.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
-		memcpy( &dbd.RenderTarget[1], &dbd.RenderTarget[0], sizeof( D3D11_RENDER_TARGET_BLEND_DESC ) );
-		memcpy( &dbd.RenderTarget[2], &dbd.RenderTarget[0], sizeof( D3D11_RENDER_TARGET_BLEND_DESC ) );
-		memcpy( &dbd.RenderTarget[3], &dbd.RenderTarget[0], sizeof( D3D11_RENDER_TARGET_BLEND_DESC ) );
-		memcpy( &dbd.RenderTarget[4], &dbd.RenderTarget[0], sizeof( D3D11_RENDER_TARGET_BLEND_DESC ) );
-		memcpy( &dbd.RenderTarget[5], &dbd.RenderTarget[0], sizeof( D3D11_RENDER_TARGET_BLEND_DESC ) );
-		memcpy( &dbd.RenderTarget[6], &dbd.RenderTarget[0], sizeof( D3D11_RENDER_TARGET_BLEND_DESC ) );
-		memcpy( &dbd.RenderTarget[7], &dbd.RenderTarget[0], sizeof( D3D11_RENDER_TARGET_BLEND_DESC ) );
+		dbd.RenderTarget[0].BlendEnable = TRUE;
 	}
-
-	if(FAILED(m_d3dDevice->CreateBlendState(&dbd,&dbs1)))
-		exit(-1);
-	m_d3dContext->OMSetBlendState(dbs1, blendFactor, 0xffffffff);
-	if(dbs0)
-		dbs0->Release();
-	dbs1->Release();
+	dbd.AlphaToCoverageEnable = FALSE;
+	dbd.IndependentBlendEnable = FALSE;
+	dbd.RenderTarget[0].SrcBlend = (D3D11_BLEND)sfactor;
+	dbd.RenderTarget[0].DestBlend = (D3D11_BLEND)dfactor;
+	dbd.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+	dbd.RenderTarget[0].SrcBlendAlpha = (D3D11_BLEND)sfactor2;
+	dbd.RenderTarget[0].DestBlendAlpha = (D3D11_BLEND)dfactor2;
+	dbd.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+	dbd.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+	memcpy( &dbd.RenderTarget[1], &dbd.RenderTarget[0], sizeof( D3D11_RENDER_TARGET_BLEND_DESC ) );
+	memcpy( &dbd.RenderTarget[2], &dbd.RenderTarget[0], sizeof( D3D11_RENDER_TARGET_BLEND_DESC ) );
+	memcpy( &dbd.RenderTarget[3], &dbd.RenderTarget[0], sizeof( D3D11_RENDER_TARGET_BLEND_DESC ) );
+	memcpy( &dbd.RenderTarget[4], &dbd.RenderTarget[0], sizeof( D3D11_RENDER_TARGET_BLEND_DESC ) );
+	memcpy( &dbd.RenderTarget[5], &dbd.RenderTarget[0], sizeof( D3D11_RENDER_TARGET_BLEND_DESC ) );
+	memcpy( &dbd.RenderTarget[6], &dbd.RenderTarget[0], sizeof( D3D11_RENDER_TARGET_BLEND_DESC ) );
+	memcpy( &dbd.RenderTarget[7], &dbd.RenderTarget[0], sizeof( D3D11_RENDER_TARGET_BLEND_DESC ) );
+
+	ccDXSetBlendState(dbd);
 }
 
 void CCEGLView::clearRender(ID3D11RenderTargetView* renderTargetView)
@@ -672,13 +774,13 @@ void CCEGLView::clearRender(ID3D11RenderTargetView* renderTargetView)
 	float color[4]={0.f,0.f,0.f,1.f};
 	if ( !renderTargetView )
 	{
-        m_d3dContext->ClearRenderTargetView(m_renderTargetView, color);
+        GetDeviceContext()->ClearRenderTargetView(m_renderTargetView, color);
 	}
 	else
 	{
-		m_d3dContext->ClearRenderTargetView(renderTargetView, color);
+		GetDeviceContext()->ClearRenderTargetView(renderTargetView, color);
 	}
-    m_d3dContext->ClearDepthStencilView(m_depthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+    GetDeviceContext()->ClearDepthStencilView(m_depthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
 }
 
 void CCEGLView::D3DClearColor(float r, float b, float g, float a)
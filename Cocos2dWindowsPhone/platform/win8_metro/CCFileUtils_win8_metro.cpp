@@ -68,6 +68,12 @@ void CCFileUtils::setResourcePath(const char *pszResourcePath)
     strcpy_s(s_pszResourcePath, pszResourcePath);
 }
 
+std::string CCFileUtils::getResourceRootPath()
+{
+    _CheckPath();
+    return s_pszResourcePath;
+}
+
 bool CCFileUtils::isFileExist(const char * resPath)
 {
     _CheckPath();
@@ -225,6 +231,80 @@ unsigned char* CCFileUtils::getFileDataPlatform(const char* pszFileName, const c
 	return pBuffer;
 }
 
+CCMappedFile::CCMappedFile()
+: m_pBytes(NULL)
+, m_uSize(0)
+, m_bMapped(false)
+{
+}
+
+CCMappedFile::~CCMappedFile()
+{
+	if (m_bMapped)
+	{
+		UnmapViewOfFile(m_pBytes);
+	}
+	else
+	{
+		CC_SAFE_DELETE_ARRAY(m_pBytes);
+	}
+}
+
+CCMappedFile* CCFileUtils::mapFile(const char* pszFileName)
+{
+	const char *pszPath = fullPathFromRelativePath(pszFileName);
+	CCMappedFile *pRet = new CCMappedFile();
+
+#if WINAPI_FAMILY != WINAPI_FAMILY_PHONE_APP
+	// Windows Phone 8 has no file mapping for applications; it always takes the buffered path
+	std::wstring path = CCUtf8ToUnicode(pszPath);
+
+	CREATEFILE2_EXTENDED_PARAMETERS extendedParams = {0};
+	extendedParams.dwSize = sizeof(CREATEFILE2_EXTENDED_PARAMETERS);
+	extendedParams.dwFileAttributes = FILE_ATTRIBUTE_NORMAL;
+	extendedParams.dwSecurityQosFlags = SECURITY_ANONYMOUS;
+
+	HANDLE hFile = ::CreateFile2(path.c_str(), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, &extendedParams);
+	if (INVALID_HANDLE_VALUE != hFile)
+	{
+		FILE_STANDARD_INFO fileStandardInfo = { 0 };
+		BOOL result = ::GetFileInformationByHandleEx(hFile, FileStandardInfo, &fileStandardInfo, sizeof(fileStandardInfo));
+
+		// empty files can't be mapped
+		if (result && fileStandardInfo.EndOfFile.HighPart == 0 && fileStandardInfo.EndOfFile.LowPart > 0)
+		{
+			HANDLE hMapping = ::CreateFileMappingFromApp(hFile, NULL, PAGE_READONLY, 0, NULL);
+			if (hMapping)
+			{
+				pRet->m_pBytes = (unsigned char*)::MapViewOfFileFromApp(hMapping, FILE_MAP_READ, 0, 0);
+				if (pRet->m_pBytes)
+				{
+					pRet->m_uSize = fileStandardInfo.EndOfFile.LowPart;
+					pRet->m_bMapped = true;
+				}
+				// the view keeps the mapping alive
+				CloseHandle(hMapping);
+			}
+		}
+		CloseHandle(hFile);
+	}
+#endif
+
+	if (! pRet->m_bMapped)
+	{
+		unsigned long nSize = 0;
+		pRet->m_pBytes = getFileDataPlatform(pszPath, "rb", &nSize);
+		pRet->m_uSize = nSize;
+		if (! pRet->m_pBytes)
+		{
+			pRet->release();
+			return NULL;
+		}
+	}
+
+	return pRet;
+}
+
 void CCFileUtils::setResource(const char* pszZipFileName)
 {
     CC_UNUSED_PARAM(pszZipFileName);
@@ -21,6 +21,7 @@
 #include "CCImage.h"
 
 #include "DirectXRender.h"
+#include "CCRenderPipeline.h"
 
 
 NS_CC_BEGIN;
@@ -45,6 +46,10 @@ bool CCImage::initWithString(
 	do{
 		CC_BREAK_IF(! pText);  
 
+#if WINAPI_FAMILY != WINAPI_FAMILY_PHONE_APP
+		// Direct2D draws the text with the immediate context
+		CCRenderPipeline::sharedRenderPipeline()->sync();
+#endif
 		TextPainter^ painter = DirectXRender::SharedDXRender()->m_textPainter;
 
 		std::wstring wStrFontName = CCUtf8ToUnicode(pFontName);
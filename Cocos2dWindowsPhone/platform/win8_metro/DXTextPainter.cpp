@@ -18,6 +18,7 @@
 
 #include "pch.h"
 #include "DXTextPainter.h"
+#include "ccDXStateCache.h"
 
 using namespace Microsoft::WRL;
 using namespace Windows::UI::Core;
@@ -199,6 +200,8 @@ Platform::Array<byte>^  DXTextPainter::DrawTextToImage(Platform::String^ text, W
 	// We ignore the HRESULT returned as we want to application to handle the 
 	// error when it uses Direct2D next.
 	m_d2dContext->EndDraw();
+	// Direct2D changed the state of the Direct3D context behind the state cache
+	cocos2d::ccDXInvalidateStateCache();
 
 	if ( m_d2dTargetBitmap == nullptr)
 	{
@@ -24,6 +24,7 @@
 #include "CCApplication.h"
 
 #include "CCDrawingPrimitives.h"
+#include "CCRenderPipeline.h"
 
 //#include "Classes\HelloWorldScene.h"
 #include "d3d10.h"
@@ -159,6 +160,7 @@ void DirectXRender::CreateDeviceResources()
 	// Note the ordering should be preserved.
 	// Don't forget to declare your application's minimum required feature level in its
 	// description.  All applications are assumed to support 9.1 unless otherwise stated.
+	// Below 9.3, CCShaderCache gives CCDrawNode a pixel shader without antialiasing: fwidth needs 4_0_level_9_3.
 	D3D_FEATURE_LEVEL featureLevels[] = 
 	{
 #if WINAPI_FAMILY == WINAPI_FAMILY_PHONE_APP
@@ -548,6 +550,11 @@ void DirectXRender::Render()
 
 // Method to deliver the final image to the display.
 void DirectXRender::Present()
+{
+	HandlePresentResult(PresentBackBuffer());
+}
+
+HRESULT DirectXRender::PresentBackBuffer()
 {
 	//int r = rand() % 255;
 	//int g = rand() % 255;
@@ -558,8 +565,11 @@ void DirectXRender::Present()
 	// to sleep until the next VSync. This ensures we don't waste any cycles rendering
 	// frames that will never be displayed to the screen.
 	// We 
-	HRESULT hr = m_swapChain->Present(1, 0);
+	return m_swapChain->Present(1, 0);
+}
 
+void DirectXRender::HandlePresentResult(HRESULT hr)
+{
 	// If the device was removed either by a disconnect or a driver upgrade, we 
 	// must completely reinitialize the renderer.
 	if (hr == DXGI_ERROR_DEVICE_REMOVED || hr == DXGI_ERROR_DEVICE_RESET)
@@ -660,8 +670,13 @@ void DirectXRender::OnWindowSizeChanged(
 	_In_ WindowSizeChangedEventArgs^ args
 	)
 {
+	// the swap chain can't be resized while a frame or a deferred context refers to its buffers
+	cocos2d::CCRenderPipeline *pPipeline = cocos2d::CCRenderPipeline::sharedRenderPipeline();
+	bool bPipelined = pPipeline->isEnabled();
+	pPipeline->setEnabled(false);
 	UpdateForWindowSizeChange();
 	cocos2d::CCEGLView::sharedOpenGLView().OnWindowSizeChanged();
+	pPipeline->setEnabled(bPipelined);
 }
 
 void DirectXRender::OnPointerPressed(
@@ -34,7 +34,7 @@ const CHAR DEFAULT_FONT_FILE_A[] = "C:\\windows\\Fonts\\SegoeWP.ttf";
 const WCHAR DEFAULT_FONT_FILE_W[] = L"C:\\windows\\Fonts\\SegoeWP.ttf";
 
 
-FTTextPainter::FTTextPainter() : m_textLibrary(0), m_fontSize(10), m_fontName(ref new Platform::String(DEFAULT_FONT_W))
+FTTextPainter::FTTextPainter() : m_textLibrary(0), m_fontFace(0), m_fontSize(10), m_fontName(ref new Platform::String(DEFAULT_FONT_W))
 {
 	if(0 != FT_Init_FreeType(&m_textLibrary)) m_textLibrary = nullptr;
 	BuildFontsInformation();
@@ -115,16 +115,60 @@ Platform::Array<byte>^ FTTextPainter::DrawTextToImage(Platform::String^ text, Wi
 	return pixelBuffer;
 }
 
+bool FTTextPainter::RenderGlyph(UINT charCode, FT_Bitmap* bitmap, INT* left, INT* top, INT* advance)
+{
+	CC_ASSERT(m_fontFace != nullptr);
+
+	if(0 != FT_Load_Char(m_fontFace, charCode, FT_LOAD_RENDER)) return false;
+
+	FT_GlyphSlot slot = m_fontFace->glyph;
+	*bitmap = slot->bitmap;
+	*left = slot->bitmap_left;
+	*top = slot->bitmap_top;
+	*advance = (INT)(slot->advance.x >> 6);
+
+	return true;
+}
+
+INT FTTextPainter::GetLineHeight()
+{
+	CC_ASSERT(m_fontFace != nullptr);
+	return (INT)(m_fontFace->size->metrics.height >> 6);
+}
+
+INT FTTextPainter::GetAscender()
+{
+	CC_ASSERT(m_fontFace != nullptr);
+	return (INT)(m_fontFace->size->metrics.ascender >> 6);
+}
+
+Platform::String^ FTTextPainter::GetFontName()
+{
+	return m_fontName;
+}
+
 bool FTTextPainter::SetFont(Platform::String^ fontName , UINT nSize)
 {
 	bool bRetVal = true;
 	FT_Error error = 0;
 
+	// the face is already loaded, nothing to do
+	if(m_fontFace != nullptr && (nSize == 0 || nSize == m_fontSize) && m_fontName->Equals(fontName))
+	{
+		return true;
+	}
+
 	if(nSize > 0 && nSize != m_fontSize)
 	{
 		m_fontSize = nSize;
 	}
 
+	if(m_fontFace != nullptr)
+	{
+		FT_Done_Face(m_fontFace);
+		m_fontFace = nullptr;
+	}
+
 	// check if we have ttf file for requested font
 	FONTS_MAP_CITR itr = m_fontMap.find(fontName);
 
@@ -0,0 +1,12 @@
+struct PixelInputType
+{
+	float4 vertices : SV_POSITION;
+	float4 color : COLOR;
+	float2 texCoords : TEXCOORD0;
+};
+
+float4 main( PixelInputType input ) : SV_TARGET
+{
+	// Feature levels 9_1 and 9_2 have no fwidth: the dots, segments and polygon borders are cut at the edge, without antialiasing.
+	return input.color * step(length(input.texCoords), 1.0f);
+}
@@ -0,0 +1,13 @@
+struct PixelInputType
+{
+	float4 vertices : SV_POSITION;
+	float4 color : COLOR;
+	float2 texCoords : TEXCOORD0;
+};
+
+float4 main( PixelInputType input ) : SV_TARGET
+{
+	// Fade out over the last pixel before the edge, which antialiases dots, segments and polygon borders.
+	float distance = length(input.texCoords);
+	return input.color * smoothstep(0.0f, length(fwidth(input.texCoords)), 1.0f - distance);
+}
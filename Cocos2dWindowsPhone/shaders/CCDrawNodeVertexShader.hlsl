@@ -0,0 +1,37 @@
+cbuffer MatrixBuffer
+{
+	matrix viewMatrix;
+	matrix projectionMatrix;
+};
+
+struct VertexInputType
+{
+	float2 vertices : POSITION;
+	float4 color : COLOR;
+	float2 texCoords : TEXCOORD0;
+};
+
+struct PixelInputType
+{
+	float4 vertices : SV_POSITION;
+	float4 color : COLOR;
+	float2 texCoords : TEXCOORD0;
+};
+
+
+PixelInputType main( VertexInputType input )
+{
+    PixelInputType output;
+
+	// Calculate the position of the vertex against the world, view, and projection matrices.
+    output.vertices = mul(float4(input.vertices, 0.0f, 1.0f), viewMatrix);
+    output.vertices = mul(output.vertices, projectionMatrix);
+
+	// The node blends with premultiplied alpha.
+    output.color = float4(input.color.rgb * input.color.a, input.color.a);
+
+	// Distance to the edge of the shape: 0 inside, 1 on the edge.
+    output.texCoords = input.texCoords;
+
+    return output;
+}
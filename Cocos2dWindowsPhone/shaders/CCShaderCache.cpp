@@ -24,28 +24,111 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 THE SOFTWARE.
 ****************************************************************************/
 
+#include "pch.h"
 #include "CCShaderCache.h"
-#include "CCGLProgram.h"
+#include "ccDXStateCache.h"
+#include "CCDirector.h"
+#include "CCEGLView.h"
+#include "CCFileUtils.h"
+#include "BasicLoader.h"
 #include "ccMacros.h"
-#include "ccShaders.h"
+#include <vector>
+
+using namespace DirectX;
 
 NS_CC_BEGIN
 
-enum {
-    kCCShaderType_PositionTextureColor,
-    kCCShaderType_PositionTextureColorAlphaTest,
-    kCCShaderType_PositionColor,
-    kCCShaderType_PositionTexture,
-    kCCShaderType_PositionTexture_uColor,
-    kCCShaderType_PositionTextureA8Color,
-    kCCShaderType_Position_uColor,
-    kCCShaderType_PositionLengthTexureColor,
-    
-    kCCShaderType_MAX,
-};
+// file of the compiled shaders, in the writable path
+#define CC_SHADER_BINARY_CACHE_FILE "shaders.bin"
 
 static CCShaderCache *_sharedShaderCache = 0;
 
+// layouts of the vertices of the default programs
+static const D3D11_INPUT_ELEMENT_DESC s_tPositionColorTextureLayout[] =
+{
+    { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+    { "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+    { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+};
+
+static const D3D11_INPUT_ELEMENT_DESC s_tPosition2DColorTextureLayout[] =
+{
+    { "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+    { "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+    { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+};
+
+static const D3D11_INPUT_ELEMENT_DESC s_tPositionTextureLayout[] =
+{
+    { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+    { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+};
+
+static const D3D11_INPUT_ELEMENT_DESC s_tPositionColorLayout[] =
+{
+    { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+    { "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+};
+
+static const D3D11_INPUT_ELEMENT_DESC s_tDrawNodeLayout[] =
+{
+    { "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, offsetof(ccV2F_C4B_T2F, vertices), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+    { "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, offsetof(ccV2F_C4B_T2F, colors), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+    { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, offsetof(ccV2F_C4B_T2F, texCoords), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+};
+
+// implementation of CCDXProgram
+
+CCDXProgram::CCDXProgram()
+: m_pVertexShader(NULL)
+, m_pPixelShader(NULL)
+, m_pInputLayout(NULL)
+{
+}
+
+CCDXProgram::~CCDXProgram()
+{
+    CCLOGINFO("cocos2d: deallocing CCDXProgram.");
+    CC_SAFE_RELEASE_NULL_DX(m_pInputLayout);
+    CC_SAFE_RELEASE_NULL_DX(m_pPixelShader);
+    CC_SAFE_RELEASE_NULL_DX(m_pVertexShader);
+}
+
+bool CCDXProgram::initWithShaderFiles(const wchar_t *pszVertexShaderFile, const wchar_t *pszPixelShaderFile,
+    const D3D11_INPUT_ELEMENT_DESC *pLayoutDesc, unsigned int uLayoutElements)
+{
+    CCAssert(pszVertexShaderFile && pszPixelShaderFile, "Invalid shader files");
+
+    // BasicLoader takes the layout by a mutable pointer
+    std::vector<D3D11_INPUT_ELEMENT_DESC> layoutDesc(pLayoutDesc, pLayoutDesc + uLayoutElements);
+
+    BasicLoader^ loader = ref new BasicLoader(CCID3D11Device);
+    loader->LoadShader(
+        ref new Platform::String(pszVertexShaderFile),
+        layoutDesc.empty() ? NULL : &layoutDesc[0],
+        uLayoutElements,
+        &m_pVertexShader,
+        &m_pInputLayout
+        );
+
+    loader->LoadShader(
+        ref new Platform::String(pszPixelShaderFile),
+        &m_pPixelShader
+        );
+
+    return m_pVertexShader && m_pPixelShader && m_pInputLayout;
+}
+
+void CCDXProgram::use(void)
+{
+    ccDXSetInputLayout(m_pInputLayout);
+    ccDXSetVertexShader(m_pVertexShader);
+    ccDXSetPixelShader(m_pPixelShader);
+    ccDXCommitStates();
+}
+
+// implementation of CCShaderCache
+
 CCShaderCache* CCShaderCache::sharedShaderCache()
 {
     if (!_sharedShaderCache) {
@@ -65,232 +148,132 @@ void CCShaderCache::purgeSharedShaderCache()
 
 CCShaderCache::CCShaderCache()
 : m_pPrograms(0)
+, m_pMatrixBuffer(0)
 {
+    CCAssert(_sharedShaderCache == NULL, "Attempted to allocate a second instance of a singleton.");
 
+    memset(&m_tView, 0, sizeof(m_tView));
+    memset(&m_tProjection, 0, sizeof(m_tProjection));
 }
 
 CCShaderCache::~CCShaderCache()
 {
     CCLOGINFO("cocos2d deallocing 0x%X", this);
-    m_pPrograms->release();
+    CC_SAFE_RELEASE(m_pPrograms);
+    CC_SAFE_RELEASE_NULL_DX(m_pMatrixBuffer);
 }
 
 bool CCShaderCache::init()
 {
+    D3D11_BUFFER_DESC matrixBufferDesc;
+    ZeroMemory( &matrixBufferDesc, sizeof( D3D11_BUFFER_DESC ) );
+    matrixBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+    matrixBufferDesc.ByteWidth = sizeof(XMFLOAT4X4) * 2;
+    matrixBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+    matrixBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    if (FAILED(CCID3D11Device->CreateBuffer(&matrixBufferDesc, NULL, &m_pMatrixBuffer)))
+    {
+        m_pMatrixBuffer = NULL;
+        return false;
+    }
+
     m_pPrograms = new CCDictionary();
     loadDefaultShaders();
     return true;
 }
 
-void CCShaderCache::loadDefaultShaders()
+void CCShaderCache::loadDefaultProgram(const char *key, const wchar_t *pszVertexShaderFile, const wchar_t *pszPixelShaderFile,
+    const D3D11_INPUT_ELEMENT_DESC *pLayoutDesc, unsigned int uLayoutElements)
 {
-    // Position Texture Color shader
-    CCGLProgram *p = new CCGLProgram();
-    loadDefaultShader(p, kCCShaderType_PositionTextureColor);
-
-    m_pPrograms->setObject(p, kCCShader_PositionTextureColor);
+    CCDXProgram *p = new CCDXProgram();
+    if (p->initWithShaderFiles(pszVertexShaderFile, pszPixelShaderFile, pLayoutDesc, uLayoutElements))
+    {
+        m_pPrograms->setObject(p, key);
+    }
     p->release();
+}
 
-    // Position Texture Color alpha test
-    p = new CCGLProgram();
-    loadDefaultShader(p, kCCShaderType_PositionTextureColorAlphaTest);
+void CCShaderCache::loadDefaultShaders()
+{
+#if CC_ENABLE_SHADER_BINARY_CACHE
+    // the compiled shaders of the last launch, read at once instead of one file per shader
+    std::string binaryCachePath = CCFileUtils::getWriteablePath() + CC_SHADER_BINARY_CACHE_FILE;
+    bool bBinaryCacheLoaded = BasicLoader::loadCachedFileData(binaryCachePath.c_str());
+#endif
 
-    m_pPrograms->setObject(p, kCCShader_PositionTextureColorAlphaTest);
-    p->release();
+    loadDefaultProgram(kCCShader_Sprite, L"CCSpriteVertexShader.cso", L"CCSpritePixelShader.cso",
+        s_tPositionColorTextureLayout, ARRAYSIZE(s_tPositionColorTextureLayout));
 
-    //
-    // Position, Color shader
-    //
-    p = new CCGLProgram();
-    loadDefaultShader(p, kCCShaderType_PositionColor);
+    loadDefaultProgram(kCCShader_TextureAtlas, L"CCTextureAtlasVertexShader.cso", L"CCTextureAtlasPixelShader.cso",
+        s_tPositionColorTextureLayout, ARRAYSIZE(s_tPositionColorTextureLayout));
 
-    m_pPrograms->setObject(p, kCCShader_PositionColor);
-    p->release();
+    loadDefaultProgram(kCCShader_Particle, L"CCParticleVertexShader.cso", L"CCParticlePixelShader.cso",
+        s_tPosition2DColorTextureLayout, ARRAYSIZE(s_tPosition2DColorTextureLayout));
 
-    //
-    // Position Texture shader
-    //
-    p = new CCGLProgram();
-    loadDefaultShader(p, kCCShaderType_PositionTexture);
+    loadDefaultProgram(kCCShader_ProgressTimer, L"CCProgressTimerVertexShader.cso", L"CCProgressTimerPixelShader.cso",
+        s_tPositionColorTextureLayout, ARRAYSIZE(s_tPositionColorTextureLayout));
 
-    m_pPrograms->setObject(p, kCCShader_PositionTexture);
-    p->release();
+    loadDefaultProgram(kCCShader_Grid, L"CCGridVertexShader.cso", L"CCGridPixelShader.cso",
+        s_tPositionTextureLayout, ARRAYSIZE(s_tPositionTextureLayout));
 
-    //
-    // Position, Texture attribs, 1 Color as uniform shader
-    //
-    p = new CCGLProgram();
-    loadDefaultShader(p, kCCShaderType_PositionTexture_uColor);
+    loadDefaultProgram(kCCShader_LayerColor, L"CCLayerColorVertexShader.cso", L"CCLayerColorPixelShader.cso",
+        s_tPositionColorLayout, ARRAYSIZE(s_tPositionColorLayout));
 
-    m_pPrograms->setObject(p ,kCCShader_PositionTexture_uColor);
-    p->release();
+    loadDefaultProgram(kCCShader_Drawing, L"CCDrawingVertexShader.cso", L"CCDrawingPixelShader.cso",
+        s_tPositionColorLayout, ARRAYSIZE(s_tPositionColorLayout));
 
-    //
-    // Position Texture A8 Color shader
-    //
-    p = new CCGLProgram();
-    loadDefaultShader(p, kCCShaderType_PositionTextureA8Color);
-    
-    m_pPrograms->setObject(p, kCCShader_PositionTextureA8Color);
-    p->release();
+    // the antialiasing of CCDrawNode needs fwidth, from ps_4_0_level_9_3 on
+    bool bDerivatives = CCID3D11Device->GetFeatureLevel() >= D3D_FEATURE_LEVEL_9_3;
+    loadDefaultProgram(kCCShader_DrawNode, L"CCDrawNodeVertexShader.cso",
+        bDerivatives ? L"CCDrawNodePixelShader.cso" : L"CCDrawNodeAliasedPixelShader.cso",
+        s_tDrawNodeLayout, ARRAYSIZE(s_tDrawNodeLayout));
 
-    //
-    // Position and 1 color passed as a uniform (to simulate glColor4ub )
-    //
-    p = new CCGLProgram();
-    loadDefaultShader(p, kCCShaderType_Position_uColor);
-    
-    m_pPrograms->setObject(p, kCCShader_Position_uColor);
-    p->release();
-    
-    //
-	// Position, Legth(TexCoords, Color (used by Draw Node basically )
-	//
-    p = new CCGLProgram();
-    loadDefaultShader(p, kCCShaderType_PositionLengthTexureColor);
-    
-    m_pPrograms->setObject(p, kCCShader_PositionLengthTexureColor);
-    p->release();
+#if CC_ENABLE_SHADER_BINARY_CACHE
+    if (! bBinaryCacheLoaded && ! BasicLoader::saveCachedFileData(binaryCachePath.c_str()))
+    {
+        CCLOG("cocos2d: CCShaderCache: can't save the compiled shaders in %s", binaryCachePath.c_str());
+    }
+#endif
 }
 
-void CCShaderCache::reloadDefaultShaders()
+CCDXProgram* CCShaderCache::programForKey(const char* key)
 {
-    // reset all programs and reload them
-    
-    // Position Texture Color shader
-    CCGLProgram *p = programForKey(kCCShader_PositionTextureColor);    
-    p->reset();
-    loadDefaultShader(p, kCCShaderType_PositionTextureColor);
-
-    // Position Texture Color alpha test
-    p = programForKey(kCCShader_PositionTextureColorAlphaTest);
-    p->reset();    
-    loadDefaultShader(p, kCCShaderType_PositionTextureColorAlphaTest);
-    
-    //
-    // Position, Color shader
-    //
-    p = programForKey(kCCShader_PositionColor);
-    p->reset();
-    loadDefaultShader(p, kCCShaderType_PositionColor);
-    
-    //
-    // Position Texture shader
-    //
-    p = programForKey(kCCShader_PositionTexture);
-    p->reset();
-    loadDefaultShader(p, kCCShaderType_PositionTexture);
-    
-    //
-    // Position, Texture attribs, 1 Color as uniform shader
-    //
-    p = programForKey(kCCShader_PositionTexture_uColor);
-    p->reset();
-    loadDefaultShader(p, kCCShaderType_PositionTexture_uColor);
-    
-    //
-    // Position Texture A8 Color shader
-    //
-    p = programForKey(kCCShader_PositionTextureA8Color);
-    p->reset();
-    loadDefaultShader(p, kCCShaderType_PositionTextureA8Color);
-    
-    //
-    // Position and 1 color passed as a uniform (to simulate glColor4ub )
-    //
-    p = programForKey(kCCShader_Position_uColor);
-    p->reset();
-    loadDefaultShader(p, kCCShaderType_Position_uColor);
-    
-    //
-	// Position, Legth(TexCoords, Color (used by Draw Node basically )
-	//
-    p = programForKey(kCCShader_PositionLengthTexureColor);
-    p->reset();
-    loadDefaultShader(p, kCCShaderType_Position_uColor);
+    return (CCDXProgram*)m_pPrograms->objectForKey(key);
 }
 
-void CCShaderCache::loadDefaultShader(CCGLProgram *p, int type)
+void CCShaderCache::addProgram(CCDXProgram* program, const char* key)
 {
-    switch (type) {
-        case kCCShaderType_PositionTextureColor:
-            p->initWithVertexShaderByteArray(ccPositionTextureColor_vert, ccPositionTextureColor_frag);
-            
-            p->addAttribute(kCCAttributeNamePosition, kCCVertexAttrib_Position);
-            p->addAttribute(kCCAttributeNameColor, kCCVertexAttrib_Color);
-            p->addAttribute(kCCAttributeNameTexCoord, kCCVertexAttrib_TexCoords);
-            
-            break;
-        case kCCShaderType_PositionTextureColorAlphaTest:
-            p->initWithVertexShaderByteArray(ccPositionTextureColor_vert, ccPositionTextureColorAlphaTest_frag);
-            
-            p->addAttribute(kCCAttributeNamePosition, kCCVertexAttrib_Position);
-            p->addAttribute(kCCAttributeNameColor, kCCVertexAttrib_Color);
-            p->addAttribute(kCCAttributeNameTexCoord, kCCVertexAttrib_TexCoords);
-
-            break;
-        case kCCShaderType_PositionColor:  
-            p->initWithVertexShaderByteArray(ccPositionColor_vert ,ccPositionColor_frag);
-            
-            p->addAttribute(kCCAttributeNamePosition, kCCVertexAttrib_Position);
-            p->addAttribute(kCCAttributeNameColor, kCCVertexAttrib_Color);
-
-            break;
-        case kCCShaderType_PositionTexture:
-            p->initWithVertexShaderByteArray(ccPositionTexture_vert ,ccPositionTexture_frag);
-            
-            p->addAttribute(kCCAttributeNamePosition, kCCVertexAttrib_Position);
-            p->addAttribute(kCCAttributeNameTexCoord, kCCVertexAttrib_TexCoords);
-
-            break;
-        case kCCShaderType_PositionTexture_uColor:
-            p->initWithVertexShaderByteArray(ccPositionTexture_uColor_vert, ccPositionTexture_uColor_frag);
-            
-            p->addAttribute(kCCAttributeNamePosition, kCCVertexAttrib_Position);
-            p->addAttribute(kCCAttributeNameTexCoord, kCCVertexAttrib_TexCoords);
-
-            break;
-        case kCCShaderType_PositionTextureA8Color:
-            p->initWithVertexShaderByteArray(ccPositionTextureA8Color_vert, ccPositionTextureA8Color_frag);
-            
-            p->addAttribute(kCCAttributeNamePosition, kCCVertexAttrib_Position);
-            p->addAttribute(kCCAttributeNameColor, kCCVertexAttrib_Color);
-            p->addAttribute(kCCAttributeNameTexCoord, kCCVertexAttrib_TexCoords);
-
-            break;
-        case kCCShaderType_Position_uColor:
-            p->initWithVertexShaderByteArray(ccPosition_uColor_vert, ccPosition_uColor_frag);    
-            
-            p->addAttribute("aVertex", kCCVertexAttrib_Position);    
-            
-            break;
-        case kCCShaderType_PositionLengthTexureColor:
-            p->initWithVertexShaderByteArray(ccPositionColorLengthTexture_vert, ccPositionColorLengthTexture_frag);
-            
-            p->addAttribute(kCCAttributeNamePosition, kCCVertexAttrib_Position);
-            p->addAttribute(kCCAttributeNameTexCoord, kCCVertexAttrib_TexCoords);
-            p->addAttribute(kCCAttributeNameColor, kCCVertexAttrib_Color);
-            
-            break;
-        default:
-            CCLOG("cocos2d: %s:%d, error shader type", __FUNCTION__, __LINE__);
-            return;
-    }
-    
-    p->link();
-    p->updateUniforms();
-    
-    CHECK_GL_ERROR_DEBUG();
+    m_pPrograms->setObject(program, key);
 }
 
-CCGLProgram* CCShaderCache::programForKey(const char* key)
+bool CCShaderCache::useMatrixBuffer(CXMMATRIX viewMatrix, CXMMATRIX projectionMatrix)
 {
-    return (CCGLProgram*)m_pPrograms->objectForKey(key);
-}
+    XMFLOAT4X4 view, projection;
+    XMStoreFloat4x4(&view, XMMatrixTranspose(viewMatrix));
+    XMStoreFloat4x4(&projection, XMMatrixTranspose(projectionMatrix));
+
+    if (! ccDXBindVSConstantBuffer(m_pMatrixBuffer)
+        && memcmp(&view, &m_tView, sizeof(view)) == 0
+        && memcmp(&projection, &m_tProjection, sizeof(projection)) == 0)
+    {
+        return true;
+    }
 
-void CCShaderCache::addProgram(CCGLProgram* program, const char* key)
-{
-    m_pPrograms->setObject(program, key);
+    D3D11_MAPPED_SUBRESOURCE mappedResource;
+    if (FAILED(CCID3D11DeviceContext->Map(m_pMatrixBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource)))
+    {
+        // the next call binds the buffer anew, which writes it
+        ccDXInvalidateStateCache();
+        return false;
+    }
+    XMFLOAT4X4 *pMatrices = (XMFLOAT4X4*)mappedResource.pData;
+    pMatrices[0] = view;
+    pMatrices[1] = projection;
+    CCID3D11DeviceContext->Unmap(m_pMatrixBuffer, 0);
+
+    m_tView = view;
+    m_tProjection = projection;
+    return true;
 }
 
 NS_CC_END
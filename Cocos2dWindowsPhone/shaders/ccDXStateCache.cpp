@@ -0,0 +1,423 @@
+/*
+* cocos2d-x   http://www.cocos2d-x.org
+*
+* Copyright (c) 2010-2011 - cocos2d-x community
+*
+* Portions Copyright (c) Microsoft Open Technologies, Inc.
+* All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on an
+* "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and limitations under the License.
+*/
+
+#include "pch.h"
+#include "ccDXStateCache.h"
+#include "CCDirector.h"
+#include "CCEGLView.h"
+#include "ccMacros.h"
+#include <map>
+#include <vector>
+
+NS_CC_BEGIN
+
+static ccDXStateStats s_tStateStats = { 0, 0, 0, 0 };
+
+// BKDR hash of the bytes of a state description
+static unsigned int hashStateDesc(const void *pDesc, size_t uSize)
+{
+    const unsigned char *p = (const unsigned char*)pDesc;
+    unsigned int uHash = 0;
+    for (size_t i = 0; i < uSize; i++)
+    {
+        uHash = uHash * 131 + p[i];
+    }
+    return uHash;
+}
+
+static HRESULT createStateObject(const D3D11_BLEND_DESC *pDesc, ID3D11BlendState **ppState)
+{
+    return CCID3D11Device->CreateBlendState(pDesc, ppState);
+}
+
+static HRESULT createStateObject(const D3D11_DEPTH_STENCIL_DESC *pDesc, ID3D11DepthStencilState **ppState)
+{
+    return CCID3D11Device->CreateDepthStencilState(pDesc, ppState);
+}
+
+// the state objects created so far, found by the hash of their description
+template <class TState, class TDesc>
+class CCDXStateObjects
+{
+public:
+    TState* stateForDesc(const TDesc &tDesc)
+    {
+        std::vector<Entry> &bucket = m_tEntries[hashStateDesc(&tDesc, sizeof(tDesc))];
+        for (typename std::vector<Entry>::iterator it = bucket.begin(); it != bucket.end(); ++it)
+        {
+            if (memcmp(&it->tDesc, &tDesc, sizeof(tDesc)) == 0)
+            {
+                return it->pState;
+            }
+        }
+
+        Entry entry;
+        entry.tDesc = tDesc;
+        entry.pState = NULL;
+        if (FAILED(createStateObject(&tDesc, &entry.pState)))
+        {
+            CCLOG("cocos2d: ccDXStateCache: can't create a state object");
+            return NULL;
+        }
+        bucket.push_back(entry);
+        s_tStateStats.uStateObjects++;
+        return entry.pState;
+    }
+
+    void purge(void)
+    {
+        typename std::map<unsigned int, std::vector<Entry> >::iterator it;
+        for (it = m_tEntries.begin(); it != m_tEntries.end(); ++it)
+        {
+            for (typename std::vector<Entry>::iterator entry = it->second.begin(); entry != it->second.end(); ++entry)
+            {
+                CC_SAFE_RELEASE_NULL_DX(entry->pState);
+            }
+        }
+        m_tEntries.clear();
+    }
+
+private:
+    struct Entry
+    {
+        TDesc tDesc;
+        TState *pState;
+    };
+    std::map<unsigned int, std::vector<Entry> > m_tEntries;
+};
+
+static CCDXStateObjects<ID3D11BlendState, D3D11_BLEND_DESC> s_tBlendStates;
+static CCDXStateObjects<ID3D11DepthStencilState, D3D11_DEPTH_STENCIL_DESC> s_tDepthStencilStates;
+
+// the states requested, which the next draw needs, and their descriptions
+static ID3D11BlendState         *s_pBlendState = NULL;
+static D3D11_BLEND_DESC          s_tBlendDesc;
+static ID3D11DepthStencilState  *s_pDepthStencilState = NULL;
+static D3D11_DEPTH_STENCIL_DESC  s_tDepthStencilDesc;
+static unsigned int              s_uStencilRef = 0;
+
+#if CC_ENABLE_DX_STATE_CACHE
+
+// value of a binding the cache doesn't know: no object is ever bound there
+#define CC_DX_UNKNOWN(__type__) ((__type__*)~(size_t)0)
+
+// context the cached bindings belong to
+static ID3D11DeviceContext      *s_pContext = NULL;
+static ID3D11InputLayout        *s_pInputLayout = CC_DX_UNKNOWN(ID3D11InputLayout);
+static ID3D11VertexShader       *s_pVertexShader = CC_DX_UNKNOWN(ID3D11VertexShader);
+static ID3D11PixelShader        *s_pPixelShader = CC_DX_UNKNOWN(ID3D11PixelShader);
+static ID3D11Buffer             *s_pVertexBuffer = CC_DX_UNKNOWN(ID3D11Buffer);
+static unsigned int              s_uVertexStride = 0;
+static unsigned int              s_uVertexOffset = 0;
+static ID3D11Buffer             *s_pIndexBuffer = CC_DX_UNKNOWN(ID3D11Buffer);
+static DXGI_FORMAT               s_eIndexFormat = DXGI_FORMAT_UNKNOWN;
+static D3D11_PRIMITIVE_TOPOLOGY  s_eTopology = D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED;
+static ID3D11Buffer             *s_pVSConstantBuffer = CC_DX_UNKNOWN(ID3D11Buffer);
+static ID3D11Buffer             *s_pPSConstantBuffer = CC_DX_UNKNOWN(ID3D11Buffer);
+static ID3D11ShaderResourceView *s_pTexture = CC_DX_UNKNOWN(ID3D11ShaderResourceView);
+static ID3D11SamplerState       *s_pSampler = CC_DX_UNKNOWN(ID3D11SamplerState);
+static ID3D11BlendState         *s_pBoundBlendState = CC_DX_UNKNOWN(ID3D11BlendState);
+static ID3D11DepthStencilState  *s_pBoundDepthStencilState = CC_DX_UNKNOWN(ID3D11DepthStencilState);
+static unsigned int              s_uBoundStencilRef = 0;
+
+// the context of CCEGLView, the cache being invalidated when it isn't the one of the cached bindings
+static ID3D11DeviceContext* currentContext(void)
+{
+    ID3D11DeviceContext *pContext = CCID3D11DeviceContext;
+    if (pContext != s_pContext)
+    {
+        ccDXInvalidateStateCache();
+        s_pContext = pContext;
+    }
+    return pContext;
+}
+
+#endif // CC_ENABLE_DX_STATE_CACHE
+
+void ccDXInvalidateStateCache(void)
+{
+#if CC_ENABLE_DX_STATE_CACHE
+    s_pContext = NULL;
+    s_pInputLayout = CC_DX_UNKNOWN(ID3D11InputLayout);
+    s_pVertexShader = CC_DX_UNKNOWN(ID3D11VertexShader);
+    s_pPixelShader = CC_DX_UNKNOWN(ID3D11PixelShader);
+    s_pVertexBuffer = CC_DX_UNKNOWN(ID3D11Buffer);
+    s_uVertexStride = 0;
+    s_uVertexOffset = 0;
+    s_pIndexBuffer = CC_DX_UNKNOWN(ID3D11Buffer);
+    s_eIndexFormat = DXGI_FORMAT_UNKNOWN;
+    s_eTopology = D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED;
+    s_pVSConstantBuffer = CC_DX_UNKNOWN(ID3D11Buffer);
+    s_pPSConstantBuffer = CC_DX_UNKNOWN(ID3D11Buffer);
+    s_pTexture = CC_DX_UNKNOWN(ID3D11ShaderResourceView);
+    s_pSampler = CC_DX_UNKNOWN(ID3D11SamplerState);
+    // the requested states are kept: the next draw sets them again
+    s_pBoundBlendState = CC_DX_UNKNOWN(ID3D11BlendState);
+    s_pBoundDepthStencilState = CC_DX_UNKNOWN(ID3D11DepthStencilState);
+    s_uBoundStencilRef = 0;
+#endif
+}
+
+void ccDXSetInputLayout(ID3D11InputLayout *pInputLayout)
+{
+#if CC_ENABLE_DX_STATE_CACHE
+    ID3D11DeviceContext *pContext = currentContext();
+    if (pInputLayout != s_pInputLayout)
+    {
+        s_pInputLayout = pInputLayout;
+        pContext->IASetInputLayout(pInputLayout);
+    }
+#else
+    CCID3D11DeviceContext->IASetInputLayout(pInputLayout);
+#endif
+}
+
+void ccDXSetVertexShader(ID3D11VertexShader *pVertexShader)
+{
+#if CC_ENABLE_DX_STATE_CACHE
+    ID3D11DeviceContext *pContext = currentContext();
+    if (pVertexShader != s_pVertexShader)
+    {
+        s_pVertexShader = pVertexShader;
+        pContext->VSSetShader(pVertexShader, NULL, 0);
+    }
+#else
+    CCID3D11DeviceContext->VSSetShader(pVertexShader, NULL, 0);
+#endif
+}
+
+void ccDXSetPixelShader(ID3D11PixelShader *pPixelShader)
+{
+#if CC_ENABLE_DX_STATE_CACHE
+    ID3D11DeviceContext *pContext = currentContext();
+    if (pPixelShader != s_pPixelShader)
+    {
+        s_pPixelShader = pPixelShader;
+        pContext->PSSetShader(pPixelShader, NULL, 0);
+    }
+#else
+    CCID3D11DeviceContext->PSSetShader(pPixelShader, NULL, 0);
+#endif
+}
+
+void ccDXBindVertexBuffer(ID3D11Buffer *pBuffer, unsigned int uStride, unsigned int uOffset)
+{
+#if CC_ENABLE_DX_STATE_CACHE
+    ID3D11DeviceContext *pContext = currentContext();
+    if (pBuffer != s_pVertexBuffer || uStride != s_uVertexStride || uOffset != s_uVertexOffset)
+    {
+        s_pVertexBuffer = pBuffer;
+        s_uVertexStride = uStride;
+        s_uVertexOffset = uOffset;
+        pContext->IASetVertexBuffers(0, 1, &pBuffer, &uStride, &uOffset);
+    }
+#else
+    CCID3D11DeviceContext->IASetVertexBuffers(0, 1, &pBuffer, &uStride, &uOffset);
+#endif
+}
+
+void ccDXBindIndexBuffer(ID3D11Buffer *pBuffer, DXGI_FORMAT eFormat)
+{
+#if CC_ENABLE_DX_STATE_CACHE
+    ID3D11DeviceContext *pContext = currentContext();
+    if (pBuffer != s_pIndexBuffer || eFormat != s_eIndexFormat)
+    {
+        s_pIndexBuffer = pBuffer;
+        s_eIndexFormat = eFormat;
+        pContext->IASetIndexBuffer(pBuffer, eFormat, 0);
+    }
+#else
+    CCID3D11DeviceContext->IASetIndexBuffer(pBuffer, eFormat, 0);
+#endif
+}
+
+void ccDXSetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY eTopology)
+{
+#if CC_ENABLE_DX_STATE_CACHE
+    ID3D11DeviceContext *pContext = currentContext();
+    if (eTopology != s_eTopology)
+    {
+        s_eTopology = eTopology;
+        pContext->IASetPrimitiveTopology(eTopology);
+    }
+#else
+    CCID3D11DeviceContext->IASetPrimitiveTopology(eTopology);
+#endif
+}
+
+bool ccDXBindVSConstantBuffer(ID3D11Buffer *pBuffer)
+{
+#if CC_ENABLE_DX_STATE_CACHE
+    ID3D11DeviceContext *pContext = currentContext();
+    if (pBuffer == s_pVSConstantBuffer)
+    {
+        return false;
+    }
+    s_pVSConstantBuffer = pBuffer;
+    pContext->VSSetConstantBuffers(0, 1, &pBuffer);
+#else
+    CCID3D11DeviceContext->VSSetConstantBuffers(0, 1, &pBuffer);
+#endif
+    return true;
+}
+
+void ccDXBindPSConstantBuffer(ID3D11Buffer *pBuffer)
+{
+#if CC_ENABLE_DX_STATE_CACHE
+    ID3D11DeviceContext *pContext = currentContext();
+    if (pBuffer != s_pPSConstantBuffer)
+    {
+        s_pPSConstantBuffer = pBuffer;
+        pContext->PSSetConstantBuffers(0, 1, &pBuffer);
+    }
+#else
+    CCID3D11DeviceContext->PSSetConstantBuffers(0, 1, &pBuffer);
+#endif
+}
+
+void ccDXBindTexture2D(ID3D11ShaderResourceView *pTexture)
+{
+#if CC_ENABLE_DX_STATE_CACHE
+    ID3D11DeviceContext *pContext = currentContext();
+    if (pTexture != s_pTexture)
+    {
+        s_pTexture = pTexture;
+        pContext->PSSetShaderResources(0, 1, &pTexture);
+    }
+#else
+    CCID3D11DeviceContext->PSSetShaderResources(0, 1, &pTexture);
+#endif
+}
+
+void ccDXBindSampler(ID3D11SamplerState *pSampler)
+{
+#if CC_ENABLE_DX_STATE_CACHE
+    ID3D11DeviceContext *pContext = currentContext();
+    if (pSampler != s_pSampler)
+    {
+        s_pSampler = pSampler;
+        pContext->PSSetSamplers(0, 1, &pSampler);
+    }
+#else
+    CCID3D11DeviceContext->PSSetSamplers(0, 1, &pSampler);
+#endif
+}
+
+void ccDXSetRenderTarget(ID3D11RenderTargetView *pRenderTargetView, ID3D11DepthStencilView *pDepthStencilView)
+{
+#if CC_ENABLE_DX_STATE_CACHE
+    ID3D11DeviceContext *pContext = currentContext();
+    // the runtime unbinds the resources bound both as input and output
+    s_pTexture = CC_DX_UNKNOWN(ID3D11ShaderResourceView);
+    pContext->OMSetRenderTargets(1, &pRenderTargetView, pDepthStencilView);
+#else
+    CCID3D11DeviceContext->OMSetRenderTargets(1, &pRenderTargetView, pDepthStencilView);
+#endif
+}
+
+void ccDXSetBlendState(const D3D11_BLEND_DESC &tDesc)
+{
+    s_tStateStats.uRequests++;
+    if (s_pBlendState && memcmp(&tDesc, &s_tBlendDesc, sizeof(tDesc)) == 0)
+    {
+        return;
+    }
+
+    ID3D11BlendState *pBlendState = s_tBlendStates.stateForDesc(tDesc);
+    if (! pBlendState)
+    {
+        return;
+    }
+    s_pBlendState = pBlendState;
+    s_tBlendDesc = tDesc;
+#if ! CC_ENABLE_DX_STATE_CACHE
+    CCID3D11DeviceContext->OMSetBlendState(s_pBlendState, NULL, 0xffffffff);
+    s_tStateStats.uBlendChanges++;
+#endif
+}
+
+void ccDXSetDepthStencilState(const D3D11_DEPTH_STENCIL_DESC &tDesc, unsigned int uStencilRef)
+{
+    s_tStateStats.uRequests++;
+    if (s_pDepthStencilState && uStencilRef == s_uStencilRef
+        && memcmp(&tDesc, &s_tDepthStencilDesc, sizeof(tDesc)) == 0)
+    {
+        return;
+    }
+
+    ID3D11DepthStencilState *pDepthStencilState = s_tDepthStencilStates.stateForDesc(tDesc);
+    if (! pDepthStencilState)
+    {
+        return;
+    }
+    s_pDepthStencilState = pDepthStencilState;
+    s_tDepthStencilDesc = tDesc;
+    s_uStencilRef = uStencilRef;
+#if ! CC_ENABLE_DX_STATE_CACHE
+    CCID3D11DeviceContext->OMSetDepthStencilState(s_pDepthStencilState, s_uStencilRef);
+    s_tStateStats.uDepthStencilChanges++;
+#endif
+}
+
+void ccDXCommitStates(void)
+{
+#if CC_ENABLE_DX_STATE_CACHE
+    ID3D11DeviceContext *pContext = currentContext();
+    if (s_pBlendState && s_pBlendState != s_pBoundBlendState)
+    {
+        s_pBoundBlendState = s_pBlendState;
+        pContext->OMSetBlendState(s_pBlendState, NULL, 0xffffffff);
+        s_tStateStats.uBlendChanges++;
+    }
+    if (s_pDepthStencilState
+        && (s_pDepthStencilState != s_pBoundDepthStencilState || s_uStencilRef != s_uBoundStencilRef))
+    {
+        s_pBoundDepthStencilState = s_pDepthStencilState;
+        s_uBoundStencilRef = s_uStencilRef;
+        pContext->OMSetDepthStencilState(s_pDepthStencilState, s_uStencilRef);
+        s_tStateStats.uDepthStencilChanges++;
+    }
+#endif
+}
+
+void ccDXPurgeStateObjects(void)
+{
+    s_pBlendState = NULL;
+    s_pDepthStencilState = NULL;
+    s_uStencilRef = 0;
+    ccDXInvalidateStateCache();
+
+    // the contexts keep a reference on the states they still use
+    s_tBlendStates.purge();
+    s_tDepthStencilStates.purge();
+    s_tStateStats.uStateObjects = 0;
+}
+
+const ccDXStateStats& ccDXGetStateStats(void)
+{
+    return s_tStateStats;
+}
+
+void ccDXResetStateStats(void)
+{
+    s_tStateStats.uRequests = 0;
+    s_tStateStats.uBlendChanges = 0;
+    s_tStateStats.uDepthStencilChanges = 0;
+}
+
+NS_CC_END
@@ -37,7 +37,8 @@
 #include "CCDirector.h"
 #include "DirectXHelper.h"
 #include <string.h>
-#include "BasicLoader.h"
+#include "CCShaderCache.h"
+#include "ccDXStateCache.h"
 
 using namespace std;
 using namespace DirectX;
@@ -815,6 +816,7 @@ void CCSprite::draw(void)
 
 	mDXSprite.Render(m_pobTexture,m_sQuad);
 
+	// the default state only reaches the device context if the next draw doesn't request this one again
 	if( newBlend )
 	{
 		CCD3DCLASS->D3DBlendFunc(CC_BLEND_SRC, CC_BLEND_DST);
@@ -841,6 +843,14 @@ void CCSprite::draw(void)
 #endif // CC_SPRITE_DEBUG_DRAW
 }
 
+bool CCSprite::getRenderState(ccRenderState *pState)
+{
+	pState->shader = kCCRenderShaderSprite;
+	pState->texture = m_pobTexture;
+	pState->blendFunc = m_sBlendFunc;
+	return true;
+}
+
 // CCNode overrides
 
 void CCSprite::addChild(CCNode* pChild)
@@ -1272,13 +1282,11 @@ CCTexture2D* CCSprite::getTexture(void)
 
 CCDXSprite::CCDXSprite()
 {
-	m_vertexShader = 0;
-	m_pixelShader = 0;
-	m_layout = 0;
-	m_matrixBuffer = 0;
+	m_pProgram = 0;
 	m_indexBuffer = 0;
 	m_vertexBuffer = 0;
 	m_textureColorBuffer = 0;
+	m_iTextureColor = -1;
 
 	mIsInit = FALSE;
 }
@@ -1292,11 +1300,9 @@ void CCDXSprite::FreeBuffer()
 {
 	CC_SAFE_RELEASE_NULL_DX(m_vertexBuffer);
 	CC_SAFE_RELEASE_NULL_DX(m_indexBuffer);
-	CC_SAFE_RELEASE_NULL_DX(m_matrixBuffer);
 	CC_SAFE_RELEASE_NULL_DX(m_textureColorBuffer);
-	CC_SAFE_RELEASE_NULL_DX(m_layout);
-	CC_SAFE_RELEASE_NULL_DX(m_pixelShader);
-	CC_SAFE_RELEASE_NULL_DX(m_vertexShader);
+	CC_SAFE_RELEASE_NULL(m_pProgram);
+	m_iTextureColor = -1;
 }
 void CCDXSprite::setIsInit(bool isInit)
 {
@@ -1391,12 +1397,12 @@ void CCDXSprite::RenderVertexBuffer(ccV3F_C4B_T2F_Quad quad)
 	offset = 0;
 
 	// Set the vertex buffer to active in the input assembler so it can be rendered.
-	CCID3D11DeviceContext->IASetVertexBuffers(0, 1, &m_vertexBuffer, &stride, &offset);
+	ccDXBindVertexBuffer(m_vertexBuffer, stride, offset);
 
-	CCID3D11DeviceContext->IASetIndexBuffer( m_indexBuffer, DXGI_FORMAT_R16_UINT, 0);
+	ccDXBindIndexBuffer(m_indexBuffer, DXGI_FORMAT_R16_UINT);
 
 	// Set the type of primitive that should be rendered from this vertex buffer, in this case triangles.
-	CCID3D11DeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	ccDXSetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
 	return;
 }
@@ -1404,45 +1410,10 @@ void CCDXSprite::RenderVertexBuffer(ccV3F_C4B_T2F_Quad quad)
 bool CCDXSprite::InitializeShader()
 {
 	HRESULT result;
-	ID3D10Blob* errorMessage;
-	errorMessage = 0;
-
 
-	BasicLoader^ loader = ref new BasicLoader(CCID3D11Device);
-	D3D11_INPUT_ELEMENT_DESC layoutDesc[] = 
-	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
-	};
-
-
-	loader->LoadShader(
-		L"CCSpriteVertexShader.cso",
-		layoutDesc,
-		ARRAYSIZE(layoutDesc),
-		&m_vertexShader,
-		&m_layout
-		);
-
-	loader->LoadShader(
-		L"CCSpritePixelShader.cso",
-		&m_pixelShader
-		);
-
-
-	D3D11_BUFFER_DESC matrixBufferDesc;
-	ZeroMemory( &matrixBufferDesc, sizeof( D3D11_BUFFER_DESC ) );
-	matrixBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
-	matrixBufferDesc.ByteWidth = sizeof(MatrixBufferType);
-	matrixBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	matrixBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-	matrixBufferDesc.MiscFlags = 0;
-	matrixBufferDesc.StructureByteStride = 0;
-
-	// Create the constant buffer pointer so we can access the vertex shader constant buffer from within this class.
-	result = CCID3D11Device->CreateBuffer(&matrixBufferDesc, NULL, &m_matrixBuffer);
-	if(FAILED(result))
+	m_pProgram = CCShaderCache::sharedShaderCache()->programForKey(kCCShader_Sprite);
+	CC_SAFE_RETAIN(m_pProgram);
+	if (! m_pProgram)
 	{
 		return false;
 	}
@@ -1501,31 +1472,26 @@ void CCDXSprite::OutputShaderErrorMessage(ID3D10Blob* errorMessage,WCHAR* shader
 
 bool CCDXSprite::SetShaderParameters( XMMATRIX &viewMatrix, XMMATRIX &projectionMatrix, ID3D11ShaderResourceView* texture)
 {
-	D3D11_MAPPED_SUBRESOURCE mappedResource;
-	unsigned int bufferNumber;
-
-	viewMatrix = XMMatrixTranspose(viewMatrix);
-	projectionMatrix = XMMatrixTranspose(projectionMatrix);
-
-	MatrixBufferType* dataPtr;
-	if(FAILED(CCID3D11DeviceContext->Map(m_matrixBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource))){return false;}
-	dataPtr = (MatrixBufferType*)mappedResource.pData;
-	dataPtr->view = viewMatrix;
-	dataPtr->projection = projectionMatrix;
-	CCID3D11DeviceContext->Unmap(m_matrixBuffer, 0);
-	bufferNumber = 0;
-	CCID3D11DeviceContext->VSSetConstantBuffers(bufferNumber, 1, &m_matrixBuffer);
-
-	TextureColorType tc;
-	ZeroMemory(&tc, sizeof(tc));
-	tc.istexture[0] = (texture ? TRUE : FALSE);
-	CCID3D11DeviceContext->UpdateSubresource(m_textureColorBuffer, 0, 0, &tc, 0, 0);
-	bufferNumber = 0;
-	CCID3D11DeviceContext->PSSetConstantBuffers(bufferNumber, 1, &m_textureColorBuffer);
+	if (! CCShaderCache::sharedShaderCache()->useMatrixBuffer(viewMatrix, projectionMatrix))
+	{
+		return false;
+	}
+
+	// the buffer keeps its content: it is only written when the sprites switch between textured and not
+	int iTextureColor = (texture ? 1 : 0);
+	if (iTextureColor != m_iTextureColor)
+	{
+		TextureColorType tc;
+		ZeroMemory(&tc, sizeof(tc));
+		tc.istexture[0] = (texture ? TRUE : FALSE);
+		CCID3D11DeviceContext->UpdateSubresource(m_textureColorBuffer, 0, 0, &tc, 0, 0);
+		m_iTextureColor = iTextureColor;
+	}
+	ccDXBindPSConstantBuffer(m_textureColorBuffer);
 
 	if ( texture )
 	{
-		CCID3D11DeviceContext->PSSetShaderResources(0, 1, &texture);
+		ccDXBindTexture2D(texture);
 	}
 
 	return true;
@@ -1533,16 +1499,12 @@ bool CCDXSprite::SetShaderParameters( XMMATRIX &viewMatrix, XMMATRIX &projection
 
 void CCDXSprite::RenderShader(CCTexture2D *texture)
 {
-	// Set the vertex input layout.
-	CCID3D11DeviceContext->IASetInputLayout(m_layout);
-
-	// Set the vertex and pixel shaders that will be used to render this triangle.
-	CCID3D11DeviceContext->VSSetShader(m_vertexShader, NULL, 0);
-	CCID3D11DeviceContext->PSSetShader(m_pixelShader, NULL, 0);
+	// Set the vertex input layout and the vertex and pixel shaders that will be used to render this triangle.
+	m_pProgram->use();
 	if ( texture )
 	{
 		// Set the sampler state in the pixel shader.
-		CCID3D11DeviceContext->PSSetSamplers(0, 1, texture->GetSamplerState());
+		ccDXBindSampler(*texture->GetSamplerState());
 	}
 
 	// Render the triangle.
@@ -1562,6 +1524,10 @@ void CCDXSprite::Render(CCTexture2D *texture,ccV3F_C4B_T2F_Quad quad)
 		initVertexBuffer();
 		InitializeShader();
 	}
+	if ( !m_pProgram )
+	{
+		return;
+	}
 	
 	XMMATRIX viewMatrix, projectionMatrix;
 
@@ -1573,7 +1539,10 @@ void CCDXSprite::Render(CCTexture2D *texture,ccV3F_C4B_T2F_Quad quad)
 	RenderVertexBuffer(quad);
 
 	// Set the shader parameters that it will use for rendering.
-	SetShaderParameters(viewMatrix, projectionMatrix, (texture ? texture->getTextureResource() : NULL));
+	if ( !SetShaderParameters(viewMatrix, projectionMatrix, (texture ? texture->getTextureResource() : NULL)) )
+	{
+		return;
+	}
 
 	// Now render the prepared buffers with the shader.
 	RenderShader(texture);
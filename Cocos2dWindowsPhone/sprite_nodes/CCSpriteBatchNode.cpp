@@ -138,7 +138,12 @@ void CCSpriteBatchNode::visit(void)
 
 	transform();
 
-	draw();
+	// the sprites are drawn with the batch node: culling it skips them all
+	if (! (m_bCullingEnabled && isCulled()))
+	{
+		// draw now or when the render queue is flushed
+		CCRenderQueue::sharedRenderQueue()->addCommand(this);
+	}
 
 	if (m_pGrid && m_pGrid->isActive())
 	{
@@ -236,6 +241,14 @@ void CCSpriteBatchNode::removeAllChildrenWithCleanup(bool bCleanup)
 }
 
 // draw
+bool CCSpriteBatchNode::getRenderState(ccRenderState *pState)
+{
+	pState->shader = kCCRenderShaderTextureAtlas;
+	pState->texture = m_pobTextureAtlas->getTexture();
+	pState->blendFunc = m_blendFunc;
+	return true;
+}
+
 void CCSpriteBatchNode::draw(void)
 {
 	CCNode::draw();
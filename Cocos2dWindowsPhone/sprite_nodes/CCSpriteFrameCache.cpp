@@ -32,6 +32,8 @@
 #include "TransformUtils.h"
 #include "CCFileUtils.h"
 #include "CCString.h"
+#include "CCPlistDocument.h"
+#include <vector>
 
 using namespace std;
 
@@ -39,6 +41,83 @@ NS_CC_BEGIN
 
 static CCSpriteFrameCache *pSharedSpriteFrameCache = NULL;
 
+/*
+ Binary sprite sheet (.ccsf), little endian:
+
+     header
+     frame table    frameCount entries
+     alias table    aliasCount entries
+     string pool    zero terminated names; offset 0 is the empty string
+
+ Everything is 4 bytes aligned, so the tables are read in place.
+ */
+#define CC_SPRITE_SHEET_MAGIC   0x46534343  // "CCSF"
+#define CC_SPRITE_SHEET_VERSION 1
+
+typedef struct _ccSpriteSheetHeader
+{
+    unsigned int   magic;
+    unsigned short version;
+    unsigned short reserved;
+    unsigned int   frameCount;
+    unsigned int   aliasCount;
+    unsigned int   stringPoolSize;
+    //! texture file name, relative to the sheet; 0 if the plist had none
+    unsigned int   textureName;
+} ccSpriteSheetHeader;
+
+typedef struct _ccSpriteSheetFrame
+{
+    //! offset of the frame name in the string pool
+    unsigned int name;
+    float        x, y, width, height;
+    float        offsetX, offsetY;
+    float        originalWidth, originalHeight;
+    unsigned int rotated;
+} ccSpriteSheetFrame;
+
+typedef struct _ccSpriteSheetAlias
+{
+    unsigned int name;
+    //! index in the frame table
+    unsigned int frame;
+} ccSpriteSheetAlias;
+
+static bool isBinarySpriteSheet(const char *pszFile)
+{
+    size_t len = pszFile ? strlen(pszFile) : 0;
+    return len > 5 && _stricmp(pszFile + len - 5, ".ccsf") == 0;
+}
+
+/* Checks the header and the table sizes, and returns the string pool; NULL if the data is not a valid sheet. */
+static const char* binarySpriteSheetPool(const unsigned char *pData, unsigned long nSize, const ccSpriteSheetHeader **ppHeader)
+{
+    if (! pData || nSize < sizeof(ccSpriteSheetHeader))
+    {
+        return NULL;
+    }
+
+    const ccSpriteSheetHeader *pHeader = (const ccSpriteSheetHeader*)pData;
+    if (pHeader->magic != CC_SPRITE_SHEET_MAGIC || pHeader->version != CC_SPRITE_SHEET_VERSION)
+    {
+        CCLOG("cocos2d: CCSpriteFrameCache: not a binary sprite sheet, or an unsupported version");
+        return NULL;
+    }
+
+    unsigned long long expected = sizeof(ccSpriteSheetHeader)
+        + (unsigned long long)pHeader->frameCount * sizeof(ccSpriteSheetFrame)
+        + (unsigned long long)pHeader->aliasCount * sizeof(ccSpriteSheetAlias)
+        + pHeader->stringPoolSize;
+    if (expected > nSize || pHeader->stringPoolSize == 0 || pData[expected - 1] != 0)
+    {
+        CCLOG("cocos2d: CCSpriteFrameCache: truncated binary sprite sheet");
+        return NULL;
+    }
+
+    *ppHeader = pHeader;
+    return (const char*)pData + expected - pHeader->stringPoolSize;
+}
+
 CCSpriteFrameCache* CCSpriteFrameCache::sharedSpriteFrameCache(void)
 {
 	if (! pSharedSpriteFrameCache)
@@ -68,7 +147,54 @@ CCSpriteFrameCache::~CCSpriteFrameCache(void)
 	CC_SAFE_RELEASE(m_pSpriteFramesAliases);
 }
 
-void CCSpriteFrameCache::addSpriteFramesWithDictionary(CCDictionary *dictionary, CCTexture2D *pobTexture)
+/*
+ Reads the geometry of a frame of a Zwoptex/TexturePacker plist. Shared by the plist
+ loader and by the binary converter, so both produce the same frames.
+ */
+static void frameFromPlist(const CCPlistValue& frameDict, int format, CCRect *rect, bool *rotated, CCPoint *offset, CCSize *originalSize)
+{
+    *rotated = false;
+
+    if(format == 0) 
+    {
+        float x = frameDict.objectForKey("x").floatValue();
+        float y = frameDict.objectForKey("y").floatValue();
+        float w = frameDict.objectForKey("width").floatValue();
+        float h = frameDict.objectForKey("height").floatValue();
+        float ox = frameDict.objectForKey("offsetX").floatValue();
+        float oy = frameDict.objectForKey("offsetY").floatValue();
+        int ow = abs(frameDict.objectForKey("originalWidth").intValue());
+        int oh = abs(frameDict.objectForKey("originalHeight").intValue());
+
+        *rect = CCRectMake(x, y, w, h);
+        *offset = CCPointMake(ox, oy);
+        *originalSize = CCSizeMake((float)ow, (float)oh);
+    } 
+    else if(format == 1 || format == 2) 
+    {
+        *rect = CCRectFromString(frameDict.objectForKey("frame").getCString());
+
+        if (format == 2)
+        {
+            *rotated = frameDict.objectForKey("rotated").boolValue();
+        }
+
+        *offset = CCPointFromString(frameDict.objectForKey("offset").getCString());
+        *originalSize = CCSizeFromString(frameDict.objectForKey("sourceSize").getCString());
+    } 
+    else if (format == 3)
+    {
+        CCSize spriteSize = CCSizeFromString(frameDict.objectForKey("spriteSize").getCString());
+        CCRect textureRect = CCRectFromString(frameDict.objectForKey("textureRect").getCString());
+
+        *rect = CCRectMake(textureRect.origin.x, textureRect.origin.y, spriteSize.width, spriteSize.height);
+        *rotated = frameDict.objectForKey("textureRotated").boolValue();
+        *offset = CCPointFromString(frameDict.objectForKey("spriteOffset").getCString());
+        *originalSize = CCSizeFromString(frameDict.objectForKey("spriteSourceSize").getCString());
+    }
+}
+
+void CCSpriteFrameCache::addSpriteFramesWithPlist(const CCPlistValue& plist, CCTexture2D *pobTexture)
 {
     /*
     Supported Zwoptex Formats:
@@ -79,115 +205,39 @@ void CCSpriteFrameCache::addSpriteFramesWithDictionary(CCDictionary *dictionary,
     ZWTCoordinatesFormatOptionXML1_2 = 3, // Desktop Version 1.0.2+
     */
 
-    CCDictionary *metadataDict = (CCDictionary*)dictionary->objectForKey("metadata");
-    CCDictionary *framesDict = (CCDictionary*)dictionary->objectForKey("frames");
-    int format = 0;
-
-    // get the format
-    if(metadataDict != NULL) 
-    {
-        format = metadataDict->valueForKey("format")->intValue();
-    }
+    CCPlistValue framesDict = plist.objectForKey("frames");
+    int format = plist.objectForKey("metadata").objectForKey("format").intValue();
 
-    // check the format
-    CCAssert(format >=0 && format <= 3, "format is not supported for CCSpriteFrameCache addSpriteFramesWithDictionary:textureFilename:");
+    CCAssert(format >=0 && format <= 3, "format is not supported for CCSpriteFrameCache addSpriteFramesWithPlist:textureFilename:");
 
-    CCDictElement* pElement = NULL;
-    CCDICT_FOREACH(framesDict, pElement)
+    for (unsigned int i = 0; i < framesDict.count(); ++i)
     {
-        CCDictionary* frameDict = (CCDictionary*)pElement->getObject();
-        std::string spriteFrameName = pElement->getStrKey();
-        CCSpriteFrame* spriteFrame = (CCSpriteFrame*)m_pSpriteFrames->objectForKey(spriteFrameName);
-        if (spriteFrame)
+        CCPlistValue frameDict = framesDict.objectAtIndex(i);
+        std::string spriteFrameName = framesDict.keyAtIndex(i);
+        if (m_pSpriteFrames->objectForKey(spriteFrameName))
         {
             continue;
         }
-        
-        if(format == 0) 
-        {
-            float x = frameDict->valueForKey("x")->floatValue();
-            float y = frameDict->valueForKey("y")->floatValue();
-            float w = frameDict->valueForKey("width")->floatValue();
-            float h = frameDict->valueForKey("height")->floatValue();
-            float ox = frameDict->valueForKey("offsetX")->floatValue();
-            float oy = frameDict->valueForKey("offsetY")->floatValue();
-            int ow = frameDict->valueForKey("originalWidth")->intValue();
-            int oh = frameDict->valueForKey("originalHeight")->intValue();
-            // check ow/oh
-            if(!ow || !oh)
-            {
-                //CCLOGWARN("cocos2d: WARNING: originalWidth/Height not found on the CCSpriteFrame. AnchorPoint won't work as expected. Regenrate the .plist");
-            }
-            // abs ow/oh
-            ow = abs(ow);
-            oh = abs(oh);
-            // create frame
-            spriteFrame = new CCSpriteFrame();
-            spriteFrame->initWithTexture(pobTexture, 
-                                        CCRectMake(x, y, w, h), 
-                                        false,
-                                        CCPointMake(ox, oy),
-                                        CCSizeMake((float)ow, (float)oh)
-                                        );
-        } 
-        else if(format == 1 || format == 2) 
-        {
-            CCRect frame = CCRectFromString(frameDict->valueForKey("frame")->getCString());
-            bool rotated = false;
-
-            // rotation
-            if (format == 2)
-            {
-                rotated = frameDict->valueForKey("rotated")->boolValue();
-            }
 
-            CCPoint offset = CCPointFromString(frameDict->valueForKey("offset")->getCString());
-            CCSize sourceSize = CCSizeFromString(frameDict->valueForKey("sourceSize")->getCString());
-
-            // create frame
-            spriteFrame = new CCSpriteFrame();
-            spriteFrame->initWithTexture(pobTexture, 
-                frame,
-                rotated,
-                offset,
-                sourceSize
-                );
-        } 
-        else if (format == 3)
+        if (format == 3)
         {
-            // get values
-            CCSize spriteSize = CCSizeFromString(frameDict->valueForKey("spriteSize")->getCString());
-            CCPoint spriteOffset = CCPointFromString(frameDict->valueForKey("spriteOffset")->getCString());
-            CCSize spriteSourceSize = CCSizeFromString(frameDict->valueForKey("spriteSourceSize")->getCString());
-            CCRect textureRect = CCRectFromString(frameDict->valueForKey("textureRect")->getCString());
-            bool textureRotated = frameDict->valueForKey("textureRotated")->boolValue();
-
-            // get aliases
-            CCArray* aliases = (CCArray*) (frameDict->objectForKey("aliases"));
+            CCPlistValue aliases = frameDict.objectForKey("aliases");
             CCString * frameKey = new CCString(spriteFrameName);
-
-            CCObject* pObj = NULL;
-            CCARRAY_FOREACH(aliases, pObj)
+            for (unsigned int j = 0; j < aliases.count(); ++j)
             {
-                std::string oneAlias = ((CCString*)pObj)->getCString();
-                if (m_pSpriteFramesAliases->objectForKey(oneAlias.c_str()))
-                {
-                    //CCLOGWARN("cocos2d: WARNING: an alias with name %s already exists", oneAlias.c_str());
-                }
-
-                m_pSpriteFramesAliases->setObject(frameKey, oneAlias.c_str());
+                m_pSpriteFramesAliases->setObject(frameKey, aliases.objectAtIndex(j).getCString());
             }
             frameKey->release();
-            // create frame
-            spriteFrame = new CCSpriteFrame();
-            spriteFrame->initWithTexture(pobTexture,
-                            CCRectMake(textureRect.origin.x, textureRect.origin.y, spriteSize.width, spriteSize.height),
-                            textureRotated,
-                            spriteOffset,
-                            spriteSourceSize);
         }
 
-        // add sprite frame
+        CCRect rect;
+        bool rotated;
+        CCPoint offset;
+        CCSize originalSize;
+        frameFromPlist(frameDict, format, &rect, &rotated, &offset, &originalSize);
+
+        CCSpriteFrame *spriteFrame = new CCSpriteFrame();
+        spriteFrame->initWithTexture(pobTexture, rect, rotated, offset, originalSize);
         m_pSpriteFrames->setObject(spriteFrame, spriteFrameName);
         spriteFrame->release();
     }
@@ -195,12 +245,18 @@ void CCSpriteFrameCache::addSpriteFramesWithDictionary(CCDictionary *dictionary,
 
 void CCSpriteFrameCache::addSpriteFramesWithFile(const char *pszPlist, CCTexture2D *pobTexture)
 {
-	const char *pszPath = CCFileUtils::fullPathFromRelativePath(pszPlist);
-	CCDictionary *dict = CCFileUtils::dictionaryWithContentsOfFileThreadSafe(pszPath);
-
-	addSpriteFramesWithDictionary(dict, pobTexture);
+	if (isBinarySpriteSheet(pszPlist))
+	{
+		addSpriteFramesWithBinaryFile(pszPlist, pobTexture);
+		return;
+	}
 
-	dict->release();
+	const char *pszPath = CCFileUtils::fullPathFromRelativePath(pszPlist);
+	CCPlistDocument document;
+	if (document.initWithContentsOfFile(pszPath))
+	{
+		addSpriteFramesWithPlist(document.getRoot(), pobTexture);
+	}
 }
 
 void CCSpriteFrameCache::addSpriteFramesWithFile(const char* plist, const char* textureFileName)
@@ -220,18 +276,22 @@ void CCSpriteFrameCache::addSpriteFramesWithFile(const char* plist, const char*
 
 void CCSpriteFrameCache::addSpriteFramesWithFile(const char *pszPlist)
 {
-	const char *pszPath = CCFileUtils::fullPathFromRelativePath(pszPlist);
-	CCDictionary *dict = CCFileUtils::dictionaryWithContentsOfFileThreadSafe(pszPath);
-	
-	string texturePath("");
+	if (isBinarySpriteSheet(pszPlist))
+	{
+		addSpriteFramesWithBinaryFile(pszPlist);
+		return;
+	}
 
-	CCDictionary* metadataDict = (CCDictionary*)dict->objectForKey(string("metadata"));
-    if (metadataDict)
+	const char *pszPath = CCFileUtils::fullPathFromRelativePath(pszPlist);
+	CCPlistDocument document;
+	if (! document.initWithContentsOfFile(pszPath))
 	{
-		// try to read  texture file name from meta data
-		texturePath = string(valueForKey("textureFileName", metadataDict));
+		return;
 	}
 
+	// try to read  texture file name from meta data
+	string texturePath(document.getRoot().objectForKey("metadata").objectForKey("textureFileName").getCString());
+
 	if (! texturePath.empty())
 	{
 		// build texture path relative to plist file
@@ -256,14 +316,224 @@ void CCSpriteFrameCache::addSpriteFramesWithFile(const char *pszPlist)
 
 	if (pTexture)
 	{
-        addSpriteFramesWithDictionary(dict, pTexture);
+        addSpriteFramesWithPlist(document.getRoot(), pTexture);
 	}
 	else
 	{
 		CCLOG("cocos2d: CCSpriteFrameCache: Couldn't load texture");
 	}
+}
 
-	dict->release();
+void CCSpriteFrameCache::addSpriteFramesWithBinaryFile(const char *pszFile, CCTexture2D *pobTexture)
+{
+	const char *pszPath = CCFileUtils::fullPathFromRelativePath(pszFile);
+	CCFileData data(pszPath, "rb");
+
+	addSpriteFramesWithBinaryData(data.getBuffer(), data.getSize(), pobTexture);
+}
+
+void CCSpriteFrameCache::addSpriteFramesWithBinaryFile(const char *pszFile)
+{
+	const char *pszPath = CCFileUtils::fullPathFromRelativePath(pszFile);
+	CCFileData data(pszPath, "rb");
+
+	const ccSpriteSheetHeader *pHeader = NULL;
+	const char *pPool = binarySpriteSheetPool(data.getBuffer(), data.getSize(), &pHeader);
+	if (! pPool)
+	{
+		CCLOG("cocos2d: CCSpriteFrameCache: Couldn't load binary sprite sheet %s", pszFile);
+		return;
+	}
+
+	string texturePath("");
+	if (pHeader->textureName < pHeader->stringPoolSize)
+	{
+		texturePath = pPool + pHeader->textureName;
+	}
+
+	if (! texturePath.empty())
+	{
+		// build texture path relative to the sheet
+		texturePath = CCFileUtils::fullPathFromRelativeFile(texturePath.c_str(), pszPath);
+	}
+	else
+	{
+		// build texture path by replacing file extension
+		texturePath = pszPath;
+		texturePath = texturePath.erase(texturePath.find_last_of("."));
+		texturePath = texturePath.append(".png");
+
+		CCLOG("cocos2d: CCSpriteFrameCache: Trying to use file %s as texture", texturePath.c_str());
+	}
+
+	CCTexture2D *pTexture = CCTextureCache::sharedTextureCache()->addImage(texturePath.c_str());
+
+	if (pTexture)
+	{
+		addSpriteFramesWithBinaryData(data.getBuffer(), data.getSize(), pTexture);
+	}
+	else
+	{
+		CCLOG("cocos2d: CCSpriteFrameCache: Couldn't load texture");
+	}
+}
+
+void CCSpriteFrameCache::addSpriteFramesWithBinaryData(const unsigned char *pData, unsigned long nSize, CCTexture2D *pobTexture)
+{
+	const ccSpriteSheetHeader *pHeader = NULL;
+	const char *pPool = binarySpriteSheetPool(pData, nSize, &pHeader);
+	if (! pPool)
+	{
+		return;
+	}
+
+	const ccSpriteSheetFrame *pFrames = (const ccSpriteSheetFrame*)(pHeader + 1);
+	const ccSpriteSheetAlias *pAliases = (const ccSpriteSheetAlias*)(pFrames + pHeader->frameCount);
+	unsigned int uPoolSize = pHeader->stringPoolSize;
+
+	for (unsigned int i = 0; i < pHeader->frameCount; ++i)
+	{
+		const ccSpriteSheetFrame &frame = pFrames[i];
+		if (frame.name >= uPoolSize)
+		{
+			continue;
+		}
+
+		std::string spriteFrameName(pPool + frame.name);
+		if (m_pSpriteFrames->objectForKey(spriteFrameName))
+		{
+			continue;
+		}
+
+		CCSpriteFrame *spriteFrame = new CCSpriteFrame();
+		spriteFrame->initWithTexture(pobTexture,
+			CCRectMake(frame.x, frame.y, frame.width, frame.height),
+			frame.rotated != 0,
+			CCPointMake(frame.offsetX, frame.offsetY),
+			CCSizeMake(frame.originalWidth, frame.originalHeight));
+
+		m_pSpriteFrames->setObject(spriteFrame, spriteFrameName);
+		spriteFrame->release();
+	}
+
+	// aliases of the same frame are contiguous, so they share the key string
+	CCString *frameKey = NULL;
+	unsigned int uKeyFrame = 0;
+	for (unsigned int i = 0; i < pHeader->aliasCount; ++i)
+	{
+		const ccSpriteSheetAlias &alias = pAliases[i];
+		if (alias.name >= uPoolSize || alias.frame >= pHeader->frameCount || pFrames[alias.frame].name >= uPoolSize)
+		{
+			continue;
+		}
+
+		if (! frameKey || uKeyFrame != alias.frame)
+		{
+			CC_SAFE_RELEASE(frameKey);
+			frameKey = new CCString(pPool + pFrames[alias.frame].name);
+			uKeyFrame = alias.frame;
+		}
+
+		m_pSpriteFramesAliases->setObject(frameKey, std::string(pPool + alias.name));
+	}
+	CC_SAFE_RELEASE(frameKey);
+}
+
+bool CCSpriteFrameCache::writeBinarySpriteFramesFile(const char *pszPlist, const char *pszOutFile)
+{
+	const char *pszPath = CCFileUtils::fullPathFromRelativePath(pszPlist);
+	CCPlistDocument document;
+	if (! document.initWithContentsOfFile(pszPath))
+	{
+		CCLOG("cocos2d: CCSpriteFrameCache: Couldn't read %s", pszPlist);
+		return false;
+	}
+
+	CCPlistValue metadataDict = document.getRoot().objectForKey("metadata");
+	CCPlistValue framesDict = document.getRoot().objectForKey("frames");
+	int format = metadataDict.objectForKey("format").intValue();
+
+	CCAssert(format >=0 && format <= 3, "format is not supported for CCSpriteFrameCache writeBinarySpriteFramesFile");
+
+	// offset 0 of the pool is the empty string
+	std::string pool(1, '\0');
+	std::vector<ccSpriteSheetFrame> frames;
+	std::vector<ccSpriteSheetAlias> aliases;
+
+	ccSpriteSheetHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = CC_SPRITE_SHEET_MAGIC;
+	header.version = CC_SPRITE_SHEET_VERSION;
+
+	const char *pszTexture = metadataDict.objectForKey("textureFileName").getCString();
+	if (pszTexture[0])
+	{
+		header.textureName = (unsigned int)pool.size();
+		pool.append(pszTexture, strlen(pszTexture) + 1);
+	}
+
+	for (unsigned int i = 0; i < framesDict.count(); ++i)
+	{
+		CCPlistValue frameDict = framesDict.objectAtIndex(i);
+		std::string spriteFrameName = framesDict.keyAtIndex(i);
+
+		CCRect rect;
+		bool rotated;
+		CCPoint offset;
+		CCSize originalSize;
+		frameFromPlist(frameDict, format, &rect, &rotated, &offset, &originalSize);
+
+		ccSpriteSheetFrame frame;
+		frame.name = (unsigned int)pool.size();
+		frame.x = rect.origin.x;
+		frame.y = rect.origin.y;
+		frame.width = rect.size.width;
+		frame.height = rect.size.height;
+		frame.offsetX = offset.x;
+		frame.offsetY = offset.y;
+		frame.originalWidth = originalSize.width;
+		frame.originalHeight = originalSize.height;
+		frame.rotated = rotated ? 1 : 0;
+		pool.append(spriteFrameName.c_str(), spriteFrameName.size() + 1);
+
+		if (format == 3)
+		{
+			CCPlistValue frameAliases = frameDict.objectForKey("aliases");
+			for (unsigned int j = 0; j < frameAliases.count(); ++j)
+			{
+				const char *pszAlias = frameAliases.objectAtIndex(j).getCString();
+				ccSpriteSheetAlias alias;
+				alias.name = (unsigned int)pool.size();
+				alias.frame = (unsigned int)frames.size();
+				aliases.push_back(alias);
+				pool.append(pszAlias, strlen(pszAlias) + 1);
+			}
+		}
+
+		frames.push_back(frame);
+	}
+
+	// keep the size of the sheet a multiple of 4
+	pool.resize((pool.size() + 3) & ~3, '\0');
+
+	header.frameCount = (unsigned int)frames.size();
+	header.aliasCount = (unsigned int)aliases.size();
+	header.stringPoolSize = (unsigned int)pool.size();
+
+	FILE *fp = fopen(pszOutFile, "wb");
+	if (! fp)
+	{
+		CCLOG("cocos2d: CCSpriteFrameCache: Couldn't write %s", pszOutFile);
+		return false;
+	}
+
+	bool bRet = fwrite(&header, sizeof(header), 1, fp) == 1
+		&& (frames.empty() || fwrite(&frames[0], sizeof(ccSpriteSheetFrame), frames.size(), fp) == frames.size())
+		&& (aliases.empty() || fwrite(&aliases[0], sizeof(ccSpriteSheetAlias), aliases.size(), fp) == aliases.size())
+		&& fwrite(pool.data(), 1, pool.size(), fp) == pool.size();
+	fclose(fp);
+
+	return bRet;
 }
 
 void CCSpriteFrameCache::addSpriteFrame(CCSpriteFrame *pobFrame, const char *pszFrameName)
@@ -337,6 +607,14 @@ void CCSpriteFrameCache::removeSpriteFrameByName(const char *pszName)
 void CCSpriteFrameCache::removeSpriteFramesFromFile(const char* plist)
 {
 	const char* path = CCFileUtils::fullPathFromRelativePath(plist);
+
+	if (isBinarySpriteSheet(plist))
+	{
+		CCFileData data(path, "rb");
+		removeSpriteFramesFromBinaryData(data.getBuffer(), data.getSize());
+		return;
+	}
+
 	CCDictionary* dict = CCFileUtils::dictionaryWithContentsOfFileThreadSafe(path);
 
 	removeSpriteFramesFromDictionary((CCDictionary*)dict);
@@ -361,6 +639,25 @@ void CCSpriteFrameCache::removeSpriteFramesFromDictionary(CCDictionary *dictiona
     m_pSpriteFrames->removeObjectsForKeys(keysToRemove);
 }
 
+void CCSpriteFrameCache::removeSpriteFramesFromBinaryData(const unsigned char *pData, unsigned long nSize)
+{
+	const ccSpriteSheetHeader *pHeader = NULL;
+	const char *pPool = binarySpriteSheetPool(pData, nSize, &pHeader);
+	if (! pPool)
+	{
+		return;
+	}
+
+	const ccSpriteSheetFrame *pFrames = (const ccSpriteSheetFrame*)(pHeader + 1);
+	for (unsigned int i = 0; i < pHeader->frameCount; ++i)
+	{
+		if (pFrames[i].name < pHeader->stringPoolSize)
+		{
+			m_pSpriteFrames->removeObjectForKey(std::string(pPool + pFrames[i].name));
+		}
+	}
+}
+
 void CCSpriteFrameCache::removeSpriteFramesFromTexture(CCTexture2D* texture)
 {
 	//vector<string> keysToRemove;
@@ -0,0 +1,521 @@
+/*
+* cocos2d-x   http://www.cocos2d-x.org
+*
+* Copyright (c) 2010-2011 - cocos2d-x community
+*
+* Portions Copyright (c) Microsoft Open Technologies, Inc.
+* All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on an
+* "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and limitations under the License.
+*/
+
+#include "pch.h"
+
+#include "ccPixelConversion.h"
+#include <math.h>
+
+#if defined(_M_IX86) || defined(_M_X64)
+#define CC_PIXEL_CONVERSION_SSE2 1
+#include <emmintrin.h>
+#elif defined(_M_ARM)
+#define CC_PIXEL_CONVERSION_NEON 1
+#include <arm_neon.h>
+#endif
+
+NS_CC_BEGIN
+
+// RGB sources are expanded to RGBA8888 this many pixels at a time before being converted
+#define CC_PIXEL_CONVERSION_CHUNK 256
+
+static inline unsigned int readPixel32(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+static inline void writePixel16(unsigned char *p, unsigned int v)
+{
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+}
+
+#if CC_PIXEL_CONVERSION_SSE2
+// narrows 2 x 4 lanes of 32 bits holding 16 bit values to 8 lanes of 16 bits
+static inline __m128i pack32To16(__m128i a, __m128i b)
+{
+    a = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+    b = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+    return _mm_packs_epi32(a, b);
+}
+#endif
+
+void ccPremultiplyAlphaRGBA8888(const unsigned char *src, unsigned char *dst, unsigned int count)
+{
+    unsigned int i = 0;
+
+#if CC_PIXEL_CONVERSION_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i alphaMask = _mm_set1_epi32(0xFF000000);
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i p = _mm_loadu_si128((const __m128i*)(src + i * 4));
+        __m128i lo = _mm_unpacklo_epi8(p, zero);
+        __m128i hi = _mm_unpackhi_epi8(p, zero);
+        __m128i alo = _mm_add_epi16(_mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, 0xFF), 0xFF), one);
+        __m128i ahi = _mm_add_epi16(_mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, 0xFF), 0xFF), one);
+        lo = _mm_srli_epi16(_mm_mullo_epi16(lo, alo), 8);
+        hi = _mm_srli_epi16(_mm_mullo_epi16(hi, ahi), 8);
+        __m128i r = _mm_packus_epi16(lo, hi);
+        r = _mm_or_si128(_mm_andnot_si128(alphaMask, r), _mm_and_si128(alphaMask, p));
+        _mm_storeu_si128((__m128i*)(dst + i * 4), r);
+    }
+#elif CC_PIXEL_CONVERSION_NEON
+    for (; i + 8 <= count; i += 8)
+    {
+        uint8x8x4_t p = vld4_u8(src + i * 4);
+        uint16x8_t a = vaddl_u8(p.val[3], vdup_n_u8(1));
+        p.val[0] = vshrn_n_u16(vmulq_u16(vmovl_u8(p.val[0]), a), 8);
+        p.val[1] = vshrn_n_u16(vmulq_u16(vmovl_u8(p.val[1]), a), 8);
+        p.val[2] = vshrn_n_u16(vmulq_u16(vmovl_u8(p.val[2]), a), 8);
+        vst4_u8(dst + i * 4, p);
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        const unsigned char *s = src + i * 4;
+        unsigned char *d = dst + i * 4;
+        unsigned int a = s[3] + 1;
+        d[0] = (unsigned char)((s[0] * a) >> 8);
+        d[1] = (unsigned char)((s[1] * a) >> 8);
+        d[2] = (unsigned char)((s[2] * a) >> 8);
+        d[3] = s[3];
+    }
+}
+
+static void convertRGBA8888ToRGB565(const unsigned char *src, unsigned char *dst, unsigned int count)
+{
+    unsigned int i = 0;
+
+#if CC_PIXEL_CONVERSION_SSE2
+    const __m128i maskR = _mm_set1_epi32(0xF800);
+    const __m128i maskG = _mm_set1_epi32(0x07E0);
+    const __m128i maskB = _mm_set1_epi32(0x001F);
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i p0 = _mm_loadu_si128((const __m128i*)(src + i * 4));
+        __m128i p1 = _mm_loadu_si128((const __m128i*)(src + i * 4 + 16));
+        __m128i v0 = _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_slli_epi32(p0, 8), maskR),
+            _mm_and_si128(_mm_srli_epi32(p0, 5), maskG)), _mm_and_si128(_mm_srli_epi32(p0, 19), maskB));
+        __m128i v1 = _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_slli_epi32(p1, 8), maskR),
+            _mm_and_si128(_mm_srli_epi32(p1, 5), maskG)), _mm_and_si128(_mm_srli_epi32(p1, 19), maskB));
+        _mm_storeu_si128((__m128i*)(dst + i * 2), pack32To16(v0, v1));
+    }
+#elif CC_PIXEL_CONVERSION_NEON
+    for (; i + 8 <= count; i += 8)
+    {
+        uint8x8x4_t p = vld4_u8(src + i * 4);
+        uint16x8_t v = vandq_u16(vshll_n_u8(p.val[0], 8), vdupq_n_u16(0xF800));
+        v = vorrq_u16(v, vandq_u16(vshll_n_u8(p.val[1], 3), vdupq_n_u16(0x07E0)));
+        v = vorrq_u16(v, vmovl_u8(vshr_n_u8(p.val[2], 3)));
+        vst1q_u16((uint16_t*)(dst + i * 2), v);
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        unsigned int p = readPixel32(src + i * 4);
+        writePixel16(dst + i * 2,
+            ((((p >> 0) & 0xFF) >> 3) << 11) |  // R
+            ((((p >> 8) & 0xFF) >> 2) << 5) |   // G
+            ((((p >> 16) & 0xFF) >> 3) << 0));  // B
+    }
+}
+
+static void convertRGBA8888ToRGBA4444(const unsigned char *src, unsigned char *dst, unsigned int count)
+{
+    unsigned int i = 0;
+
+#if CC_PIXEL_CONVERSION_SSE2
+    const __m128i maskR = _mm_set1_epi32(0xF000);
+    const __m128i maskG = _mm_set1_epi32(0x0F00);
+    const __m128i maskB = _mm_set1_epi32(0x00F0);
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i p0 = _mm_loadu_si128((const __m128i*)(src + i * 4));
+        __m128i p1 = _mm_loadu_si128((const __m128i*)(src + i * 4 + 16));
+        __m128i v0 = _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_slli_epi32(p0, 8), maskR), _mm_and_si128(_mm_srli_epi32(p0, 4), maskG)),
+            _mm_or_si128(_mm_and_si128(_mm_srli_epi32(p0, 16), maskB), _mm_srli_epi32(p0, 28)));
+        __m128i v1 = _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_slli_epi32(p1, 8), maskR), _mm_and_si128(_mm_srli_epi32(p1, 4), maskG)),
+            _mm_or_si128(_mm_and_si128(_mm_srli_epi32(p1, 16), maskB), _mm_srli_epi32(p1, 28)));
+        _mm_storeu_si128((__m128i*)(dst + i * 2), pack32To16(v0, v1));
+    }
+#elif CC_PIXEL_CONVERSION_NEON
+    for (; i + 8 <= count; i += 8)
+    {
+        uint8x8x4_t p = vld4_u8(src + i * 4);
+        uint16x8_t v = vandq_u16(vshll_n_u8(p.val[0], 8), vdupq_n_u16(0xF000));
+        v = vorrq_u16(v, vandq_u16(vshll_n_u8(p.val[1], 4), vdupq_n_u16(0x0F00)));
+        v = vorrq_u16(v, vandq_u16(vmovl_u8(p.val[2]), vdupq_n_u16(0x00F0)));
+        v = vorrq_u16(v, vmovl_u8(vshr_n_u8(p.val[3], 4)));
+        vst1q_u16((uint16_t*)(dst + i * 2), v);
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        unsigned int p = readPixel32(src + i * 4);
+        writePixel16(dst + i * 2,
+            ((((p >> 0) & 0xFF) >> 4) << 12) |  // R
+            ((((p >> 8) & 0xFF) >> 4) << 8) |   // G
+            ((((p >> 16) & 0xFF) >> 4) << 4) |  // B
+            ((((p >> 24) & 0xFF) >> 4) << 0));  // A
+    }
+}
+
+static void convertRGBA8888ToRGB5A1(const unsigned char *src, unsigned char *dst, unsigned int count)
+{
+    unsigned int i = 0;
+
+#if CC_PIXEL_CONVERSION_SSE2
+    const __m128i maskR = _mm_set1_epi32(0xF800);
+    const __m128i maskG = _mm_set1_epi32(0x07C0);
+    const __m128i maskB = _mm_set1_epi32(0x003E);
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i p0 = _mm_loadu_si128((const __m128i*)(src + i * 4));
+        __m128i p1 = _mm_loadu_si128((const __m128i*)(src + i * 4 + 16));
+        __m128i v0 = _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_slli_epi32(p0, 8), maskR), _mm_and_si128(_mm_srli_epi32(p0, 5), maskG)),
+            _mm_or_si128(_mm_and_si128(_mm_srli_epi32(p0, 18), maskB), _mm_srli_epi32(p0, 31)));
+        __m128i v1 = _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_slli_epi32(p1, 8), maskR), _mm_and_si128(_mm_srli_epi32(p1, 5), maskG)),
+            _mm_or_si128(_mm_and_si128(_mm_srli_epi32(p1, 18), maskB), _mm_srli_epi32(p1, 31)));
+        _mm_storeu_si128((__m128i*)(dst + i * 2), pack32To16(v0, v1));
+    }
+#elif CC_PIXEL_CONVERSION_NEON
+    for (; i + 8 <= count; i += 8)
+    {
+        uint8x8x4_t p = vld4_u8(src + i * 4);
+        uint16x8_t v = vandq_u16(vshll_n_u8(p.val[0], 8), vdupq_n_u16(0xF800));
+        v = vorrq_u16(v, vandq_u16(vshll_n_u8(p.val[1], 3), vdupq_n_u16(0x07C0)));
+        v = vorrq_u16(v, vandq_u16(vmovl_u8(vshr_n_u8(p.val[2], 2)), vdupq_n_u16(0x003E)));
+        v = vorrq_u16(v, vmovl_u8(vshr_n_u8(p.val[3], 7)));
+        vst1q_u16((uint16_t*)(dst + i * 2), v);
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        unsigned int p = readPixel32(src + i * 4);
+        writePixel16(dst + i * 2,
+            ((((p >> 0) & 0xFF) >> 3) << 11) |  // R
+            ((((p >> 8) & 0xFF) >> 3) << 6) |   // G
+            ((((p >> 16) & 0xFF) >> 3) << 1) |  // B
+            ((((p >> 24) & 0xFF) >> 7) << 0));  // A
+    }
+}
+
+static void convertRGBA8888ToA8(const unsigned char *src, unsigned char *dst, unsigned int count)
+{
+    unsigned int i = 0;
+
+#if CC_PIXEL_CONVERSION_SSE2
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i a0 = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)(src + i * 4)), 24);
+        __m128i a1 = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)(src + i * 4 + 16)), 24);
+        __m128i a2 = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)(src + i * 4 + 32)), 24);
+        __m128i a3 = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)(src + i * 4 + 48)), 24);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(_mm_packs_epi32(a0, a1), _mm_packs_epi32(a2, a3)));
+    }
+#elif CC_PIXEL_CONVERSION_NEON
+    for (; i + 8 <= count; i += 8)
+    {
+        uint8x8x4_t p = vld4_u8(src + i * 4);
+        vst1_u8(dst + i, p.val[3]);
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        dst[i] = src[i * 4 + 3];
+    }
+}
+
+static void convertRGB888ToRGBA8888(const unsigned char *src, unsigned char *dst, unsigned int count)
+{
+    unsigned int i = 0;
+
+#if CC_PIXEL_CONVERSION_NEON
+    for (; i + 8 <= count; i += 8)
+    {
+        uint8x8x3_t rgb = vld3_u8(src + i * 3);
+        uint8x8x4_t p;
+        p.val[0] = rgb.val[0];
+        p.val[1] = rgb.val[1];
+        p.val[2] = rgb.val[2];
+        p.val[3] = vdup_n_u8(0xFF);
+        vst4_u8(dst + i * 4, p);
+    }
+#endif
+
+    // SSE2 has no byte shuffle; whole pixels are written at once instead
+    for (; i < count; ++i)
+    {
+        const unsigned char *s = src + i * 3;
+        unsigned int p = s[0] | (s[1] << 8) | (s[2] << 16) | 0xFF000000;
+        memcpy(dst + i * 4, &p, 4);
+    }
+}
+
+bool ccConvertPixels(const unsigned char *src, unsigned int srcBytesPerPixel, unsigned char *dst,
+                     CCTexture2DPixelFormat format, unsigned int count)
+{
+    if (srcBytesPerPixel == 3)
+    {
+        if (format == kCCTexture2DPixelFormat_RGB888 || format == kCCTexture2DPixelFormat_RGBA8888)
+        {
+            convertRGB888ToRGBA8888(src, dst, count);
+            return true;
+        }
+
+        // the other formats are converted from RGBA8888, a chunk at a time
+        unsigned char rgba[CC_PIXEL_CONVERSION_CHUNK * 4];
+        unsigned int dstBytesPerPixel = format == kCCTexture2DPixelFormat_A8 ? 1 : 2;
+        for (unsigned int i = 0; i < count; i += CC_PIXEL_CONVERSION_CHUNK)
+        {
+            unsigned int n = count - i < CC_PIXEL_CONVERSION_CHUNK ? count - i : CC_PIXEL_CONVERSION_CHUNK;
+            convertRGB888ToRGBA8888(src + i * 3, rgba, n);
+            if (! ccConvertPixels(rgba, 4, dst + i * dstBytesPerPixel, format, n))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    CCAssert(srcBytesPerPixel == 4, "ccConvertPixels: the source must be RGBA8888 or RGB888");
+
+    switch (format)
+    {
+    case kCCTexture2DPixelFormat_RGBA8888:
+    case kCCTexture2DPixelFormat_RGB888:
+        memcpy(dst, src, count * 4);
+        return true;
+    case kCCTexture2DPixelFormat_RGB565:
+        convertRGBA8888ToRGB565(src, dst, count);
+        return true;
+    case kCCTexture2DPixelFormat_RGBA4444:
+        convertRGBA8888ToRGBA4444(src, dst, count);
+        return true;
+    case kCCTexture2DPixelFormat_RGB5A1:
+        convertRGBA8888ToRGB5A1(src, dst, count);
+        return true;
+    case kCCTexture2DPixelFormat_A8:
+        convertRGBA8888ToA8(src, dst, count);
+        return true;
+    default:
+        return false;
+    }
+}
+
+unsigned char* ccConvertImageToTextureData(const unsigned char *src, unsigned int srcBytesPerPixel,
+                                           unsigned int width, unsigned int height,
+                                           CCTexture2DPixelFormat format, unsigned int dstWidth, unsigned int dstHeight)
+{
+    unsigned int dstBytesPerPixel;
+    switch (format)
+    {
+    case kCCTexture2DPixelFormat_RGBA8888:
+    case kCCTexture2DPixelFormat_RGB888:
+        dstBytesPerPixel = 4;
+        break;
+    case kCCTexture2DPixelFormat_RGB565:
+    case kCCTexture2DPixelFormat_RGBA4444:
+    case kCCTexture2DPixelFormat_RGB5A1:
+        dstBytesPerPixel = 2;
+        break;
+    case kCCTexture2DPixelFormat_A8:
+        dstBytesPerPixel = 1;
+        break;
+    default:
+        return NULL;
+    }
+
+    CCAssert(width <= dstWidth && height <= dstHeight, "ccConvertImageToTextureData: the texture is smaller than the image");
+
+    unsigned int dstPitch = dstWidth * dstBytesPerPixel;
+    unsigned int srcPitch = width * srcBytesPerPixel;
+    unsigned int padding = (dstWidth - width) * dstBytesPerPixel;
+    unsigned char *dst = new unsigned char[dstPitch * dstHeight];
+
+    for (unsigned int y = 0; y < height; ++y)
+    {
+        unsigned char *row = dst + y * dstPitch;
+        ccConvertPixels(src + y * srcPitch, srcBytesPerPixel, row, format, width);
+        if (padding)
+        {
+            memset(row + dstPitch - padding, 0, padding);
+        }
+    }
+    if (dstHeight > height)
+    {
+        memset(dst + height * dstPitch, 0, (dstHeight - height) * dstPitch);
+    }
+
+    return dst;
+}
+
+static inline unsigned int average8(unsigned int a, unsigned int b)
+{
+    return (a + b + 1) >> 1;
+}
+
+// averages rows then columns, rounding up each time like _mm_avg_epu8 and vrhaddq_u8 do
+static void downsampleBox(const unsigned char *src, unsigned int width, unsigned int height, unsigned char *dst)
+{
+    unsigned int dstWidth = width > 1 ? width / 2 : 1;
+    unsigned int dstHeight = height > 1 ? height / 2 : 1;
+    unsigned int pitch = width * 4;
+
+    for (unsigned int y = 0; y < dstHeight; ++y)
+    {
+        const unsigned char *row0 = src + (y * 2) * pitch;
+        const unsigned char *row1 = height > 1 ? row0 + pitch : row0;
+        unsigned char *out = dst + y * dstWidth * 4;
+        unsigned int x = 0;
+
+#if CC_PIXEL_CONVERSION_SSE2
+        for (; x * 2 + 8 <= width; x += 4)
+        {
+            __m128i a = _mm_avg_epu8(_mm_loadu_si128((const __m128i*)(row0 + x * 8)), _mm_loadu_si128((const __m128i*)(row1 + x * 8)));
+            __m128i b = _mm_avg_epu8(_mm_loadu_si128((const __m128i*)(row0 + x * 8 + 16)), _mm_loadu_si128((const __m128i*)(row1 + x * 8 + 16)));
+            __m128 even = _mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(2, 0, 2, 0));
+            __m128 odd = _mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(3, 1, 3, 1));
+            _mm_storeu_si128((__m128i*)(out + x * 4), _mm_avg_epu8(_mm_castps_si128(even), _mm_castps_si128(odd)));
+        }
+#elif CC_PIXEL_CONVERSION_NEON
+        for (; x * 2 + 8 <= width; x += 4)
+        {
+            uint8x16_t a = vrhaddq_u8(vld1q_u8(row0 + x * 8), vld1q_u8(row1 + x * 8));
+            uint8x16_t b = vrhaddq_u8(vld1q_u8(row0 + x * 8 + 16), vld1q_u8(row1 + x * 8 + 16));
+            uint32x4x2_t pixels = vuzpq_u32(vreinterpretq_u32_u8(a), vreinterpretq_u32_u8(b));
+            vst1q_u8(out + x * 4, vrhaddq_u8(vreinterpretq_u8_u32(pixels.val[0]), vreinterpretq_u8_u32(pixels.val[1])));
+        }
+#endif
+
+        for (; x < dstWidth; ++x)
+        {
+            unsigned int x0 = x * 2 * 4;
+            unsigned int x1 = width > 1 ? x0 + 4 : x0;
+            for (unsigned int c = 0; c < 4; ++c)
+            {
+                out[x * 4 + c] = (unsigned char)average8(average8(row0[x0 + c], row1[x0 + c]), average8(row0[x1 + c], row1[x1 + c]));
+            }
+        }
+    }
+}
+
+// linear values are kept on 16 bits, and looked up on their top 12 bits to go back to sRGB
+#define CC_GAMMA_LINEAR_BITS 12
+
+static struct ccGammaTables
+{
+    unsigned short toLinear[256];
+    unsigned char  toSRGB[1 << CC_GAMMA_LINEAR_BITS];
+
+    // built when the module loads, so the loader threads never race on them
+    ccGammaTables()
+    {
+        for (int i = 0; i < 256; ++i)
+        {
+            double c = i / 255.0;
+            double l = c <= 0.04045 ? c / 12.92 : pow((c + 0.055) / 1.055, 2.4);
+            toLinear[i] = (unsigned short)(l * 65535.0 + 0.5);
+        }
+        for (int i = 0; i < (1 << CC_GAMMA_LINEAR_BITS); ++i)
+        {
+            double l = (i + 0.5) / (1 << CC_GAMMA_LINEAR_BITS);
+            double c = l <= 0.0031308 ? l * 12.92 : 1.055 * pow(l, 1.0 / 2.4) - 0.055;
+            toSRGB[i] = (unsigned char)(c * 255.0 + 0.5);
+        }
+    }
+} s_gammaTables;
+
+// unpremultiplies, averages in linear space weighted by alpha, then premultiplies again
+static void downsampleGamma(const unsigned char *src, unsigned int width, unsigned int height, unsigned char *dst)
+{
+    unsigned int dstWidth = width > 1 ? width / 2 : 1;
+    unsigned int dstHeight = height > 1 ? height / 2 : 1;
+    unsigned int pitch = width * 4;
+
+    for (unsigned int y = 0; y < dstHeight; ++y)
+    {
+        const unsigned char *row0 = src + (y * 2) * pitch;
+        const unsigned char *row1 = height > 1 ? row0 + pitch : row0;
+        unsigned char *out = dst + y * dstWidth * 4;
+
+        for (unsigned int x = 0; x < dstWidth; ++x)
+        {
+            const unsigned char *texels[4];
+            texels[0] = row0 + x * 8;
+            texels[1] = width > 1 ? texels[0] + 4 : texels[0];
+            texels[2] = row1 + x * 8;
+            texels[3] = width > 1 ? texels[2] + 4 : texels[2];
+
+            unsigned int sum[3] = { 0, 0, 0 };
+            unsigned int sumAlpha = 0;
+            for (unsigned int t = 0; t < 4; ++t)
+            {
+                unsigned int a = texels[t][3];
+                if (a == 0)
+                {
+                    continue;
+                }
+                for (unsigned int c = 0; c < 3; ++c)
+                {
+                    unsigned int straight = (texels[t][c] * 255 + a / 2) / a;
+                    sum[c] += s_gammaTables.toLinear[straight > 255 ? 255 : straight] * a;
+                }
+                sumAlpha += a;
+            }
+
+            unsigned char *d = out + x * 4;
+            if (sumAlpha == 0)
+            {
+                d[0] = d[1] = d[2] = d[3] = 0;
+                continue;
+            }
+
+            unsigned int alpha = (sumAlpha + 2) >> 2;
+            for (unsigned int c = 0; c < 3; ++c)
+            {
+                unsigned int linear = sum[c] / sumAlpha;
+                unsigned int srgb = s_gammaTables.toSRGB[linear >> (16 - CC_GAMMA_LINEAR_BITS)];
+                d[c] = (unsigned char)((srgb * alpha + 127) / 255);
+            }
+            d[3] = (unsigned char)alpha;
+        }
+    }
+}
+
+void ccDownsampleRGBA8888(const unsigned char *src, unsigned int width, unsigned int height,
+                          unsigned char *dst, bool gammaCorrect)
+{
+    if (gammaCorrect)
+    {
+        downsampleGamma(src, width, height, dst);
+    }
+    else
+    {
+        downsampleBox(src, width, height, dst);
+    }
+}
+
+NS_CC_END
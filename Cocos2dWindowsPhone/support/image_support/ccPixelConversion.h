@@ -0,0 +1,64 @@
+/*
+* cocos2d-x   http://www.cocos2d-x.org
+*
+* Copyright (c) 2010-2011 - cocos2d-x community
+*
+* Portions Copyright (c) Microsoft Open Technologies, Inc.
+* All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on an
+* "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and limitations under the License.
+*/
+
+#ifndef __SUPPORT_IMAGE_SUPPORT_PIXEL_CONVERSION_H__
+#define __SUPPORT_IMAGE_SUPPORT_PIXEL_CONVERSION_H__
+
+#include "CCTexture2D.h"
+
+/** @file ccPixelConversion.h
+Pixel format conversions used to prepare texture data.
+
+The kernels use SSE2 on x86 and x64 and NEON on ARM, with a scalar loop for the
+remaining pixels; every path gives the same bits as the scalar one.
+16 bit formats are packed with red in the high bits, as CCTexture2D always did.
+*/
+
+NS_CC_BEGIN
+
+/** Premultiplies count RGBA8888 pixels by their alpha, as c * (a + 1) >> 8.
+ src and dst may be the same buffer.
+ */
+void ccPremultiplyAlphaRGBA8888(const unsigned char *src, unsigned char *dst, unsigned int count);
+
+/** Converts count pixels of 4 (RGBA8888) or 3 (RGB888) bytes to a texture format.
+ kCCTexture2DPixelFormat_RGB888 and RGBA8888 are written 4 bytes per pixel, with an opaque alpha for RGB sources.
+ @return false if the format can't be produced from the source
+ */
+bool ccConvertPixels(const unsigned char *src, unsigned int srcBytesPerPixel, unsigned char *dst,
+                     CCTexture2DPixelFormat format, unsigned int count);
+
+/** Converts a width x height image to a dstWidth x dstHeight texture in one pass, the extra
+ pixels being transparent black.
+ @return the texture data, to be freed with delete[], or NULL if the format isn't supported
+ */
+unsigned char* ccConvertImageToTextureData(const unsigned char *src, unsigned int srcBytesPerPixel,
+                                           unsigned int width, unsigned int height,
+                                           CCTexture2DPixelFormat format, unsigned int dstWidth, unsigned int dstHeight);
+
+/** Halves a width x height premultiplied RGBA8888 image into the next mipmap level, of
+ max(width / 2, 1) x max(height / 2, 1) pixels, with a 2x2 box filter.
+ With gammaCorrect, the colors are averaged in linear space and weighted by their alpha,
+ so that mipmaps of sRGB images don't darken; otherwise the bytes are averaged directly.
+ */
+void ccDownsampleRGBA8888(const unsigned char *src, unsigned int width, unsigned int height,
+                          unsigned char *dst, bool gammaCorrect);
+
+NS_CC_END
+
+#endif // __SUPPORT_IMAGE_SUPPORT_PIXEL_CONVERSION_H__
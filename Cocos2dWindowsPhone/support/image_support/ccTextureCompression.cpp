@@ -0,0 +1,742 @@
+/*
+* cocos2d-x   http://www.cocos2d-x.org
+*
+* Copyright (c) 2010-2011 - cocos2d-x community
+*
+* Portions Copyright (c) Microsoft Open Technologies, Inc.
+* All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on an
+* "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and limitations under the License.
+*/
+
+#include "pch.h"
+
+#include "ccTextureCompression.h"
+#include <string.h>
+
+NS_CC_BEGIN
+
+// block rows coded by a worker at a time
+#define CC_TEXTURE_COMPRESSION_BAND 8
+
+static inline unsigned char clampColor(int c)
+{
+    return (unsigned char)(c < 0 ? 0 : (c > 255 ? 255 : c));
+}
+
+unsigned int ccBlockSizeForPixelFormat(CCTexture2DPixelFormat format)
+{
+    switch (format)
+    {
+    case kCCTexture2DPixelFormat_BC1:
+    case kCCTexture2DPixelFormat_ETC2_RGB:
+    case kCCTexture2DPixelFormat_ETC2_RGB_A1:
+        return 8;
+    case kCCTexture2DPixelFormat_BC3:
+    case kCCTexture2DPixelFormat_ETC2_RGBA:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+unsigned int ccCompressedLevelSize(CCTexture2DPixelFormat format, unsigned int width, unsigned int height)
+{
+    return ((width + 3) / 4) * ((height + 3) / 4) * ccBlockSizeForPixelFormat(format);
+}
+
+//
+// BC1 and BC3: little endian 5:6:5 endpoints and 2 bit indices, row by row;
+// BC3 adds a block of 8 bit alpha endpoints and 3 bit indices.
+//
+
+static inline void expand565(unsigned int c, int *rgb)
+{
+    int r = (c >> 11) & 0x1f;
+    int g = (c >> 5) & 0x3f;
+    int b = c & 0x1f;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+static inline unsigned int pack565(const unsigned char *rgb)
+{
+    return (((rgb[0] * 31 + 127) / 255) << 11) | (((rgb[1] * 63 + 127) / 255) << 5) | ((rgb[2] * 31 + 127) / 255);
+}
+
+// RGBA palette of a color block. BC1 blocks with c0 <= c1 have 3 colors and transparent black.
+static void bcColorPalette(unsigned int c0, unsigned int c1, bool allowThreeColors, unsigned char *palette)
+{
+    int a[3], b[3];
+    expand565(c0, a);
+    expand565(c1, b);
+    bool fourColors = ! allowThreeColors || c0 > c1;
+    for (int i = 0; i < 3; ++i)
+    {
+        palette[i] = (unsigned char)a[i];
+        palette[4 + i] = (unsigned char)b[i];
+        if (fourColors)
+        {
+            palette[8 + i] = (unsigned char)((2 * a[i] + b[i]) / 3);
+            palette[12 + i] = (unsigned char)((a[i] + 2 * b[i]) / 3);
+        }
+        else
+        {
+            palette[8 + i] = (unsigned char)((a[i] + b[i]) / 2);
+            palette[12 + i] = 0;
+        }
+    }
+    palette[3] = palette[7] = palette[11] = 255;
+    palette[15] = fourColors ? 255 : 0;
+}
+
+static void bcAlphaPalette(unsigned int a0, unsigned int a1, unsigned char *palette)
+{
+    palette[0] = (unsigned char)a0;
+    palette[1] = (unsigned char)a1;
+    if (a0 > a1)
+    {
+        for (unsigned int i = 1; i < 7; ++i)
+        {
+            palette[1 + i] = (unsigned char)(((7 - i) * a0 + i * a1) / 7);
+        }
+    }
+    else
+    {
+        for (unsigned int i = 1; i < 5; ++i)
+        {
+            palette[1 + i] = (unsigned char)(((5 - i) * a0 + i * a1) / 5);
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+static void decodeBCColorBlock(const unsigned char *src, bool allowThreeColors, unsigned char *block)
+{
+    unsigned char palette[16];
+    bcColorPalette(src[0] | (src[1] << 8), src[2] | (src[3] << 8), allowThreeColors, palette);
+
+    unsigned int indices = src[4] | (src[5] << 8) | (src[6] << 16) | ((unsigned int)src[7] << 24);
+    for (unsigned int i = 0; i < 16; ++i, indices >>= 2)
+    {
+        memcpy(block + i * 4, palette + (indices & 3) * 4, 4);
+    }
+}
+
+static void decodeBCAlphaBlock(const unsigned char *src, unsigned char *block)
+{
+    unsigned char palette[8];
+    bcAlphaPalette(src[0], src[1], palette);
+
+    unsigned long long indices = 0;
+    for (unsigned int i = 0; i < 6; ++i)
+    {
+        indices |= (unsigned long long)src[2 + i] << (8 * i);
+    }
+    for (unsigned int i = 0; i < 16; ++i, indices >>= 3)
+    {
+        block[i * 4 + 3] = palette[indices & 7];
+    }
+}
+
+static unsigned int nearestColor(const unsigned char *pixel, const unsigned char *palette, unsigned int colors)
+{
+    unsigned int best = 0;
+    int bestDistance = 0x7fffffff;
+    for (unsigned int i = 0; i < colors; ++i)
+    {
+        int dr = pixel[0] - palette[i * 4];
+        int dg = pixel[1] - palette[i * 4 + 1];
+        int db = pixel[2] - palette[i * 4 + 2];
+        int distance = dr * dr + dg * dg + db * db;
+        if (distance < bestDistance)
+        {
+            best = i;
+            bestDistance = distance;
+        }
+    }
+    return best;
+}
+
+// The endpoints are the two colors furthest apart along the principal axis of the block.
+// With allowThreeColors (BC1), pixels under half alpha use the transparent index of the 3 color mode.
+static void encodeBCColorBlock(const unsigned char *block, bool allowThreeColors, unsigned char *dst)
+{
+    bool transparent[16];
+    bool anyTransparent = false;
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    unsigned int count = 0;
+    for (unsigned int i = 0; i < 16; ++i)
+    {
+        transparent[i] = allowThreeColors && block[i * 4 + 3] < 128;
+        if (transparent[i])
+        {
+            anyTransparent = true;
+            continue;
+        }
+        for (unsigned int c = 0; c < 3; ++c)
+        {
+            mean[c] += block[i * 4 + c];
+        }
+        ++count;
+    }
+
+    if (count == 0)
+    {
+        // 3 color mode, every pixel transparent
+        memset(dst, 0, 4);
+        memset(dst + 4, 0xff, 4);
+        return;
+    }
+
+    float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    for (unsigned int c = 0; c < 3; ++c)
+    {
+        mean[c] /= count;
+    }
+    for (unsigned int i = 0; i < 16; ++i)
+    {
+        if (transparent[i])
+        {
+            continue;
+        }
+        float r = block[i * 4] - mean[0];
+        float g = block[i * 4 + 1] - mean[1];
+        float b = block[i * 4 + 2] - mean[2];
+        covariance[0] += r * r;
+        covariance[1] += r * g;
+        covariance[2] += r * b;
+        covariance[3] += g * g;
+        covariance[4] += g * b;
+        covariance[5] += b * b;
+    }
+
+    // a few power iterations are enough to separate the endpoints
+    float axis[3] = { 1.0f, 1.0f, 1.0f };
+    for (unsigned int iteration = 0; iteration < 8; ++iteration)
+    {
+        float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+        float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+        float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+        float m = x < 0 ? -x : x;
+        m = (y < 0 ? -y : y) > m ? (y < 0 ? -y : y) : m;
+        m = (z < 0 ? -z : z) > m ? (z < 0 ? -z : z) : m;
+        if (m == 0.0f)
+        {
+            break;
+        }
+        axis[0] = x / m;
+        axis[1] = y / m;
+        axis[2] = z / m;
+    }
+
+    unsigned int minIndex = 0, maxIndex = 0;
+    float minProjection = 0.0f, maxProjection = 0.0f;
+    bool first = true;
+    for (unsigned int i = 0; i < 16; ++i)
+    {
+        if (transparent[i])
+        {
+            continue;
+        }
+        float projection = block[i * 4] * axis[0] + block[i * 4 + 1] * axis[1] + block[i * 4 + 2] * axis[2];
+        if (first || projection < minProjection)
+        {
+            minProjection = projection;
+            minIndex = i;
+        }
+        if (first || projection > maxProjection)
+        {
+            maxProjection = projection;
+            maxIndex = i;
+        }
+        first = false;
+    }
+
+    unsigned int c0 = pack565(block + maxIndex * 4);
+    unsigned int c1 = pack565(block + minIndex * 4);
+    if (anyTransparent ? c0 > c1 : c0 < c1)
+    {
+        unsigned int c = c0;
+        c0 = c1;
+        c1 = c;
+    }
+
+    unsigned char palette[16];
+    bcColorPalette(c0, c1, allowThreeColors, palette);
+    unsigned int colors = allowThreeColors && c0 <= c1 ? 3 : 4;
+
+    unsigned int indices = 0;
+    for (int i = 15; i >= 0; --i)
+    {
+        unsigned int index = transparent[i] ? 3 : nearestColor(block + i * 4, palette, colors);
+        indices = (indices << 2) | index;
+    }
+
+    dst[0] = (unsigned char)c0;
+    dst[1] = (unsigned char)(c0 >> 8);
+    dst[2] = (unsigned char)c1;
+    dst[3] = (unsigned char)(c1 >> 8);
+    dst[4] = (unsigned char)indices;
+    dst[5] = (unsigned char)(indices >> 8);
+    dst[6] = (unsigned char)(indices >> 16);
+    dst[7] = (unsigned char)(indices >> 24);
+}
+
+static void encodeBCAlphaBlock(const unsigned char *block, unsigned char *dst)
+{
+    unsigned int a0 = 0, a1 = 255;
+    for (unsigned int i = 0; i < 16; ++i)
+    {
+        unsigned int a = block[i * 4 + 3];
+        a0 = a > a0 ? a : a0;
+        a1 = a < a1 ? a : a1;
+    }
+
+    unsigned char palette[8];
+    bcAlphaPalette(a0, a1, palette);
+
+    unsigned long long indices = 0;
+    for (int i = 15; i >= 0; --i)
+    {
+        unsigned int best = 0;
+        int bestDistance = 256;
+        for (unsigned int j = 0; j < 8; ++j)
+        {
+            int distance = block[i * 4 + 3] - palette[j];
+            distance = distance < 0 ? -distance : distance;
+            if (distance < bestDistance)
+            {
+                best = j;
+                bestDistance = distance;
+            }
+        }
+        indices = (indices << 3) | best;
+    }
+
+    dst[0] = (unsigned char)a0;
+    dst[1] = (unsigned char)a1;
+    for (unsigned int i = 0; i < 6; ++i)
+    {
+        dst[2 + i] = (unsigned char)(indices >> (8 * i));
+    }
+}
+
+//
+// ETC2 and EAC: big endian blocks whose indices go down the columns.
+//
+
+static const int s_etcModifiers[8][2] = {
+    { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+};
+
+static const int s_etcDistances[8] = { 3, 6, 11, 16, 23, 32, 41, 64 };
+
+static const int s_eacModifiers[16][8] = {
+    { -3, -6, -9, -15, 2, 5, 8, 14 },
+    { -3, -7, -10, -13, 2, 6, 9, 12 },
+    { -2, -5, -8, -13, 1, 4, 7, 12 },
+    { -2, -4, -6, -13, 1, 3, 5, 12 },
+    { -3, -6, -8, -12, 2, 5, 7, 11 },
+    { -3, -7, -9, -11, 2, 6, 8, 10 },
+    { -4, -7, -8, -11, 3, 6, 7, 10 },
+    { -3, -5, -8, -11, 2, 4, 7, 10 },
+    { -2, -6, -8, -10, 1, 5, 7, 9 },
+    { -2, -5, -8, -10, 1, 4, 7, 9 },
+    { -2, -4, -8, -10, 1, 3, 7, 9 },
+    { -2, -5, -7, -10, 1, 4, 6, 9 },
+    { -3, -4, -7, -10, 2, 3, 6, 9 },
+    { -1, -2, -3, -10, 0, 1, 2, 9 },
+    { -4, -6, -8, -9, 3, 5, 7, 8 },
+    { -3, -5, -7, -9, 2, 4, 6, 8 },
+};
+
+static inline int extend4(int c)
+{
+    return (c << 4) | c;
+}
+
+static inline int extend5(int c)
+{
+    return (c << 3) | (c >> 2);
+}
+
+static inline int signed3(int c)
+{
+    return (c ^ 4) - 4;
+}
+
+static inline void writeETCPixel(unsigned char *block, unsigned int i, int r, int g, int b, int a)
+{
+    // i goes down the columns, the block is stored row by row
+    unsigned char *p = block + (((i & 3) << 2) | (i >> 2)) * 4;
+    p[0] = clampColor(r);
+    p[1] = clampColor(g);
+    p[2] = clampColor(b);
+    p[3] = (unsigned char)a;
+}
+
+// T and H modes: each pixel picks one of four paint colors
+static void decodeETCPaintColors(unsigned int indices, int paint[4][3], bool opaque, unsigned char *block)
+{
+    for (unsigned int i = 0; i < 16; ++i)
+    {
+        unsigned int index = (((indices >> (16 + i)) & 1) << 1) | ((indices >> i) & 1);
+        if (! opaque && index == 2)
+        {
+            writeETCPixel(block, i, 0, 0, 0, 0);
+        }
+        else
+        {
+            writeETCPixel(block, i, paint[index][0], paint[index][1], paint[index][2], 255);
+        }
+    }
+}
+
+// ETC1 compatible modes and the T, H and planar modes of ETC2.
+// With punchThrough (ETC2 RGB A1) the differential bit tells whether the block is opaque.
+static void decodeETC2ColorBlock(const unsigned char *src, bool punchThrough, unsigned char *block)
+{
+    unsigned int indices = ((unsigned int)src[4] << 24) | (src[5] << 16) | (src[6] << 8) | src[7];
+    bool differential = (src[3] & 2) != 0;
+    bool opaque = ! punchThrough || differential;
+    int base[2][3];
+
+    if (! punchThrough && ! differential)
+    {
+        for (unsigned int c = 0; c < 3; ++c)
+        {
+            base[0][c] = extend4(src[c] >> 4);
+            base[1][c] = extend4(src[c] & 0xf);
+        }
+    }
+    else
+    {
+        int r = src[0] >> 3, dr = signed3(src[0] & 7);
+        int g = src[1] >> 3, dg = signed3(src[1] & 7);
+        int b = src[2] >> 3, db = signed3(src[2] & 7);
+
+        if (r + dr < 0 || r + dr > 31)
+        {
+            // T mode
+            int paint[4][3];
+            int c2[3];
+            paint[0][0] = extend4(((src[0] >> 1) & 0xc) | (src[0] & 3));
+            paint[0][1] = extend4(src[1] >> 4);
+            paint[0][2] = extend4(src[1] & 0xf);
+            c2[0] = extend4(src[2] >> 4);
+            c2[1] = extend4(src[2] & 0xf);
+            c2[2] = extend4(src[3] >> 4);
+            int distance = s_etcDistances[((src[3] >> 1) & 6) | (src[3] & 1)];
+            for (unsigned int c = 0; c < 3; ++c)
+            {
+                paint[1][c] = c2[c] + distance;
+                paint[2][c] = c2[c];
+                paint[3][c] = c2[c] - distance;
+            }
+            decodeETCPaintColors(indices, paint, opaque, block);
+            return;
+        }
+
+        if (g + dg < 0 || g + dg > 31)
+        {
+            // H mode
+            int c1[3], c2[3];
+            c1[0] = (src[0] >> 3) & 0xf;
+            c1[1] = ((src[0] & 7) << 1) | ((src[1] >> 4) & 1);
+            c1[2] = (src[1] & 8) | ((src[1] & 3) << 1) | (src[2] >> 7);
+            c2[0] = (src[2] >> 3) & 0xf;
+            c2[1] = ((src[2] & 7) << 1) | (src[3] >> 7);
+            c2[2] = (src[3] >> 3) & 0xf;
+            int v1 = (c1[0] << 8) | (c1[1] << 4) | c1[2];
+            int v2 = (c2[0] << 8) | (c2[1] << 4) | c2[2];
+            int distance = s_etcDistances[(src[3] & 4) | ((src[3] & 1) << 1) | (v1 >= v2 ? 1 : 0)];
+            int paint[4][3];
+            for (unsigned int c = 0; c < 3; ++c)
+            {
+                paint[0][c] = extend4(c1[c]) + distance;
+                paint[1][c] = extend4(c1[c]) - distance;
+                paint[2][c] = extend4(c2[c]) + distance;
+                paint[3][c] = extend4(c2[c]) - distance;
+            }
+            decodeETCPaintColors(indices, paint, opaque, block);
+            return;
+        }
+
+        if (b + db < 0 || b + db > 31)
+        {
+            // planar mode: the colors at (0, 0), (4, 0) and (0, 4) are interpolated, always opaque
+            int ro = (src[0] >> 1) & 0x3f;
+            int go = ((src[0] & 1) << 6) | ((src[1] >> 1) & 0x3f);
+            int bo = ((src[1] & 1) << 5) | (src[2] & 0x18) | ((src[2] & 3) << 1) | (src[3] >> 7);
+            int rh = (((src[3] >> 2) & 0x1f) << 1) | (src[3] & 1);
+            int gh = src[4] >> 1;
+            int bh = ((src[4] & 1) << 5) | (src[5] >> 3);
+            int rv = ((src[5] & 7) << 3) | (src[6] >> 5);
+            int gv = ((src[6] & 0x1f) << 2) | (src[7] >> 6);
+            int bv = src[7] & 0x3f;
+
+            ro = (ro << 2) | (ro >> 4); rh = (rh << 2) | (rh >> 4); rv = (rv << 2) | (rv >> 4);
+            go = (go << 1) | (go >> 6); gh = (gh << 1) | (gh >> 6); gv = (gv << 1) | (gv >> 6);
+            bo = (bo << 2) | (bo >> 4); bh = (bh << 2) | (bh >> 4); bv = (bv << 2) | (bv >> 4);
+
+            for (int y = 0; y < 4; ++y)
+            {
+                for (int x = 0; x < 4; ++x)
+                {
+                    writeETCPixel(block, x * 4 + y,
+                        (x * (rh - ro) + y * (rv - ro) + 4 * ro + 2) >> 2,
+                        (x * (gh - go) + y * (gv - go) + 4 * go + 2) >> 2,
+                        (x * (bh - bo) + y * (bv - bo) + 4 * bo + 2) >> 2,
+                        255);
+                }
+            }
+            return;
+        }
+
+        base[0][0] = extend5(r);
+        base[0][1] = extend5(g);
+        base[0][2] = extend5(b);
+        base[1][0] = extend5(r + dr);
+        base[1][1] = extend5(g + dg);
+        base[1][2] = extend5(b + db);
+    }
+
+    const int *modifiers[2] = { s_etcModifiers[src[3] >> 5], s_etcModifiers[(src[3] >> 2) & 7] };
+    bool flip = (src[3] & 1) != 0;
+    for (unsigned int i = 0; i < 16; ++i)
+    {
+        // 2x4 sub-blocks side by side, or 4x2 ones on top of each other when flipped
+        unsigned int subBlock = flip ? (i & 3) >> 1 : i >> 3;
+        unsigned int index = (((indices >> (16 + i)) & 1) << 1) | ((indices >> i) & 1);
+        if (! opaque && index == 2)
+        {
+            writeETCPixel(block, i, 0, 0, 0, 0);
+            continue;
+        }
+
+        int modifier = ! opaque && index == 0 ? 0 : modifiers[subBlock][index & 1];
+        modifier = index & 2 ? -modifier : modifier;
+        writeETCPixel(block, i, base[subBlock][0] + modifier, base[subBlock][1] + modifier, base[subBlock][2] + modifier, 255);
+    }
+}
+
+static void decodeEACAlphaBlock(const unsigned char *src, unsigned char *block)
+{
+    int base = src[0];
+    int multiplier = src[1] >> 4;
+    const int *modifiers = s_eacModifiers[src[1] & 0xf];
+
+    unsigned long long indices = 0;
+    for (unsigned int i = 2; i < 8; ++i)
+    {
+        indices = (indices << 8) | src[i];
+    }
+    for (unsigned int i = 0; i < 16; ++i)
+    {
+        unsigned int index = (unsigned int)(indices >> (45 - 3 * i)) & 7;
+        block[(((i & 3) << 2) | (i >> 2)) * 4 + 3] = clampColor(base + modifiers[index] * multiplier);
+    }
+}
+
+static void decodeBlock(const unsigned char *src, CCTexture2DPixelFormat format, unsigned char *block)
+{
+    switch (format)
+    {
+    case kCCTexture2DPixelFormat_BC1:
+        decodeBCColorBlock(src, true, block);
+        break;
+    case kCCTexture2DPixelFormat_BC3:
+        decodeBCColorBlock(src + 8, false, block);
+        decodeBCAlphaBlock(src, block);
+        break;
+    case kCCTexture2DPixelFormat_ETC2_RGB:
+        decodeETC2ColorBlock(src, false, block);
+        break;
+    case kCCTexture2DPixelFormat_ETC2_RGB_A1:
+        decodeETC2ColorBlock(src, true, block);
+        break;
+    case kCCTexture2DPixelFormat_ETC2_RGBA:
+        decodeETC2ColorBlock(src + 8, false, block);
+        decodeEACAlphaBlock(src, block);
+        break;
+    default:
+        break;
+    }
+}
+
+//
+// Bands of block rows coded on the thread pool
+//
+
+typedef struct _ccBlockJob
+{
+    const unsigned char    *src;
+    unsigned char          *dst;
+    CCTexture2DPixelFormat  format;
+    unsigned int            width;
+    unsigned int            height;
+    unsigned int            blockSize;
+    unsigned int            blockRows;
+    unsigned int            bandCount;
+    volatile LONG           nextBand;
+    void                  (*codeRows)(struct _ccBlockJob *job, unsigned int firstRow, unsigned int endRow);
+} ccBlockJob;
+
+static void decodeRows(ccBlockJob *job, unsigned int firstRow, unsigned int endRow)
+{
+    unsigned int blocksWide = (job->width + 3) / 4;
+    unsigned char block[64];
+    for (unsigned int by = firstRow; by < endRow; ++by)
+    {
+        const unsigned char *src = job->src + by * blocksWide * job->blockSize;
+        unsigned int rows = job->height - by * 4 < 4 ? job->height - by * 4 : 4;
+        for (unsigned int bx = 0; bx < blocksWide; ++bx, src += job->blockSize)
+        {
+            decodeBlock(src, job->format, block);
+
+            unsigned int columns = job->width - bx * 4 < 4 ? job->width - bx * 4 : 4;
+            for (unsigned int y = 0; y < rows; ++y)
+            {
+                memcpy(job->dst + ((by * 4 + y) * job->width + bx * 4) * 4, block + y * 16, columns * 4);
+            }
+        }
+    }
+}
+
+static void encodeRows(ccBlockJob *job, unsigned int firstRow, unsigned int endRow)
+{
+    unsigned int blocksWide = (job->width + 3) / 4;
+    unsigned char block[64];
+    for (unsigned int by = firstRow; by < endRow; ++by)
+    {
+        unsigned char *dst = job->dst + by * blocksWide * job->blockSize;
+        for (unsigned int bx = 0; bx < blocksWide; ++bx, dst += job->blockSize)
+        {
+            // the pixels past the edges repeat the last row and column
+            for (unsigned int y = 0; y < 4; ++y)
+            {
+                unsigned int py = by * 4 + y < job->height ? by * 4 + y : job->height - 1;
+                for (unsigned int x = 0; x < 4; ++x)
+                {
+                    unsigned int px = bx * 4 + x < job->width ? bx * 4 + x : job->width - 1;
+                    memcpy(block + (y * 4 + x) * 4, job->src + (py * job->width + px) * 4, 4);
+                }
+            }
+
+            if (job->format == kCCTexture2DPixelFormat_BC1)
+            {
+                encodeBCColorBlock(block, true, dst);
+            }
+            else
+            {
+                encodeBCAlphaBlock(block, dst);
+                encodeBCColorBlock(block, false, dst + 8);
+            }
+        }
+    }
+}
+
+// codes bands until there is none left; run by the calling thread and the pool workers
+static void codeBands(ccBlockJob *job)
+{
+    for (;;)
+    {
+        unsigned int band = (unsigned int)InterlockedIncrement(&job->nextBand) - 1;
+        if (band >= job->bandCount)
+        {
+            break;
+        }
+
+        unsigned int firstRow = band * CC_TEXTURE_COMPRESSION_BAND;
+        unsigned int endRow = firstRow + CC_TEXTURE_COMPRESSION_BAND < job->blockRows ? firstRow + CC_TEXTURE_COMPRESSION_BAND : job->blockRows;
+        job->codeRows(job, firstRow, endRow);
+    }
+}
+
+static VOID CALLBACK codeBandsCallback(PTP_CALLBACK_INSTANCE instance, PVOID context, PTP_WORK work)
+{
+    codeBands((ccBlockJob*)context);
+}
+
+static void runBlockJob(ccBlockJob *job)
+{
+    job->blockRows = (job->height + 3) / 4;
+    job->bandCount = (job->blockRows + CC_TEXTURE_COMPRESSION_BAND - 1) / CC_TEXTURE_COMPRESSION_BAND;
+    job->nextBand = 0;
+
+    // one worker per other core; the calling thread takes its share of the bands
+    SYSTEM_INFO info;
+    GetNativeSystemInfo(&info);
+    unsigned int workers = info.dwNumberOfProcessors > 1 ? info.dwNumberOfProcessors - 1 : 0;
+    if (workers > job->bandCount - 1)
+    {
+        workers = job->bandCount > 0 ? job->bandCount - 1 : 0;
+    }
+
+    PTP_WORK work = workers > 0 ? CreateThreadpoolWork(codeBandsCallback, job, NULL) : NULL;
+    for (unsigned int i = 0; work && i < workers; ++i)
+    {
+        SubmitThreadpoolWork(work);
+    }
+
+    codeBands(job);
+
+    if (work)
+    {
+        WaitForThreadpoolWorkCallbacks(work, FALSE);
+        CloseThreadpoolWork(work);
+    }
+}
+
+bool ccDecompressImage(const unsigned char *src, CCTexture2DPixelFormat format,
+                       unsigned int width, unsigned int height, unsigned char *dst)
+{
+    unsigned int blockSize = ccBlockSizeForPixelFormat(format);
+    if (blockSize == 0)
+    {
+        return false;
+    }
+
+    ccBlockJob job;
+    job.src = src;
+    job.dst = dst;
+    job.format = format;
+    job.width = width;
+    job.height = height;
+    job.blockSize = blockSize;
+    job.codeRows = decodeRows;
+    runBlockJob(&job);
+    return true;
+}
+
+bool ccCompressImage(const unsigned char *src, unsigned int width, unsigned int height,
+                     CCTexture2DPixelFormat format, unsigned char *dst)
+{
+    if (format != kCCTexture2DPixelFormat_BC1 && format != kCCTexture2DPixelFormat_BC3)
+    {
+        return false;
+    }
+
+    ccBlockJob job;
+    job.src = src;
+    job.dst = dst;
+    job.format = format;
+    job.width = width;
+    job.height = height;
+    job.blockSize = ccBlockSizeForPixelFormat(format);
+    job.codeRows = encodeRows;
+    runBlockJob(&job);
+    return true;
+}
+
+NS_CC_END
@@ -0,0 +1,58 @@
+/*
+* cocos2d-x   http://www.cocos2d-x.org
+*
+* Copyright (c) 2010-2011 - cocos2d-x community
+*
+* Portions Copyright (c) Microsoft Open Technologies, Inc.
+* All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on an
+* "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and limitations under the License.
+*/
+
+#ifndef __SUPPORT_IMAGE_SUPPORT_TEXTURE_COMPRESSION_H__
+#define __SUPPORT_IMAGE_SUPPORT_TEXTURE_COMPRESSION_H__
+
+#include "CCTexture2D.h"
+
+/** @file ccTextureCompression.h
+Block compressed texture formats: BC1 (DXT1), BC3 (DXT5), ETC2 RGB, ETC2 RGB A1 and ETC2 RGBA (EAC alpha).
+
+Every format codes 4x4 pixel blocks; levels whose sides aren't multiples of 4 are made of whole
+blocks, the extra pixels being ignored. Direct3D samples BC1 and BC3 directly, the ETC2 formats
+have to be decoded to RGBA8888.
+Images are cut in bands of block rows coded in parallel on the Windows thread pool.
+*/
+
+NS_CC_BEGIN
+
+/** Returns the size in bytes of a 4x4 block of format, or 0 if format isn't block compressed */
+unsigned int ccBlockSizeForPixelFormat(CCTexture2DPixelFormat format);
+
+/** Returns the size in bytes of a width x height level of a block compressed format */
+unsigned int ccCompressedLevelSize(CCTexture2DPixelFormat format, unsigned int width, unsigned int height);
+
+/** Decodes a width x height level to RGBA8888, width * height * 4 bytes.
+ Transparent BC1 and ETC2 RGB A1 pixels are transparent black.
+ @return false if format isn't block compressed
+ */
+bool ccDecompressImage(const unsigned char *src, CCTexture2DPixelFormat format,
+                       unsigned int width, unsigned int height, unsigned char *dst);
+
+/** Encodes a width x height RGBA8888 image to kCCTexture2DPixelFormat_BC1 or kCCTexture2DPixelFormat_BC3,
+ into ccCompressedLevelSize(format, width, height) bytes.
+ BC1 keeps one bit of alpha: pixels with an alpha under 128 become transparent black.
+ @return false if format can't be encoded
+ */
+bool ccCompressImage(const unsigned char *src, unsigned int width, unsigned int height,
+                     CCTexture2DPixelFormat format, unsigned char *dst);
+
+NS_CC_END
+
+#endif // __SUPPORT_IMAGE_SUPPORT_TEXTURE_COMPRESSION_H__
@@ -25,6 +25,7 @@
 #include "ZipUtils.h"
 #include "ccMacros.h"
 #include "CCFileUtils.h"
+#include <vector>
 
 namespace cocos2d
 {
@@ -37,6 +38,18 @@ namespace cocos2d
 		/* ret value */
 		int err = Z_OK;
 
+		// a gzip stream ends with its inflated size: use it so the buffer doesn't have to grow.
+		// Only trust it as far as deflate can compress (about 1:1032).
+		if (inLength >= 18 && in[0] == 0x1f && in[1] == 0x8b)
+		{
+			unsigned int gzipSize = in[inLength - 4] | (in[inLength - 3] << 8) | (in[inLength - 2] << 16) | ((unsigned int)in[inLength - 1] << 24);
+			if (gzipSize >= outLenghtHint && gzipSize / 1032 <= inLength)
+			{
+				// one more byte, so inflate sees the end of the stream before running out of room
+				outLenghtHint = gzipSize + 1;
+			}
+		}
+
 		int bufferSize = outLenghtHint;
 		*out = new unsigned char[bufferSize];
 
@@ -76,17 +89,21 @@ namespace cocos2d
 			// not enough memory ?
 			if (err != Z_STREAM_END) 
 			{
-                delete [] *out;
-                *out = new unsigned char[bufferSize * BUFFER_INC_FACTOR];
+                // keep what was inflated so far
+                unsigned char *tmp = new unsigned char[bufferSize * BUFFER_INC_FACTOR];
 
 				/* not enough memory, ouch */
-				if (! *out ) 
+				if (! tmp ) 
 				{
 					CCLOG("cocos2d: ZipUtils: realloc failed");
 					inflateEnd(&d_stream);
 					return Z_MEM_ERROR;
 				}
 
+				memcpy(tmp, *out, bufferSize);
+				delete [] *out;
+				*out = tmp;
+
 				d_stream.next_out = *out + bufferSize;
 				d_stream.avail_out = bufferSize;
 				bufferSize *= BUFFER_INC_FACTOR;
@@ -205,40 +222,237 @@ namespace cocos2d
 		return offset;
 	}
 
+	/*
+	 CCZ version 3: the data is cut in blocks of blockSize bytes, each compressed on its own with zlib,
+	 so the blocks can be inflated in parallel straight into the destination buffer.
+	 After the CCZHeader, all big endian:
+
+	     unsigned int blockSize;
+	     unsigned int blockCount;
+	     unsigned int offsets[blockCount + 1];   // of the compressed blocks, from the end of this table
+	 */
+	#define CCZ_BLOCKS_VERSION 3
+
+	static inline unsigned int cczReadInt(const unsigned char *p)
+	{
+		return ((unsigned int)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+	}
+
+	static inline void cczWriteInt(unsigned char *p, unsigned int value)
+	{
+		p[0] = (unsigned char)(value >> 24);
+		p[1] = (unsigned char)(value >> 16);
+		p[2] = (unsigned char)(value >> 8);
+		p[3] = (unsigned char)value;
+	}
+
+	typedef struct _CCZBlockJob
+	{
+		const unsigned char *blocks;
+		const unsigned char *offsets;
+		unsigned int         blockSize;
+		unsigned int         blockCount;
+		unsigned char       *out;
+		unsigned int         outLength;
+		volatile LONG        nextBlock;
+		volatile LONG        failures;
+	} CCZBlockJob;
+
+	// inflates blocks until there is none left; run by the calling thread and the pool workers
+	static void inflateCCZBlocks(CCZBlockJob *job)
+	{
+		for (;;)
+		{
+			unsigned int i = (unsigned int)InterlockedIncrement(&job->nextBlock) - 1;
+			if (i >= job->blockCount)
+			{
+				break;
+			}
+
+			unsigned int start = cczReadInt(job->offsets + i * 4);
+			unsigned int end = cczReadInt(job->offsets + i * 4 + 4);
+			unsigned int offset = i * job->blockSize;
+			uLongf expected = job->outLength - offset < job->blockSize ? job->outLength - offset : job->blockSize;
+			uLongf destLength = expected;
+
+			if (uncompress(job->out + offset, &destLength, job->blocks + start, end - start) != Z_OK || destLength != expected)
+			{
+				InterlockedIncrement(&job->failures);
+			}
+		}
+	}
+
+	static VOID CALLBACK inflateCCZBlocksCallback(PTP_CALLBACK_INSTANCE instance, PVOID context, PTP_WORK work)
+	{
+		inflateCCZBlocks((CCZBlockJob*)context);
+	}
+
+	// checks the block table before the output is allocated: the blocks must cover outLength exactly
+	static bool checkCCZBlocksTable(const unsigned char *data, unsigned int dataLength, unsigned int outLength)
+	{
+		if (dataLength < 8)
+		{
+			return false;
+		}
+
+		// outLength + blockSize - 1 could overflow: count the blocks without it
+		unsigned int blockSize = cczReadInt(data);
+		unsigned int blockCount = cczReadInt(data + 4);
+		if (blockSize == 0 || blockSize > outLength || blockCount == 0
+			|| blockCount != outLength / blockSize + (outLength % blockSize != 0 ? 1 : 0))
+		{
+			return false;
+		}
+
+		// blockCount + 1 offsets follow the two counts
+		if (blockCount >= (dataLength - 8) / 4)
+		{
+			return false;
+		}
+		unsigned int tableLength = 8 + 4 * (blockCount + 1);
+
+		// the offsets must be ordered and stay inside the file
+		const unsigned char *offsets = data + 8;
+		for (unsigned int i = 0; i < blockCount; ++i)
+		{
+			if (cczReadInt(offsets + i * 4) > cczReadInt(offsets + i * 4 + 4))
+			{
+				return false;
+			}
+		}
+		return cczReadInt(offsets + blockCount * 4) <= dataLength - tableLength;
+	}
+
+	// the table was checked by checkCCZBlocksTable
+	static bool inflateCCZBlocksFile(const unsigned char *data, unsigned char *out, unsigned int outLength)
+	{
+		CCZBlockJob job;
+		job.blockSize = cczReadInt(data);
+		job.blockCount = cczReadInt(data + 4);
+		job.offsets = data + 8;
+		job.blocks = data + 8 + 4 * (job.blockCount + 1);
+		job.out = out;
+		job.outLength = outLength;
+		job.nextBlock = 0;
+		job.failures = 0;
+
+		// one worker per other core; the calling thread takes its share of the blocks
+		SYSTEM_INFO info;
+		GetNativeSystemInfo(&info);
+		unsigned int workers = info.dwNumberOfProcessors > 1 ? info.dwNumberOfProcessors - 1 : 0;
+		if (workers > job.blockCount - 1)
+		{
+			workers = job.blockCount > 0 ? job.blockCount - 1 : 0;
+		}
+
+		PTP_WORK work = workers > 0 ? CreateThreadpoolWork(inflateCCZBlocksCallback, &job, NULL) : NULL;
+		for (unsigned int i = 0; work && i < workers; ++i)
+		{
+			SubmitThreadpoolWork(work);
+		}
+
+		inflateCCZBlocks(&job);
+
+		if (work)
+		{
+			WaitForThreadpoolWorkCallbacks(work, FALSE);
+			CloseThreadpoolWork(work);
+		}
+
+		return job.failures == 0;
+	}
+
+	bool ZipUtils::ccDeflateCCZBlocksFile(const unsigned char *data, unsigned int length, const char *path, unsigned int blockSize)
+	{
+		CCAssert(blockSize > 0, "ZipUtils: the block size can't be 0");
+		if (length == 0)
+		{
+			CCLOG("cocos2d: ZipUtils: Can't write an empty file in blocks");
+			return false;
+		}
+
+		// the reader rejects blocks bigger than the data
+		if (blockSize > length)
+		{
+			blockSize = length;
+		}
+		unsigned int blockCount = length / blockSize + (length % blockSize != 0 ? 1 : 0);
+		std::vector<unsigned char> table(8 + 4 * (blockCount + 1));
+		std::vector<unsigned char> blocks;
+		std::vector<unsigned char> block(compressBound(blockSize));
+
+		cczWriteInt(&table[0], blockSize);
+		cczWriteInt(&table[4], blockCount);
+		cczWriteInt(&table[8], 0);
+		for (unsigned int i = 0; i < blockCount; ++i)
+		{
+			unsigned int offset = i * blockSize;
+			uLongf blockLength = (uLongf)block.size();
+			uLong sourceLength = length - offset < blockSize ? length - offset : blockSize;
+			if (compress2(&block[0], &blockLength, data + offset, sourceLength, Z_BEST_COMPRESSION) != Z_OK)
+			{
+				CCLOG("cocos2d: ZipUtils: Failed to compress block %u", i);
+				return false;
+			}
+			blocks.insert(blocks.end(), block.begin(), block.begin() + blockLength);
+			cczWriteInt(&table[8 + 4 * (i + 1)], (unsigned int)blocks.size());
+		}
+
+		unsigned char header[sizeof(struct CCZHeader)] = { 'C', 'C', 'Z', '!' };
+		header[4] = 0;
+		header[5] = CCZ_COMPRESSION_ZLIB;
+		header[6] = 0;
+		header[7] = CCZ_BLOCKS_VERSION;
+		cczWriteInt(header + 8, 0);
+		cczWriteInt(header + 12, length);
+
+		FILE *fp = fopen(path, "wb");
+		if (! fp)
+		{
+			CCLOG("cocos2d: ZipUtils: Couldn't write %s", path);
+			return false;
+		}
+		bool bRet = fwrite(header, sizeof(header), 1, fp) == 1
+			&& fwrite(&table[0], table.size(), 1, fp) == 1
+			&& (blocks.empty() || fwrite(&blocks[0], blocks.size(), 1, fp) == 1);
+		fclose(fp);
+		return bRet;
+	}
+
 	int ZipUtils::ccInflateCCZFile(const char *path, unsigned char **out)
 	{
  		CCAssert(out, "");
  		CCAssert(&*out, "");
  
- 		// load file into memory
- 		unsigned char *compressed = NULL;
-        
-        int fileLen = 0;
-        compressed = CCFileUtils::getFileData(path, "rb", (unsigned long *)(&fileLen));
+ 		// map the file instead of loading it into memory: zlib reads the compressed data in place
+ 		CCMappedFile *pFile = CCFileUtils::mapFile(path);
  		// int fileLen  = CCFileUtils::ccLoadFileIntoMemory( path, &compressed );
 
- 		if( fileLen < 0 ) 
+ 		if( ! pFile || pFile->getSize() < sizeof(struct CCZHeader) ) 
  		{
  			CCLOG("cocos2d: Error loading CCZ compressed file");
+ 			CC_SAFE_RELEASE(pFile);
             return -1;
  		}
  
- 		struct CCZHeader *header = (struct CCZHeader*) compressed;
+ 		const unsigned char *compressed = pFile->getBytes();
+ 		int fileLen = (int)pFile->getSize();
+ 		const struct CCZHeader *header = (const struct CCZHeader*) compressed;
  
  		// verify header
  		if( header->sig[0] != 'C' || header->sig[1] != 'C' || header->sig[2] != 'Z' || header->sig[3] != '!' ) 
  		{
  			CCLOG("cocos2d: Invalid CCZ file");
- 			delete [] compressed;
+ 			pFile->release();
  			return -1;
  		}
  
  		// verify header version
  		unsigned int version = CC_SWAP_INT16_BIG_TO_HOST( header->version );
- 		if( version > 2 ) 
+ 		if( version > CCZ_BLOCKS_VERSION ) 
  		{
  			CCLOG("cocos2d: Unsupported CCZ header format");
- 			delete [] compressed;
+ 			pFile->release();
  			return -1;
  		}
  
@@ -246,26 +460,41 @@ namespace cocos2d
  		if( CC_SWAP_INT16_BIG_TO_HOST(header->compression_type) != CCZ_COMPRESSION_ZLIB ) 
  		{
  			CCLOG("cocos2d: CCZ Unsupported compression method");
- 			delete [] compressed;
+ 			pFile->release();
  			return -1;
  		}
  
  		unsigned int len = CC_SWAP_INT32_BIG_TO_HOST( header->len );
  
+ 		if( version == CCZ_BLOCKS_VERSION && ! checkCCZBlocksTable(compressed + sizeof(*header), fileLen - sizeof(*header), len) )
+ 		{
+ 			CCLOG("cocos2d: CCZ: Invalid block table");
+ 			pFile->release();
+ 			return -1;
+ 		}
+ 
  		*out = (unsigned char*)malloc( len );
  		if(! *out )
  		{
  			CCLOG("cocos2d: CCZ: Failed to allocate memory for texture");
- 			delete [] compressed;
+ 			pFile->release();
  			return -1;
  		}
  
  
- 		unsigned long destlen = len;
- 		unsigned long source = (unsigned long) compressed + sizeof(*header);
- 		int ret = uncompress(*out, &destlen, (Bytef*)source, fileLen - sizeof(*header) );
+ 		int ret = Z_OK;
+ 		if( version == CCZ_BLOCKS_VERSION )
+ 		{
+ 			ret = inflateCCZBlocksFile(compressed + sizeof(*header), *out, len) ? Z_OK : Z_DATA_ERROR;
+ 		}
+ 		else
+ 		{
+ 			unsigned long destlen = len;
+ 			unsigned long source = (unsigned long) compressed + sizeof(*header);
+ 			ret = uncompress(*out, &destlen, (Bytef*)source, fileLen - sizeof(*header) );
+ 		}
  
- 		delete [] compressed;
+ 		pFile->release();
  
  		if( ret != Z_OK )
  		{
@@ -278,4 +507,321 @@ namespace cocos2d
  		return len;
 	}
 
+
+	// ZipFile
+
+	#define ZIP_LOCAL_HEADER_SIGNATURE      0x04034b50
+	#define ZIP_LOCAL_HEADER_SIZE           30
+	#define ZIP_CENTRAL_HEADER_SIGNATURE    0x02014b50
+	#define ZIP_CENTRAL_HEADER_SIZE         46
+	#define ZIP_END_OF_DIRECTORY_SIGNATURE  0x06054b50
+	#define ZIP_END_OF_DIRECTORY_SIZE       22
+	#define ZIP_MAX_COMMENT_SIZE            0xffff
+
+	static inline unsigned short zipReadShort(const unsigned char *p)
+	{
+		return (unsigned short)(p[0] | (p[1] << 8));
+	}
+
+	static inline unsigned int zipReadInt(const unsigned char *p)
+	{
+		return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+	}
+
+	// decodes a LZ4 block; false if the block is malformed or doesn't fill the output exactly
+	static bool lz4DecompressBlock(const unsigned char *in, unsigned long inLength, unsigned char *out, unsigned long outLength)
+	{
+		const unsigned char *ip = in;
+		const unsigned char *iend = in + inLength;
+		unsigned char *op = out;
+		unsigned char *oend = out + outLength;
+
+		while (ip < iend)
+		{
+			unsigned int token = *ip++;
+
+			// literals
+			unsigned long length = token >> 4;
+			if (length == 15)
+			{
+				unsigned char b;
+				do
+				{
+					if (ip >= iend) return false;
+					b = *ip++;
+					length += b;
+				} while (b == 255);
+			}
+			if ((unsigned long)(iend - ip) < length || (unsigned long)(oend - op) < length)
+			{
+				return false;
+			}
+			memcpy(op, ip, length);
+			op += length;
+			ip += length;
+
+			// the last sequence has no match
+			if (ip >= iend)
+			{
+				break;
+			}
+
+			// match
+			if (iend - ip < 2)
+			{
+				return false;
+			}
+			unsigned long offset = zipReadShort(ip);
+			ip += 2;
+			if (offset == 0 || offset > (unsigned long)(op - out))
+			{
+				return false;
+			}
+
+			length = token & 15;
+			if (length == 15)
+			{
+				unsigned char b;
+				do
+				{
+					if (ip >= iend) return false;
+					b = *ip++;
+					length += b;
+				} while (b == 255);
+			}
+			length += 4;
+			if ((unsigned long)(oend - op) < length)
+			{
+				return false;
+			}
+
+			// the match may overlap the output, copy forward a byte at a time
+			const unsigned char *match = op - offset;
+			while (length--)
+			{
+				*op++ = *match++;
+			}
+		}
+
+		return op == oend;
+	}
+
+	ZipFile::ZipFile(const std::string &zipFile, const std::string &filter)
+	: m_pFile(NULL)
+	{
+		InitializeSRWLock(&m_readLock);
+
+		m_pFile = fopen(zipFile.c_str(), "rb");
+		if (m_pFile && ! readCentralDirectory(filter))
+		{
+			CCLOG("cocos2d: ZipFile: Invalid zip file %s", zipFile.c_str());
+			fclose(m_pFile);
+			m_pFile = NULL;
+			m_entries.clear();
+		}
+	}
+
+	ZipFile::~ZipFile()
+	{
+		if (m_pFile)
+		{
+			fclose(m_pFile);
+		}
+	}
+
+	bool ZipFile::isOpen() const
+	{
+		return m_pFile != NULL;
+	}
+
+	bool ZipFile::fileExists(const std::string &fileName) const
+	{
+		return m_entries.find(fileName) != m_entries.end();
+	}
+
+	unsigned int ZipFile::getEntryCount() const
+	{
+		return (unsigned int)m_entries.size();
+	}
+
+	bool ZipFile::readAt(unsigned long offset, void *pBuffer, unsigned long size)
+	{
+		AcquireSRWLockExclusive(&m_readLock);
+		bool bRet = fseek(m_pFile, (long)offset, SEEK_SET) == 0
+			&& fread(pBuffer, 1, size, m_pFile) == size;
+		ReleaseSRWLockExclusive(&m_readLock);
+		return bRet;
+	}
+
+	bool ZipFile::readCentralDirectory(const std::string &filter)
+	{
+		if (fseek(m_pFile, 0, SEEK_END) != 0)
+		{
+			return false;
+		}
+		long fileSize = ftell(m_pFile);
+		if (fileSize < ZIP_END_OF_DIRECTORY_SIZE)
+		{
+			return false;
+		}
+
+		// the end of central directory record is followed by a comment of up to 64k
+		unsigned long tailSize = ZIP_END_OF_DIRECTORY_SIZE + ZIP_MAX_COMMENT_SIZE;
+		if (tailSize > (unsigned long)fileSize)
+		{
+			tailSize = fileSize;
+		}
+		std::vector<unsigned char> tail(tailSize);
+		if (! readAt(fileSize - tailSize, &tail[0], tailSize))
+		{
+			return false;
+		}
+
+		const unsigned char *eocd = NULL;
+		for (long i = (long)tailSize - ZIP_END_OF_DIRECTORY_SIZE; i >= 0; --i)
+		{
+			if (zipReadInt(&tail[i]) == ZIP_END_OF_DIRECTORY_SIGNATURE)
+			{
+				eocd = &tail[i];
+				break;
+			}
+		}
+		if (! eocd)
+		{
+			return false;
+		}
+
+		unsigned int entryCount = zipReadShort(eocd + 10);
+		unsigned int directorySize = zipReadInt(eocd + 12);
+		unsigned int directoryOffset = zipReadInt(eocd + 16);
+		if (entryCount == 0xffff || directoryOffset == 0xffffffff)
+		{
+			CCLOG("cocos2d: ZipFile: zip64 archives are not supported");
+			return false;
+		}
+		if ((unsigned long)directoryOffset + directorySize > (unsigned long)fileSize)
+		{
+			return false;
+		}
+
+		std::vector<unsigned char> directory(directorySize + 1);
+		if (directorySize > 0 && ! readAt(directoryOffset, &directory[0], directorySize))
+		{
+			return false;
+		}
+
+		m_entries.reserve(entryCount);
+
+		const unsigned char *p = &directory[0];
+		const unsigned char *end = p + directorySize;
+		for (unsigned int i = 0; i < entryCount; ++i)
+		{
+			if (end - p < ZIP_CENTRAL_HEADER_SIZE || zipReadInt(p) != ZIP_CENTRAL_HEADER_SIGNATURE)
+			{
+				return false;
+			}
+
+			unsigned short flags = zipReadShort(p + 8);
+			unsigned short nameLength = zipReadShort(p + 28);
+			unsigned short extraLength = zipReadShort(p + 30);
+			unsigned short commentLength = zipReadShort(p + 32);
+			if (end - p < ZIP_CENTRAL_HEADER_SIZE + nameLength + extraLength + commentLength)
+			{
+				return false;
+			}
+
+			std::string name((const char*)p + ZIP_CENTRAL_HEADER_SIZE, nameLength);
+
+			// directories and encrypted entries can't be read
+			if (! name.empty() && name[name.length() - 1] != '/' && ! (flags & 1)
+				&& name.compare(0, filter.length(), filter) == 0)
+			{
+				ZipEntryInfo info;
+				info.method = zipReadShort(p + 10);
+				info.compressedSize = zipReadInt(p + 20);
+				info.uncompressedSize = zipReadInt(p + 24);
+				info.localHeaderOffset = zipReadInt(p + 42);
+				m_entries[name] = info;
+			}
+
+			p += ZIP_CENTRAL_HEADER_SIZE + nameLength + extraLength + commentLength;
+		}
+
+		return true;
+	}
+
+	unsigned char *ZipFile::getFileData(const std::string &fileName, unsigned long *pSize)
+	{
+		*pSize = 0;
+
+		std::unordered_map<std::string, ZipEntryInfo>::const_iterator it = m_entries.find(fileName);
+		if (! m_pFile || it == m_entries.end())
+		{
+			return NULL;
+		}
+		const ZipEntryInfo &info = it->second;
+
+		// the local header repeats the name, and may have its own extra field
+		unsigned char header[ZIP_LOCAL_HEADER_SIZE];
+		if (! readAt(info.localHeaderOffset, header, ZIP_LOCAL_HEADER_SIZE)
+			|| zipReadInt(header) != ZIP_LOCAL_HEADER_SIGNATURE)
+		{
+			CCLOG("cocos2d: ZipFile: Invalid local header for %s", fileName.c_str());
+			return NULL;
+		}
+		unsigned long dataOffset = info.localHeaderOffset + ZIP_LOCAL_HEADER_SIZE
+			+ zipReadShort(header + 26) + zipReadShort(header + 28);
+
+		unsigned char *pBuffer = new unsigned char[info.uncompressedSize + 1];
+		pBuffer[info.uncompressedSize] = 0;
+
+		bool bRet = false;
+		if (info.method == 0)
+		{
+			bRet = info.compressedSize == info.uncompressedSize
+				&& readAt(dataOffset, pBuffer, info.uncompressedSize);
+		}
+		else if (info.method == Z_DEFLATED || info.method == CC_ZIP_METHOD_LZ4)
+		{
+			unsigned char *pCompressed = new unsigned char[info.compressedSize];
+			if (readAt(dataOffset, pCompressed, info.compressedSize))
+			{
+				if (info.method == Z_DEFLATED)
+				{
+					// raw deflate stream, without the zlib header
+					z_stream stream;
+					memset(&stream, 0, sizeof(stream));
+					if (inflateInit2(&stream, -MAX_WBITS) == Z_OK)
+					{
+						stream.next_in = pCompressed;
+						stream.avail_in = info.compressedSize;
+						stream.next_out = pBuffer;
+						stream.avail_out = info.uncompressedSize;
+						bRet = inflate(&stream, Z_FINISH) == Z_STREAM_END && stream.total_out == info.uncompressedSize;
+						inflateEnd(&stream);
+					}
+				}
+				else
+				{
+					bRet = lz4DecompressBlock(pCompressed, info.compressedSize, pBuffer, info.uncompressedSize);
+				}
+			}
+			delete [] pCompressed;
+		}
+		else
+		{
+			CCLOG("cocos2d: ZipFile: Unsupported compression method %d for %s", info.method, fileName.c_str());
+		}
+
+		if (! bRet)
+		{
+			CCLOG("cocos2d: ZipFile: Failed to read %s", fileName.c_str());
+			delete [] pBuffer;
+			return NULL;
+		}
+
+		*pSize = info.uncompressedSize;
+		return pBuffer;
+	}
+
 } // end of namespace cocos2d
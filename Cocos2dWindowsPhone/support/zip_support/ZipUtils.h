@@ -27,6 +27,10 @@ THE SOFTWARE.
 #ifndef __SUPPORT_ZIPUTILS_H__
 #define __SUPPORT_ZIPUTILS_H__
 
+#include <stdio.h>
+#include <string>
+#include <unordered_map>
+
 namespace cocos2d
 {
 	/* XXX: pragma pack ??? */
@@ -35,7 +39,7 @@ namespace cocos2d
 	struct CCZHeader {
 		unsigned char			sig[4];				// signature. Should be 'CCZ!' 4 bytes
 		unsigned short		    compression_type;	// should 0
-		unsigned short		    version;			// should be 2 (although version type==1 is also supported)
+		unsigned short		    version;			// should be 2 (although version type==1 is also supported), 3 for independent blocks
 		unsigned int 		    reserved;			// Reserverd for users.
 		unsigned int		    len;				// size of the uncompressed file
 	};
@@ -83,17 +87,85 @@ namespace cocos2d
 
 		/** inflates a CCZ file into memory
 		*
+		* Version 3 files, written by ccDeflateCCZBlocksFile, are inflated in parallel.
+		*
 		* @returns the length of the deflated buffer
 		*
 		* @since v0.99.5
 		*/
 		static int ccInflateCCZFile(const char *filename, unsigned char **out);
 
+		/** 
+		* Writes data as a CCZ version 3 file: the data is cut in blocks compressed independently,
+		* which ccInflateCCZFile inflates in parallel, on as many cores as there are blocks.
+		* Meant for offline tools, e.g. to convert large .pvr.ccz atlases.
+		* The block size is reduced to the data length for smaller data.
+		*
+		* @returns false if the data is empty, couldn't be compressed or the file written
+		*/
+		static bool ccDeflateCCZBlocksFile(const unsigned char *data, unsigned int length, const char *filename, unsigned int blockSize = 256 * 1024);
+
 	private:
 		static int ccInflateMemoryWithHint(unsigned char *in, unsigned int inLength, unsigned char **out, unsigned int *outLength, 
 			unsigned int outLenghtHint);
 	};
 
+	/** Compression method of the zip entries compressed with the LZ4 block format.
+	 Not part of the zip specification: packs using it are written by our own tools.
+	 */
+	#define CC_ZIP_METHOD_LZ4 0x4C34
+
+	/** @brief A zip archive opened once and read at random.
+	*
+	* The central directory is parsed when the archive is opened into a hash of the entry names,
+	* and the file stays open, so looking an entry up is O(1) and doesn't scan the archive.
+	* Entries can be stored, deflated, or compressed with CC_ZIP_METHOD_LZ4, which decompresses faster.
+	* getFileData can be called from several threads at once: only the reads of the archive are
+	* serialized, entries are decompressed in parallel.
+	*/
+	class ZipFile
+	{
+	public:
+		/** Opens an archive.
+		@param zipFile full path of the archive
+		@param filter only the entries whose name starts with it are indexed, e.g. "assets/"
+		*/
+		ZipFile(const std::string &zipFile, const std::string &filter = std::string());
+		virtual ~ZipFile();
+
+		/** false if the archive couldn't be opened or its central directory couldn't be read */
+		bool isOpen() const;
+
+		/** Checks whether an entry exists */
+		bool fileExists(const std::string &fileName) const;
+
+		/** number of entries indexed */
+		unsigned int getEntryCount() const;
+
+		/** Decompresses an entry.
+		@param pSize is set to the size of the entry
+		@return the data, zero terminated, or NULL if the entry doesn't exist or can't be decompressed
+		@warning the caller must delete[] the data
+		*/
+		unsigned char *getFileData(const std::string &fileName, unsigned long *pSize);
+
+	private:
+		struct ZipEntryInfo
+		{
+			unsigned short method;
+			unsigned int   localHeaderOffset;
+			unsigned int   compressedSize;
+			unsigned int   uncompressedSize;
+		};
+
+		bool readCentralDirectory(const std::string &filter);
+		bool readAt(unsigned long offset, void *pBuffer, unsigned long size);
+
+		FILE *m_pFile;
+		SRWLOCK m_readLock;
+		std::unordered_map<std::string, ZipEntryInfo> m_entries;
+	};
+
 } // end of namespace cocos2d
 #endif // __PLATFORM_WOPHONE_ZIPUTILS_H__
 
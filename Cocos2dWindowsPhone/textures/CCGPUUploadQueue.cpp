@@ -0,0 +1,161 @@
+/*
+* cocos2d-x   http://www.cocos2d-x.org
+*
+* Copyright (c) 2010-2011 - cocos2d-x community
+*
+* Portions Copyright (c) Microsoft Open Technologies, Inc.
+* All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on an
+* "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and limitations under the License.
+*/
+
+#include "pch.h"
+#include "CCGPUUploadQueue.h"
+#include "CCTexture2D.h"
+#include "ccMacros.h"
+#include "support/CCProfiling.h"
+
+NS_CC_BEGIN
+
+static CCGPUUploadQueue *g_sharedGPUUploadQueue = NULL;
+
+CCGPUUploadQueue * CCGPUUploadQueue::sharedGPUUploadQueue()
+{
+    if (!g_sharedGPUUploadQueue)
+        g_sharedGPUUploadQueue = new CCGPUUploadQueue();
+
+    return g_sharedGPUUploadQueue;
+}
+
+void CCGPUUploadQueue::purgeSharedGPUUploadQueue()
+{
+    CC_SAFE_RELEASE_NULL(g_sharedGPUUploadQueue);
+}
+
+CCGPUUploadQueue::CCGPUUploadQueue()
+: m_uBytesPerFrame(CC_GPU_UPLOAD_BYTES_PER_FRAME)
+, m_pPlaceholderTexture(NULL)
+{
+    CCAssert(g_sharedGPUUploadQueue == NULL, "Attempted to allocate a second instance of a singleton.");
+
+    memset(&m_tStats, 0, sizeof(m_tStats));
+}
+
+CCGPUUploadQueue::~CCGPUUploadQueue()
+{
+    CCLOGINFO("cocos2d: deallocing CCGPUUploadQueue.");
+    // no texture may be left waiting for a queue that is gone
+    flushUploads();
+    CC_SAFE_RELEASE(m_pPlaceholderTexture);
+}
+
+void CCGPUUploadQueue::setBytesPerFrame(unsigned int uBytes)
+{
+    m_uBytesPerFrame = uBytes;
+    if (m_uBytesPerFrame == 0)
+    {
+        flushUploads();
+    }
+}
+
+bool CCGPUUploadQueue::addUpload(CCGPUUploadDelegate *pDelegate, unsigned int uBytes)
+{
+    CCAssert(pDelegate, "pDelegate can't be NULL");
+    if (m_uBytesPerFrame == 0)
+    {
+        return false;
+    }
+    if (m_tUploadsByDelegate.find(pDelegate) != m_tUploadsByDelegate.end())
+    {
+        return true;
+    }
+
+    ccGPUUpload upload = { pDelegate, uBytes };
+    m_tUploadsByDelegate[pDelegate] = m_tUploads.insert(m_tUploads.end(), upload);
+    m_tStats.uPending++;
+    m_tStats.uPendingBytes += uBytes;
+    return true;
+}
+
+void CCGPUUploadQueue::removeUpload(CCGPUUploadDelegate *pDelegate)
+{
+    std::map<CCGPUUploadDelegate*, UploadList::iterator>::iterator it = m_tUploadsByDelegate.find(pDelegate);
+    if (it == m_tUploadsByDelegate.end())
+    {
+        return;
+    }
+
+    m_tStats.uPending--;
+    m_tStats.uPendingBytes -= it->second->uBytes;
+    m_tUploads.erase(it->second);
+    m_tUploadsByDelegate.erase(it);
+}
+
+void CCGPUUploadQueue::flushUpload(CCGPUUploadDelegate *pDelegate)
+{
+    if (m_tUploadsByDelegate.find(pDelegate) == m_tUploadsByDelegate.end())
+    {
+        return;
+    }
+
+    // dequeue first: the delegate may queue other uploads while it creates its resources
+    removeUpload(pDelegate);
+    pDelegate->uploadGPUResources();
+}
+
+void CCGPUUploadQueue::flushUploads(void)
+{
+    while (! m_tUploads.empty())
+    {
+        processFrontUpload();
+    }
+}
+
+void CCGPUUploadQueue::processFrontUpload(void)
+{
+    ccGPUUpload upload = m_tUploads.front();
+    removeUpload(upload.pDelegate);
+    upload.pDelegate->uploadGPUResources();
+
+    m_tStats.uUploadedLastFrame++;
+    m_tStats.uUploadedBytesLastFrame += upload.uBytes;
+}
+
+void CCGPUUploadQueue::processUploads(void)
+{
+    m_tStats.uUploadedLastFrame = 0;
+    m_tStats.uUploadedBytesLastFrame = 0;
+    if (m_tUploads.empty())
+    {
+        return;
+    }
+
+    CC_PROFILER_START("CCGPUUploadQueue - process uploads");
+    // the first upload always goes, so that one bigger than the budget doesn't wait forever
+    do
+    {
+        processFrontUpload();
+    } while (! m_tUploads.empty()
+        && m_tStats.uUploadedBytesLastFrame + m_tUploads.front().uBytes <= m_uBytesPerFrame);
+    CC_PROFILER_STOP("CCGPUUploadQueue - process uploads");
+}
+
+CCTexture2D* CCGPUUploadQueue::getPlaceholderTexture(void)
+{
+    if (! m_pPlaceholderTexture)
+    {
+        unsigned char pixel[4] = { 0, 0, 0, 0 };
+        m_pPlaceholderTexture = new CCTexture2D();
+        m_pPlaceholderTexture->initWithData(pixel, kCCTexture2DPixelFormat_RGBA8888, 1, 1, CCSizeMake(1, 1));
+    }
+    return m_pPlaceholderTexture;
+}
+
+NS_CC_END
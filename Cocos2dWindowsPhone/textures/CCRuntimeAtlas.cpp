@@ -0,0 +1,634 @@
+/*
+* cocos2d-x   http://www.cocos2d-x.org
+*
+* Copyright (c) 2010-2011 - cocos2d-x community
+*
+* Portions Copyright (c) Microsoft Open Technologies, Inc.
+* All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on an
+* "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and limitations under the License.
+*/
+
+#include "pch.h"
+#include "CCRuntimeAtlas.h"
+#include "CCTexture2D.h"
+#include "CCTextureCache.h"
+#include "CCSpriteFrame.h"
+#include "CCImage.h"
+#include "CCFileUtils.h"
+#include "CCConfiguration.h"
+#include "CCDirector.h"
+#include "support/image_support/ccPixelConversion.h"
+#include <algorithm>
+#include <cctype>
+
+NS_CC_BEGIN
+
+static CCRuntimeAtlas *g_sharedRuntimeAtlas = NULL;
+
+CCRuntimeAtlas * CCRuntimeAtlas::sharedRuntimeAtlas()
+{
+    if (!g_sharedRuntimeAtlas)
+        g_sharedRuntimeAtlas = new CCRuntimeAtlas();
+
+    return g_sharedRuntimeAtlas;
+}
+
+void CCRuntimeAtlas::purgeSharedRuntimeAtlas()
+{
+    CC_SAFE_RELEASE_NULL(g_sharedRuntimeAtlas);
+}
+
+CCRuntimeAtlas::CCRuntimeAtlas()
+{
+    CCAssert(g_sharedRuntimeAtlas == NULL, "Attempted to allocate a second instance of a singleton.");
+
+    memset(&m_tStats, 0, sizeof(m_tStats));
+}
+
+CCRuntimeAtlas::~CCRuntimeAtlas()
+{
+    CCLOGINFO("cocos2d: deallocing CCRuntimeAtlas.");
+    removeAllImages();
+}
+
+char * CCRuntimeAtlas::description(void)
+{
+    char *ret = new char[100];
+    sprintf(ret, "<CCRuntimeAtlas | Number of images = %u | Number of pages = %u>", m_tStats.uImages, m_tStats.uPages);
+    return ret;
+}
+
+// keys are resolved like the ones of CCTextureCache
+static std::string atlasKey(const char *pszKey)
+{
+    std::string key = pszKey;
+    CCFileUtils::removeSuffixFromFile(key);
+    return CCFileUtils::fullPathFromRelativePath(key.c_str());
+}
+
+static unsigned int atlasPageSize(void)
+{
+    unsigned int maxTextureSize = CCConfiguration::sharedConfiguration()->getMaxTextureSize();
+    return CC_RUNTIME_ATLAS_PAGE_SIZE < maxTextureSize ? CC_RUNTIME_ATLAS_PAGE_SIZE : maxTextureSize;
+}
+
+CCSpriteFrame* CCRuntimeAtlas::addImage(const char *pszFile)
+{
+    CCAssert(pszFile != NULL, "CCRuntimeAtlas: file image MUST not be NULL");
+
+    std::string key = atlasKey(pszFile);
+    std::map<std::string, ccAtlasEntry>::iterator it = m_tEntries.find(key);
+    if (it != m_tEntries.end())
+    {
+        return it->second.pFrame;
+    }
+
+    std::string lowerCase(pszFile);
+    for (unsigned int i = 0; i < lowerCase.length(); ++i)
+    {
+        lowerCase[i] = tolower(lowerCase[i]);
+    }
+    CCImage::EImageFormat eFormat = (std::string::npos != lowerCase.find(".jpg") || std::string::npos != lowerCase.find(".jpeg"))
+        ? CCImage::kFmtJpg : CCImage::kFmtPng;
+
+    CCImage image;
+    if (! image.initWithImageFileThreadSafe(key.c_str(), eFormat))
+    {
+        CCLOG("cocos2d: CCRuntimeAtlas: Couldn't load image:%s", pszFile);
+        return NULL;
+    }
+
+    return addUIImage(&image, pszFile);
+}
+
+CCSpriteFrame* CCRuntimeAtlas::addUIImage(CCImage *pImage, const char *pszKey)
+{
+    CCAssert(pImage != NULL && pszKey != NULL, "CCRuntimeAtlas: image and key MUST not be NULL");
+
+    std::string key = atlasKey(pszKey);
+    std::map<std::string, ccAtlasEntry>::iterator it = m_tEntries.find(key);
+    if (it != m_tEntries.end())
+    {
+        return it->second.pFrame;
+    }
+
+    unsigned int width = pImage->getWidth();
+    unsigned int height = pImage->getHeight();
+    const unsigned char *pData = pImage->getData();
+    if (pData == NULL || width == 0 || height == 0)
+    {
+        return NULL;
+    }
+
+    // the pages hold premultiplied RGBA8888
+    unsigned char *pConverted = NULL;
+    unsigned int bytesPerPixel = pImage->hasAlpha() ? 4 : 3;
+    if (bytesPerPixel != 4 || ! pImage->isPremultipliedAlpha())
+    {
+        pConverted = new unsigned char[width * height * 4];
+        ccConvertPixels(pData, bytesPerPixel, pConverted, kCCTexture2DPixelFormat_RGBA8888, width * height);
+        if (bytesPerPixel == 4)
+        {
+            ccPremultiplyAlphaRGBA8888(pConverted, pConverted, width * height);
+        }
+        pData = pConverted;
+    }
+
+    CCSpriteFrame *pFrame = addRGBA8888Image(pData, width, height, key);
+    CC_SAFE_DELETE_ARRAY(pConverted);
+
+    if (pFrame == NULL)
+    {
+        // too big or no room left: the image gets a texture of its own
+        CCTexture2D *pTexture = CCTextureCache::sharedTextureCache()->addUIImage(pImage, pszKey);
+        if (pTexture == NULL)
+        {
+            return NULL;
+        }
+
+        const CCSize& size = pTexture->getContentSizeInPixels();
+        pFrame = new CCSpriteFrame();
+        pFrame->initWithTexture(pTexture, CCRectMake(0, 0, size.width, size.height), false, CCPointZero, size);
+
+        ccAtlasEntry entry;
+        entry.pFrame = pFrame;
+        entry.nPage = -1;
+        memset(&entry.rect, 0, sizeof(entry.rect));
+        m_tEntries[key] = entry;
+        m_tStats.uFallbacks++;
+        m_tStats.uImages++;
+    }
+
+    return pFrame;
+}
+
+CCSpriteFrame* CCRuntimeAtlas::addRGBA8888Image(const unsigned char *pData, unsigned int width, unsigned int height, const std::string& key)
+{
+    const unsigned int border = CC_RUNTIME_ATLAS_EXTRUDE;
+    unsigned int extrudedW = width + 2 * border;
+    unsigned int extrudedH = height + 2 * border;
+
+    int page;
+    ccAtlasRect rect;
+    if (! allocate(extrudedW + CC_RUNTIME_ATLAS_PADDING, extrudedH + CC_RUNTIME_ATLAS_PADDING, &page, &rect))
+    {
+        return NULL;
+    }
+
+    // repeat the edges of the image in the border
+    unsigned char *pixels = new unsigned char[extrudedW * extrudedH * 4];
+    for (unsigned int y = 0; y < extrudedH; ++y)
+    {
+        unsigned int sy = y < border ? 0 : (y - border >= height ? height - 1 : y - border);
+        const unsigned char *src = pData + sy * width * 4;
+        unsigned char *dst = pixels + y * extrudedW * 4;
+        for (unsigned int x = 0; x < border; ++x)
+        {
+            memcpy(dst + x * 4, src, 4);
+            memcpy(dst + (border + width + x) * 4, src + (width - 1) * 4, 4);
+        }
+        memcpy(dst + border * 4, src, width * 4);
+    }
+
+    CCTexture2D *pTexture = m_tPages[page].pTexture;
+    pTexture->updateWithData(pixels, rect.x, rect.y, extrudedW, extrudedH);
+    delete [] pixels;
+
+    CCSpriteFrame *pFrame = new CCSpriteFrame();
+    pFrame->initWithTexture(pTexture, CCRectMake((float)(rect.x + border), (float)(rect.y + border), (float)width, (float)height),
+                            false, CCPointZero, CCSizeMake((float)width, (float)height));
+
+    ccAtlasEntry entry;
+    entry.pFrame = pFrame;
+    entry.nPage = page;
+    entry.rect = rect;
+    m_tEntries[key] = entry;
+    m_tStats.uImages++;
+    m_tStats.uUsedPixels += rect.width * rect.height;
+
+    return pFrame;
+}
+
+CCSpriteFrame* CCRuntimeAtlas::spriteFrameForKey(const char *pszKey)
+{
+    std::map<std::string, ccAtlasEntry>::iterator it = m_tEntries.find(atlasKey(pszKey));
+    return it != m_tEntries.end() ? it->second.pFrame : NULL;
+}
+
+void CCRuntimeAtlas::removeImageForKey(const char *pszKey)
+{
+    std::map<std::string, ccAtlasEntry>::iterator it = m_tEntries.find(atlasKey(pszKey));
+    if (it == m_tEntries.end())
+    {
+        return;
+    }
+
+    ccAtlasEntry& entry = it->second;
+    if (entry.nPage >= 0)
+    {
+        // sprites don't retain the frame, only the page: don't overwrite pixels they may still show
+        ccAtlasPage& page = m_tPages[entry.nPage];
+        page.pendingRects.push_back(entry.rect);
+        page.uFreedPixels += entry.rect.width * entry.rect.height;
+        m_tStats.uUsedPixels -= entry.rect.width * entry.rect.height;
+    }
+    else
+    {
+        m_tStats.uFallbacks--;
+    }
+
+    entry.pFrame->release();
+    m_tEntries.erase(it);
+    m_tStats.uImages--;
+}
+
+void CCRuntimeAtlas::removeAllImages(void)
+{
+    for (std::map<std::string, ccAtlasEntry>::iterator it = m_tEntries.begin(); it != m_tEntries.end(); ++it)
+    {
+        it->second.pFrame->release();
+    }
+    m_tEntries.clear();
+
+    for (unsigned int i = 0; i < m_tPages.size(); ++i)
+    {
+        CC_SAFE_RELEASE(m_tPages[i].pTexture);
+    }
+    m_tPages.clear();
+
+    unsigned int uRepacks = m_tStats.uRepacks;
+    memset(&m_tStats, 0, sizeof(m_tStats));
+    m_tStats.uRepacks = uRepacks;
+}
+
+CCTexture2D* CCRuntimeAtlas::textureForPage(unsigned int page)
+{
+    return page < m_tPages.size() ? m_tPages[page].pTexture : NULL;
+}
+
+unsigned int CCRuntimeAtlas::defragment(void)
+{
+    unsigned int count = 0;
+
+    // backwards, as releasing a page shifts the following ones
+    for (unsigned int i = (unsigned int)m_tPages.size(); i-- > 0; )
+    {
+        if (m_tPages[i].uFreedPixels == 0 || isPageInUse(i))
+        {
+            continue;
+        }
+
+        bool bEmpty = true;
+        for (std::map<std::string, ccAtlasEntry>::iterator it = m_tEntries.begin(); it != m_tEntries.end(); ++it)
+        {
+            if (it->second.nPage == (int)i)
+            {
+                bEmpty = false;
+                break;
+            }
+        }
+
+        if (bEmpty)
+        {
+            releasePage(i);
+            count++;
+        }
+        else if (repackPage(i))
+        {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+bool CCRuntimeAtlas::allocate(unsigned int width, unsigned int height, int *pPage, ccAtlasRect *pRect)
+{
+    unsigned int pageSize = atlasPageSize();
+    if (width > pageSize || height > pageSize)
+    {
+        return false;
+    }
+
+    for (int attempt = 0; attempt < 3; ++attempt)
+    {
+        if (attempt == 1)
+        {
+            // the pages are full: win back the space of the removed images first
+            if (defragment() == 0)
+            {
+                continue;
+            }
+        }
+        else if (attempt == 2)
+        {
+            if (m_tPages.size() >= CC_RUNTIME_ATLAS_MAX_PAGES || ! addPage())
+            {
+                return false;
+            }
+        }
+
+        for (unsigned int i = 0; i < m_tPages.size(); ++i)
+        {
+            reclaimPendingRects(i);
+            if (findPosition(m_tPages[i].freeRects, width, height, pRect))
+            {
+                placeRect(m_tPages[i].freeRects, *pRect);
+                *pPage = (int)i;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+// a blank premultiplied page
+static CCTexture2D* createPageTexture(unsigned int pageSize)
+{
+    unsigned int bytes = pageSize * pageSize * 4;
+    unsigned char *data = new unsigned char[bytes];
+    memset(data, 0, bytes);
+
+    CCTexture2D *texture = new CCTexture2D();
+    bool bRet = texture->initWithData(data, kCCTexture2DPixelFormat_RGBA8888, pageSize, pageSize,
+                                      CCSizeMake((float)pageSize, (float)pageSize));
+    delete [] data;
+
+    if (! bRet)
+    {
+        texture->release();
+        return NULL;
+    }
+    texture->setHasPremultipliedAlpha(true);
+    return texture;
+}
+
+bool CCRuntimeAtlas::addPage(void)
+{
+    unsigned int pageSize = atlasPageSize();
+    CCTexture2D *texture = createPageTexture(pageSize);
+    if (texture == NULL)
+    {
+        CCLOG("cocos2d: CCRuntimeAtlas: Couldn't create a %u x %u page", pageSize, pageSize);
+        return false;
+    }
+
+    ccAtlasPage page;
+    page.pTexture = texture;
+    ccAtlasRect whole = { 0, 0, pageSize, pageSize };
+    page.freeRects.push_back(whole);
+    page.uFreedPixels = 0;
+    m_tPages.push_back(page);
+    m_tStats.uPages++;
+
+    return true;
+}
+
+bool CCRuntimeAtlas::isPageInUse(unsigned int page)
+{
+    // the atlas holds the page and its frames; any other reference is a sprite or an animation
+    unsigned int frames = 0;
+    for (std::map<std::string, ccAtlasEntry>::iterator it = m_tEntries.begin(); it != m_tEntries.end(); ++it)
+    {
+        if (it->second.nPage == (int)page)
+        {
+            if (it->second.pFrame->retainCount() > 1)
+            {
+                return true;
+            }
+            frames++;
+        }
+    }
+    return m_tPages[page].pTexture->retainCount() > 1 + frames;
+}
+
+void CCRuntimeAtlas::reclaimPendingRects(unsigned int page)
+{
+    ccAtlasPage& atlasPage = m_tPages[page];
+    if (atlasPage.pendingRects.empty() || isPageInUse(page))
+    {
+        return;
+    }
+
+    atlasPage.freeRects.insert(atlasPage.freeRects.end(), atlasPage.pendingRects.begin(), atlasPage.pendingRects.end());
+    atlasPage.pendingRects.clear();
+    pruneFreeRects(atlasPage.freeRects);
+}
+
+static bool compareLongestSide(const std::pair<unsigned int, std::string>& a, const std::pair<unsigned int, std::string>& b)
+{
+    return a.first > b.first;
+}
+
+bool CCRuntimeAtlas::repackPage(unsigned int page)
+{
+    unsigned int pageSize = atlasPageSize();
+
+    // place the images again, the biggest first
+    std::vector< std::pair<unsigned int, std::string> > keys;
+    for (std::map<std::string, ccAtlasEntry>::iterator it = m_tEntries.begin(); it != m_tEntries.end(); ++it)
+    {
+        if (it->second.nPage == (int)page)
+        {
+            const ccAtlasRect& r = it->second.rect;
+            keys.push_back(std::make_pair(r.width > r.height ? r.width : r.height, it->first));
+        }
+    }
+    std::sort(keys.begin(), keys.end(), compareLongestSide);
+
+    std::vector<ccAtlasRect> freeRects;
+    ccAtlasRect whole = { 0, 0, pageSize, pageSize };
+    freeRects.push_back(whole);
+    std::vector<ccAtlasRect> newRects(keys.size());
+    for (unsigned int i = 0; i < keys.size(); ++i)
+    {
+        const ccAtlasRect& r = m_tEntries[keys[i].second].rect;
+        if (! findPosition(freeRects, r.width, r.height, &newRects[i]))
+        {
+            return false;
+        }
+        placeRect(freeRects, newRects[i]);
+    }
+
+    CCTexture2D *texture = createPageTexture(pageSize);
+    if (texture == NULL)
+    {
+        return false;
+    }
+
+    // move the pixels on the GPU, the padding excepted
+    ID3D11Resource *pSource = NULL;
+    ID3D11Resource *pDestination = NULL;
+    m_tPages[page].pTexture->getTextureResource()->GetResource(&pSource);
+    texture->getTextureResource()->GetResource(&pDestination);
+
+    const unsigned int border = CC_RUNTIME_ATLAS_EXTRUDE;
+    for (unsigned int i = 0; i < keys.size(); ++i)
+    {
+        ccAtlasEntry& entry = m_tEntries[keys[i].second];
+        D3D11_BOX box;
+        box.left = entry.rect.x;
+        box.top = entry.rect.y;
+        box.front = 0;
+        box.right = entry.rect.x + entry.rect.width - CC_RUNTIME_ATLAS_PADDING;
+        box.bottom = entry.rect.y + entry.rect.height - CC_RUNTIME_ATLAS_PADDING;
+        box.back = 1;
+        CCID3D11DeviceContext->CopySubresourceRegion(pDestination, 0, newRects[i].x, newRects[i].y, 0, pSource, 0, &box);
+
+        entry.rect = newRects[i];
+        entry.pFrame->setTexture(texture);
+        const CCRect& old = entry.pFrame->getRectInPixels();
+        entry.pFrame->setRectInPixels(CCRectMake((float)(newRects[i].x + border), (float)(newRects[i].y + border), old.size.width, old.size.height));
+    }
+
+    pSource->Release();
+    pDestination->Release();
+
+    m_tPages[page].pTexture->release();
+    m_tPages[page].pTexture = texture;
+    m_tPages[page].freeRects = freeRects;
+    m_tPages[page].pendingRects.clear();
+    m_tPages[page].uFreedPixels = 0;
+    m_tStats.uRepacks++;
+
+    return true;
+}
+
+void CCRuntimeAtlas::releasePage(unsigned int page)
+{
+    for (std::map<std::string, ccAtlasEntry>::iterator it = m_tEntries.begin(); it != m_tEntries.end(); ++it)
+    {
+        if (it->second.nPage > (int)page)
+        {
+            it->second.nPage--;
+        }
+    }
+
+    m_tPages[page].pTexture->release();
+    m_tPages.erase(m_tPages.begin() + page);
+    m_tStats.uPages--;
+}
+
+// MaxRects, best short side fit: the free rect leaving the smallest leftover on its shorter side
+bool CCRuntimeAtlas::findPosition(const std::vector<ccAtlasRect>& freeRects, unsigned int width, unsigned int height, ccAtlasRect *pRect)
+{
+    unsigned int bestShortSide = 0xffffffff;
+    unsigned int bestLongSide = 0xffffffff;
+    bool bFound = false;
+
+    for (unsigned int i = 0; i < freeRects.size(); ++i)
+    {
+        const ccAtlasRect& r = freeRects[i];
+        if (r.width < width || r.height < height)
+        {
+            continue;
+        }
+
+        unsigned int leftoverH = r.width - width;
+        unsigned int leftoverV = r.height - height;
+        unsigned int shortSide = leftoverH < leftoverV ? leftoverH : leftoverV;
+        unsigned int longSide = leftoverH < leftoverV ? leftoverV : leftoverH;
+        if (shortSide < bestShortSide || (shortSide == bestShortSide && longSide < bestLongSide))
+        {
+            pRect->x = r.x;
+            pRect->y = r.y;
+            pRect->width = width;
+            pRect->height = height;
+            bestShortSide = shortSide;
+            bestLongSide = longSide;
+            bFound = true;
+        }
+    }
+
+    return bFound;
+}
+
+// splits every free rect overlapping the used one into the (up to 4) maximal rects around it
+void CCRuntimeAtlas::placeRect(std::vector<ccAtlasRect>& freeRects, const ccAtlasRect& used)
+{
+    std::vector<ccAtlasRect> split;
+    for (unsigned int i = 0; i < freeRects.size(); )
+    {
+        ccAtlasRect r = freeRects[i];
+        if (used.x >= r.x + r.width || used.x + used.width <= r.x ||
+            used.y >= r.y + r.height || used.y + used.height <= r.y)
+        {
+            ++i;
+            continue;
+        }
+
+        if (used.y > r.y)
+        {
+            ccAtlasRect top = { r.x, r.y, r.width, used.y - r.y };
+            split.push_back(top);
+        }
+        if (used.y + used.height < r.y + r.height)
+        {
+            ccAtlasRect bottom = { r.x, used.y + used.height, r.width, r.y + r.height - (used.y + used.height) };
+            split.push_back(bottom);
+        }
+        if (used.x > r.x)
+        {
+            ccAtlasRect left = { r.x, r.y, used.x - r.x, r.height };
+            split.push_back(left);
+        }
+        if (used.x + used.width < r.x + r.width)
+        {
+            ccAtlasRect right = { used.x + used.width, r.y, r.x + r.width - (used.x + used.width), r.height };
+            split.push_back(right);
+        }
+
+        freeRects[i] = freeRects.back();
+        freeRects.pop_back();
+    }
+
+    freeRects.insert(freeRects.end(), split.begin(), split.end());
+    pruneFreeRects(freeRects);
+}
+
+// drops the free rects contained in another one
+void CCRuntimeAtlas::pruneFreeRects(std::vector<ccAtlasRect>& freeRects)
+{
+    for (unsigned int i = 0; i < freeRects.size(); )
+    {
+        bool bContained = false;
+        for (unsigned int j = i + 1; j < freeRects.size(); )
+        {
+            const ccAtlasRect& a = freeRects[i];
+            const ccAtlasRect& b = freeRects[j];
+            if (a.x >= b.x && a.y >= b.y && a.x + a.width <= b.x + b.width && a.y + a.height <= b.y + b.height)
+            {
+                bContained = true;
+                break;
+            }
+            if (b.x >= a.x && b.y >= a.y && b.x + b.width <= a.x + a.width && b.y + b.height <= a.y + a.height)
+            {
+                freeRects.erase(freeRects.begin() + j);
+            }
+            else
+            {
+                ++j;
+            }
+        }
+
+        if (bContained)
+        {
+            freeRects.erase(freeRects.begin() + i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
+
+NS_CC_END
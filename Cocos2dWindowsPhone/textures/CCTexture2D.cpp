@@ -34,15 +34,23 @@
 #include "CCImage.h"
 #include "CCGL.h"
 #include "support/ccUtils.h"
+#include "support/image_support/ccPixelConversion.h"
+#include "support/image_support/ccTextureCompression.h"
 #include "CCPlatformMacros.h"
 #include "CCTexturePVR.h"
 #include "CCDirector.h"
+#include "CCRenderPipeline.h"
 
 #if CC_ENABLE_CACHE_TEXTTURE_DATA
     #include "CCTextureCache.h"
 #endif
 
+#if CC_ENABLE_PROFILERS
+#include "support/CCProfiling.h"
+#endif // CC_ENABLE_PROFILERS
+
 #include <fstream>
+#include <vector>
 using namespace std;
 
 NS_CC_BEGIN
@@ -60,8 +68,18 @@ static CCTexture2DPixelFormat g_defaultAlphaPixelFormat = kCCTexture2DPixelForma
 // By default PVR images are treated as if they don't have the alpha channel premultiplied
 static bool PVRHaveAlphaPremultiplied_ = false;
 
+// By default images are loaded without mipmaps
+static bool g_bGenerateMipmapsOnLoad = false;
+
 ID3D11ShaderResourceView* CCTexture2D::getTextureResource()
 {
+	// the resource is fetched to be bound for drawing: stamp the texture for the LRU of CCTextureCache
+	m_uLastUsedFrame = CCDirector::sharedDirector()->getTotalFrames();
+	if (m_pTextureResource == NULL && m_pPendingLevels)
+	{
+		// not created yet: draw the placeholder meanwhile
+		return CCGPUUploadQueue::sharedGPUUploadQueue()->getPlaceholderTexture()->getTextureResource();
+	}
 	return m_pTextureResource;
 }
 
@@ -73,6 +91,10 @@ CCTexture2D::CCTexture2D()
 , m_fMaxT(0.0)
 , m_bHasPremultipliedAlpha(false)
 , m_bPVRHaveAlphaPremultiplied(true)
+, m_uMipmapLevels(0)
+, m_uLastUsedFrame(0)
+, m_bDeferredUpload(false)
+, m_pPendingLevels(NULL)
 {
 	m_pTextureResource=0;
 	m_sampleState = 0;
@@ -86,6 +108,12 @@ CCTexture2D::~CCTexture2D()
 
 	CCLOGINFO("cocos2d: deallocing CCTexture2D %u.", m_uName);
 
+	if (m_pPendingLevels)
+	{
+		CCGPUUploadQueue::sharedGPUUploadQueue()->removeUpload(this);
+		CC_SAFE_DELETE_ARRAY(m_pPendingLevels);
+	}
+
 	// Release the texture resource.
 	if(m_pTextureResource)
 	{
@@ -182,89 +210,253 @@ bool CCTexture2D::hasPremultipliedAlpha()
 	return m_bHasPremultipliedAlpha;
 }
 
-bool CCTexture2D::initWithData(const void *data, CCTexture2DPixelFormat pixelFormat, unsigned int pixelsWide, unsigned int pixelsHigh, const CCSize& contentSize)
+void CCTexture2D::setHasPremultipliedAlpha(bool hasPremultipliedAlpha)
+{
+	m_bHasPremultipliedAlpha = hasPremultipliedAlpha;
+}
+
+// DXGI format and size of a pixel of the textures created in pixelFormat, 0 for the block compressed formats
+static bool textureFormatForPixelFormat(CCTexture2DPixelFormat pixelFormat, DXGI_FORMAT *pFormat, unsigned int *pBytesPerPixel)
 {
-	int formatTmp = DXGI_FORMAT_R8G8B8A8_UNORM;
-	int dataSizeByte = 4;
-	/*==
-	glPixelStorei(CC_UNPACK_ALIGNMENT,1);
-	glGenTextures(1, &m_uName);
-	glBindTexture(CC_TEXTURE_2D, m_uName);
-	==*/
-	this->setAntiAliasTexParameters();
-	
 	// Specify OpenGL texture image
 	switch(pixelFormat)
 	{
 	case kCCTexture2DPixelFormat_RGBA8888:
-		formatTmp = DXGI_FORMAT_R8G8B8A8_UNORM;
-		dataSizeByte = 4;
+		*pFormat = DXGI_FORMAT_R8G8B8A8_UNORM;
+		*pBytesPerPixel = 4;
 		//info.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
 		//=glTexImage2D(CC_TEXTURE_2D, 0, CC_RGBA, (GLsizei)pixelsWide, (GLsizei)pixelsHigh, 0, CC_RGBA, CC_UNSIGNED_BYTE, data);
 		break;
 	case kCCTexture2DPixelFormat_RGB888:
-		dataSizeByte = 4;
-		formatTmp = DXGI_FORMAT_R8G8B8A8_UNORM;
+		*pBytesPerPixel = 4;
+		*pFormat = DXGI_FORMAT_R8G8B8A8_UNORM;
 		//info.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
 		//=glTexImage2D(CC_TEXTURE_2D, 0, CC_RGB, (GLsizei)pixelsWide, (GLsizei)pixelsHigh, 0, CC_RGB, CC_UNSIGNED_BYTE, data);
 		break;
 	case kCCTexture2DPixelFormat_RGBA4444:
-		dataSizeByte = 4;
-		formatTmp = DXGI_FORMAT_B4G4R4A4_UNORM;
+		*pBytesPerPixel = 2;
+		*pFormat = DXGI_FORMAT_B4G4R4A4_UNORM;
 		//info.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
 		//=glTexImage2D(CC_TEXTURE_2D, 0, CC_RGBA, (GLsizei)pixelsWide, (GLsizei)pixelsHigh, 0, CC_RGBA, CC_UNSIGNED_SHORT_4_4_4_4, data);
 		break;
 	case kCCTexture2DPixelFormat_RGB5A1:
-		dataSizeByte = 2;
-		formatTmp = DXGI_FORMAT_B5G5R5A1_UNORM;
+		*pBytesPerPixel = 2;
+		*pFormat = DXGI_FORMAT_B5G5R5A1_UNORM;
 		//info.Format = DXGI_FORMAT_B5G5R5A1_UNORM;
 		//=glTexImage2D(CC_TEXTURE_2D, 0, CC_RGBA, (GLsizei)pixelsWide, (GLsizei)pixelsHigh, 0, CC_RGBA, CC_UNSIGNED_SHORT_5_5_5_1, data);
 		break;
 	case kCCTexture2DPixelFormat_RGB565:
-		dataSizeByte = 2;
-		formatTmp = DXGI_FORMAT_B5G6R5_UNORM;
+		*pBytesPerPixel = 2;
+		*pFormat = DXGI_FORMAT_B5G6R5_UNORM;
 		//info.Format = DXGI_FORMAT_B5G6R5_UNORM;
 		//=glTexImage2D(CC_TEXTURE_2D, 0, CC_RGB, (GLsizei)pixelsWide, (GLsizei)pixelsHigh, 0, CC_RGB, CC_UNSIGNED_SHORT_5_6_5, data);
 		break;
 	case kCCTexture2DPixelFormat_AI88:
-		dataSizeByte = 2;
-		formatTmp = DXGI_FORMAT_R8G8_UNORM;
+		*pBytesPerPixel = 2;
+		*pFormat = DXGI_FORMAT_R8G8_UNORM;
 		//info.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
 		//=glTexImage2D(CC_TEXTURE_2D, 0, CC_LUMINANCE_ALPHA, (GLsizei)pixelsWide, (GLsizei)pixelsHigh, 0, CC_LUMINANCE_ALPHA, CC_UNSIGNED_BYTE, data);
 		break;
 	case kCCTexture2DPixelFormat_A8:
-		dataSizeByte = 1;
-		formatTmp = DXGI_FORMAT_A8_UNORM;
+		*pBytesPerPixel = 1;
+		*pFormat = DXGI_FORMAT_A8_UNORM;
 		//info.Format = DXGI_FORMAT_A8_UNORM;
 		//=glTexImage2D(CC_TEXTURE_2D, 0, CC_ALPHA, (GLsizei)pixelsWide, (GLsizei)pixelsHigh, 0, CC_ALPHA, CC_UNSIGNED_BYTE, data);
 		break;
+	case kCCTexture2DPixelFormat_BC1:
+		*pBytesPerPixel = 0;
+		*pFormat = DXGI_FORMAT_BC1_UNORM;
+		break;
+	case kCCTexture2DPixelFormat_BC3:
+		*pBytesPerPixel = 0;
+		*pFormat = DXGI_FORMAT_BC3_UNORM;
+		break;
 	default:
-		CCAssert(0, "NSInternalInconsistencyException");
+		return false;
+	}
+	return true;
+}
+
+// bytes of a row of a level and number of rows; the rows of the block compressed formats are 4 pixels high
+static unsigned int textureLevelPitch(CCTexture2DPixelFormat pixelFormat, unsigned int bytesPerPixel, unsigned int width, unsigned int height, unsigned int *pRows)
+{
+	unsigned int blockSize = ccBlockSizeForPixelFormat(pixelFormat);
+	if (blockSize)
+	{
+		*pRows = (height + 3) / 4;
+		return (width + 3) / 4 * blockSize;
+	}
+	*pRows = height;
+	return width * bytesPerPixel;
+}
+
+bool CCTexture2D::initWithData(const void *data, CCTexture2DPixelFormat pixelFormat, unsigned int pixelsWide, unsigned int pixelsHigh, const CCSize& contentSize)
+{
+	return initWithMipmaps(&data, 1, pixelFormat, pixelsWide, pixelsHigh, contentSize);
+}
+
+bool CCTexture2D::initWithMipmaps(const void **levels, unsigned int levelCount, CCTexture2DPixelFormat pixelFormat, unsigned int pixelsWide, unsigned int pixelsHigh, const CCSize& contentSize)
+{
+	/*==
+	glPixelStorei(CC_UNPACK_ALIGNMENT,1);
+	glGenTextures(1, &m_uName);
+	glBindTexture(CC_TEXTURE_2D, m_uName);
+	==*/
+	// a file may list more levels than a texture can have: the texture and m_uMipmapLevels keep the first ones
+	if (levelCount > D3D11_REQ_MIP_LEVELS)
+	{
+		levelCount = D3D11_REQ_MIP_LEVELS;
+	}
+
+	if (levelCount > 1)
+	{
+		ccTexParams texParams = { CC_LINEAR_MIPMAP_LINEAR, CC_LINEAR, CC_CLAMP_TO_EDGE, CC_CLAMP_TO_EDGE };
+		this->setTexParameters(&texParams);
+	}
+	else
+	{
+		this->setAntiAliasTexParameters();
+	}
+
+	// a previous init may still be waiting for its upload
+	if (m_pPendingLevels)
+	{
+		CCGPUUploadQueue::sharedGPUUploadQueue()->removeUpload(this);
+		CC_SAFE_DELETE_ARRAY(m_pPendingLevels);
+	}
+
+	if (! (m_bDeferredUpload && queueTextureResource(levels, levelCount, pixelFormat, pixelsWide, pixelsHigh))
+		&& ! createTextureResource(levels, levelCount, pixelFormat, pixelsWide, pixelsHigh))
+	{
+		return false;
+	}
+
+	m_tContentSize = contentSize;
+	m_uPixelsWide = pixelsWide;
+	m_uPixelsHigh = pixelsHigh;
+	m_ePixelFormat = pixelFormat;
+	m_fMaxS = contentSize.width / (float)(pixelsWide);
+	m_fMaxT = contentSize.height / (float)(pixelsHigh);
+
+	m_bHasPremultipliedAlpha = false;
+
+	m_eResolutionType = kCCResolutionUnknown;
+
+	return true;
+}
+
+bool CCTexture2D::queueTextureResource(const void **levels, unsigned int levelCount, CCTexture2DPixelFormat pixelFormat, unsigned int pixelsWide, unsigned int pixelsHigh)
+{
+	DXGI_FORMAT format;
+	unsigned int bytesPerPixel;
+	if (levels[0] == NULL || CCGPUUploadQueue::sharedGPUUploadQueue()->getBytesPerFrame() == 0
+		|| ! textureFormatForPixelFormat(pixelFormat, &format, &bytesPerPixel))
+	{
+		return false;
+	}
+	CCAssert(levelCount >= 1 && levelCount <= D3D11_REQ_MIP_LEVELS, "Invalid number of mipmap levels");
+
+	// the caller frees the levels once init returns: keep a copy until the upload
+	unsigned int levelSizes[D3D11_REQ_MIP_LEVELS];
+	unsigned int bytes = 0;
+	for (unsigned int i = 0; i < levelCount; ++i)
+	{
+		unsigned int levelWide = pixelsWide >> i ? pixelsWide >> i : 1;
+		unsigned int levelHigh = pixelsHigh >> i ? pixelsHigh >> i : 1;
+		unsigned int rows;
+		levelSizes[i] = textureLevelPitch(pixelFormat, bytesPerPixel, levelWide, levelHigh, &rows) * rows;
+		bytes += levelSizes[i];
+	}
+	m_pPendingLevels = new unsigned char[bytes];
+	unsigned char *dst = m_pPendingLevels;
+	for (unsigned int i = 0; i < levelCount; ++i)
+	{
+		memcpy(dst, levels[i], levelSizes[i]);
+		dst += levelSizes[i];
+	}
+
+	// a texture re-initialized while it waits draws the placeholder, not its previous content
+	if (m_pTextureResource)
+	{
+		m_pTextureResource->Release();
+		m_pTextureResource = NULL;
+		m_uName = 0;
+	}
+	m_uMipmapLevels = levelCount;
+	CCGPUUploadQueue::sharedGPUUploadQueue()->addUpload(this, bytes);
+	return true;
+}
 
+void CCTexture2D::uploadGPUResources()
+{
+	if (m_pPendingLevels == NULL)
+	{
+		return;
 	}
+
+	DXGI_FORMAT format;
+	unsigned int bytesPerPixel;
+	textureFormatForPixelFormat(m_ePixelFormat, &format, &bytesPerPixel);
+
+	const void *levels[D3D11_REQ_MIP_LEVELS];
+	const unsigned char *src = m_pPendingLevels;
+	for (unsigned int i = 0; i < m_uMipmapLevels; ++i)
+	{
+		unsigned int levelWide = m_uPixelsWide >> i ? m_uPixelsWide >> i : 1;
+		unsigned int levelHigh = m_uPixelsHigh >> i ? m_uPixelsHigh >> i : 1;
+		unsigned int rows;
+		levels[i] = src;
+		src += textureLevelPitch(m_ePixelFormat, bytesPerPixel, levelWide, levelHigh, &rows) * rows;
+	}
+
+	if (! createTextureResource(levels, m_uMipmapLevels, m_ePixelFormat, m_uPixelsWide, m_uPixelsHigh))
+	{
+		CCLOG("cocos2d: CCTexture2D: Couldn't create the %u x %u texture queued for upload", m_uPixelsWide, m_uPixelsHigh);
+	}
+	CC_SAFE_DELETE_ARRAY(m_pPendingLevels);
+}
+
+bool CCTexture2D::createTextureResource(const void **levels, unsigned int levelCount, CCTexture2DPixelFormat pixelFormat, unsigned int pixelsWide, unsigned int pixelsHigh)
+{
+	DXGI_FORMAT format;
+	unsigned int bytesPerPixel;
+	if (! textureFormatForPixelFormat(pixelFormat, &format, &bytesPerPixel))
+	{
+		CCAssert(0, "NSInternalInconsistencyException");
+		return false;
+	}
+	CCAssert(levelCount >= 1 && levelCount <= D3D11_REQ_MIP_LEVELS, "Invalid number of mipmap levels");
+
 	ID3D11Device *pdevice = CCDirector::sharedDirector()->getOpenGLView()->GetDevice();
 	ID3D11Texture2D *tex;
 	D3D11_TEXTURE2D_DESC tdesc;
-	D3D11_SUBRESOURCE_DATA tbsd;
-	tbsd.pSysMem = data;
-	tbsd.SysMemPitch = pixelsWide*dataSizeByte;
-	tbsd.SysMemSlicePitch = pixelsWide*pixelsHigh*dataSizeByte; // Not needed since this is a 2d texture
+	D3D11_SUBRESOURCE_DATA tbsd[D3D11_REQ_MIP_LEVELS];
+	for (unsigned int i = 0; i < levelCount; ++i)
+	{
+		unsigned int levelWide = pixelsWide >> i ? pixelsWide >> i : 1;
+		unsigned int levelHigh = pixelsHigh >> i ? pixelsHigh >> i : 1;
+		unsigned int rows;
+		tbsd[i].pSysMem = levels[i];
+		tbsd[i].SysMemPitch = textureLevelPitch(pixelFormat, bytesPerPixel, levelWide, levelHigh, &rows);
+		tbsd[i].SysMemSlicePitch = tbsd[i].SysMemPitch * rows; // Not needed since this is a 2d texture
+	}
 
 	tdesc.Width = pixelsWide;
 	tdesc.Height = pixelsHigh;
-	tdesc.MipLevels = 1;
+	tdesc.MipLevels = levelCount;
 	tdesc.ArraySize = 1;
 
 	tdesc.SampleDesc.Count = 1;
 	tdesc.SampleDesc.Quality = 0;
 	tdesc.Usage = D3D11_USAGE_DEFAULT;
-	tdesc.Format = (DXGI_FORMAT)formatTmp;
-	tdesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+	tdesc.Format = format;
+	// compressed textures can't be rendered to
+	tdesc.BindFlags = bytesPerPixel ? D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE : D3D11_BIND_SHADER_RESOURCE;
 
 	tdesc.CPUAccessFlags = 0;
 	tdesc.MiscFlags = 0;
 	
-	if(FAILED(pdevice->CreateTexture2D(&tdesc,&tbsd,&tex)))
+	if(FAILED(pdevice->CreateTexture2D(&tdesc,tbsd,&tex)))
 	{
 		return false;
 	}
@@ -281,29 +473,77 @@ bool CCTexture2D::initWithData(const void *data, CCTexture2DPixelFormat pixelFor
 	srvDesc.Texture2D.MostDetailedMip = 0;
 	srvDesc.Texture2D.MipLevels = desc.MipLevels;
 
-	// Create the shader resource view.
-	pdevice->CreateShaderResourceView( tex, &srvDesc, &m_pTextureResource );
-	m_uName = (CCuint)m_pTextureResource;
+	// Create the shader resource view, replacing the one of a previous init
+	ID3D11ShaderResourceView *pTextureResource = NULL;
+	HRESULT hr = pdevice->CreateShaderResourceView( tex, &srvDesc, &pTextureResource );
 	if ( tex )
 	{
 		tex->Release();
 		tex = 0;
 	}
-	
-	m_tContentSize = contentSize;
-	m_uPixelsWide = pixelsWide;
-	m_uPixelsHigh = pixelsHigh;
-	m_ePixelFormat = pixelFormat;
-	m_fMaxS = contentSize.width / (float)(pixelsWide);
-	m_fMaxT = contentSize.height / (float)(pixelsHigh);
-
-	m_bHasPremultipliedAlpha = false;
+	if (FAILED(hr))
+	{
+		return false;
+	}
 
-	m_eResolutionType = kCCResolutionUnknown;
+	if (m_pTextureResource)
+	{
+		m_pTextureResource->Release();
+	}
+	m_pTextureResource = pTextureResource;
+	m_uName = (CCuint)m_pTextureResource;
+	m_uMipmapLevels = levelCount;
+	m_uLastUsedFrame = CCDirector::sharedDirector()->getTotalFrames();
 
 	return true;
 }
 
+bool CCTexture2D::updateWithData(const void* data, unsigned int x, unsigned int y, unsigned int width, unsigned int height)
+{
+	CCAssert(data != NULL, "Invalid data");
+	if (m_pPendingLevels)
+	{
+		CCGPUUploadQueue::sharedGPUUploadQueue()->flushUpload(this);
+	}
+	if (m_pTextureResource == NULL || width == 0 || height == 0
+		|| x + width > m_uPixelsWide || y + height > m_uPixelsHigh)
+	{
+		return false;
+	}
+
+	DXGI_FORMAT format;
+	unsigned int bytesPerPixel;
+	if (! textureFormatForPixelFormat(m_ePixelFormat, &format, &bytesPerPixel) || bytesPerPixel == 0)
+	{
+		return false;
+	}
+
+	ID3D11Resource *pResource = NULL;
+	m_pTextureResource->GetResource(&pResource);
+	if (pResource == NULL)
+	{
+		return false;
+	}
+
+	D3D11_BOX box;
+	box.left = x;
+	box.top = y;
+	box.front = 0;
+	box.right = x + width;
+	box.bottom = y + height;
+	box.back = 1;
+	const unsigned char *pSrc = (const unsigned char*)data;
+	ID3D11DeviceContext *pContext = CCID3D11DeviceContext;
+	// the runtime recording a deferred context for the driver offsets the source by the box as well
+	if (pContext->GetType() == D3D11_DEVICE_CONTEXT_DEFERRED && ! CCD3DCLASS->HasDriverCommandLists())
+	{
+		pSrc -= y * width * bytesPerPixel + x * bytesPerPixel;
+	}
+	pContext->UpdateSubresource(pResource, 0, &box, pSrc, width * bytesPerPixel, 0);
+	pResource->Release();
+
+	return true;
+}
 
 char * CCTexture2D::description(void)
 {
@@ -319,36 +559,46 @@ bool CCTexture2D::initWithImage(CCImage * uiImage)
 	return initWithImage(uiImage, kCCResolutionUnknown);
 }
 
-bool CCTexture2D::initWithImage(CCImage * uiImage, ccResolutionType resolution)
+// size of the texture of a width x height image, false if the device can't create it
+static bool textureSizeForImage(unsigned int width, unsigned int height, unsigned int *pPOTWide, unsigned int *pPOTHigh)
 {
-	unsigned int POTWide, POTHigh;
-
-	if(uiImage == NULL)
-	{
-		CCLOG("cocos2d: CCTexture2D. Can't create Texture. UIImage is nil");
-		this->release();
-		return false;
-	}
-
 	CCConfiguration *conf = CCConfiguration::sharedConfiguration();
 
 #if CC_TEXTURE_NPOT_SUPPORT
 	if( conf->isSupportsNPOT() ) 
 	{
-		POTWide = uiImage->getWidth();
-		POTHigh = uiImage->getHeight();
+		*pPOTWide = width;
+		*pPOTHigh = height;
 	}
 	else 
 #endif
 	{
-		POTWide = ccNextPOT(uiImage->getWidth());
-		POTHigh = ccNextPOT(uiImage->getHeight());
+		*pPOTWide = ccNextPOT(width);
+		*pPOTHigh = ccNextPOT(height);
 	}
 
 	unsigned maxTextureSize = conf->getMaxTextureSize();
-	if( POTHigh > maxTextureSize || POTWide > maxTextureSize ) 
+	if( *pPOTHigh > maxTextureSize || *pPOTWide > maxTextureSize ) 
+	{
+		CCLOG("cocos2d: WARNING: Image (%u x %u) is bigger than the supported %u x %u", *pPOTWide, *pPOTHigh, maxTextureSize, maxTextureSize);
+		return false;
+	}
+	return true;
+}
+
+bool CCTexture2D::initWithImage(CCImage * uiImage, ccResolutionType resolution)
+{
+	unsigned int POTWide, POTHigh;
+
+	if(uiImage == NULL)
+	{
+		CCLOG("cocos2d: CCTexture2D. Can't create Texture. UIImage is nil");
+		this->release();
+		return false;
+	}
+
+	if (! textureSizeForImage(uiImage->getWidth(), uiImage->getHeight(), &POTWide, &POTHigh))
 	{
-		CCLOG("cocos2d: WARNING: Image (%u x %u) is bigger than the supported %u x %u", POTWide, POTHigh, maxTextureSize, maxTextureSize);
 		this->release();
 		return NULL;
 	}
@@ -358,28 +608,93 @@ bool CCTexture2D::initWithImage(CCImage * uiImage, ccResolutionType resolution)
 	// always load premultiplied images
 	return initPremultipliedATextureWithImage(uiImage, POTWide, POTHigh);
 }
-bool CCTexture2D::initPremultipliedATextureWithImage(CCImage *image, unsigned int POTWide, unsigned int POTHigh)
+
+// A8_UNORM can't be sampled on every feature level 9 device
+static bool isA8TextureSupported()
 {
-	unsigned char*			data = NULL;
-	unsigned char*			tempData =NULL;
-	unsigned int*			inPixel32 = NULL;
-	unsigned short*			outPixel16 = NULL;
-	bool					hasAlpha;
-	CCSize					imageSize;
-	CCTexture2DPixelFormat	pixelFormat;
+	static int s_nSupported = -1;
+	if (s_nSupported < 0)
+	{
+		UINT support = 0;
+		s_nSupported = SUCCEEDED(CCID3D11Device->CheckFormatSupport(DXGI_FORMAT_A8_UNORM, &support))
+			&& (support & D3D11_FORMAT_SUPPORT_TEXTURE2D) && (support & D3D11_FORMAT_SUPPORT_SHADER_SAMPLE) ? 1 : 0;
+	}
+	return s_nSupported == 1;
+}
 
-	hasAlpha = image->hasAlpha();
+// Builds the mipmap chain of a POT premultiplied RGBA8888 image, in pixelFormat.
+// levels receives every level, base included, and buffers what must be freed with delete[].
+// It only touches the pixels, so it is safe to call from any thread.
+static bool buildMipmapChain(const unsigned char *base, unsigned int width, unsigned int height, CCTexture2DPixelFormat pixelFormat,
+							 std::vector<const void*>& levels, std::vector<unsigned char*>& buffers)
+{
+	DXGI_FORMAT format;
+	unsigned int bytesPerPixel;
+	if (! textureFormatForPixelFormat(pixelFormat, &format, &bytesPerPixel))
+	{
+		return false;
+	}
+	bool convert = pixelFormat != kCCTexture2DPixelFormat_RGBA8888 && pixelFormat != kCCTexture2DPixelFormat_RGB888;
+	bool compress = ccBlockSizeForPixelFormat(pixelFormat) != 0;
 
-	size_t bpp = image->getBitsPerComponent();
+	const unsigned char *src = base;
+	for (;;)
+	{
+		if (convert)
+		{
+			unsigned char *level = new unsigned char[compress ? ccCompressedLevelSize(pixelFormat, width, height) : width * height * bytesPerPixel];
+			buffers.push_back(level);
+			bool bConverted = compress ? ccCompressImage(src, width, height, pixelFormat, level)
+				: ccConvertPixels(src, 4, level, pixelFormat, width * height);
+			if (! bConverted)
+			{
+				return false;
+			}
+			levels.push_back(level);
+		}
+		else
+		{
+			levels.push_back(src);
+		}
+
+		if (width == 1 && height == 1)
+		{
+			return true;
+		}
+
+		unsigned int nextWidth = width > 1 ? width / 2 : 1;
+		unsigned int nextHeight = height > 1 ? height / 2 : 1;
+		unsigned char *next = new unsigned char[nextWidth * nextHeight * 4];
+		buffers.push_back(next);
+		ccDownsampleRGBA8888(src, width, height, next, CC_TEXTURE_MIPMAP_GAMMA_CORRECT != 0);
+
+		src = next;
+		width = nextWidth;
+		height = nextHeight;
+	}
+}
+
+static void freeMipmapChain(std::vector<unsigned char*>& buffers)
+{
+	for (unsigned int i = 0; i < buffers.size(); ++i)
+	{
+		delete [] buffers[i];
+	}
+	buffers.clear();
+}
 
-    // compute pixel format
+// texture format of an image: the default alpha format for images with alpha, RGB888 for the others,
+// falling back to RGBA8888 when the device can't sample or create the format
+static CCTexture2DPixelFormat pixelFormatForImage(bool hasAlpha, unsigned int bitsPerComponent, unsigned int POTWide, unsigned int POTHigh)
+{
+	CCTexture2DPixelFormat pixelFormat;
 	if(hasAlpha)
 	{
 		pixelFormat = g_defaultAlphaPixelFormat;
 	}
 	else
 	{
-		if (bpp >= 8)
+		if (bitsPerComponent >= 8)
 		{
 			pixelFormat = kCCTexture2DPixelFormat_RGB888;
 		}
@@ -390,173 +705,204 @@ bool CCTexture2D::initPremultipliedATextureWithImage(CCImage *image, unsigned in
 		}
 	}
 
+	if (pixelFormat == kCCTexture2DPixelFormat_A8 && ! isA8TextureSupported())
+	{
+		CCLOG("cocos2d: CCTexture2D: A8 textures are not supported, using RGBA8888");
+		pixelFormat = kCCTexture2DPixelFormat_RGBA8888;
+	}
 
-	imageSize = CCSizeMake((float)(image->getWidth()), (float)(image->getHeight()));
+	// only BC1 and BC3 can be compressed and sampled, from whole blocks
+	if (ccBlockSizeForPixelFormat(pixelFormat) != 0
+		&& ((pixelFormat != kCCTexture2DPixelFormat_BC1 && pixelFormat != kCCTexture2DPixelFormat_BC3)
+			|| ! CCConfiguration::sharedConfiguration()->isSupportsBCTextures() || POTWide % 4 != 0 || POTHigh % 4 != 0))
+	{
+		CCLOG("cocos2d: CCTexture2D: Can't compress a %u x %u texture to format %d, using RGBA8888", POTWide, POTHigh, pixelFormat);
+		pixelFormat = kCCTexture2DPixelFormat_RGBA8888;
+	}
+	return pixelFormat;
+}
 
-	switch(pixelFormat) {          
-		case kCCTexture2DPixelFormat_RGBA8888:
-		case kCCTexture2DPixelFormat_RGBA4444:
-		case kCCTexture2DPixelFormat_RGB5A1:
-		case kCCTexture2DPixelFormat_RGB565:
-		case kCCTexture2DPixelFormat_A8:
-			tempData = (unsigned char*)(image->getData());
-			CCAssert(tempData != NULL, "NULL image data.");
+// format of the pixels laid out at the POT size before the upload: RGBA8888 when mipmaps are filtered
+// or blocks encoded from them, pixelFormat otherwise
+static CCTexture2DPixelFormat layoutFormatForPixelFormat(CCTexture2DPixelFormat pixelFormat, unsigned int POTWide, unsigned int POTHigh)
+{
+	if (ccBlockSizeForPixelFormat(pixelFormat) != 0
+		|| (g_bGenerateMipmapsOnLoad && POTWide == ccNextPOT(POTWide) && POTHigh == ccNextPOT(POTHigh)))
+	{
+		return kCCTexture2DPixelFormat_RGBA8888;
+	}
+	return pixelFormat;
+}
 
-			if(image->getWidth() == (short)POTWide && image->getHeight() == (short)POTHigh)
-			{
-				data = new unsigned char[POTHigh * POTWide * 4];
-				memcpy(data, tempData, POTHigh * POTWide * 4);
-			}
-			else
-			{
-				data = new unsigned char[POTHigh * POTWide * 4];
-				memset(data, 0, POTHigh * POTWide * 4);
+// Lays the rows of an image out as they are decoded: converted to the layout format at the POT size,
+// the extra pixels transparent black. The image is never held in its decoded form.
+class CCTextureImageDecoder : public CCImageDecodeDelegate
+{
+public:
+	CCTextureImageDecoder()
+	: m_pData(NULL)
+	, m_uPOTWide(0)
+	, m_uPOTHigh(0)
+	, m_uImageWidth(0)
+	, m_uImageBytesPerPixel(0)
+	, m_uBytesPerPixel(0)
+	, m_ePixelFormat(kCCTexture2DPixelFormat_Default)
+	, m_eLayoutFormat(kCCTexture2DPixelFormat_Default)
+	{
+	}
 
-				unsigned char* pPixelData = (unsigned char*) tempData;
-				unsigned char* pTargetData = (unsigned char*) data;
+	virtual ~CCTextureImageDecoder()
+	{
+		CC_SAFE_DELETE_ARRAY(m_pData);
+	}
 
-                int imageHeight = image->getHeight();
-				for(int y = 0; y < imageHeight; ++y)
-				{
-					memcpy(pTargetData+POTWide*4*y, pPixelData+(image->getWidth())*4*y, (image->getWidth())*4);
-				}
-			}
+	virtual bool imageWillDecode(CCImage *pImage)
+	{
+		m_uImageWidth = pImage->getWidth();
+		unsigned int imageHeight = pImage->getHeight();
+		if (! textureSizeForImage(m_uImageWidth, imageHeight, &m_uPOTWide, &m_uPOTHigh))
+		{
+			return false;
+		}
 
-			break;    
-		case kCCTexture2DPixelFormat_RGB888:
-			tempData = (unsigned char*)(image->getData());
-			CCAssert(tempData != NULL, "NULL image data.");
-			data = new unsigned char[POTHigh * POTWide * 4];
-			memset(data, 0, POTHigh * POTWide * 4);
-			if(image->getWidth() == (short)POTWide && image->getHeight() == (short)POTHigh)
-			{
-				for (int i = 0; i < POTHigh; ++i)
-				{
-					for (int j = 0; j < POTWide; ++j)
-					{
-						int m = (i * POTWide * 4) + (j * 4);
-						int n = (i * POTWide * 3) + (j * 3);
-						data[m+0] = tempData[n+0];
-						data[m+1] = tempData[n+1];
-						data[m+2] = tempData[n+2];
-						data[m+3] = 255;
-					}
-				}
-			}
-			else
-			{
-				int imagewidth = image->getWidth();
-				int imageHeight = image->getHeight();
-				for (int i = 0; i < imageHeight; ++i)
-				{
-					for (int j = 0; j < imagewidth; ++j)
-					{
-						int m = (i * POTWide * 4) + (j * 4);
-						int n = (i * imagewidth * 3) + (j * 3);
-						data[m+0] = tempData[n+0];
-						data[m+1] = tempData[n+1];
-						data[m+2] = tempData[n+2];
-						data[m+3] = 255;
-					}
-				}
-			}
-			break;   
-		default:
+		m_ePixelFormat = pixelFormatForImage(pImage->hasAlpha(), pImage->getBitsPerComponent(), m_uPOTWide, m_uPOTHigh);
+		m_eLayoutFormat = layoutFormatForPixelFormat(m_ePixelFormat, m_uPOTWide, m_uPOTHigh);
+		DXGI_FORMAT format;
+		if (! textureFormatForPixelFormat(m_eLayoutFormat, &format, &m_uBytesPerPixel) || m_uBytesPerPixel == 0)
+		{
 			CCAssert(0, "Invalid pixel format");
+			return false;
+		}
+		// images with alpha are decoded to RGBA8888, the others to RGB888
+		m_uImageBytesPerPixel = pImage->hasAlpha() ? 4 : 3;
+
+		unsigned int pitch = m_uPOTWide * m_uBytesPerPixel;
+		m_pData = new unsigned char[pitch * m_uPOTHigh];
+		memset(m_pData + imageHeight * pitch, 0, (m_uPOTHigh - imageHeight) * pitch);
+		return true;
 	}
 
-	// Repack the pixel data into the right format
+	virtual void imageDidDecodeRow(CCImage *pImage, unsigned int row, unsigned char *pPixels)
+	{
+		CC_UNUSED_PARAM(pImage);
+		unsigned char *dst = m_pData + row * m_uPOTWide * m_uBytesPerPixel;
+		ccConvertPixels(pPixels, m_uImageBytesPerPixel, dst, m_eLayoutFormat, m_uImageWidth);
+		memset(dst + m_uImageWidth * m_uBytesPerPixel, 0, (m_uPOTWide - m_uImageWidth) * m_uBytesPerPixel);
+	}
 
-	if(pixelFormat == kCCTexture2DPixelFormat_RGB565) {
-		//Convert "RRRRRRRRRGGGGGGGGBBBBBBBBAAAAAAAA" to "RRRRRGGGGGGBBBBB"
-		tempData = new unsigned char[POTHigh * POTWide * 2];
-		inPixel32 = (unsigned int*)data;
-		outPixel16 = (unsigned short*)tempData;
+	const unsigned char *getData() const { return m_pData; }
+	CCTexture2DPixelFormat getPixelFormat() const { return m_ePixelFormat; }
+	unsigned int getPOTWide() const { return m_uPOTWide; }
+	unsigned int getPOTHigh() const { return m_uPOTHigh; }
+
+private:
+	unsigned char *m_pData;
+	unsigned int m_uPOTWide;
+	unsigned int m_uPOTHigh;
+	unsigned int m_uImageWidth;
+	unsigned int m_uImageBytesPerPixel;
+	unsigned int m_uBytesPerPixel;
+	CCTexture2DPixelFormat m_ePixelFormat;
+	CCTexture2DPixelFormat m_eLayoutFormat;
+};
+
+bool CCTexture2D::initWithImageFile(const char *fullpath, CCImage::EImageFormat imageType, ccResolutionType resolution)
+{
+	CCImage image;
+	CCTextureImageDecoder decoder;
 
-		unsigned int length = POTWide * POTHigh;
-		for(unsigned int i = 0; i < length; ++i, ++inPixel32)
-		{
-			*outPixel16++ = 
-				((((*inPixel32 >> 0) & 0xFF) >> 3) << 11) |  // R
-				((((*inPixel32 >> 8) & 0xFF) >> 2) << 5) |   // G
-				((((*inPixel32 >> 16) & 0xFF) >> 3) << 0);   // B
-		}
+	CC_PROFILER_START("CCTexture2D - decode image");
+	bool bDecoded = image.initWithImageFileThreadSafe(fullpath, imageType, &decoder);
+	CC_PROFILER_STOP("CCTexture2D - decode image");
 
-		delete [] data;
-		data = tempData;
+	if (! bDecoded)
+	{
+		CCLOG("cocos2d: CCTexture2D. Can't decode %s", fullpath);
+		return false;
 	}
-	else if (pixelFormat == kCCTexture2DPixelFormat_RGBA4444) {
-		//Convert "RRRRRRRRRGGGGGGGGBBBBBBBBAAAAAAAA" to "RRRRGGGGBBBBAAAA"
-		tempData = new unsigned char[POTHigh * POTWide * 2];
-		inPixel32 = (unsigned int*)data;
-		outPixel16 = (unsigned short*)tempData;
 
-		unsigned int length = POTWide * POTHigh;
-		for(unsigned int i = 0; i < length; ++i, ++inPixel32)
-		{
-			*outPixel16++ = 
-			((((*inPixel32 >> 0) & 0xFF) >> 4) << 12) | // R
-			((((*inPixel32 >> 8) & 0xFF) >> 4) << 8) | // G
-			((((*inPixel32 >> 16) & 0xFF) >> 4) << 4) | // B
-			((((*inPixel32 >> 24) & 0xFF) >> 4) << 0); // A
-		}
+	m_eResolutionType = resolution;
 
-		delete [] data;
-		data = tempData;
-	}
-	else if (pixelFormat == kCCTexture2DPixelFormat_RGB5A1) {
-		//Convert "RRRRRRRRRGGGGGGGGBBBBBBBBAAAAAAAA" to "RRRRRGGGGGBBBBBA"
-		tempData = new unsigned char[POTHigh * POTWide * 2];
-		inPixel32 = (unsigned int*)data;
-		outPixel16 = (unsigned short*)tempData;
+	CCSize imageSize = CCSizeMake((float)(image.getWidth()), (float)(image.getHeight()));
+	bool bRet = initWithTextureLayout(decoder.getData(), decoder.getPixelFormat(), decoder.getPOTWide(), decoder.getPOTHigh(), imageSize);
+	m_bHasPremultipliedAlpha = image.isPremultipliedAlpha();
+	return bRet;
+}
 
-		unsigned int length = POTWide * POTHigh;
-		for(unsigned int i = 0; i < length; ++i, ++inPixel32)
+bool CCTexture2D::initWithTextureLayout(const unsigned char *data, CCTexture2DPixelFormat pixelFormat, unsigned int POTWide, unsigned int POTHigh, const CCSize& imageSize)
+{
+	if (g_bGenerateMipmapsOnLoad && POTWide == ccNextPOT(POTWide) && POTHigh == ccNextPOT(POTHigh))
+	{
+		// the levels are filtered in RGBA8888, then converted one by one
+		CC_PROFILER_START("CCTexture2D - build mipmaps");
+		std::vector<const void*> levels;
+		std::vector<unsigned char*> buffers;
+		bool bRet = buildMipmapChain(data, POTWide, POTHigh, pixelFormat, levels, buffers);
+		CC_PROFILER_STOP("CCTexture2D - build mipmaps");
+
+		if (bRet)
 		{
- 			*outPixel16++ = 
-			((((*inPixel32 >> 0) & 0xFF) >> 3) << 11) | // R
-			((((*inPixel32 >> 8) & 0xFF) >> 3) << 6) | // G
-			((((*inPixel32 >> 16) & 0xFF) >> 3) << 1) | // B
-			((((*inPixel32 >> 24) & 0xFF) >> 7) << 0); // A
+			bRet = this->initWithMipmaps(&levels[0], (unsigned int)levels.size(), pixelFormat, POTWide, POTHigh, imageSize);
 		}
-
-		delete []data;
-		data = tempData;
+		freeMipmapChain(buffers);
+		return bRet;
 	}
-	else if (pixelFormat == kCCTexture2DPixelFormat_A8)
+
+	if (ccBlockSizeForPixelFormat(pixelFormat) != 0)
 	{
-		// fix me, how to convert to A8
-		pixelFormat = kCCTexture2DPixelFormat_RGBA8888;
+		// the blocks are encoded from the RGBA8888 layout
+		CC_PROFILER_START("CCTexture2D - compress pixels");
+		unsigned char *blocks = new unsigned char[ccCompressedLevelSize(pixelFormat, POTWide, POTHigh)];
+		ccCompressImage(data, POTWide, POTHigh, pixelFormat, blocks);
+		CC_PROFILER_STOP("CCTexture2D - compress pixels");
+
+		bool bRet = this->initWithData(blocks, pixelFormat, POTWide, POTHigh, imageSize);
+		delete [] blocks;
+		return bRet;
+	}
 
-		/*
-		 * The code can not work, how to convert to A8?
-		 *
-		tempData = new unsigned char[POTHigh * POTWide];
-		inPixel32 = (unsigned int*)data;
-		outPixel8 = tempData;
+	return this->initWithData(data, pixelFormat, POTWide, POTHigh, imageSize);
+}
 
-		unsigned int length = POTWide * POTHigh;
-		for(unsigned int i = 0; i < length; ++i, ++inPixel32)
+bool CCTexture2D::initPremultipliedATextureWithImage(CCImage *image, unsigned int POTWide, unsigned int POTHigh)
+{
+	bool hasAlpha = image->hasAlpha();
+	CCTexture2DPixelFormat pixelFormat = pixelFormatForImage(hasAlpha, image->getBitsPerComponent(), POTWide, POTHigh);
+	CCTexture2DPixelFormat layoutFormat = layoutFormatForPixelFormat(pixelFormat, POTWide, POTHigh);
+	CCSize imageSize = CCSizeMake((float)(image->getWidth()), (float)(image->getHeight()));
+
+	const unsigned char *imageData = image->getData();
+	CCAssert(imageData != NULL, "NULL image data.");
+
+	// images with alpha are RGBA8888, the others RGB888
+	unsigned int imageBytesPerPixel = hasAlpha ? 4 : 3;
+	unsigned int imageWidth = image->getWidth();
+	unsigned int imageHeight = image->getHeight();
+
+	// Repack the pixel data into the layout format and the POT size, in one pass,
+	// unless the image can be uploaded as is
+	unsigned char *data = NULL;
+	if (layoutFormat != kCCTexture2DPixelFormat_RGBA8888 || imageBytesPerPixel != 4
+		|| imageWidth != POTWide || imageHeight != POTHigh)
+	{
+		CC_PROFILER_START("CCTexture2D - convert pixels");
+		data = ccConvertImageToTextureData(imageData, imageBytesPerPixel, imageWidth, imageHeight,
+			layoutFormat, POTWide, POTHigh);
+		CC_PROFILER_STOP("CCTexture2D - convert pixels");
+
+		if (! data)
 		{
-			*outPixel8++ = (*inPixel32 >> 24) & 0xFF;
+			CCAssert(0, "Invalid pixel format");
+			return false;
 		}
-
-		delete []data;
-		data = tempData;
-		*/
 	}
 
-	if (data)
-	{
-		//CCAssert(this->initWithData(data, pixelFormat, POTWide, POTHigh, imageSize), "Create texture failed!");
-		this->initWithData(data, pixelFormat, POTWide, POTHigh, imageSize);
-		// should be after calling super init
-		m_bHasPremultipliedAlpha = image->isPremultipliedAlpha();
+	bool bRet = initWithTextureLayout(data ? data : imageData, pixelFormat, POTWide, POTHigh, imageSize);
+	// should be after calling super init
+	m_bHasPremultipliedAlpha = image->isPremultipliedAlpha();
 
-		//CGContextRelease(context);
-		delete [] data;
-	}
-	return true;
+	delete [] data;
+	return bRet;
 }
 
 // implementation CCTexture2D (Text)
@@ -703,18 +1049,17 @@ bool CCTexture2D::initWithPVRFile(const char* file)
         
     if (bRet)
     {
-        pvr->setRetainName(true); // don't dealloc texture on release
-        
-        m_uName = pvr->getName();
-        m_fMaxS = 1.0f;
-        m_fMaxT = 1.0f;
-        m_uPixelsWide = pvr->getWidth();
-        m_uPixelsHigh = pvr->getHeight();
-        m_tContentSize = CCSizeMake((float)m_uPixelsWide, (float)m_uPixelsHigh);
-        m_bHasPremultipliedAlpha = PVRHaveAlphaPremultiplied_;
-        m_ePixelFormat = pvr->getFormat();
-                
-        this->setAntiAliasTexParameters();
+        // the levels point into the pvr, valid until it is released
+        const void *levels[CC_PVRMIPMAP_MAX];
+        for (unsigned int i = 0; i < pvr->getNumberOfMipmaps(); ++i)
+        {
+            levels[i] = pvr->getMipmaps()[i].address;
+        }
+
+        unsigned int width = pvr->getWidth();
+        unsigned int height = pvr->getHeight();
+        bRet = this->initWithMipmaps(levels, pvr->getNumberOfMipmaps(), pvr->getFormat(), width, height, CCSizeMake((float)width, (float)height));
+        m_bHasPremultipliedAlpha = pvr->isForcePremultipliedAlpha() || PVRHaveAlphaPremultiplied_;
         pvr->release();
     }
     else
@@ -740,6 +1085,83 @@ void CCTexture2D::generateMipmap()
 {
 
 	CCAssert( m_uPixelsWide == ccNextPOT(m_uPixelsWide) && m_uPixelsHigh == ccNextPOT(m_uPixelsHigh), "Mimpap texture only works in POT textures");
+	if (m_pPendingLevels)
+	{
+		CCGPUUploadQueue::sharedGPUUploadQueue()->flushUpload(this);
+	}
+	if (m_pTextureResource == NULL)
+	{
+		return;
+	}
+	if (m_ePixelFormat != kCCTexture2DPixelFormat_RGBA8888 && m_ePixelFormat != kCCTexture2DPixelFormat_RGB888)
+	{
+		CCLOG("cocos2d: CCTexture2D: mipmaps can only be generated from 32-bit textures, use setGenerateMipmapsOnLoad");
+		return;
+	}
+
+	ID3D11Resource *pResource = NULL;
+	m_pTextureResource->GetResource(&pResource);
+	if (pResource == NULL)
+	{
+		return;
+	}
+
+	D3D11_TEXTURE2D_DESC desc;
+	((ID3D11Texture2D*)pResource)->GetDesc(&desc);
+	if (desc.MipLevels > 1)
+	{
+		// already has its mipmaps
+		pResource->Release();
+		return;
+	}
+
+	// read the pixels back through a staging copy
+	ID3D11Texture2D *pStagingTexture = NULL;
+	desc.Usage = D3D11_USAGE_STAGING;
+	desc.BindFlags = 0;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+	desc.MiscFlags = 0;
+	if (FAILED(CCID3D11Device->CreateTexture2D(&desc, NULL, &pStagingTexture)))
+	{
+		pResource->Release();
+		return;
+	}
+	// read back on the CPU: the commands recorded so far must have run
+	CCRenderPipeline::sharedRenderPipeline()->sync();
+	ID3D11DeviceContext *pContext = CCD3DCLASS->GetImmediateDeviceContext();
+	pContext->CopyResource(pStagingTexture, pResource);
+	pResource->Release();
+
+	unsigned char *base = NULL;
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (SUCCEEDED(pContext->Map(pStagingTexture, 0, D3D11_MAP_READ, 0, &mapped)))
+	{
+		unsigned int pitch = m_uPixelsWide * 4;
+		base = new unsigned char[pitch * m_uPixelsHigh];
+		for (unsigned int y = 0; y < m_uPixelsHigh; ++y)
+		{
+			memcpy(base + y * pitch, (unsigned char*)mapped.pData + y * mapped.RowPitch, pitch);
+		}
+		pContext->Unmap(pStagingTexture, 0);
+	}
+	pStagingTexture->Release();
+
+	if (base == NULL)
+	{
+		return;
+	}
+
+	CC_PROFILER_START("CCTexture2D - build mipmaps");
+	std::vector<const void*> levels;
+	std::vector<unsigned char*> buffers;
+	if (buildMipmapChain(base, m_uPixelsWide, m_uPixelsHigh, m_ePixelFormat, levels, buffers))
+	{
+		createTextureResource(&levels[0], (unsigned int)levels.size(), m_ePixelFormat, m_uPixelsWide, m_uPixelsHigh);
+	}
+	CC_PROFILER_STOP("CCTexture2D - build mipmaps");
+
+	freeMipmapChain(buffers);
+	delete [] base;
 }
 
  void CCTexture2D::setTexParameters(ccTexParams *texParams)
@@ -753,6 +1175,7 @@ void CCTexture2D::generateMipmap()
 	int filter = -1;
 	int u = -1;
 	int v = -1;
+	float maxLOD = D3D11_FLOAT32_MAX;
 	bool bcreat = true;
 	ZeroMemory(&samplerDesc,sizeof(D3D11_SAMPLER_DESC));
 	if ( m_sampleState )
@@ -763,6 +1186,12 @@ void CCTexture2D::generateMipmap()
 		v = samplerDesc.AddressV;
 	}
 
+	// without a mipmap min filter, only the base level is sampled, as in OpenGL
+	if ( texParams->minFilter == CC_NEAREST || texParams->minFilter == CC_LINEAR )
+	{
+		maxLOD = 0.0f;
+	}
+
 	if ( texParams->magFilter == CC_NEAREST )
 	{
 		switch(texParams->minFilter)
@@ -774,13 +1203,13 @@ void CCTexture2D::generateMipmap()
 			filter = D3D11_FILTER_MIN_LINEAR_MAG_MIP_POINT;
 			break;
 		case CC_NEAREST_MIPMAP_NEAREST:
-			filter = D3D11_FILTER_MIN_POINT_MAG_MIP_LINEAR;
+			filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
 			break;
 		case CC_LINEAR_MIPMAP_NEAREST:
-			filter = D3D11_FILTER_MIN_POINT_MAG_LINEAR_MIP_POINT;
+			filter = D3D11_FILTER_MIN_LINEAR_MAG_MIP_POINT;
 			break;
 		case CC_NEAREST_MIPMAP_LINEAR:
-			filter = D3D11_FILTER_MIN_LINEAR_MAG_MIP_POINT;
+			filter = D3D11_FILTER_MIN_MAG_POINT_MIP_LINEAR;
 			break;
 		case CC_LINEAR_MIPMAP_LINEAR:
 			filter = D3D11_FILTER_MIN_LINEAR_MAG_POINT_MIP_LINEAR;
@@ -802,13 +1231,13 @@ void CCTexture2D::generateMipmap()
 			filter = D3D11_FILTER_MIN_POINT_MAG_LINEAR_MIP_POINT;
 			break;
 		case CC_LINEAR_MIPMAP_NEAREST:
-			filter = D3D11_FILTER_MIN_LINEAR_MAG_MIP_POINT;
+			filter = D3D11_FILTER_MIN_MAG_LINEAR_MIP_POINT;
 			break;
 		case CC_NEAREST_MIPMAP_LINEAR:
-			filter = D3D11_FILTER_MIN_MAG_LINEAR_MIP_POINT;
+			filter = D3D11_FILTER_MIN_POINT_MAG_MIP_LINEAR;
 			break;
 		case CC_LINEAR_MIPMAP_LINEAR:
-			filter = D3D11_FILTER_MIN_LINEAR_MAG_POINT_MIP_LINEAR;
+			filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
 			break;
 		}
 	}
@@ -831,7 +1260,7 @@ void CCTexture2D::generateMipmap()
 		v = D3D11_TEXTURE_ADDRESS_CLAMP;
 	}
 
-	if ( (filter==samplerDesc.Filter) && (u==samplerDesc.AddressU) && (v==samplerDesc.AddressV) )
+	if ( (filter==samplerDesc.Filter) && (u==samplerDesc.AddressU) && (v==samplerDesc.AddressV) && (maxLOD==samplerDesc.MaxLOD) )
 	{
 		bcreat = false;
 	}
@@ -854,7 +1283,7 @@ void CCTexture2D::generateMipmap()
 	samplerDesc.ComparisonFunc = D3D11_COMPARISON_ALWAYS;
 	samplerDesc.BorderColor[0] = samplerDesc.BorderColor[1] = samplerDesc.BorderColor[2] = samplerDesc.BorderColor[3] = 0;
 	samplerDesc.MinLOD = 0;
-	samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+	samplerDesc.MaxLOD = maxLOD;
 
 	if ( bcreat )
 	{
@@ -896,6 +1325,41 @@ CCTexture2DPixelFormat CCTexture2D::defaultAlphaPixelFormat()
 	return g_defaultAlphaPixelFormat;
 }
 
+void CCTexture2D::setGenerateMipmapsOnLoad(bool generateMipmaps)
+{
+	g_bGenerateMipmapsOnLoad = generateMipmaps;
+}
+
+bool CCTexture2D::doesGenerateMipmapsOnLoad()
+{
+	return g_bGenerateMipmapsOnLoad;
+}
+
+unsigned int CCTexture2D::getMemoryUsage()
+{
+	if (m_pTextureResource == NULL)
+	{
+		return 0;
+	}
+
+	DXGI_FORMAT format;
+	unsigned int bytesPerPixel;
+	if (! textureFormatForPixelFormat(m_ePixelFormat, &format, &bytesPerPixel))
+	{
+		return m_uPixelsWide * m_uPixelsHigh * bitsPerPixelForFormat() / 8;
+	}
+
+	unsigned int bytes = 0;
+	for (unsigned int i = 0; i < m_uMipmapLevels; ++i)
+	{
+		unsigned int levelWide = m_uPixelsWide >> i ? m_uPixelsWide >> i : 1;
+		unsigned int levelHigh = m_uPixelsHigh >> i ? m_uPixelsHigh >> i : 1;
+		unsigned int rows;
+		bytes += textureLevelPitch(m_ePixelFormat, bytesPerPixel, levelWide, levelHigh, &rows) * rows;
+	}
+	return bytes;
+}
+
 unsigned int CCTexture2D::bitsPerPixelForFormat()
 {
 	unsigned int ret = 0;
@@ -923,6 +1387,15 @@ unsigned int CCTexture2D::bitsPerPixelForFormat()
 		case kCCTexture2DPixelFormat_PVRTC2:
 			ret = 2;
 			break;
+		case kCCTexture2DPixelFormat_BC1:
+		case kCCTexture2DPixelFormat_ETC2_RGB:
+		case kCCTexture2DPixelFormat_ETC2_RGB_A1:
+			ret = 4;
+			break;
+		case kCCTexture2DPixelFormat_BC3:
+		case kCCTexture2DPixelFormat_ETC2_RGBA:
+			ret = 8;
+			break;
 		case kCCTexture2DPixelFormat_I8:
 			ret = 8;
 			break;
@@ -32,7 +32,8 @@
 #include "DirectXHelper.h"
 #include <stdlib.h>
 #include <fstream>
-#include "BasicLoader.h"
+#include "CCShaderCache.h"
+#include "ccDXStateCache.h"
 
 using namespace DirectX;
 using namespace std;
@@ -490,10 +491,7 @@ void CCTextureAtlas::SetColor(UINT r,UINT g,UINT b,UINT a)
 
 CCDXTextureAtlas::CCDXTextureAtlas()
 {
-	m_vertexShader = 0;
-	m_pixelShader = 0;
-	m_layout = 0;
-	m_matrixBuffer = 0;
+	m_pProgram = 0;
 	m_indexBuffer = 0;
 	m_vertexBuffer = 0;
 
@@ -507,10 +505,7 @@ void CCDXTextureAtlas::FreeBuffer()
 {
 	CC_SAFE_RELEASE_NULL_DX(m_vertexBuffer);
 	CC_SAFE_RELEASE_NULL_DX(m_indexBuffer);
-	CC_SAFE_RELEASE_NULL_DX(m_matrixBuffer);
-	CC_SAFE_RELEASE_NULL_DX(m_layout);
-	CC_SAFE_RELEASE_NULL_DX(m_pixelShader);
-	CC_SAFE_RELEASE_NULL_DX(m_vertexShader);
+	CC_SAFE_RELEASE_NULL(m_pProgram);
 }
 void CCDXTextureAtlas::setIsInit(bool isInit)
 {
@@ -560,10 +555,10 @@ void CCDXTextureAtlas::RenderVertexBuffer(ccV3F_C4B_T2F_Quad* quads,unsigned int
 	unsigned int offset;
 	stride = sizeof(VertexType); 
 	offset = 0;
-	CCID3D11DeviceContext->IASetVertexBuffers(0, 1, &m_vertexBuffer, &stride, &offset);
-	CCID3D11DeviceContext->IASetIndexBuffer( m_indexBuffer, DXGI_FORMAT_R16_UINT, 0);
+	ccDXBindVertexBuffer(m_vertexBuffer, stride, offset);
+	ccDXBindIndexBuffer(m_indexBuffer, DXGI_FORMAT_R16_UINT);
 
-	CCID3D11DeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	ccDXSetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
 	return;
 }
@@ -605,54 +600,10 @@ void CCDXTextureAtlas::initVertexBuffer(unsigned short* indices,unsigned int cap
 
 bool CCDXTextureAtlas::InitializeShader()
 {
-	HRESULT result;
-	ID3D10Blob* errorMessage;
-	//ID3D10Blob* vertexShaderBuffer;
-	//ID3D10Blob* pixelShaderBuffer;
-	D3D11_BUFFER_DESC matrixBufferDesc;
+	m_pProgram = CCShaderCache::sharedShaderCache()->programForKey(kCCShader_TextureAtlas);
+	CC_SAFE_RETAIN(m_pProgram);
 
-	// Initialize the pointers this function will use to null.
-	errorMessage = 0;
-	//vertexShaderBuffer = 0;
-	//pixelShaderBuffer = 0;
-
-	BasicLoader^ loader = ref new BasicLoader(CCID3D11Device);
-	D3D11_INPUT_ELEMENT_DESC layoutDesc[] = 
-	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
-	};
-
-	loader->LoadShader(
-		L"CCTextureAtlasVertexShader.cso",
-		layoutDesc,
-		ARRAYSIZE(layoutDesc),
-		&m_vertexShader,
-		&m_layout
-		);
-
-	loader->LoadShader(
-		L"CCTextureAtlasPixelShader.cso",
-		&m_pixelShader
-		);
-
-	// Setup the description of the dynamic matrix constant buffer that is in the vertex shader.
-	matrixBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
-	matrixBufferDesc.ByteWidth = sizeof(MatrixBufferType);
-	matrixBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	matrixBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-	matrixBufferDesc.MiscFlags = 0;
-	matrixBufferDesc.StructureByteStride = 0;
-
-	// Create the constant buffer pointer so we can access the vertex shader constant buffer from within this class.
-	result = CCID3D11Device->CreateBuffer(&matrixBufferDesc, NULL, &m_matrixBuffer);
-	if(FAILED(result))
-	{
-		return false;
-	}
-
-	return true;
+	return m_pProgram != NULL;
 }
 
 void CCDXTextureAtlas::OutputShaderErrorMessage(ID3D10Blob* errorMessage, HWND hwnd, WCHAR* shaderFilename)
@@ -693,33 +644,20 @@ void CCDXTextureAtlas::OutputShaderErrorMessage(ID3D10Blob* errorMessage, HWND h
 
 bool CCDXTextureAtlas::SetShaderParameters( XMMATRIX &viewMatrix, XMMATRIX &projectionMatrix, ID3D11ShaderResourceView* texture)
 {
-	D3D11_MAPPED_SUBRESOURCE mappedResource;
-	MatrixBufferType* dataPtr;
-	unsigned int bufferNumber;
-
-	viewMatrix = XMMatrixTranspose(viewMatrix);
-	projectionMatrix = XMMatrixTranspose(projectionMatrix);
-
-	if(FAILED(CCID3D11DeviceContext->Map(m_matrixBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource))){return false;}
-	dataPtr = (MatrixBufferType*)mappedResource.pData;
-	dataPtr->view = viewMatrix;
-	dataPtr->projection = projectionMatrix;
-	CCID3D11DeviceContext->Unmap(m_matrixBuffer, 0);
-
-	bufferNumber = 0;
-	CCID3D11DeviceContext->VSSetConstantBuffers(bufferNumber, 1, &m_matrixBuffer);
+	if (! CCShaderCache::sharedShaderCache()->useMatrixBuffer(viewMatrix, projectionMatrix))
+	{
+		return false;
+	}
 
-	CCID3D11DeviceContext->PSSetShaderResources(0, 1, &texture);
+	ccDXBindTexture2D(texture);
 
 	return true;
 }
 
 void CCDXTextureAtlas::RenderShader(CCTexture2D* texture,unsigned int n, unsigned int start)
 {
-	CCID3D11DeviceContext->IASetInputLayout(m_layout);
-	CCID3D11DeviceContext->VSSetShader(m_vertexShader, NULL, 0);
-	CCID3D11DeviceContext->PSSetShader(m_pixelShader, NULL, 0);
-	CCID3D11DeviceContext->PSSetSamplers(0, 1, texture->GetSamplerState());
+	m_pProgram->use();
+	ccDXBindSampler(*texture->GetSamplerState());
 	CCID3D11DeviceContext->DrawIndexed(n*6, start*6, 0 );
 
 	return;
@@ -734,6 +672,10 @@ void CCDXTextureAtlas::Render(ccV3F_C4B_T2F_Quad* quads,unsigned short* indices,
 		FreeBuffer();
 		InitializeShader();
 	}
+	if ( !m_pProgram )
+	{
+		return;
+	}
 	initVertexBuffer(indices,capacity);
 
 	XMMATRIX viewMatrix, projectionMatrix;
@@ -745,7 +687,10 @@ void CCDXTextureAtlas::Render(ccV3F_C4B_T2F_Quad* quads,unsigned short* indices,
 	RenderVertexBuffer(quads,capacity);
 
 	// Set the shader parameters that it will use for rendering.
-	SetShaderParameters(viewMatrix, projectionMatrix, texture->getTextureResource());
+	if ( !SetShaderParameters(viewMatrix, projectionMatrix, texture->getTextureResource()) )
+	{
+		return;
+	}
 
 	// Now render the prepared buffers with the shader.
 	RenderShader(texture,n,start);
@@ -44,6 +44,8 @@
 #include <cctype>
 #include <queue>
 #include <list>
+#include <vector>
+#include <algorithm>
 
 using namespace std;
 
@@ -176,6 +178,7 @@ CCTextureCache::CCTextureCache()
 	CCAssert(g_sharedTextureCache == NULL, "Attempted to allocate a second instance of a singleton.");
 	
 	m_pTextures = new CCDictionary();
+	m_uMemoryBudget = CC_TEXTURE_CACHE_MEMORY_BUDGET;
 }
 
 CCTextureCache::~CCTextureCache()
@@ -289,6 +292,7 @@ void CCTextureCache::addImageAsyncCallBack(ccTime dt)
 
 		// generate texture in render thread
 		CCTexture2D *texture = new CCTexture2D();
+		texture->setDeferredUpload(true);
 		texture->initWithImage(pImage);
 
 #if CC_ENABLE_CACHE_TEXTTURE_DATA
@@ -341,6 +345,17 @@ void CCTextureCache::addImageAsyncCallBack(ccTime dt)
     std::string fullpath = pathKey; // (CCFileUtils::fullPathFromRelativePath(path));
 	if( ! texture ) 
 	{
+		// an evicted texture comes back in the pixel format it was loaded with
+		std::map<std::string, ccTextureReloadInfo>::iterator reload = m_tReloadInfos.find(pathKey);
+		bool bReload = reload != m_tReloadInfos.end() && reload->second.evicted;
+		CCTexture2DPixelFormat eOldPixelFormat = CCTexture2D::defaultAlphaPixelFormat();
+		bool bOldMipmaps = CCTexture2D::doesGenerateMipmapsOnLoad();
+		if (bReload)
+		{
+			CCTexture2D::setDefaultAlphaPixelFormat(reload->second.pixelFormat);
+			CCTexture2D::setGenerateMipmapsOnLoad(reload->second.mipmaps);
+		}
+
 		std::string lowerCase(path);
 		for (unsigned int i = 0; i < lowerCase.length(); ++i)
 		{
@@ -351,23 +366,21 @@ void CCTextureCache::addImageAsyncCallBack(ccTime dt)
 		{
 			if (std::string::npos != lowerCase.find(".pvr"))
 			{
-				// pvr is not supported in windows
-				texture = nullptr;//texture = this->addPVRImage(fullpath.c_str());
+				texture = this->addPVRImage(fullpath.c_str());
 				break;
 			}
 			// Issue #886: TEMPORARY FIX FOR TRANSPARENT JPEGS IN IOS4
 			else if (std::string::npos != lowerCase.find(".jpg") || std::string::npos != lowerCase.find(".jpeg"))
 			{
-				CCImage image;
-                CCFileData data(fullpath.c_str(), "rb");
-                unsigned long nSize  = data.getSize();
-                unsigned char* pBuffer = data.getBuffer();
-                CC_BREAK_IF(! image.initWithImageData((void*)pBuffer, nSize, CCImage::kFmtJpg));
-
                 ccResolutionType resolution;
                 fullpath = CCFileUtils::fullPathFromRelativePath(fullpath.c_str(), &resolution);
+				// the rows are laid out in the texture format while they are decoded
 				texture = new CCTexture2D();
-				texture->initWithImage(&image, resolution);
+				texture->setDeferredUpload(true);
+				if (! texture->initWithImageFile(fullpath.c_str(), CCImage::kFmtJpg, resolution))
+				{
+					CC_SAFE_RELEASE_NULL(texture);
+				}
 
 				if( texture )
 				{
@@ -387,17 +400,15 @@ void CCTextureCache::addImageAsyncCallBack(ccTime dt)
 			}
 			else
 			{
-				// prevents overloading the autorelease pool
-				CCImage image;
-                CCFileData data(fullpath.c_str(), "rb");
-                unsigned long nSize  = data.getSize();
-                unsigned char* pBuffer = data.getBuffer();
-                CC_BREAK_IF(! image.initWithImageData((void*)pBuffer, nSize, CCImage::kFmtPng));
-
                 ccResolutionType resolution;
                 fullpath = CCFileUtils::fullPathFromRelativePath(fullpath.c_str(), &resolution);
+				// the rows are laid out in the texture format while they are decoded
 				texture = new CCTexture2D();
-				texture->initWithImage(&image, resolution);
+				texture->setDeferredUpload(true);
+				if (! texture->initWithImageFile(fullpath.c_str(), CCImage::kFmtPng, resolution))
+				{
+					CC_SAFE_RELEASE_NULL(texture);
+				}
 
 				if( texture )
 				{
@@ -417,6 +428,19 @@ void CCTextureCache::addImageAsyncCallBack(ccTime dt)
 			}
 
 		} while (0);
+
+		if (bReload)
+		{
+			CCTexture2D::setDefaultAlphaPixelFormat(eOldPixelFormat);
+			CCTexture2D::setGenerateMipmapsOnLoad(bOldMipmaps);
+		}
+
+		if (texture)
+		{
+			ccTextureReloadInfo info = { texture->getPixelFormat(), texture->getMipmapLevels() > 1, false };
+			m_tReloadInfos[pathKey] = info;
+			checkMemoryBudget();
+		}
 	}
 
 	//pthread_mutex_unlock(m_pDictLock);
@@ -478,6 +502,7 @@ CCTexture2D * CCTextureCache::addPVRImage(const char* path)
     // Split up directory and filename
     std::string fullpath = CCFileUtils::fullPathFromRelativePath(key.c_str());
 	tex = new CCTexture2D();
+	tex->setDeferredUpload(true);
 	if( tex->initWithPVRFile(fullpath.c_str()) )
 	{
 #if CC_ENABLE_CACHE_TEXTTURE_DATA
@@ -486,6 +511,7 @@ CCTexture2D * CCTextureCache::addPVRImage(const char* path)
 #endif
 		m_pTextures->setObject(tex, key);
 		tex->autorelease();
+		checkMemoryBudget();
 	}
 	else
 	{
@@ -526,6 +552,7 @@ CCTexture2D* CCTextureCache::addUIImage(CCImage *image, const char *key)
 		{
 			m_pTextures->setObject(texture, forKey);
 			texture->autorelease();
+			checkMemoryBudget();
 		}
 		else
 		{
@@ -542,6 +569,7 @@ CCTexture2D* CCTextureCache::addUIImage(CCImage *image, const char *key)
 void CCTextureCache::removeAllTextures()
 {
 	m_pTextures->removeAllObjects();
+	m_tReloadInfos.clear();
 }
 
 void CCTextureCache::removeUnusedTextures()
@@ -565,6 +593,7 @@ void CCTextureCache::removeUnusedTextures()
         for (list<CCDictElement*>::iterator iter = elementToRemove.begin(); iter != elementToRemove.end(); ++iter)
         {
             CCLOG("cocos2d: CCTextureCache: removing unused texture: %s", (*iter)->getStrKey());
+            m_tReloadInfos.erase((*iter)->getStrKey());
             m_pTextures->removeObjectForElememt(*iter);
         }
     }
@@ -578,6 +607,11 @@ void CCTextureCache::removeTexture(CCTexture2D* texture)
     }
 
     CCArray* keys = m_pTextures->allKeysForObject(texture);
+    CCObject* pKey = NULL;
+    CCARRAY_FOREACH(keys, pKey)
+    {
+        m_tReloadInfos.erase(((CCString*)pKey)->getCString());
+    }
     m_pTextures->removeObjectsForKeys(keys);
 }
 
@@ -589,6 +623,7 @@ void CCTextureCache::removeTextureForKey(const char *textureKeyName)
 	}
 
     string fullPath = CCFileUtils::fullPathFromRelativePath(textureKeyName);
+	m_tReloadInfos.erase(fullPath);
 	m_pTextures->removeObjectForKey(fullPath);
 }
 
@@ -615,21 +650,118 @@ void CCTextureCache::dumpCachedTextureInfo()
     {
         CCTexture2D* tex = (CCTexture2D*)pElement->getObject();
         unsigned int bpp = tex->bitsPerPixelForFormat();
-        // Each texture takes up width * height * bytesPerPixel bytes.
-        unsigned int bytes = tex->getPixelsWide() * tex->getPixelsHigh() * bpp / 8;
+        // video memory of every level, at the size of a pixel on the GPU
+        unsigned int bytes = tex->getMemoryUsage();
         totalBytes += bytes;
         count++;
-        CCLOG("cocos2d: \"%s\" rc=%lu id=%lu %lu x %lu @ %ld bpp => %lu KB",
+        CCLOG("cocos2d: \"%s\" rc=%lu id=%lu %lu x %lu @ %ld bpp, %lu mipmaps, last used at frame %lu => %lu KB",
                pElement->getStrKey(),
                (long)tex->retainCount(),
                (long)tex->getName(),
                (long)tex->getPixelsWide(),
                (long)tex->getPixelsHigh(),
                (long)bpp,
+               (long)tex->getMipmapLevels(),
+               (long)tex->getLastUsedFrame(),
                (long)bytes / 1024);
     }
 
-    CCLOG("cocos2d: CCTextureCache dumpDebugInfo: %ld textures, for %lu KB (%.2f MB)", (long)count, (long)totalBytes / 1024, totalBytes / (1024.0f*1024.0f));
+    CCLOG("cocos2d: CCTextureCache dumpDebugInfo: %ld textures, for %lu KB (%.2f MB), budget %lu KB", (long)count, (long)totalBytes / 1024, totalBytes / (1024.0f*1024.0f), (long)m_uMemoryBudget / 1024);
+}
+
+unsigned int CCTextureCache::getMemoryUsage()
+{
+    unsigned int totalBytes = 0;
+    CCDictElement* pElement = NULL;
+    CCDICT_FOREACH(m_pTextures, pElement)
+    {
+        totalBytes += ((CCTexture2D*)pElement->getObject())->getMemoryUsage();
+    }
+    return totalBytes;
+}
+
+void CCTextureCache::setMemoryBudget(unsigned int uBytes)
+{
+    m_uMemoryBudget = uBytes;
+    checkMemoryBudget();
+}
+
+unsigned int CCTextureCache::getMemoryBudget()
+{
+    return m_uMemoryBudget;
+}
+
+static bool compareLastUsedFrame(CCDictElement* a, CCDictElement* b)
+{
+    return ((CCTexture2D*)a->getObject())->getLastUsedFrame() < ((CCTexture2D*)b->getObject())->getLastUsedFrame();
+}
+
+unsigned int CCTextureCache::trimMemory(unsigned int uBytes)
+{
+    unsigned int usage = getMemoryUsage();
+    if (usage <= uBytes)
+    {
+        return 0;
+    }
+
+    // unused textures that can be loaded again, least recently drawn first
+    unsigned int currentFrame = CCDirector::sharedDirector()->getTotalFrames();
+    std::vector<CCDictElement*> candidates;
+    CCDictElement* pElement = NULL;
+    CCDICT_FOREACH(m_pTextures, pElement)
+    {
+        CCTexture2D* tex = (CCTexture2D*)pElement->getObject();
+        std::map<std::string, ccTextureReloadInfo>::iterator reload = m_tReloadInfos.find(pElement->getStrKey());
+        if (tex->retainCount() == 1 && tex->getLastUsedFrame() != currentFrame && reload != m_tReloadInfos.end())
+        {
+            candidates.push_back(pElement);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), compareLastUsedFrame);
+
+    unsigned int released = 0;
+    for (unsigned int i = 0; i < candidates.size() && usage - released > uBytes; ++i)
+    {
+        CCTexture2D* tex = (CCTexture2D*)candidates[i]->getObject();
+        released += tex->getMemoryUsage();
+        CCLOG("cocos2d: CCTextureCache: evicting texture: %s", candidates[i]->getStrKey());
+        m_tReloadInfos[candidates[i]->getStrKey()].evicted = true;
+        m_pTextures->removeObjectForElememt(candidates[i]);
+    }
+
+    return released;
+}
+
+void CCTextureCache::didReceiveMemoryWarning()
+{
+    unsigned int released = trimMemory(0);
+    CCLOG("cocos2d: CCTextureCache: low memory, released %lu KB", (long)released / 1024);
+}
+
+// the process is killed past its commit limit, trim before getting there
+#define CC_TEXTURE_CACHE_LOW_MEMORY_PERCENT 90
+
+static bool isProcessMemoryLow()
+{
+#if WINAPI_FAMILY == WINAPI_FAMILY_PHONE_APP
+    unsigned long long limit = Windows::Phone::System::Memory::MemoryManager::ProcessCommittedLimit;
+    unsigned long long used = Windows::Phone::System::Memory::MemoryManager::ProcessCommittedBytes;
+    return limit > 0 && used * 100 > limit * CC_TEXTURE_CACHE_LOW_MEMORY_PERCENT;
+#else
+    return false;
+#endif
+}
+
+void CCTextureCache::checkMemoryBudget()
+{
+    if (isProcessMemoryLow())
+    {
+        didReceiveMemoryWarning();
+    }
+    else if (m_uMemoryBudget > 0)
+    {
+        trimMemory(m_uMemoryBudget);
+    }
 }
 
 #if CC_ENABLE_CACHE_TEXTTURE_DATA
@@ -781,11 +913,7 @@ void VolatileTexture::reloadAllTextures()
                 } 
                 else 
                 {
-                    CCFileData data(vt->m_strFileName.c_str(), "rb");
-                    unsigned long nSize  = data.getSize();
-                    unsigned char* pBuffer = data.getBuffer();
-
-                    if (image.initWithImageData((void*)pBuffer, nSize, vt->m_FmtImage))
+                    if (image.initWithImageFileThreadSafe(vt->m_strFileName.c_str(), vt->m_FmtImage))
                     {
                         CCTexture2DPixelFormat oldPixelFormat = CCTexture2D::defaultAlphaPixelFormat();
                         CCTexture2D::setDefaultAlphaPixelFormat(vt->m_PixelFormat);
@@ -29,7 +29,9 @@
 #include "support/ccUtils.h"
 #include "CCStdC.h"
 #include "CCFileUtils.h"
-//#include "support/zip_support/ZipUtils.h"
+#include "support/zip_support/ZipUtils.h"
+#include "support/image_support/ccTextureCompression.h"
+#include "support/CCProfiling.h"
 
 #include <cctype>
 
@@ -80,53 +82,79 @@ enum
 };
 
 /*
-	Helps us to convert pvr format to the gl compatible bitspaces
-
-	WARNING!! OpenGL ES 1.1. does not support CC_BGRA format. Its PowerVR 
-	extension and it will work only on PowerVR chipsets. It means that
-
-	kPVRTextureFlagTypeBGRA_8888 can be used only on apple devices (or PowerVR compatible)
+	Formats of version 2 files that Direct3D can sample
 */
-static const unsigned int tableFormats[][7] = {
+static const unsigned int tableFormats[][3] = {
 	
 	// - PVR texture format
-	// - OpenGL internal format
-	// - OpenGL format
-	// - OpenGL type
 	// - bpp
-	// - compressed
     // - Cocos2d texture format constant
-	{ kPVRTextureFlagTypeRGBA_4444, 9,	9, 9,	16, false, kCCTexture2DPixelFormat_RGBA4444	},
-// 	{ kPVRTextureFlagTypeRGBA_4444, CC_RGBA,	CC_RGBA, CC_UNSIGNED_SHORT_4_4_4_4,	16, false, kCCTexture2DPixelFormat_RGBA4444	},
-// 	{ kPVRTextureFlagTypeRGBA_5551, CC_RGBA,	CC_RGBA, CC_UNSIGNED_SHORT_5_5_5_1,	16, false, kCCTexture2DPixelFormat_RGB5A1	},
-// 	{ kPVRTextureFlagTypeRGBA_8888, CC_RGBA,	CC_RGBA, CC_UNSIGNED_BYTE,			32, false, kCCTexture2DPixelFormat_RGBA8888	},
-// 	{ kPVRTextureFlagTypeRGB_565,	CC_RGB,		CC_RGB,	 CC_UNSIGNED_SHORT_5_6_5,	16, false, kCCTexture2DPixelFormat_RGB565	},
-//     { kPVRTextureFlagTypeA_8,		CC_ALPHA,	CC_ALPHA,	CC_UNSIGNED_BYTE,		8,	false, kCCTexture2DPixelFormat_A8	    },
-// 	{ kPVRTextureFlagTypeI_8,		CC_LUMINANCE,	CC_LUMINANCE,	CC_UNSIGNED_BYTE,			8,	false, kCCTexture2DPixelFormat_I8	},
-// 	{ kPVRTextureFlagTypeAI_88,		CC_LUMINANCE_ALPHA,	CC_LUMINANCE_ALPHA, CC_UNSIGNED_BYTE,	16,	false, kCCTexture2DPixelFormat_AI88 },
-#if (CC_TARGET_PLATFORM == CC_PLATFORM_IOS)
-	{ kPVRTextureFlagTypePVRTC_2,	CC_COMPRESSED_RGBA_PVRTC_2BPPV1_IMG, -1, -1,	2,	true, kCCTexture2DPixelFormat_PVRTC2 },
-	{ kPVRTextureFlagTypePVRTC_4,	CC_COMPRESSED_RGBA_PVRTC_4BPPV1_IMG, -1, -1,	4,	true, kCCTexture2DPixelFormat_PVRTC4 },
-	{ kPVRTextureFlagTypeBGRA_8888, CC_RGBA,	CC_BGRA, CC_UNSIGNED_BYTE,			32,	false, kCCTexture2DPixelFormat_RGBA8888	},
-#endif
+	{ kPVRTextureFlagTypeRGBA_4444, 16, kCCTexture2DPixelFormat_RGBA4444	},
+	{ kPVRTextureFlagTypeRGBA_5551, 16, kCCTexture2DPixelFormat_RGB5A1		},
+	{ kPVRTextureFlagTypeRGBA_8888, 32, kCCTexture2DPixelFormat_RGBA8888	},
+	{ kPVRTextureFlagTypeRGB_565,	16, kCCTexture2DPixelFormat_RGB565		},
+	{ kPVRTextureFlagTypeA_8,		8,	kCCTexture2DPixelFormat_A8			},
+	{ kPVRTextureFlagTypeAI_88,		16,	kCCTexture2DPixelFormat_AI88		},
 };
 
 //Tells How large is tableFormats
 #define MAX_TABLE_ELEMENTS (sizeof(tableFormats) / sizeof(tableFormats[0]))
 
 /*
-	Helper enum to traverse tableFormats
+	Helper enum to traverse tableFormats and tableFormatsV3
 */
 enum {
 	kCCInternalPVRTextureFormat,
-	kCCInternalOpenGLInternalFormat,
-	kCCInternalOpenGLFormat,
-	kCCInternalOpenGLType,
 	kCCInternalBPP,
-	kCCInternalCompressedImage,
     kCCInternalCCTexture2DPixelFormat,
+	kCCInternalHasAlpha,
+};
+
+/*
+	Version 3 files start with 'P' 'V' 'R' 3. Their pixel format is 64 bits:
+	the compressed formats are numbered in the low 32 bits, the others name
+	their channels in the low bytes and give their sizes in the high ones.
+*/
+#define PVR3_TEXTURE_VERSION			0x03525650
+#define PVR3_TEXTURE_FLAG_PREMULTIPLIED	0x02
+
+#define PVR3_TEXTURE_FORMAT(c0, c1, c2, c3, b0, b1, b2, b3) \
+	((unsigned long long)(c0) | ((unsigned long long)(c1) << 8) | ((unsigned long long)(c2) << 16) | ((unsigned long long)(c3) << 24) \
+	| ((unsigned long long)(b0) << 32) | ((unsigned long long)(b1) << 40) | ((unsigned long long)(b2) << 48) | ((unsigned long long)(b3) << 56))
+
+enum
+{
+	kPVR3TextureFormatETC1 = 6,
+	kPVR3TextureFormatDXT1 = 7,
+	kPVR3TextureFormatDXT4 = 10,			// DXT5 with premultiplied colors
+	kPVR3TextureFormatDXT5 = 11,
+	kPVR3TextureFormatETC2_RGB = 22,
+	kPVR3TextureFormatETC2_RGBA = 23,
+	kPVR3TextureFormatETC2_RGB_A1 = 24,
+};
+
+/*
+	Formats of version 3 files, laid out like tableFormats; bpp is
+	0 for the block compressed formats
+*/
+static const unsigned long long tableFormatsV3[][4] = {
+	{ PVR3_TEXTURE_FORMAT('r', 'g', 'b', 'a', 8, 8, 8, 8),	32,	kCCTexture2DPixelFormat_RGBA8888,	true	},
+	{ PVR3_TEXTURE_FORMAT('r', 'g', 'b', 'a', 4, 4, 4, 4),	16,	kCCTexture2DPixelFormat_RGBA4444,	true	},
+	{ PVR3_TEXTURE_FORMAT('r', 'g', 'b', 'a', 5, 5, 5, 1),	16,	kCCTexture2DPixelFormat_RGB5A1,		true	},
+	{ PVR3_TEXTURE_FORMAT('r', 'g', 'b', 0, 5, 6, 5, 0),	16,	kCCTexture2DPixelFormat_RGB565,		false	},
+	{ PVR3_TEXTURE_FORMAT('a', 0, 0, 0, 8, 0, 0, 0),		8,	kCCTexture2DPixelFormat_A8,			true	},
+	{ PVR3_TEXTURE_FORMAT('l', 'a', 0, 0, 8, 8, 0, 0),		16,	kCCTexture2DPixelFormat_AI88,		true	},
+	{ kPVR3TextureFormatDXT1,								0,	kCCTexture2DPixelFormat_BC1,		true	},
+	{ kPVR3TextureFormatDXT4,								0,	kCCTexture2DPixelFormat_BC3,		true	},
+	{ kPVR3TextureFormatDXT5,								0,	kCCTexture2DPixelFormat_BC3,		true	},
+	{ kPVR3TextureFormatETC1,								0,	kCCTexture2DPixelFormat_ETC2_RGB,	false	},
+	{ kPVR3TextureFormatETC2_RGB,							0,	kCCTexture2DPixelFormat_ETC2_RGB,	false	},
+	{ kPVR3TextureFormatETC2_RGB_A1,						0,	kCCTexture2DPixelFormat_ETC2_RGB_A1,true	},
+	{ kPVR3TextureFormatETC2_RGBA,							0,	kCCTexture2DPixelFormat_ETC2_RGBA,	true	},
 };
 
+#define MAX_TABLE_ELEMENTS_V3 (sizeof(tableFormatsV3) / sizeof(tableFormatsV3[0]))
+
 /*
 	Official PVRT header
 */
@@ -147,9 +175,40 @@ typedef struct _PVRTexHeader
 	unsigned int numSurfs;
 } PVRTexHeader;
 
+/*
+	Version 3 header. It is followed by metadataLength bytes of meta data,
+	then by the levels, largest first, each holding numSurfaces * numFaces
+	images. The pixel format is split so that the header stays 52 bytes.
+*/
+typedef struct _PVRv3TexHeader
+{
+	unsigned int version;
+	unsigned int flags;
+	unsigned int pixelFormatLow;
+	unsigned int pixelFormatHigh;
+	unsigned int colorSpace;
+	unsigned int channelType;
+	unsigned int height;
+	unsigned int width;
+	unsigned int depth;
+	unsigned int numSurfaces;
+	unsigned int numFaces;
+	unsigned int numMipmaps;
+	unsigned int metadataLength;
+} PVRv3TexHeader;
+
 CCTexturePVR::CCTexturePVR() :
+    m_uName(0),
+    m_uWidth(0),
+    m_uHeight(0),
+    m_bHasAlpha(false),
+    m_bRetainName(false),
     m_uTableFormatIndex(0),
-	m_uNumberOfMipmaps(0)
+	m_uNumberOfMipmaps(0),
+	m_bForcePremultipliedAlpha(false),
+	m_pFile(NULL),
+	m_pData(NULL),
+	m_pDecodedData(NULL)
 {
 }
 
@@ -161,6 +220,11 @@ CCTexturePVR::~CCTexturePVR()
 	{
 		//glDeleteTextures(1, &m_uName);
 	}
+
+	CC_SAFE_RELEASE(m_pFile);
+	// inflated by ZipUtils, with malloc
+	free(m_pData);
+	delete [] m_pDecodedData;
 }
 
 CCuint CCTexturePVR::getName()
@@ -199,6 +263,20 @@ void CCTexturePVR::setRetainName(bool var)
 }
 
 bool CCTexturePVR::unpackPVRData(unsigned char* data, unsigned int len)
+{
+	if (data == NULL || len < sizeof(unsigned int))
+	{
+		return false;
+	}
+
+	if (CC_SWAP_INT32_LITTLE_TO_HOST(*(unsigned int *)data) == PVR3_TEXTURE_VERSION)
+	{
+		return unpackPVRv3Data(data, len);
+	}
+	return unpackPVRv2Data(data, len);
+}
+
+bool CCTexturePVR::unpackPVRv2Data(unsigned char* data, unsigned int len)
 {
 	bool success = false;
     PVRTexHeader *header = NULL;
@@ -209,6 +287,11 @@ bool CCTexturePVR::unpackPVRData(unsigned char* data, unsigned int len)
 	unsigned char *bytes = NULL;
     unsigned int formatFlags;
 
+	if (len < sizeof(PVRTexHeader))
+	{
+		return false;
+	}
+
 	//Cast first sizeof(PVRTexHeader) bytes of data stream as PVRTexHeader
     header = (PVRTexHeader *)data;
 
@@ -285,6 +368,10 @@ bool CCTexturePVR::unpackPVRData(unsigned char* data, unsigned int len)
 			
 			//Get ptr to where data starts..
 			dataLength = CC_SWAP_INT32_LITTLE_TO_HOST(header->dataLength);
+			if (dataLength > len - sizeof(PVRTexHeader))
+			{
+				dataLength = len - sizeof(PVRTexHeader);
+			}
 
 			//Move by size of header
 			bytes = ((unsigned char *)data) + sizeof(PVRTexHeader);
@@ -297,14 +384,15 @@ bool CCTexturePVR::unpackPVRData(unsigned char* data, unsigned int len)
 				switch (formatFlags) {
 					case kPVRTextureFlagTypePVRTC_2:
 						blockSize = 8 * 4; // Pixel by pixel block size for 2bpp
-						widthBlocks = width / 8;
-						heightBlocks = height / 4;
+						// PVRTC levels have at least 2 x 2 blocks
+						widthBlocks = MAX(width / 8, 2);
+						heightBlocks = MAX(height / 4, 2);
 						bpp = 2;
 						break;
 					case kPVRTextureFlagTypePVRTC_4:
 						blockSize = 4 * 4; // Pixel by pixel block size for 4bpp
-						widthBlocks = width / 4;
-						heightBlocks = height / 4;
+						widthBlocks = MAX(width / 4, 2);
+						heightBlocks = MAX(height / 4, 2);
 						bpp = 4;
 						break;
 					case kPVRTextureFlagTypeBGRA_8888:
@@ -320,40 +408,43 @@ bool CCTexturePVR::unpackPVRData(unsigned char* data, unsigned int len)
 						bpp = tableFormats[m_uTableFormatIndex][kCCInternalBPP];
 						break;
 				}
-				
-				// Clamp to minimum number of blocks
-				if (widthBlocks < 2)
-					widthBlocks = 2;
-				if (heightBlocks < 2)
-					heightBlocks = 2;
 
 				dataSize = widthBlocks * heightBlocks * ((blockSize  * bpp) / 8);
 				unsigned int packetLength = (dataLength-dataOffset);
-				packetLength = packetLength > dataSize ? dataSize : packetLength;
-				
+
+				// a level cut short by the end of the file can't be uploaded
+				if (packetLength < dataSize)
+				{
+					CCLOG("cocos2d: WARNING: PVR file is truncated after %u levels", m_uNumberOfMipmaps);
+					break;
+				}
+
+				//Check that we don't overflow
+				if (m_uNumberOfMipmaps == CC_PVRMIPMAP_MAX)
+				{
+					CCLOG("cocos2d: WARNING: TexturePVR: more than %d mipmaps, the smallest ones are ignored", CC_PVRMIPMAP_MAX);
+					break;
+				}
+
 				//Make record to the mipmaps array and increment coutner
 				m_asMipmaps[m_uNumberOfMipmaps].address = bytes+dataOffset;
-				m_asMipmaps[m_uNumberOfMipmaps].len = packetLength;
+				m_asMipmaps[m_uNumberOfMipmaps].len = dataSize;
 				m_uNumberOfMipmaps++;
-				
-				//Check that we didn't overflow
-				CCAssert(m_uNumberOfMipmaps < CC_PVRMIPMAP_MAX, 
-                         "TexturePVR: Maximum number of mimpaps reached. Increate the CC_PVRMIPMAP_MAX value");
-				
-				dataOffset += packetLength;
+
+				dataOffset += dataSize;
 				
 				//Update width and height to the next lower power of two 
 				width = MAX(width >> 1, 1);
 				height = MAX(height >> 1, 1);
 			}
 			
-			//Mark pass as success
-			success = true;
+			//Mark pass as success, unless not even the first level is there
+			success = m_uNumberOfMipmaps > 0;
 			break;
 		}
 	}
 
-	if (false == success)
+	if (false == success && m_uTableFormatIndex == (unsigned int)MAX_TABLE_ELEMENTS)
     {
 		CCLOG("cocos2d: WARNING: Unssupported PVR Pixel Format: 0x%2x", formatFlags);
     }
@@ -361,65 +452,139 @@ bool CCTexturePVR::unpackPVRData(unsigned char* data, unsigned int len)
 	return success;
 }
 
-bool CCTexturePVR::createGLTexture()
+bool CCTexturePVR::unpackPVRv3Data(unsigned char* data, unsigned int len)
 {
-	unsigned int width = m_uWidth;
-	unsigned int height = m_uHeight;
-	
-	if (m_uNumberOfMipmaps > 0)
+	if (len < sizeof(PVRv3TexHeader))
 	{
-		if (m_uName != 0)
-        {
-			//glDeleteTextures(1, &m_uName);
-        }
-		
-		//glGenTextures(1, &m_uName);
-		//glBindTexture(CC_TEXTURE_2D, m_uName);
+		return false;
 	}
 
-	// Generate textures with mipmaps
-	for (unsigned int i = 0; i < m_uNumberOfMipmaps; ++i)
+	PVRv3TexHeader *header = (PVRv3TexHeader *)data;
+	unsigned long long pixelFormat = CC_SWAP_INT32_LITTLE_TO_HOST(header->pixelFormatLow)
+		| ((unsigned long long)CC_SWAP_INT32_LITTLE_TO_HOST(header->pixelFormatHigh) << 32);
+
+	for (m_uTableFormatIndex = 0; m_uTableFormatIndex < (unsigned int)MAX_TABLE_ELEMENTS_V3; m_uTableFormatIndex++)
 	{
-		CCenum internalFormat = tableFormats[m_uTableFormatIndex][kCCInternalOpenGLInternalFormat];
-		CCenum format = tableFormats[m_uTableFormatIndex][kCCInternalOpenGLFormat];
-		CCenum type = tableFormats[m_uTableFormatIndex][kCCInternalOpenGLType];
-		bool compressed = tableFormats[m_uTableFormatIndex][kCCInternalCompressedImage] == 1;
-		 
-		if (compressed == true && CCConfiguration::sharedConfiguration()->isSupportsPVRTC() == false) 
+		if (tableFormatsV3[m_uTableFormatIndex][kCCInternalPVRTextureFormat] == pixelFormat)
 		{
-			CCLOG("cocos2d: WARNING: PVRTC images are not supported");
-			return false;
-		}			
-		
-		unsigned char *data = m_asMipmaps[i].address;
-		unsigned int datalen = m_asMipmaps[i].len;
-		
-		if (compressed == true)
-		{
-			//glCompressedTexImage2D(CC_TEXTURE_2D, i, internalFormat, width, height, 0, datalen, data);
+			break;
 		}
-		else 
+	}
+	if (m_uTableFormatIndex == MAX_TABLE_ELEMENTS_V3)
+	{
+		CCLOG("cocos2d: WARNING: Unssupported PVR v3 Pixel Format: 0x%08x%08x", (unsigned int)(pixelFormat >> 32), (unsigned int)pixelFormat);
+		return false;
+	}
+
+	unsigned int width = CC_SWAP_INT32_LITTLE_TO_HOST(header->width);
+	unsigned int height = CC_SWAP_INT32_LITTLE_TO_HOST(header->height);
+	unsigned int numSurfaces = CC_SWAP_INT32_LITTLE_TO_HOST(header->numSurfaces);
+	unsigned int numFaces = CC_SWAP_INT32_LITTLE_TO_HOST(header->numFaces);
+	unsigned int numMipmaps = CC_SWAP_INT32_LITTLE_TO_HOST(header->numMipmaps);
+	unsigned int metadataLength = CC_SWAP_INT32_LITTLE_TO_HOST(header->metadataLength);
+
+	if (CC_SWAP_INT32_LITTLE_TO_HOST(header->depth) > 1)
+	{
+		CCLOG("cocos2d: WARNING: PVR volume textures are not supported");
+		return false;
+	}
+
+	if (width == 0 || height == 0 || width != ccNextPOT(width) || height != ccNextPOT(height))
+	{
+		CCLOG("cocos2d: WARNING: PVR NPOT textures are not supported. Regenerate it.");
+		return false;
+	}
+
+	if (metadataLength > len - sizeof(PVRv3TexHeader))
+	{
+		return false;
+	}
+
+	m_uWidth = width;
+	m_uHeight = height;
+	m_eFormat = (CCTexture2DPixelFormat)tableFormatsV3[m_uTableFormatIndex][kCCInternalCCTexture2DPixelFormat];
+	m_bHasAlpha = tableFormatsV3[m_uTableFormatIndex][kCCInternalHasAlpha] != 0;
+	m_bForcePremultipliedAlpha = (CC_SWAP_INT32_LITTLE_TO_HOST(header->flags) & PVR3_TEXTURE_FLAG_PREMULTIPLIED) != 0
+		|| pixelFormat == kPVR3TextureFormatDXT4;
+
+	// only the first surface and face of each level are used
+	unsigned int bpp = (unsigned int)tableFormatsV3[m_uTableFormatIndex][kCCInternalBPP];
+	unsigned int images = (numSurfaces > 1 ? numSurfaces : 1) * (numFaces > 1 ? numFaces : 1);
+	unsigned char *bytes = data + sizeof(PVRv3TexHeader) + metadataLength;
+	unsigned int dataLength = len - sizeof(PVRv3TexHeader) - metadataLength;
+	unsigned int dataOffset = 0;
+
+	numMipmaps = numMipmaps > 1 ? numMipmaps : 1;
+	numMipmaps = numMipmaps < CC_PVRMIPMAP_MAX ? numMipmaps : CC_PVRMIPMAP_MAX;
+	m_uNumberOfMipmaps = 0;
+	for (unsigned int i = 0; i < numMipmaps; ++i)
+	{
+		unsigned int dataSize = bpp ? width * height * bpp / 8 : ccCompressedLevelSize(m_eFormat, width, height);
+		if (dataSize > dataLength - dataOffset || images > (dataLength - dataOffset) / dataSize)
 		{
-			//glTexImage2D(CC_TEXTURE_2D, i, internalFormat, width, height, 0, format, type, data);
+			CCLOG("cocos2d: WARNING: PVR file is truncated after %u levels", m_uNumberOfMipmaps);
+			break;
 		}
 
-		if(i > 0 && (width != height || ccNextPOT(width) != width ) )
-        {
-			CCLOG("cocos2d: TexturePVR. WARNING. Mipmap level %lu is not squared. Texture won't render correctly. width=%lu != height=%lu", i, width, height);
-        }
-		
-		//err = glGetError();
-// 		if (err != CC_NO_ERROR)
-// 		{
-// 			CCLOG("cocos2d: TexturePVR: Error uploading compressed texture level: %u . glError: 0x%04X", (unsigned int)i, err);
-// 			return false;
-// 		}
-		
-		//Update width and height to the next lower power of two
-		width = MAX(width >> 1, 1);
-		height = MAX(height >> 1, 1);
+		m_asMipmaps[m_uNumberOfMipmaps].address = bytes + dataOffset;
+		m_asMipmaps[m_uNumberOfMipmaps].len = dataSize;
+		m_uNumberOfMipmaps++;
+		dataOffset += dataSize * images;
+
+		width = width > 1 ? width >> 1 : 1;
+		height = height > 1 ? height >> 1 : 1;
 	}
-		
+
+	return m_uNumberOfMipmaps > 0;
+}
+
+bool CCTexturePVR::decodeMipmapsIfNeeded()
+{
+	if (ccBlockSizeForPixelFormat(m_eFormat) == 0)
+	{
+		return true;
+	}
+
+	// Direct3D wants whole blocks in the largest level
+	if ((m_eFormat == kCCTexture2DPixelFormat_BC1 || m_eFormat == kCCTexture2DPixelFormat_BC3)
+		&& CCConfiguration::sharedConfiguration()->isSupportsBCTextures()
+		&& m_uWidth % 4 == 0 && m_uHeight % 4 == 0)
+	{
+		return true;
+	}
+
+	CC_PROFILER_START("CCTexturePVR - decode");
+
+	unsigned int width = m_uWidth;
+	unsigned int height = m_uHeight;
+	unsigned int length = 0;
+	for (unsigned int i = 0; i < m_uNumberOfMipmaps; ++i)
+	{
+		length += width * height * 4;
+		width = width > 1 ? width >> 1 : 1;
+		height = height > 1 ? height >> 1 : 1;
+	}
+
+	m_pDecodedData = new unsigned char[length];
+
+	unsigned char *level = m_pDecodedData;
+	width = m_uWidth;
+	height = m_uHeight;
+	for (unsigned int i = 0; i < m_uNumberOfMipmaps; ++i)
+	{
+		ccDecompressImage(m_asMipmaps[i].address, m_eFormat, width, height, level);
+		m_asMipmaps[i].address = level;
+		m_asMipmaps[i].len = width * height * 4;
+		level += m_asMipmaps[i].len;
+
+		width = width > 1 ? width >> 1 : 1;
+		height = height > 1 ? height >> 1 : 1;
+	}
+
+	CC_PROFILER_STOP("CCTexturePVR - decode");
+
+	CCLOG("cocos2d: TexturePVR: format %d decoded to RGBA8888", m_eFormat);
+	m_eFormat = kCCTexture2DPixelFormat_RGBA8888;
 	return true;
 }
 
@@ -428,6 +593,7 @@ bool CCTexturePVR::initWithContentsOfFile(const char* path)
 {
     unsigned char* pvrdata = NULL;
     int pvrlen = 0;
+    CCMappedFile* pvrfile = NULL;
     
     std::string lowerCase(path);
     for (unsigned int i = 0; i < lowerCase.length(); ++i)
@@ -437,15 +603,25 @@ bool CCTexturePVR::initWithContentsOfFile(const char* path)
         
     if (lowerCase.find(".ccz") != std::string::npos)
     {
-        //pvrlen = ZipUtils::ccInflateCCZFile(path, &pvrdata);
+        pvrlen = ZipUtils::ccInflateCCZFile(path, &pvrdata);
     }
     else if (lowerCase.find(".gz") != std::string::npos)
     {
-        //pvrlen = ZipUtils::ccInflateGZipFile(path, &pvrdata);
+        pvrlen = ZipUtils::ccInflateGZipFile(path, &pvrdata);
     }
     else
     {
-		pvrdata = CCFileUtils::getFileData(path, "rb", (unsigned long *)(&pvrlen));
+		// the mipmaps point into the mapped file, kept until the object is released
+		pvrfile = CCFileUtils::mapFile(path);
+		if (pvrfile)
+		{
+			pvrdata = (unsigned char*)pvrfile->getBytes();
+			pvrlen = (int)pvrfile->getSize();
+		}
+		else
+		{
+			pvrlen = -1;
+		}
     }
     
     if (pvrlen < 0)
@@ -453,6 +629,9 @@ bool CCTexturePVR::initWithContentsOfFile(const char* path)
         this->release();
         return false;
     }
+
+	m_pFile = pvrfile;
+	m_pData = pvrfile ? NULL : pvrdata;
     
     m_uNumberOfMipmaps = 0;
 
@@ -462,14 +641,13 @@ bool CCTexturePVR::initWithContentsOfFile(const char* path)
 
 	m_bRetainName = false; // cocos2d integration
 
-	if ( !unpackPVRData(pvrdata, pvrlen)  || !createGLTexture() )
+	bool bRet = unpackPVRData(pvrdata, pvrlen) && decodeMipmapsIfNeeded();
+
+	if (! bRet)
 	{
-		delete [] pvrdata;
 		this->release();
 		return false;
 	}
-
-    delete [] pvrdata;
     
 	return true;
 }
@@ -29,11 +29,15 @@ THE SOFTWARE.
 #include "CCTMXTiledMap.h"
 #include "CCSprite.h"
 #include "CCTextureCache.h"
+#include "CCTextureAtlas.h"
 //#include "CCShaderCache.h"
 //#include "CCGLProgram.h"
 #include "CCPointExtension.h"
 #include "ccCArray.h"
 #include "CCDirector.h"
+#include "CCGrid.h"
+#include "CCCamera.h"
+#include <float.h>
 
 NS_CC_BEGIN
 
@@ -52,10 +56,10 @@ CCTMXLayer * CCTMXLayer::create(CCTMXTilesetInfo *tilesetInfo, CCTMXLayerInfo *l
 }
 bool CCTMXLayer::initWithTilesetInfo(CCTMXTilesetInfo *tilesetInfo, CCTMXLayerInfo *layerInfo, CCTMXMapInfo *mapInfo)
 {    
-    // XXX: is 35% a good estimate ?
+    // The tiles are drawn by the chunks. The batch node atlas only holds
+    // the tiles that were converted into CCSprite by tileAt()
     CCSize size = layerInfo->m_tLayerSize;
-    float totalNumberOfTiles = size.width * size.height;
-    float capacity = totalNumberOfTiles * 0.35f + 1; // 35 percent is occupied ?
+    unsigned int capacity = 29;
 
     CCTexture2D *texture = NULL;
     if( tilesetInfo )
@@ -63,7 +67,7 @@ bool CCTMXLayer::initWithTilesetInfo(CCTMXTilesetInfo *tilesetInfo, CCTMXLayerIn
         texture = CCTextureCache::sharedTextureCache()->addImage(tilesetInfo->m_sSourceImage.c_str());
     }
 
-    if (CCSpriteBatchNode::initWithTexture(texture, (unsigned int)capacity))
+    if (CCSpriteBatchNode::initWithTexture(texture, capacity))
     {
         // layerInfo
         m_sLayerName = layerInfo->m_sName;
@@ -87,7 +91,20 @@ bool CCTMXLayer::initWithTilesetInfo(CCTMXTilesetInfo *tilesetInfo, CCTMXLayerIn
         CCPoint offset = this->calculateLayerOffset(layerInfo->m_tOffset);
         this->setPosition(CC_POINT_PIXELS_TO_POINTS(offset));
 
-        m_pAtlasIndexArray = ccCArrayNew((unsigned int)totalNumberOfTiles);
+        m_pAtlasIndexArray = ccCArrayNew(capacity);
+
+        // chunks
+        m_uChunksWide = ((unsigned int)m_tLayerSize.width + CC_TMX_LAYER_CHUNK_SIZE - 1) / CC_TMX_LAYER_CHUNK_SIZE;
+        m_uChunksHigh = ((unsigned int)m_tLayerSize.height + CC_TMX_LAYER_CHUNK_SIZE - 1) / CC_TMX_LAYER_CHUNK_SIZE;
+        unsigned int chunkCount = m_uChunksWide * m_uChunksHigh;
+        if (chunkCount > 0)
+        {
+            m_pChunks = (ccTMXTileChunk*)calloc(chunkCount, sizeof(ccTMXTileChunk));
+            for (unsigned int i = 0; i < chunkCount; i++)
+            {
+                m_pChunks[i].bDirty = true;
+            }
+        }
 
         this->setContentSize(CC_SIZE_PIXELS_TO_POINTS(CCSizeMake(m_tLayerSize.width * m_tMapTileSize.width, m_tLayerSize.height * m_tMapTileSize.height)));
 
@@ -106,16 +123,25 @@ CCTMXLayer::CCTMXLayer()
 ,m_pTileSet(NULL)
 ,m_pProperties(NULL)
 ,m_sLayerName("")
-,m_pReusedTile(NULL)
 ,m_pAtlasIndexArray(NULL)    
-{}
+,m_pChunks(NULL)
+,m_uChunksWide(0)
+,m_uChunksHigh(0)
+,m_uVisibleChunks(0)
+,m_pOrderedAtlas(NULL)
+,m_bOrderedDirty(true)
+{
+    memset(m_nOrderedChunks, 0, sizeof(m_nOrderedChunks));
+}
 
 CCTMXLayer::~CCTMXLayer()
 {
     CC_SAFE_RELEASE(m_pTileSet);
-    CC_SAFE_RELEASE(m_pReusedTile);
     CC_SAFE_RELEASE(m_pProperties);
 
+    releaseChunks();
+    CC_SAFE_RELEASE(m_pOrderedAtlas);
+
     if (m_pAtlasIndexArray)
     {
         ccCArrayFree(m_pAtlasIndexArray);
@@ -139,6 +165,25 @@ void CCTMXLayer::setTileSet(CCTMXTilesetInfo* var)
 
 void CCTMXLayer::releaseMap()
 {
+    // the chunks are generated from the GID map, so build the ones that were never visible
+    if (m_pTiles && m_pChunks)
+    {
+        for (unsigned int cy = 0; cy < m_uChunksHigh; cy++)
+        {
+            for (unsigned int cx = 0; cx < m_uChunksWide; cx++)
+            {
+                if (m_pChunks[cx + cy * m_uChunksWide].bDirty)
+                {
+                    buildChunk(cx, cy);
+                }
+                else
+                {
+                    updateDirtyTiles(cx, cy);
+                }
+            }
+        }
+    }
+
     if (m_pTiles)
     {
         delete [] m_pTiles;
@@ -170,28 +215,24 @@ void CCTMXLayer::setupTiles()
     // Parse cocos2d properties
     this->parseInternalProperties();
 
-    for (unsigned int y=0; y < m_tLayerSize.height; y++) 
+    // The quads are not created here: every chunk generates its own quads
+    // the first time it becomes visible. See CCTMXLayer::draw
+    unsigned int totalNumberOfTiles = (unsigned int)(m_tLayerSize.width * m_tLayerSize.height);
+    for (unsigned int pos = 0; pos < totalNumberOfTiles; pos++) 
     {
-        for (unsigned int x=0; x < m_tLayerSize.width; x++) 
+        // gid are stored in little endian.
+        // if host is big endian, then swap
+        //if( o == CFByteOrderBigEndian )
+        //    gid = CFSwapInt32( gid );
+        /* We support little endian.*/
+        unsigned int gid = m_pTiles[ pos ] & kCCFlippedMask;
+
+        // XXX: gid == 0 --> empty tile
+        if (gid != 0) 
         {
-            unsigned int pos = (unsigned int)(x + m_tLayerSize.width * y);
-            unsigned int gid = m_pTiles[ pos ];
-
-            // gid are stored in little endian.
-            // if host is big endian, then swap
-            //if( o == CFByteOrderBigEndian )
-            //    gid = CFSwapInt32( gid );
-            /* We support little endian.*/
-
-            // XXX: gid == 0 --> empty tile
-            if (gid != 0) 
-            {
-                this->appendTileForGID(gid, ccp(x, y));
-
-                // Optimization: update min and max GID rendered by the layer
-                m_uMinGID = MIN(gid, m_uMinGID);
-                m_uMaxGID = MAX(gid, m_uMaxGID);
-            }
+            // Optimization: update min and max GID rendered by the layer
+            m_uMinGID = MIN(gid, m_uMinGID);
+            m_uMaxGID = MAX(gid, m_uMaxGID);
         }
     }
 
@@ -286,30 +327,6 @@ void CCTMXLayer::setupTileSprite(CCSprite* sprite, CCPoint pos, unsigned int gid
     }
 }
 
-CCSprite* CCTMXLayer::reusedTileWithRect(CCRect rect)
-{
-    if (! m_pReusedTile) 
-    {
-        m_pReusedTile = new CCSprite();
-        m_pReusedTile->initWithTexture(m_pobTextureAtlas->getTexture(), rect);
-        m_pReusedTile->setBatchNode(this);
-    }
-    else
-    {
-        // XXX HACK: Needed because if "batch node" is nil,
-		// then the Sprite'squad will be reset
-        m_pReusedTile->setBatchNode(NULL);
-        
-		// Re-init the sprite
-        m_pReusedTile->setTextureRect(rect, false, rect.size);
-        
-		// restore the batch node
-        m_pReusedTile->setBatchNode(this);
-    }
-
-    return m_pReusedTile;
-}
-
 // CCTMXLayer - obtaining tiles/gids
 CCSprite * CCTMXLayer::tileAt(const CCPoint& pos)
 {
@@ -323,7 +340,7 @@ CCSprite * CCTMXLayer::tileAt(const CCPoint& pos)
     if (gid) 
     {
         int z = (int)(pos.x + pos.y * m_tLayerSize.width);
-        tile = (CCSprite*) this->getChildByTag(z);
+        tile = hasSpriteForZ(z) ? (CCSprite*) this->getChildByTag(z) : NULL;
 
         // tile not created yet. create it
         if (! tile) 
@@ -334,14 +351,33 @@ CCSprite * CCTMXLayer::tileAt(const CCPoint& pos)
             tile = new CCSprite();
             tile->initWithTexture(this->getTexture(), rect);
             tile->setBatchNode(this);
-            tile->setPosition(positionAt(pos));
-            tile->setVertexZ((float)vertexZForPos(pos));
-            tile->setAnchorPoint(CCPointZero);
-            tile->setOpacity(m_cOpacity);
+            setupTileSprite(tile, pos, m_pTiles[z]);
+
+            // the sprite quads are sorted by z in the batch node atlas
+            unsigned int indexForZ = atlasIndexForNewZ(z);
+            this->insertQuadFromSprite(tile, indexForZ);
+            ccCArrayInsertValueAtIndex(m_pAtlasIndexArray, (void*)(intptr_t)z, indexForZ);
+
+            // update possible children
+            CCObject* pObject = NULL;
+            CCARRAY_FOREACH(m_pChildren, pObject)
+            {
+                CCSprite* pChild = (CCSprite*) pObject;
+                if (pChild)
+                {
+                    unsigned int ai = pChild->getAtlasIndex();
+                    if ( ai >= indexForZ )
+                    {
+                        pChild->setAtlasIndex(ai+1);
+                    }
+                }
+            }
 
-            unsigned int indexForZ = atlasIndexForExistantZ(z);
             this->addSpriteWithoutQuad(tile, indexForZ, z);
             tile->release();
+
+            // the tile is now drawn by the sprite, remove it from its chunk
+            markTileDirty((unsigned int)pos.x, (unsigned int)pos.y);
         }
     }
     
@@ -371,249 +407,705 @@ unsigned int CCTMXLayer::tileGIDAt(const CCPoint& pos, ccTMXTileFlags* flags)
     return (tile & kCCFlippedMask);
 }
 
-// CCTMXLayer - adding helper methods
-CCSprite * CCTMXLayer::insertTileForGID(unsigned int gid, const CCPoint& pos)
+// CCTMXLayer - atlasIndex and Z
+unsigned int CCTMXLayer::atlasIndexForNewZ(int z)
 {
-    CCRect rect = m_pTileSet->rectForGID(gid);
-    rect = CC_RECT_PIXELS_TO_POINTS(rect);
-
-    intptr_t z = (intptr_t)(pos.x + pos.y * m_tLayerSize.width);
+    // first index whose z is greater than the new one
+    unsigned int low = 0;
+    unsigned int high = m_pAtlasIndexArray->num;
+    while (low < high) 
+    {
+        unsigned int mid = (low + high) / 2;
+        int val = (int)(size_t) m_pAtlasIndexArray->arr[mid];
+        if (z < val)
+        {
+            high = mid;
+        }
+        else
+        {
+            low = mid + 1;
+        }
+    } 
+    
+    return low;
+}
 
-    CCSprite *tile = reusedTileWithRect(rect);
+// CCTMXLayer - adding / remove tiles
+void CCTMXLayer::setTileGID(unsigned int gid, const CCPoint& pos)
+{
+    setTileGID(gid, pos, (ccTMXTileFlags)0);
+}
 
-    setupTileSprite(tile, pos, gid);
+void CCTMXLayer::setTileGID(unsigned int gid, const CCPoint& pos, ccTMXTileFlags flags)
+{
+    CCAssert(pos.x < m_tLayerSize.width && pos.y < m_tLayerSize.height && pos.x >=0 && pos.y >=0, "TMXLayer: invalid position");
+    CCAssert(m_pTiles && m_pAtlasIndexArray, "TMXLayer: the tiles map has been released");
+    CCAssert(gid == 0 || gid >= m_pTileSet->m_uFirstGid, "TMXLayer: invalid gid" );
 
-    // get atlas index
-    unsigned int indexForZ = atlasIndexForNewZ(z);
+    // setting gid=0 is equal to remove the tile
+    setTileGIDAndFlags(gid ? gid | flags : 0, (unsigned int)pos.x, (unsigned int)pos.y);
+}
 
-    // Optimization: add the quad without adding a child
-    this->insertQuadFromSprite(tile, indexForZ);
+void CCTMXLayer::setTileGIDs(const unsigned int *gids, const CCPoint& origin, const CCSize& size)
+{
+    CCAssert(origin.x >= 0 && origin.y >= 0 && origin.x + size.width <= m_tLayerSize.width && origin.y + size.height <= m_tLayerSize.height, "TMXLayer: invalid region");
+    CCAssert(m_pTiles && m_pAtlasIndexArray, "TMXLayer: the tiles map has been released");
 
-    // insert it into the local atlasindex array
-    ccCArrayInsertValueAtIndex(m_pAtlasIndexArray, (void*)z, indexForZ);
+    unsigned int x0 = (unsigned int)origin.x;
+    unsigned int y0 = (unsigned int)origin.y;
+    unsigned int width = (unsigned int)size.width;
+    unsigned int height = (unsigned int)size.height;
 
-    // update possible children
-    if (m_pChildren && m_pChildren->count()>0)
+    for (unsigned int y = 0; y < height; y++)
     {
-        CCObject* pObject = NULL;
-        CCARRAY_FOREACH(m_pChildren, pObject)
+        for (unsigned int x = 0; x < width; x++)
         {
-            CCSprite* pChild = (CCSprite*) pObject;
-            if (pChild)
-            {
-                unsigned int ai = pChild->getAtlasIndex();
-                if ( ai >= indexForZ )
-                {
-                    pChild->setAtlasIndex(ai+1);
-                }
-            }
+            unsigned int gidAndFlags = gids[x + y * width];
+            CCAssert((gidAndFlags & kCCFlippedMask) == 0 || (gidAndFlags & kCCFlippedMask) >= m_pTileSet->m_uFirstGid, "TMXLayer: invalid gid" );
+            setTileGIDAndFlags((gidAndFlags & kCCFlippedMask) ? gidAndFlags : 0, x0 + x, y0 + y);
         }
     }
-    m_pTiles[z] = gid;
-    return tile;
 }
-CCSprite * CCTMXLayer::updateTileForGID(unsigned int gid, const CCPoint& pos)    
+
+void CCTMXLayer::setTileGIDAndFlags(unsigned int gidAndFlags, unsigned int x, unsigned int y)
 {
-    CCRect rect = m_pTileSet->rectForGID(gid);
-    rect = CCRectMake(rect.origin.x / m_fContentScaleFactor, rect.origin.y / m_fContentScaleFactor, rect.size.width/ m_fContentScaleFactor, rect.size.height/ m_fContentScaleFactor);
-    int z = (int)(pos.x + pos.y * m_tLayerSize.width);
+    unsigned int z = x + y * (unsigned int)m_tLayerSize.width;
+    if (m_pTiles[z] == gidAndFlags)
+    {
+        return;
+    }
 
-    CCSprite *tile = reusedTileWithRect(rect);
+    // only tiles converted by tileAt() have a sprite
+    CCSprite *sprite = hasSpriteForZ(z) ? (CCSprite*)getChildByTag(z) : NULL;
+    if (sprite)
+    {
+        if (gidAndFlags == 0)
+        {
+            // remove tile from atlas position array
+            ccCArrayRemoveValueAtIndex(m_pAtlasIndexArray, sprite->getAtlasIndex());
+            CCSpriteBatchNode::removeChild(sprite, true);
+        }
+        else
+        {
+            CCRect rect = m_pTileSet->rectForGID(gidAndFlags);
+            rect = CC_RECT_PIXELS_TO_POINTS(rect);
 
-    setupTileSprite(tile ,pos ,gid);
+            sprite->setTextureRect(rect, false, rect.size);
+            setupTileSprite(sprite, ccp((float)x, (float)y), gidAndFlags);
+        }
+    }
 
-    // get atlas index
-    unsigned int indexForZ = atlasIndexForExistantZ(z);
-    tile->setAtlasIndex(indexForZ);
-    tile->setDirty(true);
-    tile->updateTransform();
-    m_pTiles[z] = gid;
+    m_pTiles[z] = gidAndFlags;
+    markTileDirty(x, y);
+}
 
-    return tile;
+void CCTMXLayer::addChild(CCNode * child, int zOrder, int tag)
+{
+    CC_UNUSED_PARAM(child);
+    CC_UNUSED_PARAM(zOrder);
+    CC_UNUSED_PARAM(tag);
+    CCAssert(0, "addChild: is not supported on CCTMXLayer. Instead use setTileGID:at:/tileAt:");
 }
+void CCTMXLayer::removeChild(CCNode* node, bool cleanup)
+{
+    CCSprite *sprite = (CCSprite*)node;
+    // allows removing nil objects
+    if (! sprite)
+    {
+        return;
+    }
 
-// used only when parsing the map. useless after the map was parsed
-// since lot's of assumptions are no longer true
-CCSprite * CCTMXLayer::appendTileForGID(unsigned int gid, const CCPoint& pos)
+    CCAssert(m_pChildren->containsObject(sprite), "Tile does not belong to TMXLayer");
+
+    unsigned int atlasIndex = sprite->getAtlasIndex();
+    unsigned int zz = (size_t)m_pAtlasIndexArray->arr[atlasIndex];
+    m_pTiles[zz] = 0;
+    ccCArrayRemoveValueAtIndex(m_pAtlasIndexArray, atlasIndex);
+    CCSpriteBatchNode::removeChild(sprite, cleanup);
+    markTileDirty(zz % (unsigned int)m_tLayerSize.width, zz / (unsigned int)m_tLayerSize.width);
+}
+void CCTMXLayer::removeTileAt(const CCPoint& pos)
 {
-    CCRect rect = m_pTileSet->rectForGID(gid);
-    rect = CC_RECT_PIXELS_TO_POINTS(rect);
+    CCAssert(pos.x < m_tLayerSize.width && pos.y < m_tLayerSize.height && pos.x >=0 && pos.y >=0, "TMXLayer: invalid position");
+    CCAssert(m_pTiles && m_pAtlasIndexArray, "TMXLayer: the tiles map has been released");
 
-    intptr_t z = (intptr_t)(pos.x + pos.y * m_tLayerSize.width);
+    // remove tile from GID map, and its sprite if it has one
+    setTileGIDAndFlags(0, (unsigned int)pos.x, (unsigned int)pos.y);
+}
 
-    CCSprite *tile = reusedTileWithRect(rect);
+// CCTMXLayer - chunks
+ccTMXTileChunk* CCTMXLayer::chunkForTile(unsigned int x, unsigned int y)
+{
+    return &m_pChunks[(x / CC_TMX_LAYER_CHUNK_SIZE) + (y / CC_TMX_LAYER_CHUNK_SIZE) * m_uChunksWide];
+}
 
-    setupTileSprite(tile ,pos ,gid);
+void CCTMXLayer::markTileDirty(unsigned int x, unsigned int y)
+{
+    if (! m_pChunks)
+    {
+        return;
+    }
 
-    // optimization:
-    // The difference between appendTileForGID and insertTileforGID is that append is faster, since
-    // it appends the tile at the end of the texture atlas
-    unsigned int indexForZ = m_pAtlasIndexArray->num;
+    // not generated yet, or waiting to be regenerated: nothing to patch
+    ccTMXTileChunk *chunk = chunkForTile(x, y);
+    if (chunk->bDirty)
+    {
+        return;
+    }
 
-    // don't add it using the "standard" way.
-    insertQuadFromSprite(tile, indexForZ);
+    unsigned int local = (x % CC_TMX_LAYER_CHUNK_SIZE) + (y % CC_TMX_LAYER_CHUNK_SIZE) * CC_TMX_LAYER_CHUNK_SIZE;
+    unsigned short quadIndex = chunk->pQuadIndices ? chunk->pQuadIndices[local] : (unsigned short)kCCTMXTileNoQuad;
 
-    // append should be after addQuadFromSprite since it modifies the quantity values
-    ccCArrayInsertValueAtIndex(m_pAtlasIndexArray, (void*)z, indexForZ);
+    if ((quadIndex & ~kCCTMXTileQueued) == kCCTMXTileNoQuad)
+    {
+        // the tile needs a new quad only if the chunk has to draw it.
+        // Inserting quads would shift the chunk, so regenerate it instead
+        unsigned int z = x + y * (unsigned int)m_tLayerSize.width;
+        if ((m_pTiles[z] & kCCFlippedMask) && ! hasSpriteForZ(z))
+        {
+            chunk->bDirty = true;
+        }
+        return;
+    }
 
-    return tile;
+    if (! (quadIndex & kCCTMXTileQueued))
+    {
+        chunk->pQuadIndices[local] = quadIndex | kCCTMXTileQueued;
+        ccCArrayAppendValueWithResize(chunk->pDirtyTiles, (void*)(intptr_t)local);
+    }
 }
 
-// CCTMXLayer - atlasIndex and Z
-static inline int compareInts(const void * a, const void * b)
-{
-    return ((*(int*)a) - (*(int*)b));
-}
-unsigned int CCTMXLayer::atlasIndexForExistantZ(unsigned int z)
+void CCTMXLayer::updateDirtyTiles(unsigned int cx, unsigned int cy)
 {
-    int key=z;
-    int *item = (int*)bsearch((void*)&key, (void*)&m_pAtlasIndexArray->arr[0], m_pAtlasIndexArray->num, sizeof(void*), compareInts);
+    ccTMXTileChunk *chunk = &m_pChunks[cx + cy * m_uChunksWide];
+    if (! chunk->pDirtyTiles || chunk->pDirtyTiles->num == 0)
+    {
+        return;
+    }
+    m_bOrderedDirty = true;
+
+    unsigned int layerWidth = (unsigned int)m_tLayerSize.width;
+    ccV3F_C4B_T2F_Quad quad;
 
-    CCAssert(item, "TMX atlas index not found. Shall not happen");
+    for (unsigned int i = 0; i < chunk->pDirtyTiles->num; i++)
+    {
+        unsigned int local = (unsigned int)(size_t)chunk->pDirtyTiles->arr[i];
+        unsigned short quadIndex = chunk->pQuadIndices[local] & ~kCCTMXTileQueued;
+        chunk->pQuadIndices[local] = quadIndex;
 
-    int index = ((size_t)item - (size_t)m_pAtlasIndexArray->arr) / sizeof(void*);
-    return index;
+        unsigned int x = cx * CC_TMX_LAYER_CHUNK_SIZE + local % CC_TMX_LAYER_CHUNK_SIZE;
+        unsigned int y = cy * CC_TMX_LAYER_CHUNK_SIZE + local / CC_TMX_LAYER_CHUNK_SIZE;
+        unsigned int z = x + y * layerWidth;
+        unsigned int gid = m_pTiles[z];
+
+        // removed tiles keep their quad, empty, so that the next quads don't move
+        if ((gid & kCCFlippedMask) && ! hasSpriteForZ(z))
+        {
+            fillQuadForGID(&quad, gid, x, y);
+        }
+        else
+        {
+            memset(&quad, 0, sizeof(quad));
+        }
+        chunk->pAtlas->updateQuad(&quad, quadIndex);
+    }
+
+    ccCArrayRemoveAllValues(chunk->pDirtyTiles);
 }
-unsigned int CCTMXLayer::atlasIndexForNewZ(int z)
+
+unsigned int CCTMXLayer::getBuiltChunkCount()
 {
-    // XXX: This can be improved with a sort of binary search
-    unsigned int i=0;
-    for (i=0; i< m_pAtlasIndexArray->num ; i++) 
+    unsigned int count = 0;
+    for (unsigned int i = 0; i < getChunkCount(); i++)
     {
-        int val = (size_t) m_pAtlasIndexArray->arr[i];
-        if (z < val)
+        if (m_pChunks[i].pAtlas)
         {
-            break;
+            count++;
         }
-    } 
-    
-    return i;
+    }
+    return count;
 }
 
-// CCTMXLayer - adding / remove tiles
-void CCTMXLayer::setTileGID(unsigned int gid, const CCPoint& pos)
+void CCTMXLayer::releaseChunks()
 {
-    setTileGID(gid, pos, (ccTMXTileFlags)0);
+    if (m_pChunks)
+    {
+        for (unsigned int i = 0; i < getChunkCount(); i++)
+        {
+            CC_SAFE_RELEASE(m_pChunks[i].pAtlas);
+            CC_SAFE_FREE(m_pChunks[i].pQuadIndices);
+            CC_SAFE_FREE(m_pChunks[i].pRowQuads);
+            ccCArrayFree(m_pChunks[i].pDirtyTiles);
+        }
+        free(m_pChunks);
+        m_pChunks = NULL;
+    }
 }
 
-void CCTMXLayer::setTileGID(unsigned int gid, const CCPoint& pos, ccTMXTileFlags flags)
+void CCTMXLayer::fillQuadForGID(ccV3F_C4B_T2F_Quad *quad, unsigned int gid, unsigned int x, unsigned int y)
 {
-    CCAssert(pos.x < m_tLayerSize.width && pos.y < m_tLayerSize.height && pos.x >=0 && pos.y >=0, "TMXLayer: invalid position");
-    CCAssert(m_pTiles && m_pAtlasIndexArray, "TMXLayer: the tiles map has been released");
-    CCAssert(gid == 0 || gid >= m_pTileSet->m_uFirstGid, "TMXLayer: invalid gid" );
+    CCRect rect = m_pTileSet->rectForGID(gid);
+    CCTexture2D *tex = m_pobTextureAtlas->getTexture();
+
+    float atlasWidth = (float)tex->getPixelsWide();
+    float atlasHeight = (float)tex->getPixelsHigh();
+
+    float left, right, top, bottom;
+#if CC_FIX_ARTIFACTS_BY_STRECHING_TEXEL
+    left    = (2*rect.origin.x+1)/(2*atlasWidth);
+    right    = left + (rect.size.width*2-2)/(2*atlasWidth);
+    top        = (2*rect.origin.y+1)/(2*atlasHeight);
+    bottom    = top + (rect.size.height*2-2)/(2*atlasHeight);
+#else
+    left    = rect.origin.x/atlasWidth;
+    right    = (rect.origin.x + rect.size.width) / atlasWidth;
+    top        = rect.origin.y/atlasHeight;
+    bottom    = (rect.origin.y + rect.size.height) / atlasHeight;
+#endif // ! CC_FIX_ARTIFACTS_BY_STRECHING_TEXEL
+
+    ccTex2F tl = tex2(left, top);
+    ccTex2F tr = tex2(right, top);
+    ccTex2F bl = tex2(left, bottom);
+    ccTex2F br = tex2(right, bottom);
+    float w = rect.size.width;
+    float h = rect.size.height;
+
+    // Same order as Tiled: swap the axis first, then flip horizontally and vertically
+    if (gid & kCCTMXTileDiagonalFlag)
+    {
+        CC_SWAP(tr, bl, ccTex2F);
+        CC_SWAP(w, h, float);
+    }
+    if (gid & kCCTMXTileHorizontalFlag)
+    {
+        CC_SWAP(tl, tr, ccTex2F);
+        CC_SWAP(bl, br, ccTex2F);
+    }
+    if (gid & kCCTMXTileVerticalFlag)
+    {
+        CC_SWAP(tl, bl, ccTex2F);
+        CC_SWAP(tr, br, ccTex2F);
+    }
+
+    CCPoint pos = ccp((float)x, (float)y);
+    CCPoint origin = positionInPixelsAt(pos);
+    float z = (float)vertexZForPos(pos);
+    float x1 = origin.x;
+    float y1 = origin.y;
+    float x2 = x1 + w;
+    float y2 = y1 + h;
+
+    quad->bl.vertices = vertex3(x1, y1, z);
+    quad->br.vertices = vertex3(x2, y1, z);
+    quad->tl.vertices = vertex3(x1, y2, z);
+    quad->tr.vertices = vertex3(x2, y2, z);
+
+    quad->bl.texCoords = bl;
+    quad->br.texCoords = br;
+    quad->tl.texCoords = tl;
+    quad->tr.texCoords = tr;
+
+    // same color the tile would get as a CCSprite
+    ccColor4B color = ccc4(255, 255, 255, m_cOpacity);
+    if (tex->hasPremultipliedAlpha())
+    {
+        color = ccc4(m_cOpacity, m_cOpacity, m_cOpacity, m_cOpacity);
+    }
+    quad->bl.colors = color;
+    quad->br.colors = color;
+    quad->tl.colors = color;
+    quad->tr.colors = color;
+}
 
-    ccTMXTileFlags currentFlags;
-    unsigned int currentGID = tileGIDAt(pos, &currentFlags);
+void CCTMXLayer::buildChunk(unsigned int cx, unsigned int cy)
+{
+    ccTMXTileChunk *chunk = &m_pChunks[cx + cy * m_uChunksWide];
+    chunk->bDirty = false;
+    m_bOrderedDirty = true;
 
-    if (currentGID != gid || currentFlags != flags) 
+    // the map was released: keep the quads that were generated before
+    if (! m_pTiles)
     {
-        unsigned gidAndFlags = gid | flags;
+        return;
+    }
 
-        // setting gid=0 is equal to remove the tile
-        if (gid == 0)
-        {
-            removeTileAt(pos);
-        }
-        // empty tile. create a new one
-        else if (currentGID == 0)
-        {
-            insertTileForGID(gidAndFlags, pos);
-        }
-        // modifying an existing tile with a non-empty tile
-        else 
+    unsigned int layerWidth = (unsigned int)m_tLayerSize.width;
+    unsigned int x0 = cx * CC_TMX_LAYER_CHUNK_SIZE;
+    unsigned int y0 = cy * CC_TMX_LAYER_CHUNK_SIZE;
+    unsigned int x1 = MIN(x0 + CC_TMX_LAYER_CHUNK_SIZE, layerWidth);
+    unsigned int y1 = MIN(y0 + CC_TMX_LAYER_CHUNK_SIZE, (unsigned int)m_tLayerSize.height);
+
+    // tiles converted into CCSprite are drawn by the batch node atlas, not by the chunk
+    unsigned int count = 0;
+    for (unsigned int y = y0; y < y1; y++)
+    {
+        for (unsigned int x = x0; x < x1; x++)
         {
-            unsigned int z = (unsigned int)(pos.x + pos.y * m_tLayerSize.width);
-            CCSprite *sprite = (CCSprite*)getChildByTag(z);
-            if (sprite)
+            unsigned int z = x + y * layerWidth;
+            if ((m_pTiles[z] & kCCFlippedMask) && ! hasSpriteForZ(z))
             {
-                CCRect rect = m_pTileSet->rectForGID(gid);
-                rect = CC_RECT_PIXELS_TO_POINTS(rect);
+                count++;
+            }
+        }
+    }
 
-                sprite->setTextureRect(rect, false, rect.size);
-                if (flags) 
-                {
-                    setupTileSprite(sprite, sprite->getPosition(), gidAndFlags);
-                }
-                m_pTiles[z] = gidAndFlags;
-            } 
-            else 
+    if (count == 0)
+    {
+        CC_SAFE_RELEASE_NULL(chunk->pAtlas);
+        CC_SAFE_FREE(chunk->pQuadIndices);
+        CC_SAFE_FREE(chunk->pRowQuads);
+        ccCArrayFree(chunk->pDirtyTiles);
+        chunk->pDirtyTiles = NULL;
+        return;
+    }
+
+    if (! chunk->pAtlas)
+    {
+        chunk->pAtlas = new CCTextureAtlas();
+        chunk->pAtlas->initWithTexture(m_pobTextureAtlas->getTexture(), count);
+        chunk->pQuadIndices = (unsigned short*)malloc(sizeof(unsigned short) * CC_TMX_LAYER_CHUNK_SIZE * CC_TMX_LAYER_CHUNK_SIZE);
+        chunk->pRowQuads = (unsigned short*)malloc(sizeof(unsigned short) * (CC_TMX_LAYER_CHUNK_SIZE + 1));
+        chunk->pDirtyTiles = ccCArrayNew(16);
+    }
+    else if (chunk->pAtlas->getCapacity() < count)
+    {
+        chunk->pAtlas->resizeCapacity(count);
+    }
+    chunk->pAtlas->removeAllQuads();
+    ccCArrayRemoveAllValues(chunk->pDirtyTiles);
+    for (unsigned int i = 0; i < CC_TMX_LAYER_CHUNK_SIZE * CC_TMX_LAYER_CHUNK_SIZE; i++)
+    {
+        chunk->pQuadIndices[i] = kCCTMXTileNoQuad;
+    }
+
+    // quads are added in z order, like the tiles of the map
+    ccV3F_C4B_T2F_Quad quad;
+    unsigned int index = 0;
+    for (unsigned int y = y0; y < y1; y++)
+    {
+        chunk->pRowQuads[y - y0] = (unsigned short)index;
+        for (unsigned int x = x0; x < x1; x++)
+        {
+            unsigned int z = x + y * layerWidth;
+            unsigned int gid = m_pTiles[z];
+            if ((gid & kCCFlippedMask) && ! hasSpriteForZ(z))
             {
-                updateTileForGID(gidAndFlags, pos);
+                fillQuadForGID(&quad, gid, x, y);
+                chunk->pAtlas->updateQuad(&quad, index);
+                chunk->pQuadIndices[(x - x0) + (y - y0) * CC_TMX_LAYER_CHUNK_SIZE] = (unsigned short)index;
+                index++;
             }
         }
     }
+    for (unsigned int row = y1 - y0; row <= CC_TMX_LAYER_CHUNK_SIZE; row++)
+    {
+        chunk->pRowQuads[row] = (unsigned short)index;
+    }
 }
-void CCTMXLayer::addChild(CCNode * child, int zOrder, int tag)
+
+bool CCTMXLayer::hasSpriteForZ(unsigned int z)
 {
-    CC_UNUSED_PARAM(child);
-    CC_UNUSED_PARAM(zOrder);
-    CC_UNUSED_PARAM(tag);
-    CCAssert(0, "addChild: is not supported on CCTMXLayer. Instead use setTileGID:at:/tileAt:");
+    if (m_pAtlasIndexArray->num == 0)
+    {
+        return false;
+    }
+    unsigned int index = atlasIndexForNewZ(z);
+    return index > 0 && (unsigned int)(size_t)m_pAtlasIndexArray->arr[index - 1] == z;
 }
-void CCTMXLayer::removeChild(CCNode* node, bool cleanup)
+
+bool CCTMXLayer::visibleTileRange(int *x0, int *y0, int *x1, int *y1)
 {
-    CCSprite *sprite = (CCSprite*)node;
-    // allows removing nil objects
-    if (! sprite)
+    // grids and cameras move the vertices after the transform: don't cull
+    if ((m_pGrid && m_pGrid->isActive()) || (m_pCamera && m_pCamera->getDirty()))
     {
-        return;
+        return false;
     }
 
-    CCAssert(m_pChildren->containsObject(sprite), "Tile does not belong to TMXLayer");
+    // screen rect in the layer coordinates, in points, then in pixels like the map tile size
+    CCSize winSize = CCDirector::sharedDirector()->getWinSize();
+    CCRect screen = CCRectApplyAffineTransform(CCRectMake(0, 0, winSize.width, winSize.height), worldToNodeTransform());
+    screen = CC_RECT_POINTS_TO_PIXELS(screen);
+
+    float layerWidth = m_tLayerSize.width;
+    float layerHeight = m_tLayerSize.height;
+    float corners[4][2] = {
+        { screen.getMinX(), screen.getMinY() },
+        { screen.getMaxX(), screen.getMinY() },
+        { screen.getMinX(), screen.getMaxY() },
+        { screen.getMaxX(), screen.getMaxY() },
+    };
+
+    float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+    for (int i = 0; i < 4; i++)
+    {
+        float fx = 0, fy = 0;
+        switch (m_uLayerOrientation)
+        {
+        case CCTMXOrientationOrtho:
+            fx = corners[i][0] / m_tMapTileSize.width;
+            fy = layerHeight - corners[i][1] / m_tMapTileSize.height;
+            break;
+        case CCTMXOrientationIso:
+            {
+                // inverse of positionForIsoAt
+                float a = corners[i][0] / (m_tMapTileSize.width / 2) - layerWidth + 1;
+                float b = layerHeight * 2 - 2 - corners[i][1] / (m_tMapTileSize.height / 2);
+                fx = (a + b) / 2;
+                fy = (b - a) / 2;
+            }
+            break;
+        case CCTMXOrientationHex:
+            fx = corners[i][0] / (m_tMapTileSize.width * 3 / 4);
+            fy = layerHeight - corners[i][1] / m_tMapTileSize.height;
+            break;
+        }
+        minX = MIN(minX, fx);
+        minY = MIN(minY, fy);
+        maxX = MAX(maxX, fx);
+        maxY = MAX(maxY, fy);
+    }
 
-    unsigned int atlasIndex = sprite->getAtlasIndex();
-    unsigned int zz = (size_t)m_pAtlasIndexArray->arr[atlasIndex];
-    m_pTiles[zz] = 0;
-    ccCArrayRemoveValueAtIndex(m_pAtlasIndexArray, atlasIndex);
-    CCSpriteBatchNode::removeChild(sprite, cleanup);
+    // tiles bigger than the map tiles overflow into the neighbour cells
+    int margin = 1 + (int)ceilf(MAX(m_pTileSet->m_tTileSize.width / m_tMapTileSize.width,
+                                    m_pTileSet->m_tTileSize.height / m_tMapTileSize.height));
+    if (m_uLayerOrientation != CCTMXOrientationOrtho)
+    {
+        margin++;
+    }
+
+    *x0 = MAX((int)floorf(minX) - margin, 0);
+    *y0 = MAX((int)floorf(minY) - margin, 0);
+    *x1 = MIN((int)floorf(maxX) + margin, (int)layerWidth - 1);
+    *y1 = MIN((int)floorf(maxY) + margin, (int)layerHeight - 1);
+    return true;
 }
-void CCTMXLayer::removeTileAt(const CCPoint& pos)
+
+// CCTMXLayer - draw
+bool CCTMXLayer::needsOrderedDraw()
 {
-    CCAssert(pos.x < m_tLayerSize.width && pos.y < m_tLayerSize.height && pos.x >=0 && pos.y >=0, "TMXLayer: invalid position");
-    CCAssert(m_pTiles && m_pAtlasIndexArray, "TMXLayer: the tiles map has been released");
+    // without overlaps the chunks can be drawn in any order
+    return m_uLayerOrientation != CCTMXOrientationOrtho
+        || m_pTileSet->m_tTileSize.width > m_tMapTileSize.width
+        || m_pTileSet->m_tTileSize.height > m_tMapTileSize.height
+        || m_pobTextureAtlas->getTotalQuads() > 0;
+}
 
-    unsigned int gid = tileGIDAt(pos);
+unsigned int CCTMXLayer::chunkQuadForColumn(ccTMXTileChunk *chunk, unsigned int row, unsigned int column)
+{
+    // quads follow the columns of the row: the first tile with a quad from the column on
+    for (unsigned int c = column; c < CC_TMX_LAYER_CHUNK_SIZE; c++)
+    {
+        unsigned short quadIndex = chunk->pQuadIndices[c + row * CC_TMX_LAYER_CHUNK_SIZE] & ~kCCTMXTileQueued;
+        if (quadIndex != kCCTMXTileNoQuad)
+        {
+            return quadIndex;
+        }
+    }
+    return chunk->pRowQuads[row + 1];
+}
 
-    if (gid) 
+static void appendQuads(CCTextureAtlas *atlas, ccV3F_C4B_T2F_Quad *quads, unsigned int first, unsigned int last, unsigned int *index)
+{
+    for (unsigned int i = first; i < last; i++)
     {
-        unsigned int z = (unsigned int)(pos.x + pos.y * m_tLayerSize.width);
-        unsigned int atlasIndex = atlasIndexForExistantZ(z);
+        atlas->updateQuad(&quads[i], (*index)++);
+    }
+}
 
-        // remove tile from GID map
-        m_pTiles[z] = 0;
+void CCTMXLayer::drawOrdered(int cx0, int cy0, int cx1, int cy1)
+{
+    // the quads are gathered again only when the visible chunks, their tiles or the converted tiles change.
+    // Nothing draws the batch node atlas itself: its dirty flag tells if a converted tile was updated
+    if (m_bOrderedDirty || m_pobTextureAtlas->m_bDirty
+        || cx0 != m_nOrderedChunks[0] || cy0 != m_nOrderedChunks[1] || cx1 != m_nOrderedChunks[2] || cy1 != m_nOrderedChunks[3])
+    {
+        gatherOrderedQuads(cx0, cy0, cx1, cy1);
+        m_nOrderedChunks[0] = cx0;
+        m_nOrderedChunks[1] = cy0;
+        m_nOrderedChunks[2] = cx1;
+        m_nOrderedChunks[3] = cy1;
+        m_bOrderedDirty = false;
+        m_pobTextureAtlas->m_bDirty = false;
+    }
 
-        // remove tile from atlas position array
-        ccCArrayRemoveValueAtIndex(m_pAtlasIndexArray, atlasIndex);
+    if (m_pOrderedAtlas)
+    {
+        m_pOrderedAtlas->setTexture(m_pobTextureAtlas->getTexture());
+        m_pOrderedAtlas->drawQuads();
+    }
+}
 
-        // remove it from sprites and/or texture atlas
-        CCSprite *sprite = (CCSprite*)getChildByTag(z);
-        if (sprite)
+void CCTMXLayer::gatherOrderedQuads(int cx0, int cy0, int cx1, int cy1)
+{
+    unsigned int layerWidth = (unsigned int)m_tLayerSize.width;
+    unsigned int layerHeight = (unsigned int)m_tLayerSize.height;
+    ccV3F_C4B_T2F_Quad *spriteQuads = m_pobTextureAtlas->getQuads();
+    unsigned int spriteCount = m_pobTextureAtlas->getTotalQuads();
+    // the z of the converted tiles is lost with the map: they are then drawn last
+    unsigned int sortedSprites = m_pAtlasIndexArray ? m_pAtlasIndexArray->num : 0;
+
+    unsigned int count = spriteCount;
+    for (int cy = cy0; cy <= cy1; cy++)
+    {
+        for (int cx = cx0; cx <= cx1; cx++)
         {
-            CCSpriteBatchNode::removeChild(sprite, true);
+            ccTMXTileChunk *chunk = &m_pChunks[cx + cy * m_uChunksWide];
+            if (chunk->pAtlas)
+            {
+                count += chunk->pAtlas->getTotalQuads();
+            }
         }
-        else 
+    }
+    if (count == 0)
+    {
+        if (m_pOrderedAtlas)
         {
-            m_pobTextureAtlas->removeQuadAtIndex(atlasIndex);
+            m_pOrderedAtlas->removeAllQuads();
+        }
+        return;
+    }
 
-            // update possible children
-            if (m_pChildren && m_pChildren->count()>0)
+    if (! m_pOrderedAtlas)
+    {
+        m_pOrderedAtlas = new CCTextureAtlas();
+        m_pOrderedAtlas->initWithTexture(m_pobTextureAtlas->getTexture(), count);
+    }
+    else if (m_pOrderedAtlas->getCapacity() < count)
+    {
+        m_pOrderedAtlas->resizeCapacity(count);
+    }
+    m_pOrderedAtlas->removeAllQuads();
+
+    // same order as a single atlas of the whole map: row by row, and the columns of a row across the chunks
+    unsigned int index = 0;
+    unsigned int sprite = 0;
+    for (int cy = cy0; cy <= cy1; cy++)
+    {
+        unsigned int rows = MIN((unsigned int)CC_TMX_LAYER_CHUNK_SIZE, layerHeight - cy * CC_TMX_LAYER_CHUNK_SIZE);
+        for (unsigned int row = 0; row < rows; row++)
+        {
+            unsigned int y = cy * CC_TMX_LAYER_CHUNK_SIZE + row;
+            for (int cx = cx0; cx <= cx1; cx++)
             {
-                CCObject* pObject = NULL;
-                CCARRAY_FOREACH(m_pChildren, pObject)
+                ccTMXTileChunk *chunk = &m_pChunks[cx + cy * m_uChunksWide];
+                if (! chunk->pAtlas)
+                {
+                    continue;
+                }
+
+                ccV3F_C4B_T2F_Quad *quads = chunk->pAtlas->getQuads();
+                unsigned int first = chunk->pRowQuads[row];
+                unsigned int last = chunk->pRowQuads[row + 1];
+                unsigned int zFirst = cx * CC_TMX_LAYER_CHUNK_SIZE + y * layerWidth;
+                unsigned int columns = MIN((unsigned int)CC_TMX_LAYER_CHUNK_SIZE, layerWidth - cx * CC_TMX_LAYER_CHUNK_SIZE);
+
+                // the converted tiles before the row of the chunk, then the ones within it
+                while (sprite < sortedSprites)
                 {
-                    CCSprite* pChild = (CCSprite*) pObject;
-                    if (pChild)
+                    unsigned int z = (unsigned int)(size_t)m_pAtlasIndexArray->arr[sprite];
+                    if (z >= zFirst + columns)
                     {
-                        unsigned int ai = pChild->getAtlasIndex();
-                        if ( ai >= atlasIndex )
-                        {
-                            pChild->setAtlasIndex(ai-1);
-                        }
+                        break;
                     }
+                    unsigned int split = z < zFirst ? first : chunkQuadForColumn(chunk, row, z - zFirst);
+                    appendQuads(m_pOrderedAtlas, quads, first, split, &index);
+                    appendQuads(m_pOrderedAtlas, spriteQuads, sprite, sprite + 1, &index);
+                    first = split;
+                    sprite++;
+                }
+                appendQuads(m_pOrderedAtlas, quads, first, last, &index);
+            }
+        }
+    }
+
+    // the converted tiles after the visible chunks
+    appendQuads(m_pOrderedAtlas, spriteQuads, sprite, spriteCount, &index);
+}
+
+void CCTMXLayer::draw(void)
+{
+    m_uVisibleChunks = 0;
+
+    // tiles converted into CCSprite: update their quads in the batch node atlas
+    if (m_pobDescendants && m_pobDescendants->count() > 0)
+    {
+        CCObject* pObject = NULL;
+        CCARRAY_FOREACH(m_pobDescendants, pObject)
+        {
+            CCSprite* pChild = (CCSprite*) pObject;
+            if (pChild)
+            {
+                pChild->updateTransform();
+            }
+        }
+    }
+
+    int cx0 = 0;
+    int cy0 = 0;
+    int cx1 = (int)m_uChunksWide - 1;
+    int cy1 = (int)m_uChunksHigh - 1;
+
+    int x0, y0, x1, y1;
+    if (m_pChunks && visibleTileRange(&x0, &y0, &x1, &y1))
+    {
+        cx0 = x0 / CC_TMX_LAYER_CHUNK_SIZE;
+        cy0 = y0 / CC_TMX_LAYER_CHUNK_SIZE;
+        // an empty range leaves cx1 < cx0 or cy1 < cy0: no chunk is drawn
+        cx1 = x1 < x0 ? -1 : x1 / CC_TMX_LAYER_CHUNK_SIZE;
+        cy1 = y1 < y0 ? -1 : y1 / CC_TMX_LAYER_CHUNK_SIZE;
+    }
+
+    for (int cy = cy0; cy <= cy1; cy++)
+    {
+        for (int cx = cx0; cx <= cx1; cx++)
+        {
+            ccTMXTileChunk *chunk = &m_pChunks[cx + cy * m_uChunksWide];
+            if (chunk->bDirty)
+            {
+                buildChunk(cx, cy);
+            }
+            else
+            {
+                updateDirtyTiles(cx, cy);
+            }
+
+            if (chunk->pAtlas && chunk->pAtlas->getTotalQuads() > 0)
+            {
+                m_uVisibleChunks++;
+            }
+        }
+    }
+
+    bool newBlend = m_blendFunc.src != CC_BLEND_SRC || m_blendFunc.dst != CC_BLEND_DST;
+    if (newBlend)
+    {
+        CCD3DCLASS->D3DBlendFunc(m_blendFunc.src, m_blendFunc.dst);
+    }
+
+    if (needsOrderedDraw())
+    {
+        drawOrdered(cx0, cy0, cx1, cy1);
+    }
+    else
+    {
+        // no tile overlaps another one: a draw per chunk
+        for (int cy = cy0; cy <= cy1; cy++)
+        {
+            for (int cx = cx0; cx <= cx1; cx++)
+            {
+                ccTMXTileChunk *chunk = &m_pChunks[cx + cy * m_uChunksWide];
+                if (chunk->pAtlas && chunk->pAtlas->getTotalQuads() > 0)
+                {
+                    chunk->pAtlas->drawQuads();
                 }
             }
         }
     }
+
+    if (newBlend)
+    {
+        CCD3DCLASS->D3DBlendFunc(CC_BLEND_SRC, CC_BLEND_DST);
+    }
 }
 
 //CCTMXLayer - obtaining positions, offset
@@ -636,6 +1128,12 @@ CCPoint CCTMXLayer::calculateLayerOffset(const CCPoint& pos)
     return ret;    
 }
 CCPoint CCTMXLayer::positionAt(const CCPoint& pos)
+{
+    CCPoint ret = positionInPixelsAt(pos);
+    ret = CC_POINT_PIXELS_TO_POINTS( ret );
+    return ret;
+}
+CCPoint CCTMXLayer::positionInPixelsAt(const CCPoint& pos)
 {
     CCPoint ret = CCPointZero;
     switch (m_uLayerOrientation)
@@ -650,7 +1148,6 @@ CCPoint CCTMXLayer::positionAt(const CCPoint& pos)
         ret = positionForHexAt(pos);
         break;
     }
-    ret = CC_POINT_PIXELS_TO_POINTS( ret );
     return ret;
 }
 CCPoint CCTMXLayer::positionForOrthoAt(const CCPoint& pos)
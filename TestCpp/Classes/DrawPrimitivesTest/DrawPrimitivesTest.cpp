@@ -1,13 +1,140 @@
 #include "pch.h"
 #include "DrawPrimitivesTest.h"
+#include "../testResource.h"
 
+#define MAX_LAYER    2
+
+static int sceneIdx = -1;
+
+static CCLayer* createDrawPrimitivesLayer(int nIndex)
+{
+    switch(nIndex)
+    {
+    case 0: return new DrawPrimitivesTest();
+    case 1: return new DrawNodeTest();
+    }
+
+    return NULL;
+}
+
+static CCLayer* nextDrawPrimitivesTest()
+{
+    sceneIdx++;
+    sceneIdx = sceneIdx % MAX_LAYER;
+
+    CCLayer* pLayer = createDrawPrimitivesLayer(sceneIdx);
+    pLayer->autorelease();
+
+    return pLayer;
+}
+
+static CCLayer* backDrawPrimitivesTest()
+{
+    sceneIdx--;
+    int total = MAX_LAYER;
+    if( sceneIdx < 0 )
+        sceneIdx += total;
+
+    CCLayer* pLayer = createDrawPrimitivesLayer(sceneIdx);
+    pLayer->autorelease();
+
+    return pLayer;
+}
+
+static CCLayer* restartDrawPrimitivesTest()
+{
+    CCLayer* pLayer = createDrawPrimitivesLayer(sceneIdx);
+    pLayer->autorelease();
+
+    return pLayer;
+}
+
+//------------------------------------------------------------------
+//
+// BaseLayer
+//
+//------------------------------------------------------------------
+BaseLayer::BaseLayer()
+{
+}
+
+void BaseLayer::onEnter()
+{
+    CCLayer::onEnter();
+
+    CCSize s = CCDirector::sharedDirector()->getWinSize();
+
+    CCLabelTTF *label = CCLabelTTF::create(title().c_str(), "Arial", 26);
+    addChild(label, 1);
+    label->setPosition(ccp(s.width/2, s.height-50));
+
+    std::string strSubTitle = subtitle();
+    if (strSubTitle.length() > 0)
+    {
+        CCLabelTTF *l = CCLabelTTF::create(strSubTitle.c_str(), "Thonburi", 16);
+        addChild(l, 1);
+        l->setPosition(ccp(s.width/2, s.height-80));
+    }
+
+    CCMenuItemImage *item1 = CCMenuItemImage::create(s_pPathB1, s_pPathB2, this, menu_selector(BaseLayer::backCallback) );
+    CCMenuItemImage *item2 = CCMenuItemImage::create(s_pPathR1, s_pPathR2, this, menu_selector(BaseLayer::restartCallback) );
+    CCMenuItemImage *item3 = CCMenuItemImage::create(s_pPathF1, s_pPathF2, this, menu_selector(BaseLayer::nextCallback) );
+
+    CCMenu *menu = CCMenu::create(item1, item2, item3, NULL);
+
+    menu->setPosition(CCPointZero);
+    item1->setPosition(ccp(VisibleRect::center().x - item2->getContentSize().width*2, VisibleRect::bottom().y+item2->getContentSize().height/2));
+    item2->setPosition(ccp(VisibleRect::center().x, VisibleRect::bottom().y+item2->getContentSize().height/2));
+    item3->setPosition(ccp(VisibleRect::center().x + item2->getContentSize().width*2, VisibleRect::bottom().y+item2->getContentSize().height/2));
+    addChild(menu, 1);
+}
+
+void BaseLayer::restartCallback(CCObject* pSender)
+{
+    CCScene *s = new DrawPrimitivesTestScene();
+    s->addChild(restartDrawPrimitivesTest());
+    CCDirector::sharedDirector()->replaceScene(s);
+    s->release();
+}
+
+void BaseLayer::nextCallback(CCObject* pSender)
+{
+    CCScene *s = new DrawPrimitivesTestScene();
+    s->addChild(nextDrawPrimitivesTest());
+    CCDirector::sharedDirector()->replaceScene(s);
+    s->release();
+}
+
+void BaseLayer::backCallback(CCObject* pSender)
+{
+    CCScene *s = new DrawPrimitivesTestScene();
+    s->addChild(backDrawPrimitivesTest());
+    CCDirector::sharedDirector()->replaceScene(s);
+    s->release();
+}
+
+std::string BaseLayer::title()
+{
+    return "No title";
+}
+
+std::string BaseLayer::subtitle()
+{
+    return "";
+}
+
+//------------------------------------------------------------------
+//
+// DrawPrimitivesTest
+//
+//------------------------------------------------------------------
 DrawPrimitivesTest::DrawPrimitivesTest()
 {
 }
 
 void DrawPrimitivesTest::draw()
 {
-	CCLayer::draw();
+	BaseLayer::draw();
 
     CCSize s = CCDirector::sharedDirector()->getWinSize();
 	
@@ -55,11 +182,81 @@ void DrawPrimitivesTest::draw()
 	CCDrawingPrimitive::D3DColor4f(1.0, 1.0, 1.0, 1.0);
 }
 
+std::string DrawPrimitivesTest::title()
+{
+    return "Draw primitives";
+}
+
+//------------------------------------------------------------------
+//
+// DrawNodeTest
+//
+//------------------------------------------------------------------
+DrawNodeTest::DrawNodeTest()
+{
+    CCSize s = CCDirector::sharedDirector()->getWinSize();
+
+    CCDrawNode *draw = CCDrawNode::create();
+    addChild(draw, 10);
+
+    // dots of growing size, the small ones show the antialiasing best
+    for (int i = 0; i < 8; i++)
+    {
+        draw->drawDot(ccp(s.width/2 - 140 + i * 40, s.height - 130), 2.0f + i * 2, ccc4f(1, 1, 1, 1));
+    }
+
+    // segments, thin to thick
+    draw->drawSegment(ccp(20, s.height/2 + 100), ccp(s.width/2 - 20, s.height/2 + 60), 1, ccc4f(0, 1, 0, 1));
+    draw->drawSegment(ccp(20, s.height/2 + 40), ccp(s.width/2 - 20, s.height/2 + 20), 5, ccc4f(1, 0, 1, 0.5f));
+    draw->drawSegment(ccp(20, s.height/2 - 30), ccp(s.width/2 - 20, s.height/2 - 30), 15, ccc4f(0, 1, 1, 1));
+
+    // the same square counterclockwise and clockwise: both must look the same
+    CCPoint ccw[] = { ccp(s.width/2 + 20, s.height/2 + 40), ccp(s.width/2 + 100, s.height/2 + 40), ccp(s.width/2 + 100, s.height/2 + 120), ccp(s.width/2 + 20, s.height/2 + 120) };
+    draw->drawPolygon(ccw, 4, ccc4f(1, 0, 0, 0.5f), 4, ccc4f(0, 0, 1, 1));
+
+    CCPoint cw[] = { ccp(s.width/2 + 140, s.height/2 + 40), ccp(s.width/2 + 140, s.height/2 + 120), ccp(s.width/2 + 220, s.height/2 + 120), ccp(s.width/2 + 220, s.height/2 + 40) };
+    draw->drawPolygon(cw, 4, ccc4f(1, 0, 0, 0.5f), 4, ccc4f(0, 0, 1, 1));
+
+    // concave star, counterclockwise then clockwise
+    const int points = 5;
+    CCPoint star[points * 2];
+    CCPoint starReversed[points * 2];
+    for (int i = 0; i < points * 2; i++)
+    {
+        float radius = (i % 2 == 0) ? 60.0f : 25.0f;
+        float angle = (float)M_PI / 2 + i * (float)M_PI / points;
+        star[i] = ccp(s.width/2 - 160 + radius * cosf(angle), s.height/2 - 130 + radius * sinf(angle));
+        starReversed[points * 2 - 1 - i] = ccp(s.width/2 - 20 + radius * cosf(angle), s.height/2 - 130 + radius * sinf(angle));
+    }
+    draw->drawPolygon(star, points * 2, ccc4f(1, 1, 0, 1), 2, ccc4f(1, 0, 1, 1));
+    draw->drawPolygon(starReversed, points * 2, ccc4f(1, 1, 0, 1), 2, ccc4f(1, 0, 1, 1));
+
+    // concave arrow without a border, so the fill edge itself is antialiased
+    CCPoint arrow[] = { ccp(s.width/2 + 80, s.height/2 - 190), ccp(s.width/2 + 120, s.height/2 - 150), ccp(s.width/2 + 160, s.height/2 - 190),
+        ccp(s.width/2 + 160, s.height/2 - 70), ccp(s.width/2 + 120, s.height/2 - 110), ccp(s.width/2 + 80, s.height/2 - 70) };
+    draw->drawPolygon(arrow, 6, ccc4f(0, 0.5f, 1, 1), 0, ccc4f(0, 0, 0, 0));
+}
+
+std::string DrawNodeTest::title()
+{
+    return "Test CCDrawNode";
+}
+
+std::string DrawNodeTest::subtitle()
+{
+    return "Concave polygons and both windings";
+}
+
+//------------------------------------------------------------------
+//
+// DrawPrimitivesTestScene
+//
+//------------------------------------------------------------------
 void DrawPrimitivesTestScene::runThisTest()
 {
-    CCLayer* pLayer = new DrawPrimitivesTest();
+    sceneIdx = -1;
+    CCLayer* pLayer = nextDrawPrimitivesTest();
     addChild(pLayer);
-    pLayer->release();
 
     CCDirector::sharedDirector()->replaceScene(this);
 }
@@ -4,11 +4,36 @@
 ////----#include "cocos2d.h"
 #include "../testBasic.h"
 
-class DrawPrimitivesTest : public CCLayer
+class BaseLayer : public CCLayer
+{
+public:
+    BaseLayer();
+    virtual void onEnter();
+
+    void restartCallback(CCObject* pSender);
+    void nextCallback(CCObject* pSender);
+    void backCallback(CCObject* pSender);
+
+    virtual std::string title();
+    virtual std::string subtitle();
+};
+
+class DrawPrimitivesTest : public BaseLayer
 {
 public:
 	DrawPrimitivesTest();
 	virtual void draw();
+
+    virtual std::string title();
+};
+
+class DrawNodeTest : public BaseLayer
+{
+public:
+    DrawNodeTest();
+
+    virtual std::string title();
+    virtual std::string subtitle();
 };
 
 class DrawPrimitivesTestScene : public TestScene
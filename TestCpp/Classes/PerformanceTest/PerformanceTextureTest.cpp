@@ -3,9 +3,12 @@
 
 enum
 {
-    TEST_COUNT = 1,
+    TEST_COUNT = 2,
 };
 
+// textures built from the same decoded image, per pixel format
+#define CONVERSION_ROUNDS 10
+
 static int s_nTexCurCase = 0;
 
 float calculateDeltaTime( struct timeval *lastUpdate )
@@ -33,6 +36,9 @@ void TextureMenuLayer::showCurrentTest()
     case 0:
         pScene = TextureTest::scene();
         break;
+    case 1:
+        pScene = TexturePixelConversionTest::scene();
+        break;
     }
     s_nTexCurCase = m_nCurCase;
 
@@ -346,7 +352,97 @@ std::string TextureTest::subtitle()
 CCScene* TextureTest::scene()
 {
     CCScene *pScene = CCScene::create();
-    TextureTest *layer = new TextureTest(false, TEST_COUNT, s_nTexCurCase);
+    TextureTest *layer = new TextureTest(true, TEST_COUNT, s_nTexCurCase);
+    pScene->addChild(layer);
+    layer->release();
+
+    return pScene;
+}
+
+////////////////////////////////////////////////////////
+//
+// TexturePixelConversionTest
+//
+////////////////////////////////////////////////////////
+void TexturePixelConversionTest::performTestsImage(const char* filename)
+{
+    static const struct
+    {
+        CCTexture2DPixelFormat format;
+        const char *name;
+    } formats[] = {
+        { kCCTexture2DPixelFormat_RGBA8888, "RGBA 8888" },
+        { kCCTexture2DPixelFormat_RGBA4444, "RGBA 4444" },
+        { kCCTexture2DPixelFormat_RGB5A1, "RGBA 5551" },
+        { kCCTexture2DPixelFormat_RGB565, "RGB 565" },
+        { kCCTexture2DPixelFormat_A8, "A 8" },
+    };
+
+    // decoded once, so only the conversion to the texture format and the upload are timed
+    CCImage image;
+    if (! image.initWithImageFile(filename))
+    {
+        CCLog(" ERROR\n");
+        return;
+    }
+
+    CCTexture2DPixelFormat defaultFormat = CCTexture2D::defaultAlphaPixelFormat();
+    for (unsigned int i = 0; i < sizeof(formats) / sizeof(formats[0]); i++)
+    {
+        CCLog("%s", formats[i].name);
+        CCTexture2D::setDefaultAlphaPixelFormat(formats[i].format);
+
+        struct timeval now;
+        bool bRet = true;
+        gettimeofday(&now, NULL);
+        for (int round = 0; round < CONVERSION_ROUNDS && bRet; round++)
+        {
+            CCTexture2D *texture = new CCTexture2D();
+            bRet = texture->initWithImage(&image);
+            texture->release();
+        }
+
+        if (bRet)
+            CCLog("  ms:%f\n", calculateDeltaTime(&now) * 1000.0f / CONVERSION_ROUNDS);
+        else
+            CCLog(" ERROR\n");
+    }
+    CCTexture2D::setDefaultAlphaPixelFormat(defaultFormat);
+}
+
+void TexturePixelConversionTest::performTests()
+{
+    CCLog("\n\n--------\n\n");
+
+    CCLog("--- PNG 128x128 ---\n");
+    performTestsImage("Images/test_image.png");
+
+    CCLog("\n\n--- PNG 512x512 ---\n");
+    performTestsImage("Images/texture512x512.png");
+
+    CCLog("\n\nSPRITESHEET IMAGE\n\n");
+    CCLog("--- PNG 1024x1024 ---\n");
+    performTestsImage("Images/PlanetCute-1024x1024.png");
+
+    CCLog("\n\nLANDSCAPE IMAGE\n\n");
+    CCLog("--- PNG 1024x1024 ---\n");
+    performTestsImage("Images/landscape-1024x1024.png");
+}
+
+std::string TexturePixelConversionTest::title()
+{
+    return "Pixel Conversion Test";
+}
+
+std::string TexturePixelConversionTest::subtitle()
+{
+    return "Average ms per texture, see console";
+}
+
+CCScene* TexturePixelConversionTest::scene()
+{
+    CCScene *pScene = CCScene::create();
+    TexturePixelConversionTest *layer = new TexturePixelConversionTest(true, TEST_COUNT, s_nTexCurCase);
     pScene->addChild(layer);
     layer->release();
 
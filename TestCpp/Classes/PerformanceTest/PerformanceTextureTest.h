@@ -35,6 +35,22 @@ public:
     static CCScene* scene();
 };
 
+class TexturePixelConversionTest : public TextureMenuLayer
+{
+public:
+    TexturePixelConversionTest(bool bControlMenuVisible, int nMaxCases = 0, int nCurCase = 0)
+        :TextureMenuLayer(bControlMenuVisible, nMaxCases, nCurCase)
+    {
+    }
+
+    virtual void performTests();
+    virtual std::string title();
+    virtual std::string subtitle();
+    void performTestsImage(const char* filename);
+
+    static CCScene* scene();
+};
+
 void runTextureTest();
 
 #endif
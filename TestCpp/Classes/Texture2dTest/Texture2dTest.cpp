@@ -47,6 +47,11 @@ TEXTURE2D_CREATE_FUNC(TexturePVRI8);
 TEXTURE2D_CREATE_FUNC(TexturePVRI8v3);
 TEXTURE2D_CREATE_FUNC(TexturePVRAI88);
 TEXTURE2D_CREATE_FUNC(TexturePVRAI88v3);
+TEXTURE2D_CREATE_FUNC(TexturePVRBC1v3);
+TEXTURE2D_CREATE_FUNC(TexturePVRBC3v3);
+TEXTURE2D_CREATE_FUNC(TexturePVRETC2v3);
+TEXTURE2D_CREATE_FUNC(TexturePVRETC2A1v3);
+TEXTURE2D_CREATE_FUNC(TexturePVRETC2RGBAv3);
 TEXTURE2D_CREATE_FUNC(TexturePVRBadEncoding);
 TESTLAYER_CREATE_FUNC(TexturePNG);
 TESTLAYER_CREATE_FUNC(TextureJPEG);
@@ -96,6 +101,11 @@ static NEWTEXTURE2DTESTFUNC createFunctions[] =
     createTexturePVRI8v3,
     createTexturePVRAI88,
     createTexturePVRAI88v3,
+    createTexturePVRBC1v3,
+    createTexturePVRBC3v3,
+    createTexturePVRETC2v3,
+    createTexturePVRETC2A1v3,
+    createTexturePVRETC2RGBAv3,
     
     createTexturePVRBadEncoding,
     createTexturePNG,
@@ -1172,6 +1182,166 @@ string TexturePVRAI88v3::subtitle()
     return "Testing PVR File Format v3";
 }
 
+//------------------------------------------------------------------
+//
+// TexturePVRBC1v3
+// Image generated from test_image.png
+//
+//------------------------------------------------------------------
+void TexturePVRBC1v3::onEnter()
+{
+    TextureDemo::onEnter();
+    CCSize s = CCDirector::sharedDirector()->getWinSize();
+    
+    CCSprite *img = CCSprite::create("Images/test_image_bc1_v3.pvr");
+    
+    if (img)
+    {
+        img->setPosition(ccp(s.width/2.0f, s.height/2.0f));
+        addChild(img);
+    }
+    
+    CCTextureCache::sharedTextureCache()->dumpCachedTextureInfo();
+}
+
+string TexturePVRBC1v3::title()
+{
+    return "PVR + BC1 Test";
+}
+
+string TexturePVRBC1v3::subtitle()
+{
+    return "BC1 with mipmaps. Decoded on devices without BC support";
+}
+
+//------------------------------------------------------------------
+//
+// TexturePVRBC3v3
+// Image generated from test_image.png
+//
+//------------------------------------------------------------------
+void TexturePVRBC3v3::onEnter()
+{
+    TextureDemo::onEnter();
+    CCSize s = CCDirector::sharedDirector()->getWinSize();
+    
+    CCSprite *img = CCSprite::create("Images/test_image_bc3_v3.pvr");
+    
+    if (img)
+    {
+        img->setPosition(ccp(s.width/2.0f, s.height/2.0f));
+        addChild(img);
+    }
+    
+    CCTextureCache::sharedTextureCache()->dumpCachedTextureInfo();
+}
+
+string TexturePVRBC3v3::title()
+{
+    return "PVR + BC3 Test";
+}
+
+string TexturePVRBC3v3::subtitle()
+{
+    return "BC3 with mipmaps. Decoded on devices without BC support";
+}
+
+//------------------------------------------------------------------
+//
+// TexturePVRETC2v3
+// Image generated from test_image.png
+//
+//------------------------------------------------------------------
+void TexturePVRETC2v3::onEnter()
+{
+    TextureDemo::onEnter();
+    CCSize s = CCDirector::sharedDirector()->getWinSize();
+    
+    CCSprite *img = CCSprite::create("Images/test_image_etc2_rgb_v3.pvr");
+    
+    if (img)
+    {
+        img->setPosition(ccp(s.width/2.0f, s.height/2.0f));
+        addChild(img);
+    }
+    
+    CCTextureCache::sharedTextureCache()->dumpCachedTextureInfo();
+}
+
+string TexturePVRETC2v3::title()
+{
+    return "PVR + ETC2 RGB Test";
+}
+
+string TexturePVRETC2v3::subtitle()
+{
+    return "Decoded to RGBA8888. It has no alpha";
+}
+
+//------------------------------------------------------------------
+//
+// TexturePVRETC2A1v3
+// Image generated from test_image.png
+//
+//------------------------------------------------------------------
+void TexturePVRETC2A1v3::onEnter()
+{
+    TextureDemo::onEnter();
+    CCSize s = CCDirector::sharedDirector()->getWinSize();
+    
+    CCSprite *img = CCSprite::create("Images/test_image_etc2_rgba1_v3.pvr");
+    
+    if (img)
+    {
+        img->setPosition(ccp(s.width/2.0f, s.height/2.0f));
+        addChild(img);
+    }
+    
+    CCTextureCache::sharedTextureCache()->dumpCachedTextureInfo();
+}
+
+string TexturePVRETC2A1v3::title()
+{
+    return "PVR + ETC2 RGB A1 Test";
+}
+
+string TexturePVRETC2A1v3::subtitle()
+{
+    return "Decoded to RGBA8888. 1 bit alpha";
+}
+
+//------------------------------------------------------------------
+//
+// TexturePVRETC2RGBAv3
+// Image generated from test_image.png
+//
+//------------------------------------------------------------------
+void TexturePVRETC2RGBAv3::onEnter()
+{
+    TextureDemo::onEnter();
+    CCSize s = CCDirector::sharedDirector()->getWinSize();
+    
+    CCSprite *img = CCSprite::create("Images/test_image_etc2_rgba_v3.pvr");
+    
+    if (img)
+    {
+        img->setPosition(ccp(s.width/2.0f, s.height/2.0f));
+        addChild(img);
+    }
+    
+    CCTextureCache::sharedTextureCache()->dumpCachedTextureInfo();
+}
+
+string TexturePVRETC2RGBAv3::title()
+{
+    return "PVR + ETC2 RGBA Test";
+}
+
+string TexturePVRETC2RGBAv3::subtitle()
+{
+    return "Decoded to RGBA8888";
+}
+
 //------------------------------------------------------------------
 //
 // TexturePVRBadEncoding
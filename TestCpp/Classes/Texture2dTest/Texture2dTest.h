@@ -262,6 +262,46 @@ public:
     virtual void onEnter();
 };
 
+class TexturePVRBC1v3 : public TextureDemo
+{
+public:
+    virtual std::string title();
+    virtual std::string subtitle();
+    virtual void onEnter();
+};
+
+class TexturePVRBC3v3 : public TextureDemo
+{
+public:
+    virtual std::string title();
+    virtual std::string subtitle();
+    virtual void onEnter();
+};
+
+class TexturePVRETC2v3 : public TextureDemo
+{
+public:
+    virtual std::string title();
+    virtual std::string subtitle();
+    virtual void onEnter();
+};
+
+class TexturePVRETC2A1v3 : public TextureDemo
+{
+public:
+    virtual std::string title();
+    virtual std::string subtitle();
+    virtual void onEnter();
+};
+
+class TexturePVRETC2RGBAv3 : public TextureDemo
+{
+public:
+    virtual std::string title();
+    virtual std::string subtitle();
+    virtual void onEnter();
+};
+
 class TexturePVRBadEncoding : public TextureDemo
 {
 public: